@@ -15,7 +15,10 @@
  *  - Adjustable image quality (HIGH, MEDIUM, LOW)
  *  - HTTPS upload to Azure Blob Storage with SAS token authentication
  *  - Real-time progress reporting via serial monitor
- *  - Buffered streaming to prevent memory overflow
+ *  - Burst FIFO reads with buffered streaming to prevent memory overflow
+ *  - Camera reads overlap network writes (reader task on core 0, writer on core 1)
+ *  - Exact-length uploads: only real JPEG bytes are sent (Put Blob or Put Block + Put Block List)
+ *  - Capture queue in PSRAM: 'u' commands return right after capture, a background task uploads
  */
 
 // Include necessary libraries for camera, networking, and SPI communication
@@ -24,12 +27,26 @@
 #include <SPI.h>               // SPI protocol for camera communication
 #include <WiFi.h>              // WiFi connectivity (ESP32)
 #include <WiFiClientSecure.h>  // HTTPS secure connection support
+#include <esp_heap_caps.h>     // PSRAM-aware allocation for the upload block buffer
 #include "io_config.h"         // External config with WiFi and Azure credentials
 
 // Function declarations (prototypes) - defined later in this file
 void captureImage(CAM_IMAGE_MODE resolution);         // Capture and stream image locally
+void captureOrQueue(CAM_IMAGE_MODE resolution);       // Queue the upload if possible, else upload now
 void captureAndUpload(CAM_IMAGE_MODE resolution);    // Capture image and upload to Azure
 bool ensureWifi();                                     // Establish WiFi connection if needed
+uint32_t readJpegBlock(uint8_t* buffer, uint32_t capacity, uint8_t& prevByte, bool& foundEnd); // Burst-read one block
+void initUploadPipeline();                             // Create the pipeline queues and block buffer
+typedef bool (*PipelineSink)(const uint8_t* data, uint16_t length, void* context); // Consumes pipeline blocks
+uint32_t streamImagePipelined(PipelineSink sink, void* context, uint32_t imageSize, bool& foundEnd); // Overlap SPI and network
+bool uploadExactLength(WiFiClientSecure& client, const String& blobUrl, uint32_t imageSize, uint32_t& sent); // Only JPEG bytes
+bool uploadPadded(WiFiClientSecure& client, const String& blobUrl, uint32_t imageSize, uint32_t& sent);      // Zero-padded PUT
+void initCaptureQueue();                               // Start the queued uploader when PSRAM is present
+bool captureToQueue(CAM_IMAGE_MODE resolution);        // Capture into PSRAM for the uploader task
+void printCaptureQueueStats();                         // Queue depth, drops and oldest frame age
+void frameUploaderTask(void* param);                   // Background uploader for queued frames
+void lockSerialOutput();                               // Wait until Serial is not streaming JPEG bytes
+void unlockSerialOutput();                             // Release Serial for captureImage()
 // ==================== HARDWARE PIN CONFIGURATION ====================
 // ESP32 VSPI (Variable Speed SPI) pins for Arducam camera communication
 // These pins are used for the SPI bus that connects to the camera module
@@ -43,6 +60,10 @@ const int CS_PIN   = 5;   // Chip Select (GPIO 5)             - Enable/disable c
 // This object handles all camera-related operations (capture, settings, etc)
 Arducam_Mega myCAM(CS_PIN);
 
+// Largest block the Arducam_Mega library moves in one readBuff() burst
+// (its length parameter is a uint8_t, so larger blocks are built from several bursts)
+const uint8_t CAM_BURST_LENGTH = 255;
+
 // ==================== GLOBAL VARIABLES ====================
 // Counter to generate unique filenames for each captured image
 // Incremented after each upload to Azure; used in filename: image_1, image_2, etc
@@ -52,6 +73,116 @@ static uint32_t captureCounter = 0;
 // Format: {StorageAccountName}.blob.core.windows.net
 // Example: mystorageaccount.blob.core.windows.net
 String azureBlobHost = String(AZURE_STORAGE_ACCOUNT) + ".blob.core.windows.net";
+
+// ==================== UPLOAD PIPELINE ====================
+// Producer/consumer pipeline between the camera and the HTTPS socket
+// A reader task drains the camera FIFO into a ring of buffers ("slots") while
+// captureAndUpload() encrypts and sends slots that are already full
+// Without it the SPI bus sits idle during TLS writes, and the network sits idle during SPI reads
+const uint8_t PIPELINE_SLOTS = 4;                     // Number of buffers in the ring
+const uint16_t PIPELINE_SLOT_SIZE = 4096;             // 4KB per buffer (16KB total)
+const BaseType_t PIPELINE_READER_CORE = 0;            // loop() runs on core 1, so read on core 0
+const UBaseType_t PIPELINE_READER_PRIORITY = 2;       // Reader task priority
+const uint32_t PIPELINE_READER_STACK = 4096;          // Reader task stack size (bytes)
+const unsigned long PIPELINE_STALL_TIMEOUT_MS = 5000; // Give up if one side waits this long
+
+// One buffer in the ring
+struct PipelineSlot {
+  uint8_t data[PIPELINE_SLOT_SIZE];  // JPEG bytes
+  uint16_t length;                   // Valid bytes in data
+  bool last;                         // True for the final slot of the image
+};
+
+// Shared state between the reader task and the writer
+// Stall counters show which side is the bottleneck:
+//   reader stalls - camera waited for a free slot (network is slower)
+//   writer stalls - network waited for a full slot (camera is slower)
+struct UploadPipeline {
+  PipelineSlot slots[PIPELINE_SLOTS];
+  QueueHandle_t freeSlots;       // Slot numbers the reader may fill
+  QueueHandle_t readySlots;      // Slot numbers the writer may send
+  SemaphoreHandle_t readerDone;  // Given by the reader task just before it exits
+  uint32_t imageSize;            // Camera-reported FIFO length
+  volatile bool abort;           // Set by the writer to stop the reader early
+  bool foundEnd;                 // JPEG end marker was found
+  uint32_t readerStalls;         // Times the reader had to wait
+  uint32_t readerStallUs;        // Total reader wait time (microseconds)
+  uint32_t writerStalls;         // Times the writer had to wait
+  uint32_t writerStallUs;        // Total writer wait time (microseconds)
+};
+
+// Kept global so the 16KB ring does not live on the loop() stack
+UploadPipeline uploadPipeline;
+
+// ==================== EXACT-LENGTH UPLOAD ====================
+// The FIFO length reported by the camera is often well above the real JPEG size
+// Instead of declaring it as Content-Length and padding with zeros, bytes are collected
+// in a block buffer (PSRAM when available) and every block is sent with its exact length:
+//   - JPEG fits in one block  -> one Put Blob request
+//   - larger JPEG             -> Put Block for each block, then one Put Block List
+// Block IDs are 8 letters/digits (blk00000, blk00001, ...) - valid Base64 and URL-safe
+const bool UPLOAD_EXACT_LENGTH = true;                 // false = old zero-padded single PUT
+const uint32_t UPLOAD_BLOCK_SIZE = 64 * 1024;           // 64KB per block (multiple of PIPELINE_SLOT_SIZE)
+const unsigned long UPLOAD_RESPONSE_TIMEOUT_MS = 10000; // Wait up to 10 seconds per response
+const unsigned int HTTP_ERROR_BODY_MAX_CHARS = 1024;    // Longest Azure error body echoed to Serial
+uint8_t* uploadBlockBuffer = nullptr;                   // Allocated once in initUploadPipeline()
+
+// State of one exact-length upload
+struct BlockUpload {
+  WiFiClientSecure* client;  // Connection to Azure
+  const String* blobUrl;     // /{container}/{blob name} (no query string)
+  uint32_t blockFill;        // Bytes collected in uploadBlockBuffer
+  uint16_t blockCount;       // Blocks already stored with Put Block
+  bool failed;               // A Put Block request failed
+};
+
+// ==================== CAPTURE QUEUE ====================
+// With PSRAM, 'u' commands only capture: the JPEG is copied into a bounded queue of frames
+// and a background task uploads them oldest first, so the next capture never waits for Azure
+// While Azure (or WiFi) is unreachable, frames wait in the queue and are sent back-to-back
+// on one open connection as soon as the link returns
+// When the queue is full (or PSRAM runs out) FRAME_QUEUE_POLICY decides what is lost:
+//   DROP_OLDEST - discard the oldest waiting frame (keeps the latest scene)
+//   DROP_NEWEST - discard the new capture (keeps the history up to the outage)
+// The frame currently being uploaded is never dropped
+enum FrameDropPolicy { DROP_OLDEST, DROP_NEWEST };
+const uint8_t FRAME_QUEUE_DEPTH = 6;                     // Frames kept in PSRAM at most
+const FrameDropPolicy FRAME_QUEUE_POLICY = DROP_OLDEST;  // What to lose when the queue is full
+const uint8_t FRAME_UPLOAD_MAX_ATTEMPTS = 3;             // PUT attempts per frame before backing off
+const unsigned long FRAME_UPLOAD_RETRY_MS = 5000;        // Pause after a failed frame before retrying
+const uint32_t FRAME_UPLOADER_STACK = 8192;              // Uploader task stack (TLS needs room)
+const UBaseType_t FRAME_UPLOADER_PRIORITY = 1;           // Same priority as loop()
+
+// Life of a queue slot: FREE -> QUEUED (captured) -> UPLOADING -> FREE (uploaded)
+enum FrameSlotState : uint8_t { FRAME_FREE, FRAME_QUEUED, FRAME_UPLOADING };
+
+// One captured JPEG waiting for upload
+struct QueuedFrame {
+  uint8_t* data;             // JPEG bytes in PSRAM
+  uint32_t length;           // Exact JPEG length
+  unsigned long capturedMs;  // millis() at capture, for age reporting
+  uint32_t sequence;         // Capture order - lowest queued sequence is uploaded first
+  FrameSlotState state;      // Slot life-cycle state
+  char blobName[40];         // image_{counter}_{timestamp}.jpg
+};
+
+// Counters printed after every capture and upload
+struct CaptureQueueStats {
+  uint32_t captured;        // Frames added to the queue
+  uint32_t uploaded;        // Frames Azure accepted
+  uint32_t droppedOldest;   // Waiting frames discarded to make room
+  uint32_t droppedNewest;   // New captures discarded because there was no room
+  uint32_t uploadFailures;  // Upload attempts that ended without 201 Created
+  uint8_t maxDepth;         // Most frames queued at once
+};
+
+QueuedFrame frameQueue[FRAME_QUEUE_DEPTH];
+CaptureQueueStats captureQueueStats;
+portMUX_TYPE frameQueueLock = portMUX_INITIALIZER_UNLOCKED;  // Guards frameQueue and the counters
+SemaphoreHandle_t frameQueued = NULL;      // Given after each capture to wake the uploader
+SemaphoreHandle_t serialStreamLock = NULL; // Held while captureImage() streams raw JPEG bytes
+bool captureQueueEnabled = false;          // Set by initCaptureQueue() when PSRAM is present
+uint32_t frameSequence = 0;                // Next sequence number - 1
 // ==================== SETUP FUNCTION ====================
 // Called once when the ESP32 powers on or resets
 // Purpose: Initialize hardware (serial, SPI, camera) and display welcome message
@@ -76,6 +207,12 @@ void setup() {
   // This performs handshake with camera and prepares it for operation
   myCAM.begin();
   Serial.println("SUCCESS! Camera initialized!");
+  
+  // Create the queues used to overlap camera reads with Azure uploads
+  initUploadPipeline();
+  
+  // Let 'u' commands return right after capture when PSRAM can hold queued frames
+  initCaptureQueue();
   Serial.println();
   
   // Display startup completed message
@@ -100,6 +237,7 @@ void setup() {
   Serial.println("    'u2' - Upload VGA to Azure");
   Serial.println("    'u3' - Upload 1080p to Azure");
   Serial.println("    'u4' - Upload 3MP to Azure");
+  Serial.println("    's' - Show upload queue status");
   Serial.println();
   Serial.println("  Quality Settings:");
   Serial.println("    'q' - Set quality HIGH (smaller files)");
@@ -153,32 +291,38 @@ void loop() {
           // Process the sub-command (resolution selection for upload)
           switch(subcmd) {
             case '1':
-              // Capture and upload at QVGA resolution
-              captureAndUpload(CAM_IMAGE_MODE_QVGA);
+              // Capture and upload at QVGA resolution (queued when PSRAM is present)
+              captureOrQueue(CAM_IMAGE_MODE_QVGA);
               break;
             case '2':
               // Capture and upload at VGA resolution
-              captureAndUpload(CAM_IMAGE_MODE_VGA);
+              captureOrQueue(CAM_IMAGE_MODE_VGA);
               break;
             case '3':
               // Capture and upload at 1080p resolution
-              captureAndUpload(CAM_IMAGE_MODE_FHD);
+              captureOrQueue(CAM_IMAGE_MODE_FHD);
               break;
             case '4':
               // Capture and upload at 3MP resolution
-              captureAndUpload(CAM_IMAGE_MODE_QXGA);
+              captureOrQueue(CAM_IMAGE_MODE_QXGA);
               break;
             default:
               // If second character is not 1-4, treat just 'u' as VGA upload
-              captureAndUpload(CAM_IMAGE_MODE_VGA);
+              captureOrQueue(CAM_IMAGE_MODE_VGA);
               break;
           }
         } else {
           // No second character available, default to VGA resolution
-          captureAndUpload(CAM_IMAGE_MODE_VGA);
+          captureOrQueue(CAM_IMAGE_MODE_VGA);
         }
         break;
       
+      // ===== UPLOAD QUEUE STATUS =====
+      case 's':
+      case 'S':
+        printCaptureQueueStats();
+        break;
+      
       // ===== IMAGE QUALITY COMMANDS =====
       case 'q':
       case 'Q':
@@ -215,8 +359,11 @@ bool ensureWifi() {
   }
   
   // WiFi not connected, attempt to establish connection
+  // The uploader task can get here too, so each message waits out a JPEG stream on Serial
+  lockSerialOutput();
   Serial.print("Connecting to WiFi: ");
   Serial.println(WIFI_SSID);
+  unlockSerialOutput();
   
   // Set WiFi mode to Station (STA) - connects to existing network
   WiFi.mode(WIFI_STA);
@@ -230,22 +377,465 @@ bool ensureWifi() {
   // Loop until connected or timeout (20 seconds = 20000 milliseconds)
   while (WiFi.status() != WL_CONNECTED && millis() - start < 20000) {
     delay(500);           // Wait half a second between status checks
+    lockSerialOutput();
     Serial.print('.');    // Print a dot to show progress
+    unlockSerialOutput();
   }
   
+  lockSerialOutput();
   Serial.println();  // New line after the progress dots
   
   // Check final connection status
-  if (WiFi.status() == WL_CONNECTED) {
+  bool connected = WiFi.status() == WL_CONNECTED;
+  if (connected) {
     // Connection successful - display IP address
     Serial.print("✓ WiFi connected. IP: ");
     Serial.println(WiFi.localIP());
-    return true;
   } else {
     // Connection failed after 20-second timeout
     Serial.println("✗ WiFi connect failed");
+  }
+  unlockSerialOutput();
+  return connected;
+}
+// ==================== READ JPEG BLOCK FUNCTION ====================
+// Purpose: Fill a buffer from the camera FIFO using burst reads and find the JPEG end marker
+// Parameters:
+//   buffer   - Destination buffer
+//   capacity - Maximum number of bytes to read into buffer
+//   prevByte - Last byte of the previous block; updated so the marker can straddle blocks
+//   foundEnd - Set to true when the JPEG end marker (0xFF 0xD9) is in this block
+// Returns: number of valid bytes in buffer (up to and including the end marker)
+uint32_t readJpegBlock(uint8_t* buffer, uint32_t capacity, uint8_t& prevByte, bool& foundEnd) {
+  uint32_t filled = 0;
+  
+  // Fill the buffer with as few SPI transactions as possible
+  while (filled < capacity) {
+    uint32_t chunk = capacity - filled;
+    if (chunk > CAM_BURST_LENGTH) {
+      chunk = CAM_BURST_LENGTH;
+    }
+    uint8_t got = myCAM.readBuff(buffer + filled, (uint8_t)chunk);
+    if (got == 0) {
+      break;  // FIFO is empty - return what we have
+    }
+    filled += got;
+  }
+  
+  // Scan the whole block for 0xFF 0xD9, including a 0xFF left over from the previous block
+  uint8_t last = prevByte;
+  for (uint32_t i = 0; i < filled; i++) {
+    if (last == 0xFF && buffer[i] == 0xD9) {
+      foundEnd = true;
+      prevByte = buffer[i];
+      return i + 1;  // Drop anything after the end marker
+    }
+    last = buffer[i];
+  }
+  
+  prevByte = last;
+  return filled;
+}
+// ==================== INIT UPLOAD PIPELINE FUNCTION ====================
+// Purpose: Create the queues and semaphore shared by the pipeline reader and writer
+// Called once from setup()
+void initUploadPipeline() {
+  uploadPipeline.freeSlots = xQueueCreate(PIPELINE_SLOTS, sizeof(uint8_t));
+  uploadPipeline.readySlots = xQueueCreate(PIPELINE_SLOTS, sizeof(uint8_t));
+  uploadPipeline.readerDone = xSemaphoreCreateBinary();
+  
+  // Block buffer for exact-length uploads - prefer PSRAM so internal RAM stays free for TLS
+  uploadBlockBuffer = (uint8_t*)heap_caps_malloc(UPLOAD_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (uploadBlockBuffer == nullptr) {
+    uploadBlockBuffer = (uint8_t*)malloc(UPLOAD_BLOCK_SIZE);
+  }
+  if (uploadBlockBuffer == nullptr) {
+    Serial.println("⚠ No memory for upload block buffer; using zero-padded uploads");
+  }
+}
+// ==================== PIPELINE READER TASK ====================
+// Purpose: Producer side of the pipeline - fill free slots from the camera FIFO
+// Runs on PIPELINE_READER_CORE until the JPEG ends, the FIFO is exhausted or the writer aborts
+// Parameters:
+//   param - Pointer to the UploadPipeline being filled
+void pipelineReaderTask(void* param) {
+  UploadPipeline* pipeline = (UploadPipeline*)param;
+  uint32_t remaining = pipeline->imageSize;  // Never read past the camera-reported length
+  uint8_t prevByte = 0;                      // Lets the end marker straddle two slots
+  bool done = false;
+  
+  while (!done) {
+    // Take a free slot; if none is free the network is behind, so count a stall
+    uint8_t index;
+    if (xQueueReceive(pipeline->freeSlots, &index, 0) != pdPASS) {
+      pipeline->readerStalls++;
+      unsigned long waitStart = micros();
+      BaseType_t got = xQueueReceive(pipeline->freeSlots, &index, pdMS_TO_TICKS(PIPELINE_STALL_TIMEOUT_MS));
+      pipeline->readerStallUs += micros() - waitStart;
+      if (got != pdPASS) {
+        break;  // Writer stopped taking slots
+      }
+    }
+    if (pipeline->abort) {
+      break;  // Writer gave up (e.g. socket error)
+    }
+    
+    // Fill the slot with one burst-read block
+    PipelineSlot& slot = pipeline->slots[index];
+    uint32_t wanted = remaining < PIPELINE_SLOT_SIZE ? remaining : PIPELINE_SLOT_SIZE;
+    slot.length = readJpegBlock(slot.data, wanted, prevByte, pipeline->foundEnd);
+    remaining -= slot.length;
+    
+    // Hand the slot to the writer
+    done = pipeline->foundEnd || remaining == 0 || slot.length == 0;
+    slot.last = done;
+    xQueueSend(pipeline->readySlots, &index, portMAX_DELAY);
+  }
+  
+  // Tell the writer the slots are no longer in use, then delete this task
+  xSemaphoreGive(pipeline->readerDone);
+  vTaskDelete(NULL);
+}
+// ==================== STREAM IMAGE PIPELINED FUNCTION ====================
+// Purpose: Consumer side of the pipeline - pass full slots to a sink while the reader refills
+// Parameters:
+//   sink      - Called with each full slot (socket write or block collection); false aborts
+//   context   - Passed through to sink
+//   imageSize - Camera-reported FIFO length
+//   foundEnd  - Set to true when the JPEG end marker was found
+// Returns: number of JPEG bytes accepted by the sink
+uint32_t streamImagePipelined(PipelineSink sink, void* context, uint32_t imageSize, bool& foundEnd) {
+  UploadPipeline& pipeline = uploadPipeline;
+  
+  // Reset shared state - every slot starts out free
+  xQueueReset(pipeline.freeSlots);
+  xQueueReset(pipeline.readySlots);
+  xSemaphoreTake(pipeline.readerDone, 0);
+  for (uint8_t i = 0; i < PIPELINE_SLOTS; i++) {
+    xQueueSend(pipeline.freeSlots, &i, 0);
+  }
+  pipeline.imageSize = imageSize;
+  pipeline.abort = false;
+  pipeline.foundEnd = false;
+  pipeline.readerStalls = 0;
+  pipeline.readerStallUs = 0;
+  pipeline.writerStalls = 0;
+  pipeline.writerStallUs = 0;
+  
+  // Start the reader on the other core
+  if (xTaskCreatePinnedToCore(pipelineReaderTask, "CamReader", PIPELINE_READER_STACK, &pipeline,
+                              PIPELINE_READER_PRIORITY, NULL, PIPELINE_READER_CORE) != pdPASS) {
+    Serial.println("✗ Failed to start camera reader task");
+    return 0;
+  }
+  
+  uint32_t sent = 0;             // Track bytes sent so far
+  uint32_t nextProgress = 5000;  // Show progress every 5000 bytes sent
+  while (true) {
+    // Take a full slot; if none is ready the camera is behind, so count a stall
+    uint8_t index;
+    if (xQueueReceive(pipeline.readySlots, &index, 0) != pdPASS) {
+      pipeline.writerStalls++;
+      unsigned long waitStart = micros();
+      BaseType_t got = xQueueReceive(pipeline.readySlots, &index, pdMS_TO_TICKS(PIPELINE_STALL_TIMEOUT_MS));
+      pipeline.writerStallUs += micros() - waitStart;
+      if (got != pdPASS) {
+        Serial.println("✗ Camera reader stalled");
+        pipeline.abort = true;
+        break;
+      }
+    }
+    
+    // Hand the whole slot to the sink in one call
+    PipelineSlot& slot = pipeline.slots[index];
+    bool last = slot.last;
+    if (slot.length == 0) {
+      Serial.println("✗ Camera FIFO returned no data");
+    } else if (!sink(slot.data, slot.length, context)) {
+      pipeline.abort = true;
+      last = true;
+    } else {
+      sent += slot.length;
+    }
+    
+    // Give the slot back to the reader
+    xQueueSend(pipeline.freeSlots, &index, 0);
+    
+    // Show progress every 5000 bytes sent
+    while (sent >= nextProgress) {
+      Serial.print(".");
+      nextProgress += 5000;
+    }
+    if (last) {
+      break;
+    }
+  }
+  
+  // Wait for the reader task to exit before the slots are reused
+  xSemaphoreTake(pipeline.readerDone, portMAX_DELAY);
+  foundEnd = pipeline.foundEnd && !pipeline.abort;
+  return sent;
+}
+// ==================== SEND PUT REQUEST FUNCTION ====================
+// Purpose: Send one HTTP PUT request to Azure on an already open connection
+// Parameters:
+//   client       - Connected HTTPS client
+//   pathAndQuery - Request path including the SAS token query string
+//   extraHeaders - Additional header lines, each ending in "\r\n" (may be empty)
+//   body         - Request body, or nullptr if the caller streams the body itself
+//   length       - Value for the Content-Length header
+// Returns: false if the socket did not accept the whole body
+bool sendPutRequest(WiFiClientSecure& client, const String& pathAndQuery, const char* extraHeaders,
+                    const uint8_t* body, uint32_t length) {
+  // Request line and Host header (required by HTTP/1.1)
+  client.print("PUT ");
+  client.print(pathAndQuery);
+  client.println(" HTTP/1.1");
+  client.print("Host: ");
+  client.println(azureBlobHost);
+  
+  // Azure validates that the received data matches Content-Length exactly
+  client.print("Content-Length: ");
+  client.println(length);
+  client.print(extraHeaders);
+  
+  // Keep the connection open - block uploads send several requests on it
+  client.println("Connection: keep-alive");
+  
+  // Empty line marks end of headers, beginning of body
+  client.println();
+  
+  if (body == nullptr || length == 0) {
+    return true;
+  }
+  return client.write(body, length) == length;
+}
+// ==================== READ HTTP RESPONSE FUNCTION ====================
+// Purpose: Read one HTTP response from Azure
+// Reads exactly Content-Length body bytes so the connection can be used for the next request
+// Headers and body are only printed when the request failed (to diagnose the problem)
+// Parameters:
+//   client - Connected HTTPS client
+// Returns: HTTP status code (e.g. 201), or -1 on timeout
+int readHttpResponse(WiFiClientSecure& client) {
+  // Wait up to UPLOAD_RESPONSE_TIMEOUT_MS for Azure to respond
+  unsigned long start = millis();
+  while (!client.available() && client.connected() && millis() - start < UPLOAD_RESPONSE_TIMEOUT_MS) {
+    delay(5);
+  }
+  if (!client.available()) {
+    lockSerialOutput();
+    Serial.println("✗ No response from server (timeout)");
+    unlockSerialOutput();
+    return -1;
+  }
+  
+  // Read the HTTP status line, e.g. "HTTP/1.1 201 Created"
+  String statusLine = client.readStringUntil('\n');
+  statusLine.trim();
+  int statusCode = statusLine.length() >= 12 ? statusLine.substring(9, 12).toInt() : -1;
+  bool failed = statusCode < 200 || statusCode >= 300;
+  if (failed) {
+    lockSerialOutput();
+    Serial.print("Azure response: ");
+    Serial.println(statusLine);
+    unlockSerialOutput();
+  }
+  
+  // Read headers up to the empty line, remembering the body length
+  long contentLength = 0;
+  while (client.connected() || client.available()) {
+    String line = client.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) {
+      break;  // End of headers
+    }
+    if (line.substring(0, 15).equalsIgnoreCase("Content-Length:")) {
+      contentLength = line.substring(15).toInt();
+    }
+    if (failed) {
+      lockSerialOutput();
+      Serial.print("  ");
+      Serial.println(line);
+      unlockSerialOutput();
+    }
+  }
+  
+  // Read the body - Azure error responses explain the problem in XML
+  // It is collected first so Serial is only held for the print, not while the body arrives
+  String errorBody;
+  start = millis();
+  while (contentLength > 0 && millis() - start < UPLOAD_RESPONSE_TIMEOUT_MS) {
+    int c = client.read();
+    if (c < 0) {
+      delay(1);  // Body not arrived yet
+      continue;
+    }
+    if (failed && errorBody.length() < HTTP_ERROR_BODY_MAX_CHARS) {
+      errorBody += (char)c;
+    }
+    contentLength--;
+  }
+  if (failed) {
+    lockSerialOutput();
+    Serial.println(errorBody);
+    unlockSerialOutput();
+  }
+  return statusCode;
+}
+// ==================== CLIENT SINK FUNCTION ====================
+// Purpose: Pipeline sink that writes each block straight to the socket (padded mode)
+bool clientSink(const uint8_t* data, uint16_t length, void* context) {
+  WiFiClientSecure* client = (WiFiClientSecure*)context;
+  if (client->write(data, length) != length) {
+    Serial.println("✗ Socket write failed");
+    return false;
+  }
+  return true;
+}
+// ==================== FLUSH UPLOAD BLOCK FUNCTION ====================
+// Purpose: Store the collected block in Azure with Put Block and start a new block
+// Parameters:
+//   upload - Exact-length upload state
+// Returns: true if Azure returned 201 Created
+bool flushUploadBlock(BlockUpload& upload) {
+  // Block IDs must all have the same length: blk00000, blk00001, ...
+  char blockId[9];
+  snprintf(blockId, sizeof(blockId), "blk%05u", (unsigned)upload.blockCount);
+  String target = *upload.blobUrl + "?comp=block&blockid=" + blockId + "&" + String(AZURE_SAS_TOKEN);
+  
+  if (!sendPutRequest(*upload.client, target, "", uploadBlockBuffer, upload.blockFill) ||
+      readHttpResponse(*upload.client) != 201) {
+    Serial.print("✗ Put Block ");
+    Serial.print(blockId);
+    Serial.println(" failed");
+    upload.failed = true;
     return false;
   }
+  upload.blockCount++;
+  upload.blockFill = 0;
+  return true;
+}
+// ==================== BLOCK SINK FUNCTION ====================
+// Purpose: Pipeline sink that collects bytes into uploadBlockBuffer (exact-length mode)
+// A full block is stored with Put Block; the last partial block is left for the caller
+bool blockSink(const uint8_t* data, uint16_t length, void* context) {
+  BlockUpload* upload = (BlockUpload*)context;
+  while (length > 0) {
+    // Copy as much as fits in the current block
+    uint32_t room = UPLOAD_BLOCK_SIZE - upload->blockFill;
+    uint32_t n = length < room ? length : room;
+    memcpy(uploadBlockBuffer + upload->blockFill, data, n);
+    upload->blockFill += n;
+    data += n;
+    length -= n;
+    
+    // Block full - send it to Azure
+    if (upload->blockFill == UPLOAD_BLOCK_SIZE && !flushUploadBlock(*upload)) {
+      return false;
+    }
+  }
+  return true;
+}
+// ==================== UPLOAD EXACT LENGTH FUNCTION ====================
+// Purpose: Upload only the real JPEG bytes (nothing after the 0xFF 0xD9 end marker)
+// Parameters:
+//   client    - Connected HTTPS client
+//   blobUrl   - /{container}/{blob name} without query string
+//   imageSize - Camera-reported FIFO length (upper bound on the JPEG size)
+//   sent      - Set to the number of JPEG bytes uploaded
+// Returns: true if Azure accepted the blob
+bool uploadExactLength(WiFiClientSecure& client, const String& blobUrl, uint32_t imageSize, uint32_t& sent) {
+  // Collect the JPEG into blocks; full blocks are sent while the camera keeps reading
+  BlockUpload upload = {&client, &blobUrl, 0, 0, false};
+  bool foundEnd = false;
+  sent = streamImagePipelined(blockSink, &upload, imageSize, foundEnd);
+  if (upload.failed || sent == 0) {
+    return false;
+  }
+  if (foundEnd) {
+    Serial.println("✓ Found JPEG end marker");
+  } else {
+    Serial.println("⚠ JPEG end marker not found; uploading FIFO contents");
+  }
+  
+  // Small image: the whole JPEG is in one block - a single Put Blob with its exact length
+  if (upload.blockCount == 0) {
+    Serial.println("Sending PUT request...");
+    String target = blobUrl + "?" + String(AZURE_SAS_TOKEN);
+    if (!sendPutRequest(client, target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n",
+                        uploadBlockBuffer, upload.blockFill)) {
+      Serial.println("✗ Socket write failed");
+      return false;
+    }
+    return readHttpResponse(client) == 201;
+  }
+  
+  // Large image: store the last (partial) block, then commit all blocks in order
+  if (upload.blockFill > 0 && !flushUploadBlock(upload)) {
+    return false;
+  }
+  Serial.print("Committing ");
+  Serial.print(upload.blockCount);
+  Serial.println(" blocks...");
+  
+  // Put Block List body: <BlockList><Latest>blk00000</Latest>...</BlockList>
+  String blockList = "<?xml version=\"1.0\" encoding=\"utf-8\"?><BlockList>";
+  char blockId[9];
+  for (uint16_t i = 0; i < upload.blockCount; i++) {
+    snprintf(blockId, sizeof(blockId), "blk%05u", (unsigned)i);
+    blockList += "<Latest>";
+    blockList += blockId;
+    blockList += "</Latest>";
+  }
+  blockList += "</BlockList>";
+  
+  // The content type is set on the committed blob with x-ms-blob-content-type
+  String target = blobUrl + "?comp=blocklist&" + String(AZURE_SAS_TOKEN);
+  if (!sendPutRequest(client, target, "x-ms-blob-content-type: image/jpeg\r\n",
+                      (const uint8_t*)blockList.c_str(), blockList.length())) {
+    Serial.println("✗ Socket write failed");
+    return false;
+  }
+  return readHttpResponse(client) == 201;
+}
+// ==================== UPLOAD PADDED FUNCTION ====================
+// Purpose: Upload with one PUT of imageSize bytes, padding with zeros after the JPEG end marker
+// Used when UPLOAD_EXACT_LENGTH is false or the block buffer could not be allocated
+// Parameters: same as uploadExactLength()
+// Returns: true if Azure returned 201 Created
+bool uploadPadded(WiFiClientSecure& client, const String& blobUrl, uint32_t imageSize, uint32_t& sent) {
+  // Send HTTP PUT headers with the camera-reported size as Content-Length
+  Serial.println("Sending PUT request...");
+  String target = blobUrl + "?" + String(AZURE_SAS_TOKEN);
+  sendPutRequest(client, target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n", nullptr, imageSize);
+  
+  // Stream the JPEG straight to the socket
+  bool foundEnd = false;
+  sent = streamImagePipelined(clientSink, &client, imageSize, foundEnd);
+  
+  if (foundEnd) {
+    Serial.println("✓ Found JPEG end marker");
+    
+    // Azure expects exactly imageSize bytes as declared in Content-Length
+    // If we found the JPEG end before imageSize, pad remaining with zeros
+    // (the reader task has exited, so slot 0 is free to use as a zero buffer)
+    uint8_t* padding = uploadPipeline.slots[0].data;
+    memset(padding, 0x00, PIPELINE_SLOT_SIZE);
+    while (sent < imageSize) {
+      uint32_t padLen = imageSize - sent;
+      if (padLen > PIPELINE_SLOT_SIZE) {
+        padLen = PIPELINE_SLOT_SIZE;
+      }
+      client.write(padding, padLen);
+      sent += padLen;
+    }
+  }
+  
+  // Make sure all data is transmitted from ESP32 to Azure, then wait for the response
+  client.flush();
+  Serial.println("Flushed data, waiting for response...");
+  return readHttpResponse(client) == 201;
 }
 // ==================== CAPTURE AND UPLOAD FUNCTION ====================
 // Purpose: Capture an image from camera and upload it to Azure Blob Storage
@@ -301,11 +891,10 @@ void captureAndUpload(CAM_IMAGE_MODE resolution) {
   // Get current milliseconds as timestamp for additional uniqueness
   uint32_t timestamp = millis();
   
-  // Construct the full Azure blob storage path with SAS token
-  // Format: /{container}/image_{counter}_{timestamp}.jpg?{SAS_TOKEN}
-  String azureBlobPath = "/" + String(AZURE_CONTAINER) + "/image_" + 
-                         String(captureCounter) + "_" + String(timestamp) + 
-                         ".jpg?" + String(AZURE_SAS_TOKEN);
+  // Construct the Azure blob path (the SAS token is added per request)
+  // Format: /{container}/image_{counter}_{timestamp}.jpg
+  String blobUrl = "/" + String(AZURE_CONTAINER) + "/image_" + 
+                   String(captureCounter) + "_" + String(timestamp) + ".jpg";
   
   // STEP 4: ESTABLISH HTTPS CONNECTION TO AZURE
   // Create a secure WiFi client for HTTPS communication
@@ -328,149 +917,57 @@ void captureAndUpload(CAM_IMAGE_MODE resolution) {
   
   Serial.println("✓ Connected to Azure");
   
-  // STEP 5: SEND HTTP PUT REQUEST HEADERS
-  // HTTP PUT is used to create/upload a blob to Azure storage
-  Serial.println("Sending PUT request...");
-  
-  // Send the request line: PUT {path} HTTP/1.1
-  client.print("PUT ");
-  client.print(azureBlobPath);
-  client.println(" HTTP/1.1");
-  
-  // Send the Host header (required by HTTP/1.1)
-  client.print("Host: ");
-  client.println(azureBlobHost);
-  
-  // Specify JPEG content type
-  client.println("Content-Type: image/jpeg");
-  
-  // Send exact image size so Azure knows how many bytes to expect
-  // This is critical - Azure validates the received data matches this length
-  client.print("Content-Length: ");
-  client.println(imageSize);
-  
-  // Azure-specific header: specify this is a block blob (as opposed to append blob)
-  client.println("x-ms-blob-type: BlockBlob");
-  
-  // Tell server to close connection after response
-  client.println("Connection: close");
-  
-  // Empty line marks end of headers, beginning of body
-  client.println();
-  
-  // STEP 6: STREAM IMAGE BYTES WITH BUFFERING
-  // Don't send all bytes at once - use buffering to avoid memory issues on ESP32
+  // STEP 5: STREAM IMAGE BYTES THROUGH THE PIPELINE
+  // A reader task burst-reads 4KB blocks from the camera while this function handles
+  // the blocks already read, so SPI and network work at the same time
   Serial.println("Streaming image bytes...");
   
-  uint32_t sent = 0;                    // Track bytes sent so far
-  uint8_t prevByte = 0;                 // Used to detect JPEG end marker (0xFF 0xD9)
-  const uint16_t BUFFER_SIZE = 4096;    // 4KB buffer for efficient streaming
-  uint8_t buffer[BUFFER_SIZE];          // Temporary buffer
-  uint16_t bufferPos = 0;               // Current position in buffer
-  
-  // Loop until all image bytes are sent
-  while (sent < imageSize) {
-    // Read one byte from camera's image buffer
-    uint8_t byte = myCAM.readByte();
-    
-    // Store byte in local buffer
-    buffer[bufferPos++] = byte;
-    sent++;
-    
-    // When buffer is full OR all data has been read, flush to socket
-    if (bufferPos >= BUFFER_SIZE || sent >= imageSize) {
-      // Send accumulated bytes to Azure
-      client.write(buffer, bufferPos);
-      bufferPos = 0;  // Reset buffer position
-    }
-    
-    // Show progress every 5000 bytes sent
-    if (sent % 5000 == 0) {
-      Serial.print(".");
-    }
-    
-    // JPEG format ends with specific 2-byte marker: 0xFF 0xD9
-    // Detect this to find the actual image boundary
-    if (prevByte == 0xFF && byte == 0xD9) {
-      Serial.println("✓ Found JPEG end marker");
-      
-      // Flush any remaining buffered data
-      if (bufferPos > 0) {
-        client.write(buffer, bufferPos);
-        bufferPos = 0;
-      }
-      
-      // Azure expects exactly imageSize bytes as declared in Content-Length
-      // If we found the JPEG end before imageSize, pad remaining with zeros
-      while (sent < imageSize) {
-        buffer[bufferPos++] = 0x00;  // Padding byte
-        sent++;
-        
-        // Flush buffer if full
-        if (bufferPos >= BUFFER_SIZE) {
-          client.write(buffer, bufferPos);
-          bufferPos = 0;
-        }
-      }
-      break;  // Exit the reading loop
-    }
-    
-    prevByte = byte;  // Save for next iteration
+  unsigned long streamStart = millis(); // Used to report streaming throughput
+  uint32_t sent = 0;                    // JPEG (or padded) bytes uploaded
+  bool success;                         // Azure accepted the blob
+  if (UPLOAD_EXACT_LENGTH && uploadBlockBuffer != nullptr) {
+    // Only real JPEG bytes go over the wire
+    success = uploadExactLength(client, blobUrl, imageSize, sent);
+  } else {
+    // Fallback: declare the FIFO length and pad with zeros
+    success = uploadPadded(client, blobUrl, imageSize, sent);
   }
   
-  // Flush any remaining bytes still in the buffer
-  if (bufferPos > 0) {
-    client.write(buffer, bufferPos);
-  }
+  // Report how fast the camera-to-Azure stream ran
+  unsigned long streamMs = millis() - streamStart;
   
-  // Display upload progress summary
+  // STEP 6: DISPLAY UPLOAD SUMMARY
   Serial.println();
   Serial.print("Sent ");
   Serial.print(sent);
-  Serial.println(" bytes");
+  Serial.print(" bytes in ");
+  Serial.print(streamMs);
+  Serial.print(" ms (");
+  Serial.print(streamMs > 0 ? (sent * 1000UL) / streamMs : sent);
+  Serial.println(" bytes/sec)");
   
-  // STEP 7: WAIT FOR AZURE RESPONSE
-  // Make sure all data is transmitted from ESP32 to Azure
-  client.flush();
-  Serial.println("Flushed data, waiting for response...");
-  
-  // Wait up to 10 seconds for Azure to respond
-  unsigned long timeout = millis();
-  while (!client.available() && millis() - timeout < 10000) {
-    delay(50);  // Check every 50ms
+  // Bandwidth and storage saved by not uploading the FIFO padding
+  if (sent < imageSize) {
+    Serial.print("  Skipped ");
+    Serial.print(imageSize - sent);
+    Serial.println(" bytes of FIFO padding");
   }
   
-  // Check if we received a response before timeout
-  if (!client.available()) {
-    Serial.println("✗ No response from server (timeout)");
-    client.stop();  // Close connection
-    Serial.println();
-    return;  // Exit function
-  }
-  
-  // STEP 8: PARSE AZURE RESPONSE
-  // Read the HTTP status line (first line of response)
-  String statusLine = client.readStringUntil('\n');
-  statusLine.trim();  // Remove whitespace
-  Serial.print("Azure response: ");
-  Serial.println(statusLine);
-  
-  // Read and display remaining response headers/body for debugging
-  // This helps diagnose any issues with the upload
-  while (client.available()) {
-    String line = client.readStringUntil('\n');
-    line.trim();
-    if (line.length() > 0) {
-      Serial.print("  ");
-      Serial.println(line);
-    }
-  }
+  // Show where the pipeline waited - the side with more stall time is the bottleneck
+  Serial.print("Pipeline stalls: reader ");
+  Serial.print(uploadPipeline.readerStalls);
+  Serial.print(" (");
+  Serial.print(uploadPipeline.readerStallUs / 1000);
+  Serial.print(" ms), writer ");
+  Serial.print(uploadPipeline.writerStalls);
+  Serial.print(" (");
+  Serial.print(uploadPipeline.writerStallUs / 1000);
+  Serial.print(" ms) -> bottleneck: ");
+  Serial.println(uploadPipeline.readerStallUs > uploadPipeline.writerStallUs ? "network" : "camera");
   
-  // STEP 9: VERIFY UPLOAD SUCCESS
-  // Azure returns HTTP 201 (Created) if blob was successfully uploaded
+  // STEP 7: VERIFY UPLOAD SUCCESS
+  // Azure returns HTTP 201 (Created) for every request if the blob was successfully uploaded
   // Any other code means upload failed
-  bool success = statusLine.startsWith("HTTP/1.1 201");
-  
   if (!success) {
     Serial.println("✗ Upload did not return 201 Created");
   } else {
@@ -488,6 +985,377 @@ void captureAndUpload(CAM_IMAGE_MODE resolution) {
   client.stop();
   Serial.println();
 }
+// ==================== CAPTURE OR QUEUE FUNCTION ====================
+// Purpose: Handle a 'u' command - queue the frame for the uploader task when the capture
+//          queue is running, otherwise capture and upload inline as before
+// Parameters:
+//   resolution - Image resolution mode (QVGA, VGA, FHD, or QXGA)
+void captureOrQueue(CAM_IMAGE_MODE resolution) {
+  if (captureQueueEnabled) {
+    captureToQueue(resolution);
+  } else {
+    captureAndUpload(resolution);
+  }
+}
+// ==================== INIT CAPTURE QUEUE FUNCTION ====================
+// Purpose: Start the background uploader if PSRAM is available to hold queued frames
+// Called once from setup(); without PSRAM the 'u' commands keep uploading inline
+void initCaptureQueue() {
+  if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) == 0) {
+    Serial.println("⚠ No PSRAM; uploads run inline");
+    return;
+  }
+  frameQueued = xSemaphoreCreateBinary();
+  serialStreamLock = xSemaphoreCreateMutex();
+  if (frameQueued == NULL || serialStreamLock == NULL ||
+      xTaskCreatePinnedToCore(frameUploaderTask, "FrameUpload", FRAME_UPLOADER_STACK, NULL,
+                              FRAME_UPLOADER_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS) {
+    Serial.println("⚠ Failed to start frame uploader; uploads run inline");
+    return;
+  }
+  captureQueueEnabled = true;
+  Serial.print("Upload queue: ");
+  Serial.print(FRAME_QUEUE_DEPTH);
+  Serial.println(FRAME_QUEUE_POLICY == DROP_OLDEST ? " frames in PSRAM, drop oldest when full"
+                                                    : " frames in PSRAM, drop newest when full");
+}
+// ==================== SERIAL OUTPUT LOCK FUNCTIONS ====================
+// Purpose: Keep uploader messages out of the raw JPEG bytes captureImage() streams on Serial
+// Take the lock only around the prints themselves, never across network I/O
+// Both are no-ops until initCaptureQueue() has created the lock
+void lockSerialOutput() {
+  if (serialStreamLock != NULL) {
+    xSemaphoreTake(serialStreamLock, portMAX_DELAY);
+  }
+}
+void unlockSerialOutput() {
+  if (serialStreamLock != NULL) {
+    xSemaphoreGive(serialStreamLock);
+  }
+}
+// ==================== PRINT CAPTURE QUEUE STATS FUNCTION ====================
+// Purpose: Show queue depth, drop counters and how long the oldest frame has been waiting
+void printCaptureQueueStats() {
+  if (!captureQueueEnabled) {
+    Serial.println("Upload queue disabled (no PSRAM)");
+    return;
+  }
+  
+  // Take a consistent snapshot under the lock, print it afterwards
+  uint8_t depth = 0;
+  unsigned long oldestMs = 0;
+  bool haveOldest = false;
+  portENTER_CRITICAL(&frameQueueLock);
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state != FRAME_FREE) {
+      depth++;
+      if (!haveOldest || (long)(frameQueue[i].capturedMs - oldestMs) < 0) {
+        oldestMs = frameQueue[i].capturedMs;
+        haveOldest = true;
+      }
+    }
+  }
+  CaptureQueueStats stats = captureQueueStats;
+  portEXIT_CRITICAL(&frameQueueLock);
+  
+  Serial.print("Queue: depth ");
+  Serial.print(depth);
+  Serial.print("/");
+  Serial.print(FRAME_QUEUE_DEPTH);
+  Serial.print(" (max ");
+  Serial.print(stats.maxDepth);
+  Serial.print("), oldest ");
+  Serial.print(haveOldest ? (millis() - oldestMs) / 1000 : 0);
+  Serial.print(" s | captured ");
+  Serial.print(stats.captured);
+  Serial.print(", uploaded ");
+  Serial.print(stats.uploaded);
+  Serial.print(", dropped ");
+  Serial.print(stats.droppedOldest);
+  Serial.print(" oldest / ");
+  Serial.print(stats.droppedNewest);
+  Serial.print(" newest, failed uploads ");
+  Serial.println(stats.uploadFailures);
+}
+// ==================== DETACH OLDEST QUEUED FRAME FUNCTION ====================
+// Purpose: Remove the oldest waiting (not uploading) frame to make room (DROP_OLDEST)
+// Must be called with frameQueueLock held; the caller frees the returned buffer
+// (heap functions must not run inside a critical section)
+// Parameters:
+//   slot - Set to the freed slot index, or -1 if nothing could be dropped
+// Returns: The dropped frame's PSRAM buffer, or nullptr
+uint8_t* detachOldestQueuedFrame(int& slot) {
+  slot = -1;
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state == FRAME_QUEUED &&
+        (slot < 0 || frameQueue[i].sequence < frameQueue[slot].sequence)) {
+      slot = i;
+    }
+  }
+  if (slot < 0) {
+    return nullptr;
+  }
+  uint8_t* data = frameQueue[slot].data;
+  frameQueue[slot].data = nullptr;
+  frameQueue[slot].state = FRAME_FREE;
+  captureQueueStats.droppedOldest++;
+  return data;
+}
+// ==================== UPLOAD QUEUED FRAME FUNCTION ====================
+// Purpose: Send one frame from PSRAM as a single exact-length Put Blob, with retries
+// Opens the connection only if it is not already open, so a backlog reuses one TLS session
+// Parameters:
+//   client - HTTPS client owned by the uploader task (may already be connected)
+//   frame  - Frame to upload
+// Returns: true if Azure returned 201 Created
+bool uploadQueuedFrame(WiFiClientSecure& client, const QueuedFrame& frame) {
+  String target = "/" + String(AZURE_CONTAINER) + "/" + frame.blobName + "?" + String(AZURE_SAS_TOKEN);
+  for (uint8_t attempt = 1; attempt <= FRAME_UPLOAD_MAX_ATTEMPTS; attempt++) {
+    if (!ensureWifi()) {
+      return false;  // Nothing to retry until WiFi is back
+    }
+    if (!client.connected()) {
+      client.stop();
+      client.setInsecure();
+      if (!client.connect(azureBlobHost.c_str(), 443)) {
+        lockSerialOutput();
+        Serial.println("✗ Connection to Azure failed");
+        unlockSerialOutput();
+        continue;
+      }
+    }
+    if (sendPutRequest(client, target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n",
+                       frame.data, frame.length) &&
+        readHttpResponse(client) == 201) {
+      return true;
+    }
+    // The socket may be half-way through a request - start the next attempt on a new one
+    client.stop();
+    delay(250 * attempt);
+  }
+  return false;
+}
+// ==================== FRAME UPLOADER TASK ====================
+// Purpose: Consumer side of the capture queue - upload queued frames oldest first
+// Sleeps until a frame is queued; a frame that fails stays queued and is retried later
+// Parameters:
+//   param - Unused
+void frameUploaderTask(void* param) {
+  WiFiClientSecure client;  // Kept open while a backlog drains
+  uint32_t batch = 0;       // Frames uploaded since the queue was last empty
+  
+  while (true) {
+    // Claim the oldest queued frame
+    int index = -1;
+    portENTER_CRITICAL(&frameQueueLock);
+    for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+      if (frameQueue[i].state == FRAME_QUEUED &&
+          (index < 0 || frameQueue[i].sequence < frameQueue[index].sequence)) {
+        index = i;
+      }
+    }
+    if (index >= 0) {
+      frameQueue[index].state = FRAME_UPLOADING;
+    }
+    portEXIT_CRITICAL(&frameQueueLock);
+    
+    // Queue empty - report the drained backlog, close the socket and sleep until the next capture
+    if (index < 0) {
+      if (batch > 1) {
+        lockSerialOutput();
+        Serial.print("✓ Drained backlog: ");
+        Serial.print(batch);
+        Serial.println(" frames uploaded back-to-back");
+        unlockSerialOutput();
+      }
+      batch = 0;
+      client.stop();
+      xSemaphoreTake(frameQueued, portMAX_DELAY);
+      continue;
+    }
+    
+    // Only this task touches an UPLOADING slot, so it can be read without the lock
+    // The fields printed afterwards are copied now: once the slot is FRAME_FREE, a capture can reuse it
+    QueuedFrame& frame = frameQueue[index];
+    char blobName[sizeof(frame.blobName)];
+    memcpy(blobName, frame.blobName, sizeof(blobName));
+    uint32_t length = frame.length;
+    unsigned long capturedMs = frame.capturedMs;
+    unsigned long uploadStart = millis();
+    bool success = uploadQueuedFrame(client, frame);
+    unsigned long uploadMs = millis() - uploadStart;
+    
+    uint8_t* uploaded = nullptr;
+    portENTER_CRITICAL(&frameQueueLock);
+    if (success) {
+      uploaded = frame.data;
+      frame.data = nullptr;
+      frame.state = FRAME_FREE;
+      captureQueueStats.uploaded++;
+    } else {
+      frame.state = FRAME_QUEUED;  // Keep it for the next attempt
+      captureQueueStats.uploadFailures++;
+    }
+    portEXIT_CRITICAL(&frameQueueLock);
+    
+    if (success) {
+      heap_caps_free(uploaded);
+      batch++;
+    }
+    // Serial is only held for the report, so a capture never waits on the network
+    lockSerialOutput();
+    if (success) {
+      Serial.print("✓ Uploaded ");
+      Serial.print(blobName);
+      Serial.print(" (");
+      Serial.print(length);
+      Serial.print(" bytes in ");
+      Serial.print(uploadMs);
+      Serial.print(" ms, ");
+      Serial.print(millis() - capturedMs);
+      Serial.println(" ms after capture)");
+    } else {
+      Serial.print("✗ Upload of ");
+      Serial.print(blobName);
+      Serial.println(" failed; frame kept for retry");
+    }
+    printCaptureQueueStats();
+    unlockSerialOutput();
+    
+    if (!success) {
+      vTaskDelay(pdMS_TO_TICKS(FRAME_UPLOAD_RETRY_MS));
+    }
+  }
+}
+// ==================== CAPTURE TO QUEUE FUNCTION ====================
+// Purpose: Capture a JPEG into PSRAM and queue it for the uploader task
+// Returns as soon as the frame is in memory - no network access here
+// Parameters:
+//   resolution - Image resolution mode (QVGA, VGA, FHD, or QXGA)
+// Returns: true if the frame was queued
+bool captureToQueue(CAM_IMAGE_MODE resolution) {
+  // STEP 1: CAPTURE IMAGE FROM CAMERA
+  CamStatus status = myCAM.takePicture(resolution, CAM_IMAGE_PIX_FMT_JPG);
+  if (status != CAM_ERR_SUCCESS) {
+    Serial.println("✗ Capture FAILED!");
+    Serial.print("Error code: ");
+    Serial.println(status);
+    return false;
+  }
+  delay(100);
+  uint32_t imageSize = myCAM.getTotalLength();
+  if (imageSize == 0) {
+    Serial.println("✗ Image size is 0, nothing to queue");
+    return false;
+  }
+  
+  // STEP 2: RESERVE PSRAM FOR THE FRAME
+  // Under DROP_OLDEST, waiting frames give way until the new one fits
+  uint8_t* data = (uint8_t*)heap_caps_malloc(imageSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  while (data == nullptr && FRAME_QUEUE_POLICY == DROP_OLDEST) {
+    int slot;
+    portENTER_CRITICAL(&frameQueueLock);
+    uint8_t* dropped = detachOldestQueuedFrame(slot);
+    portEXIT_CRITICAL(&frameQueueLock);
+    if (dropped == nullptr) {
+      break;  // Only the uploading frame is left
+    }
+    heap_caps_free(dropped);
+    data = (uint8_t*)heap_caps_malloc(imageSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  if (data == nullptr) {
+    portENTER_CRITICAL(&frameQueueLock);
+    captureQueueStats.droppedNewest++;
+    portEXIT_CRITICAL(&frameQueueLock);
+    Serial.println("✗ No PSRAM for frame; capture dropped");
+    printCaptureQueueStats();
+    return false;
+  }
+  
+  // STEP 3: BURST-READ THE JPEG INTO PSRAM (stops at the end marker)
+  uint32_t length = 0;
+  uint8_t prevByte = 0;
+  bool foundEnd = false;
+  while (length < imageSize && !foundEnd) {
+    uint32_t wanted = imageSize - length;
+    if (wanted > PIPELINE_SLOT_SIZE) {
+      wanted = PIPELINE_SLOT_SIZE;
+    }
+    uint32_t got = readJpegBlock(data + length, wanted, prevByte, foundEnd);
+    if (got == 0) {
+      break;  // FIFO exhausted
+    }
+    length += got;
+  }
+  if (length == 0) {
+    heap_caps_free(data);
+    Serial.println("✗ Camera FIFO returned no data");
+    return false;
+  }
+  
+  // STEP 4: ADD TO THE QUEUE, APPLYING THE DROP POLICY WHEN EVERY SLOT IS TAKEN
+  captureCounter++;
+  unsigned long capturedMs = millis();
+  uint8_t* rejected = nullptr;
+  uint8_t* dropped = nullptr;
+  portENTER_CRITICAL(&frameQueueLock);
+  int slot = -1;
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state == FRAME_FREE) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0 && FRAME_QUEUE_POLICY == DROP_OLDEST) {
+    dropped = detachOldestQueuedFrame(slot);
+  }
+  if (slot < 0) {
+    rejected = data;
+    captureQueueStats.droppedNewest++;
+  } else {
+    QueuedFrame& frame = frameQueue[slot];
+    frame.data = data;
+    frame.length = length;
+    frame.capturedMs = capturedMs;
+    frame.sequence = ++frameSequence;
+    frame.state = FRAME_QUEUED;
+    snprintf(frame.blobName, sizeof(frame.blobName), "image_%lu_%lu.jpg",
+             (unsigned long)captureCounter, capturedMs);
+    captureQueueStats.captured++;
+    uint8_t depth = 0;
+    for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+      if (frameQueue[i].state != FRAME_FREE) {
+        depth++;
+      }
+    }
+    if (depth > captureQueueStats.maxDepth) {
+      captureQueueStats.maxDepth = depth;
+    }
+  }
+  portEXIT_CRITICAL(&frameQueueLock);
+  
+  // Free outside the critical section
+  if (dropped != nullptr) {
+    heap_caps_free(dropped);
+  }
+  if (rejected != nullptr) {
+    heap_caps_free(rejected);
+    Serial.println("✗ Upload queue full; new frame dropped");
+    printCaptureQueueStats();
+    return false;
+  }
+  
+  Serial.print("✓ Queued image_");
+  Serial.print(captureCounter);
+  Serial.print("_");
+  Serial.print(capturedMs);
+  Serial.print(".jpg (");
+  Serial.print(length);
+  Serial.println(" bytes)");
+  printCaptureQueueStats();
+  xSemaphoreGive(frameQueued);
+  return true;
+}
 // ==================== CAPTURE IMAGE FUNCTION ====================
 // Purpose: Capture image from camera and stream it to serial port
 // Images can be captured and saved locally without uploading to Azure
@@ -513,6 +1381,9 @@ void captureImage(CAM_IMAGE_MODE resolution) {
   Serial.println("│");
   Serial.println("└─────────────────────────────────────┘");
   
+  // Keep the background uploader quiet while raw JPEG bytes go out on Serial
+  lockSerialOutput();
+  
   // Record the current time to measure capture duration
   unsigned long startTime = millis();
   
@@ -526,6 +1397,7 @@ void captureImage(CAM_IMAGE_MODE resolution) {
     Serial.print("Error code: ");
     Serial.println(status);
     Serial.println();
+    unlockSerialOutput();
     return;  // Exit function early - no image to display
   }
   
@@ -604,4 +1476,5 @@ void captureImage(CAM_IMAGE_MODE resolution) {
   Serial.println("END_IMAGE_DATA");
   Serial.println("─────────────────────────────────────");
   Serial.println();
+  unlockSerialOutput();
 }
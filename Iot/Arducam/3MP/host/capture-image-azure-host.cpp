@@ -0,0 +1,168 @@
+// =================================================
+// capture-image-azure-host.cpp
+// Linux tests for capture-image-azure's camera reads and exact-length upload.
+//
+// Overview:
+//   The sketch is compiled unchanged against shim/ and the LLM host shims
+//   (see the Makefile).  The camera FIFO and the Azure endpoint are fakes,
+//   so each case loads a known JPEG, runs one sketch function and checks
+//   exactly which bytes came out:
+//
+//     readJpegBlock        – end marker inside a burst, across blocks,
+//                            missing, and an empty FIFO;
+//     streamImagePipelined – whole JPEG through the reader task for small,
+//                            slot-straddling and multi-slot images, FIFO
+//                            padding dropped, and a failing sink that must
+//                            stop the reader without hanging the next run;
+//     uploadExactLength    – Put Blob, Put Block + Put Block List, and a
+//                            failed block or commit reported as a failure.
+//
+//   setup() is not called (it waits on WiFi); main() runs
+//   initUploadPipeline() itself.
+// =================================================
+#include "../capture-image-azure.cpp"
+#include "upload_test.h"
+
+static void loadCamera(const std::vector<uint8_t> &fifo) {
+  hostCameraFifo = fifo;
+  myCAM.takePicture(CAM_IMAGE_MODE_VGA, CAM_IMAGE_PIX_FMT_JPG);
+}
+
+static void testReadJpegBlock() {
+  uint8_t buffer[PIPELINE_SLOT_SIZE];
+
+  // Marker in the second 255-byte burst; padding after it is not returned
+  std::vector<uint8_t> jpeg = makeTestJpeg(256, 1);
+  loadCamera(withFifoPadding(jpeg, 100));
+  uint8_t prevByte = 0;
+  bool foundEnd = false;
+  uint32_t got = readJpegBlock(buffer, sizeof(buffer), prevByte, foundEnd);
+  CHECK(got == 256);
+  CHECK(foundEnd);
+  CHECK(memcmp(buffer, jpeg.data(), jpeg.size()) == 0);
+
+  // 0xFF ends the first block and 0xD9 starts the second
+  loadCamera(makeTestJpeg(PIPELINE_SLOT_SIZE + 1, 2));
+  prevByte = 0;
+  foundEnd = false;
+  got = readJpegBlock(buffer, PIPELINE_SLOT_SIZE, prevByte, foundEnd);
+  CHECK(got == PIPELINE_SLOT_SIZE);
+  CHECK(!foundEnd);
+  CHECK(prevByte == 0xFF);
+  got = readJpegBlock(buffer, PIPELINE_SLOT_SIZE, prevByte, foundEnd);
+  CHECK(got == 1);
+  CHECK(foundEnd);
+
+  // No marker: the FIFO is returned as is, then nothing
+  std::vector<uint8_t> noMarker = makeTestJpeg(1000, 3);
+  noMarker.back() = 0x00;
+  loadCamera(noMarker);
+  prevByte = 0;
+  foundEnd = false;
+  got = readJpegBlock(buffer, sizeof(buffer), prevByte, foundEnd);
+  CHECK(got == 1000);
+  CHECK(!foundEnd);
+  got = readJpegBlock(buffer, sizeof(buffer), prevByte, foundEnd);
+  CHECK(got == 0);
+  CHECK(!foundEnd);
+}
+
+struct CollectSink {
+  std::vector<uint8_t> bytes;
+  uint32_t calls;
+  uint32_t failOnCall;  // 0 = never fail
+};
+
+static bool collectSink(const uint8_t* data, uint16_t length, void* context) {
+  CollectSink* sink = (CollectSink*)context;
+  sink->calls++;
+  if (sink->calls == sink->failOnCall) {
+    return false;
+  }
+  sink->bytes.insert(sink->bytes.end(), data, data + length);
+  return true;
+}
+
+static void checkStreamed(size_t jpegLength, size_t padding, uint32_t seed) {
+  std::vector<uint8_t> jpeg = makeTestJpeg(jpegLength, seed);
+  std::vector<uint8_t> fifo = withFifoPadding(jpeg, padding);
+  loadCamera(fifo);
+  CollectSink sink = {{}, 0, 0};
+  bool foundEnd = false;
+  uint32_t sent = streamImagePipelined(collectSink, &sink, fifo.size(), foundEnd);
+  CHECK(foundEnd);
+  CHECK(sent == jpegLength);
+  CHECK(sink.bytes == jpeg);
+}
+
+static void testStreamImagePipelined() {
+  checkStreamed(1000, 0, 10);
+  checkStreamed(PIPELINE_SLOT_SIZE, 512, 11);
+  checkStreamed(PIPELINE_SLOT_SIZE + 1, 0, 12);
+  checkStreamed(50000, 3000, 13);
+
+  // No marker: every FIFO byte is passed on and foundEnd stays false
+  std::vector<uint8_t> noMarker = makeTestJpeg(20000, 14);
+  noMarker.back() = 0x00;
+  loadCamera(noMarker);
+  CollectSink sink = {{}, 0, 0};
+  bool foundEnd = true;
+  uint32_t sent = streamImagePipelined(collectSink, &sink, noMarker.size(), foundEnd);
+  CHECK(!foundEnd);
+  CHECK(sent == noMarker.size());
+  CHECK(sink.bytes == noMarker);
+
+  // A failing sink aborts: only the slots before it count, and the reader is gone afterwards
+  loadCamera(makeTestJpeg(60000, 15));
+  CollectSink failing = {{}, 0, 2};
+  foundEnd = true;
+  sent = streamImagePipelined(collectSink, &failing, 60000, foundEnd);
+  CHECK(!foundEnd);
+  CHECK(sent == PIPELINE_SLOT_SIZE);
+  checkStreamed(9000, 0, 16);
+}
+
+static bool uploadFromCamera(const std::vector<uint8_t> &fifo, const String &blobUrl, uint32_t &sent) {
+  loadCamera(fifo);
+  WiFiClientSecure client;
+  client.connect(azureBlobHost.c_str(), 443);
+  return uploadExactLength(client, blobUrl, fifo.size(), sent);
+}
+
+static void testUploadExactLength() {
+  // One block: a single Put Blob with only the JPEG bytes
+  hostAzure.reset();
+  std::vector<uint8_t> small = makeTestJpeg(30000, 20);
+  uint32_t sent = 0;
+  CHECK(uploadFromCamera(withFifoPadding(small, 2000), "/images/small.jpg", sent));
+  CHECK(sent == small.size());
+  CHECK(hostAzure.putBlocks == 0);
+  CHECK(hostAzure.blob("/images/small.jpg") == asString(small));
+
+  // Three blocks, the last partial, committed in order
+  hostAzure.reset();
+  std::vector<uint8_t> large = makeTestJpeg(2 * UPLOAD_BLOCK_SIZE + 5000, 21);
+  CHECK(uploadFromCamera(withFifoPadding(large, 4096), "/images/large.jpg", sent));
+  CHECK(sent == large.size());
+  CHECK(hostAzure.putBlocks == 3);
+  CHECK(hostAzure.blob("/images/large.jpg") == asString(large));
+
+  // This sketch does not retry: a failed block or commit fails the upload and commits nothing
+  hostAzure.reset();
+  hostAzure.inject("blockid=blk00001", 1, HOST_AZURE_HTTP_500);
+  CHECK(!uploadFromCamera(large, "/images/block-fails.jpg", sent));
+  CHECK(hostAzure.blob("/images/block-fails.jpg").empty());
+
+  hostAzure.reset();
+  hostAzure.inject("comp=blocklist", 1, HOST_AZURE_DROP_CONNECTION);
+  CHECK(!uploadFromCamera(large, "/images/commit-drops.jpg", sent));
+  CHECK(hostAzure.blob("/images/commit-drops.jpg").empty());
+}
+
+int main() {
+  initUploadPipeline();
+  testReadJpegBlock();
+  testStreamImagePipelined();
+  testUploadExactLength();
+  finishUploadTests("capture-image-azure");
+}
@@ -0,0 +1,73 @@
+// =================================================
+// Arducam_Mega.h (host shim)
+// A camera whose FIFO holds whatever the test loads into hostCameraFifo.
+//
+// Overview:
+//   takePicture() rewinds the FIFO, getTotalLength() reports its size (the
+//   JPEG plus any padding the test added after the end marker) and
+//   readBuff() hands it out like the library does: up to `length` bytes
+//   per burst, 0 once the FIFO is empty.  hostCameraFail makes the next
+//   takePicture() return that status instead.
+// =================================================
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+typedef enum {
+  CAM_IMAGE_MODE_QQVGA = 0,
+  CAM_IMAGE_MODE_QVGA = 1,
+  CAM_IMAGE_MODE_VGA = 2,
+  CAM_IMAGE_MODE_SVGA = 3,
+  CAM_IMAGE_MODE_HD = 4,
+  CAM_IMAGE_MODE_SXGAM = 5,
+  CAM_IMAGE_MODE_UXGA = 6,
+  CAM_IMAGE_MODE_FHD = 7,
+  CAM_IMAGE_MODE_QXGA = 8,
+} CAM_IMAGE_MODE;
+
+typedef enum {
+  CAM_IMAGE_PIX_FMT_JPG = 0x01,
+} CAM_IMAGE_PIX_FMT;
+
+typedef enum {
+  HIGH_QUALITY = 0,
+  DEFAULT_QUALITY = 1,
+  LOW_QUALITY = 2,
+} IMAGE_QUALITY;
+
+typedef enum {
+  CAM_ERR_SUCCESS = 0,
+  CAM_ERR_NO_CALLBACK = -1,
+} CamStatus;
+
+inline std::vector<uint8_t> hostCameraFifo;
+inline CamStatus hostCameraFail = CAM_ERR_SUCCESS;
+
+class Arducam_Mega {
+ public:
+  explicit Arducam_Mega(int) {}
+  CamStatus begin() { return CAM_ERR_SUCCESS; }
+  CamStatus setImageQuality(IMAGE_QUALITY) { return CAM_ERR_SUCCESS; }
+  CamStatus takePicture(CAM_IMAGE_MODE, CAM_IMAGE_PIX_FMT) {
+    CamStatus status = hostCameraFail;
+    hostCameraFail = CAM_ERR_SUCCESS;
+    readPosition_ = 0;
+    return status;
+  }
+  uint32_t getTotalLength() { return (uint32_t)hostCameraFifo.size(); }
+  uint8_t readBuff(uint8_t *buffer, uint8_t length) {
+    size_t available = hostCameraFifo.size() - readPosition_;
+    if (available < length) {
+      length = (uint8_t)available;
+    }
+    memcpy(buffer, hostCameraFifo.data() + readPosition_, length);
+    readPosition_ += length;
+    return length;
+  }
+  uint8_t readByte() { return readPosition_ < hostCameraFifo.size() ? hostCameraFifo[readPosition_++] : 0; }
+
+ private:
+  size_t readPosition_ = 0;
+};
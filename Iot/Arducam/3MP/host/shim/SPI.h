@@ -0,0 +1,8 @@
+// SPI.h (host shim): the camera shim needs no bus.
+#pragma once
+
+class SPIClass {
+ public:
+  void begin(int, int, int, int) {}
+};
+inline SPIClass SPI;
@@ -0,0 +1,196 @@
+// =================================================
+// WiFiClientSecure.h (host shim)
+// A TLS client connected to an in-process fake of the Azure Blob endpoint.
+//
+// Overview:
+//   Bytes the sketch writes are parsed as HTTP/1.1 PUT requests; once a
+//   request's body has arrived, hostAzure answers it and the response is
+//   read back through available()/read().  The fake keeps Put Block
+//   staging per blob, commits a Put Block List in list order and stores a
+//   Put Blob whole, so a test compares hostAzure.blobs with the JPEG it
+//   loaded into the camera.
+//
+//   Faults are injected by target substring: the next `count` requests
+//   whose target contains `match` get a 500 with an error body, or lose
+//   the connection before any response.  refuseConnects fails that many
+//   connect() calls.  Every client shares hostAzure, so the parallel
+//   upload workers see one endpoint.
+// =================================================
+#pragma once
+
+#include <WiFi.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "io_config.h"
+
+enum HostAzureFaultKind { HOST_AZURE_HTTP_500, HOST_AZURE_DROP_CONNECTION };
+
+struct HostAzureFault {
+  std::string match;
+  int count;
+  HostAzureFaultKind kind;
+};
+
+struct HostAzureServer {
+  std::mutex mutex;
+  std::map<std::string, std::map<std::string, std::string>> stagedBlocks;  // Blob path -> block ID -> bytes
+  std::map<std::string, std::string> blobs;                                // Committed blob path -> bytes
+  std::vector<HostAzureFault> faults;
+  int refuseConnects = 0;
+  uint32_t connects = 0;
+  uint32_t requests = 0;
+  uint32_t injectedFaults = 0;
+  uint32_t putBlocks = 0;
+
+  void reset() {
+    std::lock_guard<std::mutex> guard(mutex);
+    stagedBlocks.clear();
+    blobs.clear();
+    faults.clear();
+    refuseConnects = 0;
+    connects = requests = injectedFaults = putBlocks = 0;
+  }
+  void inject(const std::string &match, int count, HostAzureFaultKind kind) {
+    std::lock_guard<std::mutex> guard(mutex);
+    faults.push_back({match, count, kind});
+  }
+  std::string blob(const std::string &path) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto found = blobs.find(path);
+    return found == blobs.end() ? std::string() : found->second;
+  }
+
+  static std::string response(int status, const char *reason, const std::string &body) {
+    return "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\nx-ms-version: 2020-10-02\r\n\r\n" + body;
+  }
+  static std::string queryValue(const std::string &query, const std::string &key) {
+    size_t at = ("&" + query).find("&" + key + "=");
+    if (at == std::string::npos) {
+      return std::string();
+    }
+    size_t start = at + key.size() + 1;
+    return query.substr(start, query.find('&', start) - start);
+  }
+
+  // Answers one complete request; returns false when the connection should drop instead.
+  bool handle(const std::string &target, const std::string &headers, const std::string &body, std::string &reply) {
+    std::lock_guard<std::mutex> guard(mutex);
+    requests++;
+    for (HostAzureFault &fault : faults) {
+      if (fault.count > 0 && target.find(fault.match) != std::string::npos) {
+        fault.count--;
+        injectedFaults++;
+        if (fault.kind == HOST_AZURE_DROP_CONNECTION) {
+          return false;
+        }
+        reply = response(500, "Internal Server Error", "<Error><Code>InternalError</Code></Error>");
+        return true;
+      }
+    }
+    size_t queryStart = target.find('?');
+    std::string path = target.substr(0, queryStart);
+    std::string query = queryStart == std::string::npos ? std::string() : target.substr(queryStart + 1);
+    if (query.find(AZURE_SAS_TOKEN) == std::string::npos) {
+      reply = response(403, "Forbidden", "<Error><Code>AuthenticationFailed</Code></Error>");
+      return true;
+    }
+    std::string comp = queryValue(query, "comp");
+    if (comp == "block") {
+      stagedBlocks[path][queryValue(query, "blockid")] = body;
+      putBlocks++;
+    } else if (comp == "blocklist") {
+      std::string committed;
+      std::map<std::string, std::string> &staged = stagedBlocks[path];
+      for (size_t at = body.find("<Latest>"); at != std::string::npos; at = body.find("<Latest>", at)) {
+        at += 8;
+        std::string id = body.substr(at, body.find("</Latest>", at) - at);
+        auto block = staged.find(id);
+        if (block == staged.end()) {
+          reply = response(400, "Bad Request", "<Error><Code>InvalidBlockList</Code></Error>");
+          return true;
+        }
+        committed += block->second;
+      }
+      blobs[path] = committed;
+      staged.clear();
+    } else if (headers.find("x-ms-blob-type: BlockBlob") != std::string::npos) {
+      blobs[path] = body;
+    } else {
+      reply = response(400, "Bad Request", "<Error><Code>MissingRequiredHeader</Code></Error>");
+      return true;
+    }
+    reply = response(201, "Created", std::string());
+    return true;
+  }
+};
+inline HostAzureServer hostAzure;
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setInsecure() {}
+  int connect(const char *, uint16_t) override {
+    stop();
+    std::lock_guard<std::mutex> guard(hostAzure.mutex);
+    if (hostAzure.refuseConnects > 0) {
+      hostAzure.refuseConnects--;
+      return 0;
+    }
+    hostAzure.connects++;
+    connected_ = true;
+    return 1;
+  }
+  uint8_t connected() override { return connected_ ? 1 : 0; }
+  void stop() override {
+    connected_ = false;
+    request_.clear();
+    response_.clear();
+    responseRead_ = 0;
+  }
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    if (!connected_) {
+      return 0;
+    }
+    request_.append((const char *)buffer, size);
+    serveCompleteRequests();
+    return size;
+  }
+  int available() override { return (int)(response_.size() - responseRead_); }
+  int read() override { return available() > 0 ? (uint8_t)response_[responseRead_++] : -1; }
+  int peek() override { return available() > 0 ? (uint8_t)response_[responseRead_] : -1; }
+
+ private:
+  void serveCompleteRequests() {
+    while (connected_) {
+      size_t headerEnd = request_.find("\r\n\r\n");
+      if (headerEnd == std::string::npos) {
+        return;
+      }
+      std::string headers = request_.substr(0, headerEnd + 2);
+      size_t lengthAt = headers.find("Content-Length: ");
+      size_t length = lengthAt == std::string::npos ? 0 : strtoul(headers.c_str() + lengthAt + 16, nullptr, 10);
+      if (request_.size() < headerEnd + 4 + length) {
+        return;
+      }
+      std::string body = request_.substr(headerEnd + 4, length);
+      request_.erase(0, headerEnd + 4 + length);
+      size_t targetStart = headers.find(' ') + 1;
+      std::string target = headers.substr(targetStart, headers.find(' ', targetStart) - targetStart);
+      std::string reply;
+      if (!hostAzure.handle(target, headers, body, reply)) {
+        stop();
+        return;
+      }
+      response_ += reply;
+    }
+  }
+
+  bool connected_ = false;
+  std::string request_;
+  std::string response_;
+  size_t responseRead_ = 0;
+};
@@ -0,0 +1,8 @@
+// driver/adc.h (host shim): ADC setup for storage-web's unused noise input.
+#pragma once
+
+typedef enum { ADC_0db = 0, ADC_2_5db, ADC_6db, ADC_11db } adc_attenuation_t;
+
+inline void analogReadResolution(int) {}
+inline void analogSetPinAttenuation(int, adc_attenuation_t) {}
+inline int analogRead(int) { return 0; }
@@ -0,0 +1,8 @@
+// io_config.h (host shim): credentials for the fake Azure endpoint in WiFiClientSecure.h.
+#pragma once
+
+#define WIFI_SSID ""
+#define WIFI_PASSWORD ""
+#define AZURE_STORAGE_ACCOUNT "hostaccount"
+#define AZURE_CONTAINER "images"
+#define AZURE_SAS_TOKEN "sv=host&sig=test"
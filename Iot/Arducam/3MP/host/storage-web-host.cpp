@@ -0,0 +1,143 @@
+// =================================================
+// storage-web-host.cpp
+// Linux tests for storage-web's per-request retry and chunked parallel upload.
+//
+// Overview:
+//   The sketch is compiled unchanged against shim/ and the LLM host shims.
+//   Faults are injected into the fake Azure endpoint by request target, so
+//   a case can fail one block a fixed number of times however the two
+//   upload workers interleave, and then check what Azure committed:
+//
+//     putWithRetry          – success after a 500, a dropped connection
+//                             and a refused connect; giving up after
+//                             UPLOAD_BLOCK_MAX_ATTEMPTS;
+//     uploadChunkedParallel – Put Blob for one block, every block committed
+//                             in order for a multi-block frame, a failing
+//                             block retried on its own (retries and bytes
+//                             re-sent counted), a block that never succeeds
+//                             failing the frame, a dropped commit retried,
+//                             and the frame streamed from the camera.
+//
+//   setup() is not called (it waits on WiFi); main() runs
+//   initUploadPipeline() itself.
+// =================================================
+#include "../storage-web.cpp"
+#include "upload_test.h"
+
+static const char BLOB_HEADERS[] = "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n";
+
+static String blobTarget(const char* path) { return String(path) + "?" + String(AZURE_SAS_TOKEN); }
+
+static void testPutWithRetry() {
+  std::vector<uint8_t> body = makeTestJpeg(5000, 30);
+  AzureConnection& connection = azureConnections[0];
+  uint8_t attempts = 0;
+
+  // A 500, then a dropped connection, then success on the third connection
+  hostAzure.reset();
+  dropAzureConnection(connection);
+  hostAzure.inject("retry.jpg", 1, HOST_AZURE_HTTP_500);
+  hostAzure.inject("retry.jpg", 1, HOST_AZURE_DROP_CONNECTION);
+  CHECK(putWithRetry(connection, blobTarget("/images/retry.jpg"), BLOB_HEADERS, body.data(), body.size(), attempts));
+  CHECK(attempts == 3);
+  CHECK(hostAzure.connects == 3);
+  CHECK(hostAzure.blob("/images/retry.jpg") == asString(body));
+
+  // Refused connects use up attempts too
+  hostAzure.reset();
+  dropAzureConnection(connection);
+  hostAzure.refuseConnects = 2;
+  CHECK(putWithRetry(connection, blobTarget("/images/refused.jpg"), BLOB_HEADERS, body.data(), body.size(), attempts));
+  CHECK(attempts == 3);
+  CHECK(hostAzure.blob("/images/refused.jpg") == asString(body));
+
+  // A warm connection is reused: no new handshake
+  uint32_t connectsBefore = hostAzure.connects;
+  CHECK(putWithRetry(connection, blobTarget("/images/reused.jpg"), BLOB_HEADERS, body.data(), body.size(), attempts));
+  CHECK(attempts == 1);
+  CHECK(hostAzure.connects == connectsBefore);
+
+  // Every attempt fails: give up after the limit and leave nothing behind
+  hostAzure.reset();
+  hostAzure.inject("lost.jpg", UPLOAD_BLOCK_MAX_ATTEMPTS, HOST_AZURE_HTTP_500);
+  CHECK(!putWithRetry(connection, blobTarget("/images/lost.jpg"), BLOB_HEADERS, body.data(), body.size(), attempts));
+  CHECK(attempts == UPLOAD_BLOCK_MAX_ATTEMPTS);
+  CHECK(hostAzure.requests == UPLOAD_BLOCK_MAX_ATTEMPTS);
+  CHECK(hostAzure.blob("/images/lost.jpg").empty());
+}
+
+static bool uploadFrame(std::vector<uint8_t>& frame, const char* path, uint32_t& sent) {
+  String blobUrl = path;
+  return uploadChunkedParallel(frame.data(), blobUrl, frame.size(), false, sent);
+}
+
+static void testUploadChunkedParallel() {
+  // Frame that fits one block: a single Put Blob
+  hostAzure.reset();
+  std::vector<uint8_t> small = makeTestJpeg(30000, 40);
+  uint32_t sent = 0;
+  CHECK(uploadFrame(small, "/images/one-block.jpg", sent));
+  CHECK(sent == small.size());
+  CHECK(hostAzure.putBlocks == 0);
+  CHECK(hostAzure.blob("/images/one-block.jpg") == asString(small));
+
+  // Four blocks with a short tail, spread over both workers and committed in order
+  hostAzure.reset();
+  std::vector<uint8_t> frame = makeTestJpeg(3 * UPLOAD_BLOCK_SIZE + 3392, 41);
+  CHECK(uploadFrame(frame, "/images/four-blocks.jpg", sent));
+  CHECK(hostAzure.putBlocks == 4);
+  CHECK(chunkedUpload.retries == 0);
+  CHECK(hostAzure.blob("/images/four-blocks.jpg") == asString(frame));
+
+  // One block fails twice: only that block is sent again
+  hostAzure.reset();
+  hostAzure.inject("blockid=blk00002", 2, HOST_AZURE_HTTP_500);
+  CHECK(uploadFrame(frame, "/images/block-retried.jpg", sent));
+  CHECK(hostAzure.putBlocks == 4);
+  CHECK(chunkedUpload.retries == 2);
+  CHECK(chunkedUpload.retriedBytes == 2 * UPLOAD_BLOCK_SIZE);
+  CHECK(hostAzure.blob("/images/block-retried.jpg") == asString(frame));
+
+  // The tail block drops its connection once: retried bytes are the tail's length
+  hostAzure.reset();
+  hostAzure.inject("blockid=blk00003", 1, HOST_AZURE_DROP_CONNECTION);
+  CHECK(uploadFrame(frame, "/images/tail-retried.jpg", sent));
+  CHECK(chunkedUpload.retries == 1);
+  CHECK(chunkedUpload.retriedBytes == 3392);
+  CHECK(hostAzure.blob("/images/tail-retried.jpg") == asString(frame));
+
+  // A block that never succeeds fails the frame before anything is committed
+  hostAzure.reset();
+  hostAzure.inject("blockid=blk00001", UPLOAD_BLOCK_MAX_ATTEMPTS, HOST_AZURE_HTTP_500);
+  CHECK(!uploadFrame(frame, "/images/block-lost.jpg", sent));
+  CHECK(chunkedUpload.failed);
+  CHECK(hostAzure.blob("/images/block-lost.jpg").empty());
+
+  // The commit drops once and is retried on a fresh connection
+  hostAzure.reset();
+  hostAzure.inject("comp=blocklist", 1, HOST_AZURE_DROP_CONNECTION);
+  CHECK(uploadFrame(frame, "/images/commit-retried.jpg", sent));
+  CHECK(chunkedUpload.retries == 1);
+  CHECK(hostAzure.blob("/images/commit-retried.jpg") == asString(frame));
+
+  // From the camera: workers upload blocks while the pipeline is still reading
+  hostAzure.reset();
+  std::vector<uint8_t> jpeg = makeTestJpeg(2 * UPLOAD_BLOCK_SIZE + 777, 42);
+  hostCameraFifo = withFifoPadding(jpeg, 6000);
+  myCAM.takePicture(CAM_IMAGE_MODE_QXGA, CAM_IMAGE_PIX_FMT_JPG);
+  std::vector<uint8_t> psramFrame(hostCameraFifo.size());
+  String blobUrl = "/images/from-camera.jpg";
+  hostAzure.inject("blockid=blk00000", 1, HOST_AZURE_HTTP_500);
+  CHECK(uploadChunkedParallel(psramFrame.data(), blobUrl, hostCameraFifo.size(), true, sent));
+  CHECK(sent == jpeg.size());
+  CHECK(hostAzure.putBlocks == 3);
+  CHECK(chunkedUpload.retries == 1);
+  CHECK(hostAzure.blob("/images/from-camera.jpg") == asString(jpeg));
+}
+
+int main() {
+  initUploadPipeline();
+  testPutWithRetry();
+  testUploadChunkedParallel();
+  finishUploadTests("storage-web");
+}
@@ -0,0 +1,62 @@
+// =================================================
+// upload_test.h
+// Checks and test images shared by the Arducam upload tests.
+//
+// Overview:
+//   CHECK records a failure and keeps going, so one run reports every
+//   broken case; finishUploadTests() prints the tally and exits non-zero
+//   when anything failed.  makeTestJpeg() builds a JPEG-shaped buffer of
+//   an exact length: SOI, payload with no 0xFF 0xD9 inside it, then EOI.
+//   Placing the length at 256 or 4097 puts the end marker across a
+//   255-byte burst or a 4 KB pipeline slot.
+// =================================================
+#pragma once
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+inline int uploadTestChecks = 0;
+inline int uploadTestFailures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    uploadTestChecks++;                                                        \
+    if (!(condition)) {                                                        \
+      uploadTestFailures++;                                                    \
+      fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);     \
+    }                                                                          \
+  } while (0)
+
+inline std::vector<uint8_t> makeTestJpeg(size_t length, uint32_t seed) {
+  std::vector<uint8_t> jpeg(length);
+  uint32_t state = seed;
+  for (size_t i = 0; i < length; i++) {
+    state = state * 1664525u + 1013904223u;
+    jpeg[i] = (uint8_t)(state >> 24);
+    if (i > 0 && jpeg[i - 1] == 0xFF && jpeg[i] == 0xD9) {
+      jpeg[i] = 0x00;
+    }
+  }
+  jpeg[0] = 0xFF;
+  jpeg[1] = 0xD8;
+  jpeg[length - 2] = 0xFF;
+  jpeg[length - 1] = 0xD9;
+  return jpeg;
+}
+
+// FIFO contents: the JPEG followed by `padding` bytes the camera reports but did not encode.
+inline std::vector<uint8_t> withFifoPadding(std::vector<uint8_t> jpeg, size_t padding) {
+  jpeg.insert(jpeg.end(), padding, 0x00);
+  return jpeg;
+}
+
+inline std::string asString(const std::vector<uint8_t> &bytes) { return std::string(bytes.begin(), bytes.end()); }
+
+[[noreturn]] inline void finishUploadTests(const char *program) {
+  fflush(stdout);
+  fprintf(stderr, "%s: %d checks, %d failed\n", program, uploadTestChecks, uploadTestFailures);
+  // Detached reader and upload tasks may still be parked; do not wait on them at exit.
+  _exit(uploadTestFailures == 0 ? 0 : 1);
+}
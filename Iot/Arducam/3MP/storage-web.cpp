@@ -32,10 +32,19 @@
  * 1. Initializes SPI and the Arducam Mega, sets image quality.
  * 2. Ensures Wi-Fi connectivity.
  * 3. Every CAPTURE_INTERVAL_MS, captures a JPEG image at QXGA and uploads it to Azure Blob Storage.
- * 4. The HTTP PUT includes a fixed Content-Length equal to camera-reported size.
- * 5. Streams the captured bytes; once the JPEG end marker (0xFF 0xD9) is found, any remaining
- *    bytes up to Content-Length are padded with zeros to honor the declared length.
+ *    With PSRAM, captures go into a bounded frame queue that a separate uploader task drains, so
+ *    the capture cadence does not depend on upload latency (see Capture_Queue).
+ * 4. Streams the captured bytes into PSRAM and stops at the JPEG end marker (0xFF 0xD9),
+ *    so only real image bytes are uploaded:
+ *    - a JPEG that fits in one block is sent as a single Put Blob with its exact length;
+ *    - a larger JPEG is sent as Put Block requests over parallel connections while the camera is
+ *      still being read, followed by one Put Block List. A failed block is retried on its own.
+ * 5. Without PSRAM for the frame, blocks are staged one at a time in a single buffer; if that cannot
+ *    be allocated either (or `UPLOAD_EXACT_LENGTH` is false), falls back to a single PUT with
+ *    Content-Length equal to the camera-reported size, zero-padded after the marker.
  * 6. Expects HTTP 201 Created on success.
+ * 7. Keeps the TLS connection to Azure open between captures and reconnects only after a failure,
+ *    an idle period longer than `AZURE_KEEPALIVE_IDLE_MS`, or a `Connection: close` from the server.
  *
  * Alternative Flow
  * - The helper `captureImage()` streams the JPEG to Serial with headers so a host can
@@ -48,7 +57,8 @@
  *
  * Limitations
  * - Azure SAS must grant `w` (write) permission on the container for PUT operations.
- * - Network instability may cause timeouts; retries are minimal here for simplicity.
+ * - Network instability may cause timeouts; in chunked mode each request is retried up to
+ *   `UPLOAD_BLOCK_MAX_ATTEMPTS` times on a fresh connection. Without PSRAM a failed frame is not retried.
  */
 #include <Arduino.h>
 #include <Arducam_Mega.h>
@@ -56,6 +66,7 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <driver/adc.h>
+#include <esp_heap_caps.h>
 #include "io_config.h"
 
 // Function declarations (defined later)
@@ -76,6 +87,85 @@ void captureAndUpload(CAM_IMAGE_MODE resolution, bool useFixedName = false);
  * @return true if connected to Wi-Fi; false on timeout/failure.
  */
 bool ensureWifi();
+/**
+ * @brief Fill a buffer from the camera FIFO with burst reads and scan it for the JPEG end marker.
+ * @param buffer    Destination buffer.
+ * @param capacity  Maximum number of bytes to read.
+ * @param prevByte  Last byte of the previous block; updated so 0xFF 0xD9 may straddle blocks.
+ * @param foundEnd  Set to true when the end marker is inside this block.
+ * @return Number of valid bytes in `buffer`, up to and including the end marker.
+ */
+uint32_t readJpegBlock(uint8_t* buffer, uint32_t capacity, uint8_t& prevByte, bool& foundEnd);
+/**
+ * @brief Create the upload pipeline queues, the upload worker semaphore and the exact-length block
+ *        buffer. Called once from `setup()`.
+ */
+void initUploadPipeline();
+/**
+ * @brief Receives each block produced by the upload pipeline.
+ * @return false to abort the transfer.
+ */
+typedef bool (*PipelineSink)(const uint8_t* data, uint16_t length, void* context);
+/**
+ * @brief Stream up to `imageSize` JPEG bytes from the camera FIFO to `sink` through the
+ *        double-buffered pipeline (reader task on `PIPELINE_READER_CORE`, writer in the caller).
+ * @param sink       Consumer for each filled slot (socket write or block staging).
+ * @param context    Passed through to `sink`.
+ * @param imageSize  Camera-reported FIFO length; the reader never reads past it.
+ * @param foundEnd   Set to true when the JPEG end marker was found.
+ * @return Number of JPEG bytes accepted by the sink.
+ */
+uint32_t streamImagePipelined(PipelineSink sink, void* context, uint32_t imageSize, bool& foundEnd);
+struct AzureConnection;
+/**
+ * @brief Upload the frame as Put Block chunks held in PSRAM, sent over `AZURE_CONNECTIONS` parallel
+ *        connections while the camera is still being read; failed blocks are retried on their own.
+ * @param frame      PSRAM buffer of at least `imageSize` bytes.
+ * @param blobUrl    Blob path without query, e.g. `/images/latest.jpg`.
+ * @param imageSize  Camera-reported FIFO length (upper bound on the JPEG size), or the exact
+ *                   frame length when `fromCamera` is false.
+ * @param fromCamera true to fill `frame` from the camera FIFO during the upload; false when
+ *                   `frame` already holds a complete JPEG (queued capture).
+ * @param sent       Set to the number of JPEG bytes uploaded.
+ * @return true if Azure committed the blob.
+ */
+bool uploadChunkedParallel(uint8_t* frame, const String& blobUrl, uint32_t imageSize, bool fromCamera, uint32_t& sent);
+/**
+ * @brief Upload the JPEG with its exact length (Put Blob, or Put Block + Put Block List), staging
+ *        one block at a time. Used when there is no PSRAM for a whole frame.
+ * @param connection Connected Azure session.
+ * @param blobUrl    Blob path without query, e.g. `/images/latest.jpg`.
+ * @param imageSize  Camera-reported FIFO length (upper bound on the JPEG size).
+ * @param sent       Set to the number of JPEG bytes uploaded.
+ * @return true if Azure accepted the blob.
+ */
+bool uploadExactLength(AzureConnection& connection, const String& blobUrl, uint32_t imageSize, uint32_t& sent);
+/**
+ * @brief Upload with a single PUT of `imageSize` bytes, zero-padding after the JPEG end marker.
+ * @return true if Azure returned 201 Created.
+ */
+bool uploadPadded(AzureConnection& connection, const String& blobUrl, uint32_t imageSize, uint32_t& sent);
+/**
+ * @brief Capture a JPEG into the PSRAM frame queue without uploading it.
+ * @param resolution    Camera resolution to use for capture.
+ * @param useFixedName  Blob name as for `captureAndUpload()`.
+ * @return true if the frame was queued.
+ */
+bool captureToQueue(CAM_IMAGE_MODE resolution, bool useFixedName);
+/**
+ * @brief Allocate the frame queue and start the uploader task when PSRAM is present.
+ */
+void initCaptureQueue();
+/**
+ * @brief Make sure an Azure TLS connection is usable, connecting only when it is not.
+ * @param connection Session to check; its `handshakeMs` grows by the connect time on reconnect.
+ * @return true if the connection is ready for a request.
+ */
+bool acquireAzureConnection(AzureConnection& connection);
+/**
+ * @brief Close an Azure connection so its next use starts a fresh session.
+ */
+void dropAzureConnection(AzureConnection& connection);
 
 /**
  * @section SPI_Pins
@@ -93,6 +183,11 @@ const int CS_PIN   = 5;
  * @brief Global Arducam Mega camera instance using `CS_PIN`.
  */
 Arducam_Mega myCAM(CS_PIN);
+/**
+ * @brief Largest transfer the Arducam Mega library performs per `readBuff()` burst.
+ *        Its length argument is a `uint8_t`, so 4 KB blocks are assembled from several bursts.
+ */
+const uint8_t CAM_BURST_LENGTH = 255;
 
 /**
  * @section Noise_Sensor
@@ -128,6 +223,178 @@ static uint32_t captureCounter = 0;
  */
 const unsigned long CAPTURE_INTERVAL_MS = 60000; // 60 seconds
 
+/**
+ * @section Upload_Pipeline
+ * Camera-to-TLS producer/consumer pipeline. A reader task drains the Arducam FIFO into a ring of
+ * `PIPELINE_SLOTS` buffers while the caller encrypts and writes filled slots to the socket, so SPI
+ * reads and network writes overlap instead of taking turns.
+ *
+ * Stall counters tell which side is the bottleneck:
+ * - reader stalls: the camera side had to wait for a free slot (network is slower)
+ * - writer stalls: the network side had to wait for a filled slot (camera is slower)
+ */
+const uint8_t PIPELINE_SLOTS = 4;
+const uint16_t PIPELINE_SLOT_SIZE = 4096;
+const BaseType_t PIPELINE_READER_CORE = 0;        // Arduino loop() runs on core 1
+const UBaseType_t PIPELINE_READER_PRIORITY = 2;
+const uint32_t PIPELINE_READER_STACK = 4096;
+const unsigned long PIPELINE_STALL_TIMEOUT_MS = 5000;
+
+struct PipelineSlot {
+  uint8_t data[PIPELINE_SLOT_SIZE];
+  uint16_t length;
+  bool last;  // End marker found, FIFO exhausted or read failed
+};
+
+struct UploadPipeline {
+  PipelineSlot slots[PIPELINE_SLOTS];
+  QueueHandle_t freeSlots;      // Slot indices the reader may fill
+  QueueHandle_t readySlots;     // Slot indices the writer may send
+  SemaphoreHandle_t readerDone; // Given by the reader task just before it exits
+  uint32_t imageSize;
+  volatile bool abort;          // Set by the writer to stop the reader early
+  bool foundEnd;
+  uint32_t readerStalls;
+  uint32_t readerStallUs;
+  uint32_t writerStalls;
+  uint32_t writerStallUs;
+};
+
+// Static so the 16 KB ring never lands on the loop() stack
+static UploadPipeline uploadPipeline;
+
+/**
+ * @section Exact_Length_Upload
+ * The FIFO length reported by the camera is often well above the real JPEG size. Rather than
+ * declaring it as Content-Length and padding with zeros, bytes are staged in blocks and each
+ * block is uploaded with its exact length.
+ * Block IDs are 8 alphanumeric characters (`blk00000`), which is valid Base64 and URL-safe.
+ *
+ * Upload modes, in order of preference:
+ * - Chunked parallel: the whole frame is kept in PSRAM; `AZURE_CONNECTIONS` upload tasks send
+ *   Put Block requests as soon as each block has been read from the camera, and a block that
+ *   fails is retried on its own (up to `UPLOAD_BLOCK_MAX_ATTEMPTS`, with backoff) instead of
+ *   re-capturing and re-sending the frame. Put Block List commits the blob.
+ * - Exact length: one `UPLOAD_BLOCK_SIZE` staging buffer, blocks sent in order, no retries.
+ * - Padded: single PUT of the camera-reported size (`UPLOAD_EXACT_LENGTH` false or no memory).
+ */
+const bool UPLOAD_EXACT_LENGTH = true;               // false = legacy zero-padded single PUT
+const uint32_t UPLOAD_BLOCK_SIZE = 64 * 1024;         // Multiple of PIPELINE_SLOT_SIZE
+const unsigned long UPLOAD_RESPONSE_TIMEOUT_MS = 10000;
+const uint8_t UPLOAD_BLOCK_MAX_ATTEMPTS = 4;          // Per block, including the first try
+const unsigned long UPLOAD_RETRY_BACKOFF_MS = 250;    // Doubled after each failed attempt
+const uint32_t UPLOAD_WORKER_STACK = 8192;
+const UBaseType_t UPLOAD_WORKER_PRIORITY = 1;
+static uint8_t* uploadBlockBuffer = nullptr;
+
+/**
+ * @section Azure_Connection
+ * TLS sessions to Azure are kept open across timed uploads, so a capture normally costs one
+ * request round-trip instead of a full handshake. Responses are read up to their Content-Length
+ * to leave the socket ready for the next request. A session is dropped on any request failure,
+ * when the server answers `Connection: close`, or after `AZURE_KEEPALIVE_IDLE_MS` without use
+ * (Azure front ends close idle connections on their own; reconnecting first avoids writing a
+ * frame into a half-closed socket).
+ *
+ * The arduino-esp32 `WiFiClientSecure` does not expose TLS session resumption, so a reconnect is
+ * a full handshake; keeping the connection alive is what removes it from the steady state.
+ * Connection 0 carries single requests (Put Blob, Put Block List); all connections carry blocks.
+ */
+const uint8_t AZURE_CONNECTIONS = 2;
+const unsigned long AZURE_KEEPALIVE_IDLE_MS = 90000;
+
+struct AzureConnection {
+  WiFiClientSecure client;
+  unsigned long lastUsedMs;
+  uint32_t handshakes;        // Full TLS handshakes since boot
+  uint32_t reuses;            // Requests that found the session already open
+  unsigned long handshakeMs;  // Connect time during the current upload
+  unsigned long responseMs;   // Time waiting for responses during the current upload
+};
+static AzureConnection azureConnections[AZURE_CONNECTIONS];
+
+/**
+ * @brief Staging state for an exact-length block upload.
+ */
+struct BlockUpload {
+  AzureConnection* connection;
+  const String* blobUrl;
+  uint32_t blockFill;   // Bytes staged in `uploadBlockBuffer`
+  uint16_t blockCount;  // Blocks already stored with Put Block
+  bool failed;
+};
+
+/**
+ * @brief Shared state of a chunked parallel upload. Guarded by `chunkedUploadLock`.
+ */
+struct ChunkedUpload {
+  const String* blobUrl;
+  uint8_t* frame;           // Whole JPEG in PSRAM, kept until the blob is committed
+  uint32_t frameLength;     // Bytes read from the camera so far
+  bool frameComplete;       // Camera read finished; `blockCount` is final
+  uint16_t blockCount;      // Blocks in the frame (valid once `frameComplete`)
+  uint16_t workerBlocks;    // Blocks for the workers (0 when one Put Blob is enough)
+  uint16_t nextBlock;       // Next block to hand to a worker
+  bool failed;              // A block ran out of attempts
+  uint16_t retries;         // Extra attempts across all blocks
+  uint32_t retriedBytes;    // Bytes sent again because of those attempts
+  SemaphoreHandle_t workerDone;  // Given once by each worker as it exits
+};
+static ChunkedUpload chunkedUpload;
+static portMUX_TYPE chunkedUploadLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @section Capture_Queue
+ * With PSRAM, capture and upload are decoupled. `loop()` captures into a bounded queue of frames in
+ * PSRAM every `CAPTURE_INTERVAL_MS`, and `frameUploaderTask()` drains the queue oldest first. A slow
+ * or unreachable Azure endpoint no longer shifts the capture schedule; frames wait in the queue and
+ * are uploaded back-to-back over the warm connections once the link recovers.
+ *
+ * When the queue is full (or PSRAM runs out) `FRAME_QUEUE_POLICY` decides what is lost:
+ * - DROP_OLDEST: discard the oldest waiting frame to make room (keeps the most recent scene)
+ * - DROP_NEWEST: discard the new capture (keeps an unbroken history up to the outage)
+ * A frame that is being uploaded is never dropped.
+ *
+ * Fixed-name captures overwrite one blob, so only the newest is worth sending: queueing one discards
+ * every older fixed-name frame still waiting (counted as superseded). The frame already uploading
+ * finishes first, so the newest frame is always the last to land on the blob.
+ */
+enum FrameDropPolicy { DROP_OLDEST, DROP_NEWEST };
+const uint8_t FRAME_QUEUE_DEPTH = 6;
+const FrameDropPolicy FRAME_QUEUE_POLICY = DROP_OLDEST;
+const unsigned long FRAME_UPLOAD_RETRY_MS = 5000;  // Pause after a failed upload before retrying
+const uint32_t FRAME_UPLOADER_STACK = 8192;
+const UBaseType_t FRAME_UPLOADER_PRIORITY = 1;
+
+enum FrameSlotState : uint8_t { FRAME_FREE, FRAME_QUEUED, FRAME_UPLOADING };
+
+struct QueuedFrame {
+  uint8_t* data;             // JPEG bytes in PSRAM
+  uint32_t length;           // Exact JPEG length
+  unsigned long capturedMs;  // millis() at capture, for age reporting
+  uint32_t sequence;         // Capture order; lowest queued sequence is uploaded first
+  FrameSlotState state;
+  char blobName[40];
+};
+
+struct CaptureQueueStats {
+  uint32_t captured;
+  uint32_t uploaded;
+  uint32_t droppedOldest;
+  uint32_t droppedNewest;
+  uint32_t superseded;       // Waiting fixed-name frames replaced by a newer capture
+  uint32_t uploadFailures;
+  uint8_t maxDepth;
+};
+
+static QueuedFrame frameQueue[FRAME_QUEUE_DEPTH];
+static CaptureQueueStats captureQueueStats;
+static portMUX_TYPE frameQueueLock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t frameQueued = NULL;  // Given by loop() after each queued capture
+static bool captureQueueEnabled = false;
+static uint32_t frameSequence = 0;
+static const char FIXED_BLOB_NAME[] = "latest.jpg";  // Blob overwritten by fixed-name captures
+
 /**
  * @brief Azure Blob endpoint host derived from `AZURE_STORAGE_ACCOUNT`.
  *        Example: mystorageacct.blob.core.windows.net
@@ -176,6 +443,12 @@ void setup() {
   // Prefer highest quality for uploads
   myCAM.setImageQuality(HIGH_QUALITY);
 
+  // Queues for the camera-to-TLS upload pipeline
+  initUploadPipeline();
+
+  // Decouple capture from upload when PSRAM can hold queued frames
+  initCaptureQueue();
+
   // Bring Wi-Fi up on boot so first capture can upload
   ensureWifi();
 }
@@ -183,18 +456,29 @@ void setup() {
 /**
  * @brief Main loop: performs a timed capture and upload.
  *
- * Captures a 3MP (QXGA) JPEG and uploads every `CAPTURE_INTERVAL_MS`. When `useFixedName`
- * is true (as used here), the blob `latest.jpg` is overwritten each cycle.
+ * Captures a 3MP (QXGA) JPEG every `CAPTURE_INTERVAL_MS`. When `useFixedName` is true (as used
+ * here), the blob `latest.jpg` is overwritten each cycle. With the capture queue enabled the frame
+ * is queued for the uploader task and the loop returns to its schedule immediately; otherwise the
+ * upload happens inline.
  */
 void loop() {
   static unsigned long lastCaptureMs = 0;
   unsigned long now = millis();
 
   if (now - lastCaptureMs >= CAPTURE_INTERVAL_MS) {
-    lastCaptureMs = now;
+    // Advance by whole intervals so capture time does not accumulate as drift
+    lastCaptureMs += CAPTURE_INTERVAL_MS;
+    if (now - lastCaptureMs >= CAPTURE_INTERVAL_MS) {
+      lastCaptureMs = now;  // Fell more than an interval behind; restart the schedule
+    }
     Serial.println();
-    Serial.println("[TIMER] Capturing at max resolution and uploading as latest.jpg...");
-    captureAndUpload(CAM_IMAGE_MODE_QXGA, true);
+    if (captureQueueEnabled) {
+      Serial.println("[TIMER] Capturing at max resolution and queueing as latest.jpg...");
+      captureToQueue(CAM_IMAGE_MODE_QXGA, true);
+    } else {
+      Serial.println("[TIMER] Capturing at max resolution and uploading as latest.jpg...");
+      captureAndUpload(CAM_IMAGE_MODE_QXGA, true);
+    }
   }
 
   delay(50);
@@ -236,19 +520,26 @@ bool ensureWifi() {
 /**
  * @brief Capture a JPEG and upload it to Azure Blob Storage over HTTPS.
  *
- * This function captures a JPEG with the specified resolution, opens a TLS connection
- * to Azure Blob Storage, and issues an HTTP PUT request using a SAS token appended as
- * query parameters. The `Content-Length` header matches the camera-reported size.
+ * This function captures a JPEG with the specified resolution, reuses (or opens) the TLS
+ * connection to Azure Blob Storage (see `acquireAzureConnection()`), and uploads it with HTTP
+ * PUT requests using a SAS token appended as query parameters. It blocks until the upload
+ * finishes; with PSRAM the timed loop uses `captureToQueue()` instead.
  *
  * Data Streaming Strategy
- * - Bytes are read from the camera and buffered to the TLS socket.
- * - When the JPEG end marker (0xFF 0xD9) is encountered, any remaining bytes up to
- *   `Content-Length` are padded with zeros to align with the declared size.
- * - This ensures Azure accepts the payload length even if the camera ends the JPEG early.
+ * - Bytes are burst-read from the camera FIFO in 4 KB blocks (see `readJpegBlock()`) by a
+ *   reader task while this function consumes earlier blocks (see `streamImagePipelined()`).
+ * - Chunked mode (`uploadChunkedParallel()`, needs PSRAM for the frame): blocks are uploaded in
+ *   parallel as they fill, failed blocks are retried individually, and nothing after the JPEG
+ *   end marker (0xFF 0xD9) is sent.
+ * - Exact-length mode (`uploadExactLength()`): bytes are staged in one `UPLOAD_BLOCK_SIZE` buffer
+ *   and sent block by block on connection 0.
+ * - Padded mode (`uploadPadded()`): Content-Length is the camera-reported size and any bytes
+ *   after the end marker are padded with zeros to honor it.
  *
  * Response Handling
- * - Waits for server response and checks the HTTP status line.
- * - Treats `HTTP/1.1 201 Created` as success; logs response headers for diagnostics.
+ * - Each response is read up to its Content-Length (see `readHttpResponse()`), so several
+ *   requests can share one connection.
+ * - Treats `201 Created` as success; logs response headers and body on errors.
  *
  * @param resolution   Camera resolution (e.g., `CAM_IMAGE_MODE_QXGA`).
  * @param useFixedName If true, overwrites `latest.jpg`. If false, generates a unique name
@@ -290,138 +581,1023 @@ void captureAndUpload(CAM_IMAGE_MODE resolution, bool useFixedName) {
   // Build blob path; reuse same name when requested to overwrite
   captureCounter++;
   uint32_t timestamp = millis();
-  String blobName = useFixedName ? "latest.jpg" : "image_" + String(captureCounter) + "_" + String(timestamp) + ".jpg";
-  String azureBlobPath = "/" + String(AZURE_CONTAINER) + "/" + blobName + "?" + String(AZURE_SAS_TOKEN);
+  String blobName = useFixedName ? String(FIXED_BLOB_NAME) : "image_" + String(captureCounter) + "_" + String(timestamp) + ".jpg";
+  String blobUrl = "/" + String(AZURE_CONTAINER) + "/" + blobName;
 
-  WiFiClientSecure client;
-  client.setInsecure();
+  for (uint8_t i = 0; i < AZURE_CONNECTIONS; i++) {
+    azureConnections[i].handshakeMs = 0;
+    azureConnections[i].responseMs = 0;
+  }
+
+  // Stream the JPEG from camera to Azure; SPI reads overlap TLS writes
+  Serial.println("Streaming image bytes...");
+  unsigned long streamStart = millis();
+  uint32_t sent = 0;
+  bool success = false;
+  uint8_t* frame = nullptr;
+  if (UPLOAD_EXACT_LENGTH) {
+    frame = (uint8_t*)heap_caps_malloc(imageSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  if (frame != nullptr) {
+    success = uploadChunkedParallel(frame, blobUrl, imageSize, true, sent);
+    heap_caps_free(frame);
+  } else if (acquireAzureConnection(azureConnections[0])) {
+    if (UPLOAD_EXACT_LENGTH && uploadBlockBuffer != nullptr) {
+      success = uploadExactLength(azureConnections[0], blobUrl, imageSize, sent);
+    } else {
+      success = uploadPadded(azureConnections[0], blobUrl, imageSize, sent);
+    }
+    if (!success) {
+      dropAzureConnection(azureConnections[0]);
+    }
+  }
+  unsigned long streamMs = millis() - streamStart;
+
+  Serial.println();
+  Serial.print("Sent ");
+  Serial.print(sent);
+  Serial.print(" bytes in ");
+  Serial.print(streamMs);
+  Serial.print(" ms (");
+  Serial.print(streamMs > 0 ? (sent * 1000UL) / streamMs : sent);
+  Serial.println(" bytes/sec)");
+  if (sent < imageSize) {
+    Serial.print("  Skipped ");
+    Serial.print(imageSize - sent);
+    Serial.println(" bytes of FIFO padding");
+  }
+  if (frame != nullptr) {
+    Serial.print("  Blocks: ");
+    Serial.print(chunkedUpload.blockCount);
+    Serial.print(", retries: ");
+    Serial.print(chunkedUpload.retries);
+    Serial.print(" (");
+    Serial.print(chunkedUpload.retriedBytes);
+    Serial.println(" bytes re-sent)");
+  }
+  Serial.print("Pipeline stalls: reader ");
+  Serial.print(uploadPipeline.readerStalls);
+  Serial.print(" (");
+  Serial.print(uploadPipeline.readerStallUs / 1000);
+  Serial.print(" ms), writer ");
+  Serial.print(uploadPipeline.writerStalls);
+  Serial.print(" (");
+  Serial.print(uploadPipeline.writerStallUs / 1000);
+  Serial.print(" ms) -> bottleneck: ");
+  Serial.println(uploadPipeline.readerStallUs > uploadPipeline.writerStallUs ? "network" : "camera");
+
+  // Per-connection timing; handshake is 0 ms when the session was reused
+  for (uint8_t i = 0; i < AZURE_CONNECTIONS; i++) {
+    AzureConnection& connection = azureConnections[i];
+    Serial.print("Connection ");
+    Serial.print(i);
+    Serial.print(": handshake ");
+    Serial.print(connection.handshakeMs);
+    Serial.print(" ms, response ");
+    Serial.print(connection.responseMs);
+    Serial.print(" ms | sessions: ");
+    Serial.print(connection.handshakes);
+    Serial.print(" handshakes, ");
+    Serial.print(connection.reuses);
+    Serial.println(" reuses");
+  }
+
+  if (!success) {
+    Serial.println("✗ Upload did not return 201 Created");
+  } else {
+    Serial.print("✓ Upload success (201 Created)");
+    Serial.println();
+    Serial.print("  Filename: ");
+    Serial.println(blobName);
+  }
+  Serial.println();
+}
+uint32_t readJpegBlock(uint8_t* buffer, uint32_t capacity, uint8_t& prevByte, bool& foundEnd) {
+  uint32_t filled = 0;
+  while (filled < capacity) {
+    uint32_t chunk = capacity - filled;
+    if (chunk > CAM_BURST_LENGTH) {
+      chunk = CAM_BURST_LENGTH;
+    }
+    uint8_t got = myCAM.readBuff(buffer + filled, (uint8_t)chunk);
+    if (got == 0) {
+      break;
+    }
+    filled += got;
+  }
+
+  // Scan the whole block at once; the 0xFF may be the last byte of the previous block
+  uint8_t last = prevByte;
+  for (uint32_t i = 0; i < filled; i++) {
+    if (last == 0xFF && buffer[i] == 0xD9) {
+      foundEnd = true;
+      prevByte = buffer[i];
+      return i + 1;
+    }
+    last = buffer[i];
+  }
+  prevByte = last;
+  return filled;
+}
+
+void initUploadPipeline() {
+  uploadPipeline.freeSlots = xQueueCreate(PIPELINE_SLOTS, sizeof(uint8_t));
+  uploadPipeline.readySlots = xQueueCreate(PIPELINE_SLOTS, sizeof(uint8_t));
+  uploadPipeline.readerDone = xSemaphoreCreateBinary();
+  chunkedUpload.workerDone = xSemaphoreCreateCounting(AZURE_CONNECTIONS, 0);
+
+  // Prefer PSRAM for the block buffer so internal RAM stays free for TLS
+  uploadBlockBuffer = (uint8_t*)heap_caps_malloc(UPLOAD_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (uploadBlockBuffer == nullptr) {
+    uploadBlockBuffer = (uint8_t*)malloc(UPLOAD_BLOCK_SIZE);
+  }
+  if (uploadBlockBuffer == nullptr) {
+    Serial.println("⚠ No memory for upload block buffer; using zero-padded uploads");
+  }
+}
+
+/**
+ * @brief Producer side of the upload pipeline. Fills free slots from the camera FIFO and
+ *        hands them to the writer until the JPEG ends, the FIFO is exhausted or the writer aborts.
+ * @param param Pointer to the `UploadPipeline` being filled.
+ */
+void pipelineReaderTask(void* param) {
+  UploadPipeline* pipeline = (UploadPipeline*)param;
+  uint32_t remaining = pipeline->imageSize;
+  uint8_t prevByte = 0;
+  bool done = false;
+
+  while (!done) {
+    uint8_t index;
+    if (xQueueReceive(pipeline->freeSlots, &index, 0) != pdPASS) {
+      // Every slot is still queued for the network
+      pipeline->readerStalls++;
+      unsigned long waitStart = micros();
+      BaseType_t got = xQueueReceive(pipeline->freeSlots, &index, pdMS_TO_TICKS(PIPELINE_STALL_TIMEOUT_MS));
+      pipeline->readerStallUs += micros() - waitStart;
+      if (got != pdPASS) {
+        break;
+      }
+    }
+    if (pipeline->abort) {
+      break;
+    }
+
+    PipelineSlot& slot = pipeline->slots[index];
+    uint32_t wanted = remaining < PIPELINE_SLOT_SIZE ? remaining : PIPELINE_SLOT_SIZE;
+    slot.length = readJpegBlock(slot.data, wanted, prevByte, pipeline->foundEnd);
+    remaining -= slot.length;
+
+    done = pipeline->foundEnd || remaining == 0 || slot.length == 0;
+    slot.last = done;
+    xQueueSend(pipeline->readySlots, &index, portMAX_DELAY);
+  }
+
+  xSemaphoreGive(pipeline->readerDone);
+  vTaskDelete(NULL);
+}
+
+uint32_t streamImagePipelined(PipelineSink sink, void* context, uint32_t imageSize, bool& foundEnd) {
+  UploadPipeline& pipeline = uploadPipeline;
+  xQueueReset(pipeline.freeSlots);
+  xQueueReset(pipeline.readySlots);
+  xSemaphoreTake(pipeline.readerDone, 0);
+  for (uint8_t i = 0; i < PIPELINE_SLOTS; i++) {
+    xQueueSend(pipeline.freeSlots, &i, 0);
+  }
+  pipeline.imageSize = imageSize;
+  pipeline.abort = false;
+  pipeline.foundEnd = false;
+  pipeline.readerStalls = 0;
+  pipeline.readerStallUs = 0;
+  pipeline.writerStalls = 0;
+  pipeline.writerStallUs = 0;
+
+  if (xTaskCreatePinnedToCore(pipelineReaderTask, "CamReader", PIPELINE_READER_STACK, &pipeline,
+                              PIPELINE_READER_PRIORITY, NULL, PIPELINE_READER_CORE) != pdPASS) {
+    Serial.println("✗ Failed to start camera reader task");
+    return 0;
+  }
+
+  uint32_t sent = 0;
+  uint32_t nextProgress = 5000;
+  while (true) {
+    uint8_t index;
+    if (xQueueReceive(pipeline.readySlots, &index, 0) != pdPASS) {
+      // Network side is ahead of the camera
+      pipeline.writerStalls++;
+      unsigned long waitStart = micros();
+      BaseType_t got = xQueueReceive(pipeline.readySlots, &index, pdMS_TO_TICKS(PIPELINE_STALL_TIMEOUT_MS));
+      pipeline.writerStallUs += micros() - waitStart;
+      if (got != pdPASS) {
+        Serial.println("✗ Camera reader stalled");
+        pipeline.abort = true;
+        break;
+      }
+    }
+
+    PipelineSlot& slot = pipeline.slots[index];
+    bool last = slot.last;
+    if (slot.length == 0) {
+      Serial.println("✗ Camera FIFO returned no data");
+    } else if (!sink(slot.data, slot.length, context)) {
+      pipeline.abort = true;
+      last = true;
+    } else {
+      sent += slot.length;
+    }
+    xQueueSend(pipeline.freeSlots, &index, 0);
+
+    // Progress indicator
+    while (sent >= nextProgress) {
+      Serial.print(".");
+      nextProgress += 5000;
+    }
+    if (last) {
+      break;
+    }
+  }
+
+  // Reader must be gone before the slots are reused
+  xSemaphoreTake(pipeline.readerDone, portMAX_DELAY);
+  foundEnd = pipeline.foundEnd && !pipeline.abort;
+  return sent;
+}
+
+bool acquireAzureConnection(AzureConnection& connection) {
+  WiFiClientSecure& client = connection.client;
+  if (client.connected()) {
+    if (millis() - connection.lastUsedMs < AZURE_KEEPALIVE_IDLE_MS && !client.available()) {
+      connection.reuses++;
+      return true;
+    }
+    // Idle too long, or unexpected bytes waiting (e.g. a server-side timeout notice)
+    dropAzureConnection(connection);
+  }
 
   Serial.print("Connecting to Azure host: ");
   Serial.println(azureBlobHost);
-
+  client.setInsecure();
+  unsigned long connectStart = millis();
   if (!client.connect(azureBlobHost.c_str(), 443)) {
     Serial.println("✗ Connection to Azure failed");
-    Serial.println();
-    return;
+    client.stop();
+    return false;
   }
+  connection.handshakeMs += millis() - connectStart;
+  connection.handshakes++;
+  connection.lastUsedMs = millis();
   Serial.println("✓ Connected to Azure");
+  return true;
+}
 
-  // Send HTTP PUT with known Content-Length (SAS grants write permission)
-  Serial.println("Sending PUT request...");
+void dropAzureConnection(AzureConnection& connection) {
+  connection.client.stop();
+}
+
+/**
+ * @brief Send a PUT request on an open connection.
+ * @param client        Connected TLS socket.
+ * @param pathAndQuery  Request target including the SAS query string.
+ * @param extraHeaders  Additional header lines, each ending in CRLF (may be empty).
+ * @param body          Request body, or nullptr when the caller streams the body itself.
+ * @param length        Content-Length to declare.
+ * @return false if the socket did not accept every byte.
+ */
+bool sendPutRequest(WiFiClientSecure& client, const String& pathAndQuery, const char* extraHeaders,
+                    const uint8_t* body, uint32_t length) {
   client.print("PUT ");
-  client.print(azureBlobPath);
+  client.print(pathAndQuery);
   client.println(" HTTP/1.1");
   client.print("Host: ");
   client.println(azureBlobHost);
-  client.println("Content-Type: image/jpeg");
   client.print("Content-Length: ");
-  client.println(imageSize);
-  client.println("x-ms-blob-type: BlockBlob");
-  client.println("Connection: close");
+  client.println(length);
+  client.print(extraHeaders);
+  client.println("Connection: keep-alive");
   client.println();
+  if (body == nullptr || length == 0) {
+    return true;
+  }
+  return client.write(body, length) == length;
+}
 
-  // Stream exactly imageSize bytes from camera to socket with buffering
-  Serial.println("Streaming image bytes...");
-  uint32_t sent = 0;
-  uint8_t prevByte = 0;
-  const uint16_t BUFFER_SIZE = 4096;
-  uint8_t buffer[BUFFER_SIZE];
-  uint16_t bufferPos = 0;
-  
-  while (sent < imageSize) {
-    uint8_t byte = myCAM.readByte();
-    buffer[bufferPos++] = byte;
-    sent++;
-    
-    // When buffer is full or we've read all data, flush to socket
-    if (bufferPos >= BUFFER_SIZE || sent >= imageSize) {
-      client.write(buffer, bufferPos);
-      bufferPos = 0;
+/**
+ * @brief Read one HTTP response, consuming exactly its Content-Length so the connection
+ *        can carry another request.
+ * @param connection Azure session the request was sent on; its `responseMs` grows by the wait.
+ * @return HTTP status code, or -1 on timeout.
+ */
+int readHttpResponse(AzureConnection& connection) {
+  WiFiClientSecure& client = connection.client;
+  unsigned long responseStart = millis();
+  unsigned long start = responseStart;
+  while (!client.available() && client.connected() && millis() - start < UPLOAD_RESPONSE_TIMEOUT_MS) {
+    delay(5);
+  }
+  if (!client.available()) {
+    Serial.println("✗ No response from server (timeout)");
+    connection.responseMs += millis() - responseStart;
+    return -1;
+  }
+
+  // Status line, e.g. "HTTP/1.1 201 Created"
+  String statusLine = client.readStringUntil('\n');
+  statusLine.trim();
+  int statusCode = statusLine.length() >= 12 ? statusLine.substring(9, 12).toInt() : -1;
+  bool failed = statusCode < 200 || statusCode >= 300;
+  if (failed) {
+    Serial.print("Azure response: ");
+    Serial.println(statusLine);
+  }
+
+  long contentLength = 0;
+  bool serverCloses = false;
+  while (client.connected() || client.available()) {
+    String line = client.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) {
+      break;
     }
-    
-    // Progress indicator
-    if (sent % 5000 == 0) {
-      Serial.print(".");
+    if (line.substring(0, 15).equalsIgnoreCase("Content-Length:")) {
+      contentLength = line.substring(15).toInt();
+    } else if (line.equalsIgnoreCase("Connection: close")) {
+      serverCloses = true;
     }
-    
-    // Stop at JPEG end marker and pad with zeros if needed
-    if (prevByte == 0xFF && byte == 0xD9) {
-      Serial.println("✓ Found JPEG end marker");
-      // Flush any remaining data in buffer
-      if (bufferPos > 0) {
-        client.write(buffer, bufferPos);
-        bufferPos = 0;
-      }
-      // Pad remaining with zeros
-      while (sent < imageSize) {
-        buffer[bufferPos++] = 0x00;
-        sent++;
-        if (bufferPos >= BUFFER_SIZE) {
-          client.write(buffer, bufferPos);
-          bufferPos = 0;
-        }
-      }
-      break;
+    if (failed) {
+      Serial.print("  ");
+      Serial.println(line);
     }
-    prevByte = byte;
   }
-  
-  // Flush any remaining buffered data
-  if (bufferPos > 0) {
-    client.write(buffer, bufferPos);
+
+  // Drain the body; error bodies carry Azure's explanation
+  start = millis();
+  while (contentLength > 0 && millis() - start < UPLOAD_RESPONSE_TIMEOUT_MS) {
+    int c = client.read();
+    if (c < 0) {
+      delay(1);
+      continue;
+    }
+    if (failed) {
+      Serial.write((uint8_t)c);
+    }
+    contentLength--;
+  }
+  if (failed) {
+    Serial.println();
+  }
+
+  // Server will not take another request on this socket
+  if (serverCloses) {
+    client.stop();
+  } else {
+    connection.lastUsedMs = millis();
+  }
+  connection.responseMs += millis() - responseStart;
+  return statusCode;
+}
+
+/**
+ * @brief Build the Put Block List body committing blocks `blk00000` .. `blockCount - 1` in order.
+ */
+String buildBlockList(uint16_t blockCount) {
+  String blockList = "<?xml version=\"1.0\" encoding=\"utf-8\"?><BlockList>";
+  char blockId[9];
+  for (uint16_t i = 0; i < blockCount; i++) {
+    snprintf(blockId, sizeof(blockId), "blk%05u", (unsigned)i);
+    blockList += "<Latest>";
+    blockList += blockId;
+    blockList += "</Latest>";
+  }
+  blockList += "</BlockList>";
+  return blockList;
+}
+
+/**
+ * @brief Send one PUT with its full body, retrying on a fresh connection until Azure returns
+ *        201 Created or `UPLOAD_BLOCK_MAX_ATTEMPTS` is reached. The body stays in memory, so a
+ *        retry resends only this request.
+ * @param connection   Azure session to use (reconnected as needed).
+ * @param target       Request target including the SAS query string.
+ * @param extraHeaders Additional header lines, each ending in CRLF.
+ * @param body         Request body.
+ * @param length       Body length.
+ * @param attempts     Set to the number of attempts made.
+ * @return true on 201 Created.
+ */
+bool putWithRetry(AzureConnection& connection, const String& target, const char* extraHeaders,
+                  const uint8_t* body, uint32_t length, uint8_t& attempts) {
+  for (attempts = 1; attempts <= UPLOAD_BLOCK_MAX_ATTEMPTS; attempts++) {
+    if (attempts > 1) {
+      delay(UPLOAD_RETRY_BACKOFF_MS << (attempts - 2));
+    }
+    if (acquireAzureConnection(connection) &&
+        sendPutRequest(connection.client, target, extraHeaders, body, length) &&
+        readHttpResponse(connection) == 201) {
+      return true;
+    }
+    dropAzureConnection(connection);
+  }
+  attempts = UPLOAD_BLOCK_MAX_ATTEMPTS;
+  return false;
+}
+
+/**
+ * @brief Pipeline sink that writes straight to the TLS socket (padded mode).
+ */
+bool clientSink(const uint8_t* data, uint16_t length, void* context) {
+  WiFiClientSecure* client = (WiFiClientSecure*)context;
+  if (client->write(data, length) != length) {
+    Serial.println("✗ Socket write failed");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Store the staged block with Put Block and start a new one.
+ * @param upload Exact-length upload state.
+ * @return true if Azure returned 201 Created.
+ */
+bool flushUploadBlock(BlockUpload& upload) {
+  char blockId[9];
+  snprintf(blockId, sizeof(blockId), "blk%05u", (unsigned)upload.blockCount);
+  String target = *upload.blobUrl + "?comp=block&blockid=" + blockId + "&" + String(AZURE_SAS_TOKEN);
+
+  if (!sendPutRequest(upload.connection->client, target, "", uploadBlockBuffer, upload.blockFill) ||
+      readHttpResponse(*upload.connection) != 201) {
+    Serial.print("✗ Put Block ");
+    Serial.print(blockId);
+    Serial.println(" failed");
+    upload.failed = true;
+    return false;
+  }
+  upload.blockCount++;
+  upload.blockFill = 0;
+  return true;
+}
+
+/**
+ * @brief Pipeline sink that stages bytes into `uploadBlockBuffer` (exact-length mode).
+ *        A full block is stored with Put Block; the final partial block is left for the caller.
+ */
+bool blockSink(const uint8_t* data, uint16_t length, void* context) {
+  BlockUpload* upload = (BlockUpload*)context;
+  while (length > 0) {
+    uint32_t room = UPLOAD_BLOCK_SIZE - upload->blockFill;
+    uint32_t n = length < room ? length : room;
+    memcpy(uploadBlockBuffer + upload->blockFill, data, n);
+    upload->blockFill += n;
+    data += n;
+    length -= n;
+    if (upload->blockFill == UPLOAD_BLOCK_SIZE && !flushUploadBlock(*upload)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool uploadExactLength(AzureConnection& connection, const String& blobUrl, uint32_t imageSize, uint32_t& sent) {
+  WiFiClientSecure& client = connection.client;
+  BlockUpload upload = {&connection, &blobUrl, 0, 0, false};
+  bool foundEnd = false;
+  sent = streamImagePipelined(blockSink, &upload, imageSize, foundEnd);
+  if (upload.failed || sent == 0) {
+    return false;
+  }
+  if (foundEnd) {
+    Serial.println("✓ Found JPEG end marker");
+  } else {
+    Serial.println("⚠ JPEG end marker not found; uploading FIFO contents");
+  }
+
+  // Small frames: one Put Blob with the exact length
+  if (upload.blockCount == 0) {
+    Serial.println("Sending PUT request...");
+    String target = blobUrl + "?" + String(AZURE_SAS_TOKEN);
+    if (!sendPutRequest(client, target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n",
+                        uploadBlockBuffer, upload.blockFill)) {
+      Serial.println("✗ Socket write failed");
+      return false;
+    }
+    return readHttpResponse(connection) == 201;
+  }
+
+  // Large frames: store the tail block, then commit every block in order
+  if (upload.blockFill > 0 && !flushUploadBlock(upload)) {
+    return false;
+  }
+  Serial.print("Committing ");
+  Serial.print(upload.blockCount);
+  Serial.println(" blocks...");
+  String blockList = buildBlockList(upload.blockCount);
+
+  String target = blobUrl + "?comp=blocklist&" + String(AZURE_SAS_TOKEN);
+  if (!sendPutRequest(client, target, "x-ms-blob-content-type: image/jpeg\r\n",
+                      (const uint8_t*)blockList.c_str(), blockList.length())) {
+    Serial.println("✗ Socket write failed");
+    return false;
+  }
+  return readHttpResponse(connection) == 201;
+}
+
+bool uploadPadded(AzureConnection& connection, const String& blobUrl, uint32_t imageSize, uint32_t& sent) {
+  WiFiClientSecure& client = connection.client;
+  // Send HTTP PUT with the camera-reported Content-Length (SAS grants write permission)
+  Serial.println("Sending PUT request...");
+  String target = blobUrl + "?" + String(AZURE_SAS_TOKEN);
+  sendPutRequest(client, target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n", nullptr, imageSize);
+
+  bool foundEnd = false;
+  sent = streamImagePipelined(clientSink, &client, imageSize, foundEnd);
+
+  // Pad with zeros up to the declared Content-Length if the JPEG ended early
+  if (foundEnd) {
+    Serial.println("✓ Found JPEG end marker");
+    uint8_t* padding = uploadPipeline.slots[0].data;
+    memset(padding, 0x00, PIPELINE_SLOT_SIZE);
+    while (sent < imageSize) {
+      uint32_t padLen = imageSize - sent;
+      if (padLen > PIPELINE_SLOT_SIZE) {
+        padLen = PIPELINE_SLOT_SIZE;
+      }
+      client.write(padding, padLen);
+      sent += padLen;
+    }
   }
-  
-  Serial.println();
-  Serial.print("Sent ");
-  Serial.print(sent);
-  Serial.println(" bytes");
 
   // Ensure all data is sent to the network stack
   client.flush();
   Serial.println("Flushed data, waiting for response...");
+  return readHttpResponse(connection) == 201;
+}
+
+/**
+ * @brief Pipeline sink that appends camera blocks to the PSRAM frame (chunked mode).
+ *        Workers pick up each `UPLOAD_BLOCK_SIZE` block as soon as it is complete.
+ */
+bool frameSink(const uint8_t* data, uint16_t length, void* context) {
+  ChunkedUpload* upload = (ChunkedUpload*)context;
+  memcpy(upload->frame + upload->frameLength, data, length);
+  portENTER_CRITICAL(&chunkedUploadLock);
+  upload->frameLength += length;
+  bool failed = upload->failed;
+  portEXIT_CRITICAL(&chunkedUploadLock);
+  return !failed;
+}
+
+/**
+ * @brief Upload task for chunked mode. Takes the next complete block, sends it with Put Block on
+ *        its own connection (retrying just that block), and repeats until every block is handed
+ *        out or a block fails for good.
+ * @param param Index into `azureConnections`, cast to a pointer.
+ */
+void uploadWorkerTask(void* param) {
+  AzureConnection& connection = azureConnections[(uintptr_t)param];
+  ChunkedUpload* upload = &chunkedUpload;
+
+  while (true) {
+    int block = -1;
+    bool finished = false;
+    portENTER_CRITICAL(&chunkedUploadLock);
+    uint16_t ready = upload->frameComplete ? upload->workerBlocks : upload->frameLength / UPLOAD_BLOCK_SIZE;
+    if (upload->failed) {
+      finished = true;
+    } else if (upload->nextBlock < ready) {
+      block = upload->nextBlock++;
+    } else if (upload->frameComplete) {
+      finished = true;
+    }
+    portEXIT_CRITICAL(&chunkedUploadLock);
+
+    if (finished) {
+      break;
+    }
+    if (block < 0) {
+      vTaskDelay(pdMS_TO_TICKS(5));  // Camera has not filled the next block yet
+      continue;
+    }
+
+    uint32_t offset = (uint32_t)block * UPLOAD_BLOCK_SIZE;
+    uint32_t length = UPLOAD_BLOCK_SIZE;
+    portENTER_CRITICAL(&chunkedUploadLock);
+    if (upload->frameComplete && upload->frameLength - offset < length) {
+      length = upload->frameLength - offset;  // Tail block
+    }
+    portEXIT_CRITICAL(&chunkedUploadLock);
+
+    char blockId[9];
+    snprintf(blockId, sizeof(blockId), "blk%05u", (unsigned)block);
+    String target = *upload->blobUrl + "?comp=block&blockid=" + blockId + "&" + String(AZURE_SAS_TOKEN);
+    uint8_t attempts = 0;
+    bool stored = putWithRetry(connection, target, "", upload->frame + offset, length, attempts);
 
-  // Wait for response
-  unsigned long timeout = millis();
-  while (!client.available() && millis() - timeout < 10000) {
-    delay(50);
+    portENTER_CRITICAL(&chunkedUploadLock);
+    upload->retries += attempts - 1;
+    upload->retriedBytes += (uint32_t)(attempts - 1) * length;
+    if (!stored) {
+      upload->failed = true;
+    }
+    portEXIT_CRITICAL(&chunkedUploadLock);
+    if (!stored) {
+      Serial.print("✗ Put Block ");
+      Serial.print(blockId);
+      Serial.println(" failed after retries");
+    }
   }
 
-  if (!client.available()) {
-    Serial.println("✗ No response from server (timeout)");
-    client.stop();
-    Serial.println();
+  xSemaphoreGive(upload->workerDone);
+  vTaskDelete(NULL);
+}
+
+bool uploadChunkedParallel(uint8_t* frame, const String& blobUrl, uint32_t imageSize, bool fromCamera, uint32_t& sent) {
+  ChunkedUpload* upload = &chunkedUpload;
+  upload->blobUrl = &blobUrl;
+  upload->frame = frame;
+  upload->frameLength = 0;
+  upload->frameComplete = false;
+  upload->blockCount = 0;
+  upload->workerBlocks = 0;
+  upload->nextBlock = 0;
+  upload->failed = false;
+  upload->retries = 0;
+  upload->retriedBytes = 0;
+
+  // Workers start now so full blocks go out while the camera is still being read
+  uint8_t workers = 0;
+  for (uint8_t i = 0; i < AZURE_CONNECTIONS; i++) {
+    if (xTaskCreatePinnedToCore(uploadWorkerTask, "BlobUpload", UPLOAD_WORKER_STACK, (void*)(uintptr_t)i,
+                                UPLOAD_WORKER_PRIORITY, NULL, tskNO_AFFINITY) == pdPASS) {
+      workers++;
+    }
+  }
+  if (workers == 0) {
+    Serial.println("✗ Failed to start upload tasks");
+    return false;
+  }
+
+  if (fromCamera) {
+    bool foundEnd = false;
+    sent = streamImagePipelined(frameSink, upload, imageSize, foundEnd);
+    if (foundEnd) {
+      Serial.println("✓ Found JPEG end marker");
+    } else {
+      Serial.println("⚠ JPEG end marker not found; uploading FIFO contents");
+    }
+  } else {
+    upload->frameLength = imageSize;
+    sent = imageSize;
+  }
+
+  // Frame is final: hand the tail block to the workers (none if one Put Blob will do)
+  portENTER_CRITICAL(&chunkedUploadLock);
+  upload->blockCount = (upload->frameLength + UPLOAD_BLOCK_SIZE - 1) / UPLOAD_BLOCK_SIZE;
+  upload->workerBlocks = upload->blockCount > 1 ? upload->blockCount : 0;
+  upload->frameComplete = true;
+  portEXIT_CRITICAL(&chunkedUploadLock);
+
+  for (uint8_t i = 0; i < workers; i++) {
+    xSemaphoreTake(upload->workerDone, portMAX_DELAY);
+  }
+  if (upload->failed || sent == 0) {
+    return false;
+  }
+
+  // Single block: one Put Blob with the exact length; otherwise commit every block in order
+  uint8_t attempts = 0;
+  bool committed;
+  if (upload->blockCount == 1) {
+    Serial.println("Sending PUT request...");
+    String target = blobUrl + "?" + String(AZURE_SAS_TOKEN);
+    committed = putWithRetry(azureConnections[0], target, "Content-Type: image/jpeg\r\nx-ms-blob-type: BlockBlob\r\n",
+                             frame, sent, attempts);
+    upload->retriedBytes += (uint32_t)(attempts - 1) * sent;
+  } else {
+    Serial.print("Committing ");
+    Serial.print(upload->blockCount);
+    Serial.println(" blocks...");
+    String blockList = buildBlockList(upload->blockCount);
+    String target = blobUrl + "?comp=blocklist&" + String(AZURE_SAS_TOKEN);
+    committed = putWithRetry(azureConnections[0], target, "x-ms-blob-content-type: image/jpeg\r\n",
+                             (const uint8_t*)blockList.c_str(), blockList.length(), attempts);
+  }
+  upload->retries += attempts - 1;
+  return committed;
+}
+
+/**
+ * @brief Print queue depth, drop counters and the age of the oldest waiting frame.
+ */
+void printCaptureQueueStats() {
+  uint8_t depth = 0;
+  unsigned long oldestMs = 0;
+  bool haveOldest = false;
+  portENTER_CRITICAL(&frameQueueLock);
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state != FRAME_FREE) {
+      depth++;
+      if (!haveOldest || (long)(frameQueue[i].capturedMs - oldestMs) < 0) {
+        oldestMs = frameQueue[i].capturedMs;
+        haveOldest = true;
+      }
+    }
+  }
+  CaptureQueueStats stats = captureQueueStats;
+  portEXIT_CRITICAL(&frameQueueLock);
+
+  Serial.print("Queue: depth ");
+  Serial.print(depth);
+  Serial.print("/");
+  Serial.print(FRAME_QUEUE_DEPTH);
+  Serial.print(" (max ");
+  Serial.print(stats.maxDepth);
+  Serial.print("), oldest ");
+  Serial.print(haveOldest ? (millis() - oldestMs) / 1000 : 0);
+  Serial.print(" s | captured ");
+  Serial.print(stats.captured);
+  Serial.print(", uploaded ");
+  Serial.print(stats.uploaded);
+  Serial.print(", dropped ");
+  Serial.print(stats.droppedOldest);
+  Serial.print(" oldest / ");
+  Serial.print(stats.droppedNewest);
+  Serial.print(" newest, superseded ");
+  Serial.print(stats.superseded);
+  Serial.print(", failed uploads ");
+  Serial.println(stats.uploadFailures);
+}
+
+/**
+ * @brief Detach the oldest waiting (not uploading) frame from the queue.
+ *        Must be called with `frameQueueLock` held; the caller frees the returned buffer.
+ * @param slot Set to the freed slot index, or -1 if nothing could be dropped.
+ * @return The dropped frame's buffer, or nullptr.
+ */
+uint8_t* detachOldestQueuedFrame(int& slot) {
+  slot = -1;
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state == FRAME_QUEUED &&
+        (slot < 0 || frameQueue[i].sequence < frameQueue[slot].sequence)) {
+      slot = i;
+    }
+  }
+  if (slot < 0) {
+    return nullptr;
+  }
+  uint8_t* data = frameQueue[slot].data;
+  frameQueue[slot].data = nullptr;
+  frameQueue[slot].state = FRAME_FREE;
+  captureQueueStats.droppedOldest++;
+  return data;
+}
+
+/**
+ * @brief Uploader side of the capture queue. Uploads queued frames oldest first, reusing the warm
+ *        Azure connections for back-to-back frames, and keeps failed frames queued for a retry.
+ * @param param Unused.
+ */
+void frameUploaderTask(void* param) {
+  uint32_t batch = 0;  // Frames uploaded since the queue was last empty
+
+  while (true) {
+    int index = -1;
+    portENTER_CRITICAL(&frameQueueLock);
+    for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+      if (frameQueue[i].state == FRAME_QUEUED &&
+          (index < 0 || frameQueue[i].sequence < frameQueue[index].sequence)) {
+        index = i;
+      }
+    }
+    if (index >= 0) {
+      frameQueue[index].state = FRAME_UPLOADING;
+    }
+    portEXIT_CRITICAL(&frameQueueLock);
+
+    if (index < 0) {
+      if (batch > 1) {
+        Serial.print("✓ Drained backlog: ");
+        Serial.print(batch);
+        Serial.println(" frames uploaded back-to-back");
+      }
+      batch = 0;
+      xSemaphoreTake(frameQueued, portMAX_DELAY);
+      continue;
+    }
+
+    // Only the uploader touches an UPLOADING slot, so it can be read without the lock. The name is
+    // copied now: once the slot is FRAME_FREE a capture can reuse it while the result is printed.
+    QueuedFrame& frame = frameQueue[index];
+    char blobName[sizeof(frame.blobName)];
+    memcpy(blobName, frame.blobName, sizeof(blobName));
+    bool success = false;
+    uint32_t sent = 0;
+    unsigned long uploadStart = millis();
+    if (ensureWifi()) {
+      for (uint8_t i = 0; i < AZURE_CONNECTIONS; i++) {
+        azureConnections[i].handshakeMs = 0;
+        azureConnections[i].responseMs = 0;
+      }
+      String blobUrl = "/" + String(AZURE_CONTAINER) + "/" + blobName;
+      success = uploadChunkedParallel(frame.data, blobUrl, frame.length, false, sent);
+    }
+    unsigned long uploadMs = millis() - uploadStart;
+    unsigned long ageMs = millis() - frame.capturedMs;
+
+    uint8_t* uploaded = nullptr;
+    portENTER_CRITICAL(&frameQueueLock);
+    if (success) {
+      uploaded = frame.data;
+      frame.data = nullptr;
+      frame.state = FRAME_FREE;
+      captureQueueStats.uploaded++;
+    } else {
+      frame.state = FRAME_QUEUED;
+      captureQueueStats.uploadFailures++;
+    }
+    portEXIT_CRITICAL(&frameQueueLock);
+
+    if (success) {
+      heap_caps_free(uploaded);
+      batch++;
+      Serial.print("✓ Uploaded ");
+      Serial.print(blobName);
+      Serial.print(" (");
+      Serial.print(sent);
+      Serial.print(" bytes in ");
+      Serial.print(uploadMs);
+      Serial.print(" ms, ");
+      Serial.print(ageMs);
+      Serial.println(" ms after capture)");
+    } else {
+      Serial.println("✗ Queued upload failed; frame kept for retry");
+    }
+    printCaptureQueueStats();
+    if (!success) {
+      vTaskDelay(pdMS_TO_TICKS(FRAME_UPLOAD_RETRY_MS));
+    }
+  }
+}
+
+void initCaptureQueue() {
+  if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) == 0) {
+    Serial.println("⚠ No PSRAM; capture and upload run inline");
     return;
   }
+  frameQueued = xSemaphoreCreateBinary();
+  if (frameQueued == NULL ||
+      xTaskCreatePinnedToCore(frameUploaderTask, "FrameUpload", FRAME_UPLOADER_STACK, NULL,
+                              FRAME_UPLOADER_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS) {
+    Serial.println("⚠ Failed to start frame uploader; capture and upload run inline");
+    return;
+  }
+  captureQueueEnabled = true;
+  Serial.print("Capture queue: ");
+  Serial.print(FRAME_QUEUE_DEPTH);
+  Serial.println(FRAME_QUEUE_POLICY == DROP_OLDEST ? " frames in PSRAM, drop oldest when full"
+                                                    : " frames in PSRAM, drop newest when full");
+}
 
-  // Read HTTP status line (e.g., "HTTP/1.1 201 Created")
-  String statusLine = client.readStringUntil('\n');
-  statusLine.trim();
-  Serial.print("Azure response: ");
-  Serial.println(statusLine);
+bool captureToQueue(CAM_IMAGE_MODE resolution, bool useFixedName) {
+  CamStatus status = myCAM.takePicture(resolution, CAM_IMAGE_PIX_FMT_JPG);
+  if (status != CAM_ERR_SUCCESS) {
+    Serial.println("✗ Capture FAILED!");
+    Serial.print("Error code: ");
+    Serial.println(status);
+    return false;
+  }
 
-  // Print additional response headers/body for debugging
-  while (client.available()) {
-    String line = client.readStringUntil('\n');
-    line.trim();
-    if (line.length() > 0) {
-      Serial.print("  ");
-      Serial.println(line);
+  delay(100);
+
+  uint32_t imageSize = myCAM.getTotalLength();
+  if (imageSize == 0) {
+    Serial.println("✗ Image size is 0, nothing to queue");
+    return false;
+  }
+
+  // Make room in PSRAM; under DROP_OLDEST an old frame may give way to the new one
+  uint8_t* data = (uint8_t*)heap_caps_malloc(imageSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  while (data == nullptr && FRAME_QUEUE_POLICY == DROP_OLDEST) {
+    int slot;
+    portENTER_CRITICAL(&frameQueueLock);
+    uint8_t* dropped = detachOldestQueuedFrame(slot);
+    portEXIT_CRITICAL(&frameQueueLock);
+    if (dropped == nullptr) {
+      break;
     }
+    heap_caps_free(dropped);
+    data = (uint8_t*)heap_caps_malloc(imageSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  if (data == nullptr) {
+    portENTER_CRITICAL(&frameQueueLock);
+    captureQueueStats.droppedNewest++;
+    portEXIT_CRITICAL(&frameQueueLock);
+    Serial.println("✗ No PSRAM for frame; capture dropped");
+    printCaptureQueueStats();
+    return false;
   }
 
-  bool success = statusLine.startsWith("HTTP/1.1 201");
-  if (!success) {
-    Serial.println("✗ Upload did not return 201 Created");
+  // Read the JPEG into PSRAM, stopping at the end marker
+  uint32_t length = 0;
+  uint8_t prevByte = 0;
+  bool foundEnd = false;
+  while (length < imageSize && !foundEnd) {
+    uint32_t wanted = imageSize - length;
+    if (wanted > PIPELINE_SLOT_SIZE) {
+      wanted = PIPELINE_SLOT_SIZE;
+    }
+    uint32_t got = readJpegBlock(data + length, wanted, prevByte, foundEnd);
+    if (got == 0) {
+      break;
+    }
+    length += got;
+  }
+  if (length == 0) {
+    heap_caps_free(data);
+    Serial.println("✗ Camera FIFO returned no data");
+    return false;
+  }
+
+  // Queue it, applying the drop policy when every slot is taken
+  captureCounter++;
+  unsigned long capturedMs = millis();
+  uint8_t* rejected = nullptr;
+  uint8_t* dropped = nullptr;
+  uint8_t* superseded[FRAME_QUEUE_DEPTH];
+  uint8_t supersededCount = 0;
+  portENTER_CRITICAL(&frameQueueLock);
+  if (useFixedName) {
+    // This frame will overwrite the blob, so older fixed-name frames still waiting need not be sent
+    for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+      if (frameQueue[i].state == FRAME_QUEUED && strcmp(frameQueue[i].blobName, FIXED_BLOB_NAME) == 0) {
+        superseded[supersededCount++] = frameQueue[i].data;
+        frameQueue[i].data = nullptr;
+        frameQueue[i].state = FRAME_FREE;
+        captureQueueStats.superseded++;
+      }
+    }
+  }
+  int slot = -1;
+  for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+    if (frameQueue[i].state == FRAME_FREE) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0 && FRAME_QUEUE_POLICY == DROP_OLDEST) {
+    dropped = detachOldestQueuedFrame(slot);
+  }
+  if (slot < 0) {
+    rejected = data;
+    captureQueueStats.droppedNewest++;
   } else {
-    Serial.print("✓ Upload success (201 Created)");
-    Serial.println();
-    Serial.print("  Filename: ");
-    Serial.println(blobName);
+    QueuedFrame& frame = frameQueue[slot];
+    frame.data = data;
+    frame.length = length;
+    frame.capturedMs = capturedMs;
+    frame.sequence = ++frameSequence;
+    frame.state = FRAME_QUEUED;
+    if (useFixedName) {
+      snprintf(frame.blobName, sizeof(frame.blobName), "%s", FIXED_BLOB_NAME);
+    } else {
+      snprintf(frame.blobName, sizeof(frame.blobName), "image_%lu_%lu.jpg",
+               (unsigned long)captureCounter, capturedMs);
+    }
+    captureQueueStats.captured++;
+    uint8_t depth = 0;
+    for (uint8_t i = 0; i < FRAME_QUEUE_DEPTH; i++) {
+      if (frameQueue[i].state != FRAME_FREE) {
+        depth++;
+      }
+    }
+    if (depth > captureQueueStats.maxDepth) {
+      captureQueueStats.maxDepth = depth;
+    }
   }
+  portEXIT_CRITICAL(&frameQueueLock);
 
-  client.stop();
-  Serial.println();
+  for (uint8_t i = 0; i < supersededCount; i++) {
+    heap_caps_free(superseded[i]);
+  }
+  if (dropped != nullptr) {
+    heap_caps_free(dropped);
+  }
+  if (rejected != nullptr) {
+    heap_caps_free(rejected);
+    Serial.println("✗ Capture queue full; new frame dropped");
+    printCaptureQueueStats();
+    return false;
+  }
+
+  Serial.print("✓ Queued ");
+  Serial.print(length);
+  Serial.print(" bytes (FIFO ");
+  Serial.print(imageSize);
+  Serial.println(" bytes)");
+  printCaptureQueueStats();
+  xSemaphoreGive(frameQueued);
+  return true;
 }
+
 /**
  * @brief Capture a JPEG and stream it to Serial.
  *
@@ -0,0 +1,190 @@
+// =================================================
+// control_scheduler.h
+// Cooperative fixed-rate scheduler for the rover control loops, with
+// per-job execution-time, lateness and deadline-miss statistics.
+//
+// Overview:
+//   The sketches pace their work with scattered "now - lastXMs >= INTERVAL"
+//   checks, so nothing shows how late a control step really runs.  Instead,
+//   loop() registers each periodic job once with a period and a deadline and
+//   then calls runDue() on every pass:
+//
+//       scheduler.addJob("control", 5, 5, controlJob);
+//       scheduler.addJob("buzzer", 10, 10, buzzerJob);
+//       ...
+//       void loop() { scheduler.runDue(esp_timer_get_time()); }
+//
+//   Jobs run in registration order, so register the safety-critical ones
+//   first.  A job is released every period on a fixed grid (release times do
+//   not drift with its own execution time).  If a job falls more than a whole
+//   period behind, the missed releases are counted as skipped and the grid is
+//   moved to the current time instead of running the job back-to-back.
+//
+// Statistics per job:
+//   exec      – time the job function took.
+//   lateness  – release → start delay (jitter caused by the jobs ahead of it
+//               and by anything that blocked loop()).
+//   misses    – releases whose finish came later than release + deadline.
+//   Both exec and lateness are kept as histograms over SCHEDULER_HISTOGRAM_US
+//   so the tail, not just the maximum, is visible.  printStats() writes them
+//   to any Print (Serial, or a client/String in an HTTP handler).
+//
+// The time base is whatever runDue() is given (microseconds).  A virtual
+// clock works too: within one pass the real elapsed time is added on top,
+// unless setClock() supplies the clock to read before each job (for a
+// simulation whose virtual time moves while jobs run, so release decisions
+// do not depend on how fast the host is).
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Upper bounds (us) of the histogram buckets; the last bucket is open-ended.
+static const uint32_t SCHEDULER_HISTOGRAM_US[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+static const uint8_t SCHEDULER_HISTOGRAM_BUCKETS = sizeof(SCHEDULER_HISTOGRAM_US) / sizeof(SCHEDULER_HISTOGRAM_US[0]) + 1;
+
+typedef void (*ControlJobFn)(unsigned long nowMs);
+
+struct ControlJobStats {
+  uint32_t runs;
+  uint32_t deadlineMisses;
+  uint32_t skippedReleases;
+  uint64_t execTotalUs;
+  uint32_t execMaxUs;
+  uint64_t latenessTotalUs;
+  uint32_t latenessMaxUs;
+  uint32_t execHistogram[SCHEDULER_HISTOGRAM_BUCKETS];
+  uint32_t latenessHistogram[SCHEDULER_HISTOGRAM_BUCKETS];
+};
+
+struct ControlJob {
+  const char *name;
+  uint32_t periodUs;
+  uint32_t deadlineUs;
+  ControlJobFn run;
+  uint64_t nextReleaseUs;
+  ControlJobStats stats;
+};
+
+template <uint8_t MaxJobs>
+class ControlScheduler {
+ public:
+  // Registers a job; returns false when all MaxJobs slots are taken.
+  // The first release is one period after the first runDue() call.
+  bool addJob(const char *name, uint32_t periodMs, uint32_t deadlineMs, ControlJobFn run) {
+    if (jobCount_ >= MaxJobs) {
+      return false;
+    }
+    ControlJob &job = jobs_[jobCount_++];
+    job = {};
+    job.name = name;
+    job.periodUs = periodMs * 1000UL;
+    job.deadlineUs = deadlineMs * 1000UL;
+    job.run = run;
+    job.nextReleaseUs = UINT64_MAX;
+    return true;
+  }
+
+  // Start times within a pass come from clockUs instead of nowUs plus real elapsed time.
+  void setClock(uint64_t (*clockUs)()) { clockUs_ = clockUs; }
+
+  // Runs every job whose release time has come.  Returns how many ran.
+  uint8_t runDue(uint64_t nowUs) {
+    int64_t passStartRealUs = esp_timer_get_time();
+    uint8_t ran = 0;
+    for (uint8_t i = 0; i < jobCount_; i++) {
+      ControlJob &job = jobs_[i];
+      if (job.nextReleaseUs == UINT64_MAX) {
+        job.nextReleaseUs = nowUs + job.periodUs;
+      }
+      uint64_t startUs = clockUs_ != nullptr ? clockUs_() : nowUs + (uint64_t)(esp_timer_get_time() - passStartRealUs);
+      if (startUs < job.nextReleaseUs) {
+        continue;
+      }
+      uint64_t releaseUs = job.nextReleaseUs;
+      int64_t execStartRealUs = esp_timer_get_time();
+      job.run((unsigned long)(startUs / 1000ULL));
+      uint32_t execUs = (uint32_t)(esp_timer_get_time() - execStartRealUs);
+      uint32_t latenessUs = (uint32_t)(startUs - releaseUs);
+      recordRun(job.stats, execUs, latenessUs, latenessUs + execUs > job.deadlineUs);
+      job.nextReleaseUs = releaseUs + job.periodUs;
+      if (startUs >= job.nextReleaseUs) {
+        // More than a whole period behind: drop the missed releases rather than bursting.
+        uint64_t behindUs = startUs - job.nextReleaseUs;
+        job.stats.skippedReleases += (uint32_t)(behindUs / job.periodUs) + 1;
+        job.nextReleaseUs = startUs + job.periodUs;
+      }
+      ran++;
+    }
+    return ran;
+  }
+
+  // One summary line per job, then its exec and lateness histograms.
+  void printStats(Print &out) const {
+    out.print("Sched | histogram buckets (us):");
+    for (uint8_t b = 0; b + 1 < SCHEDULER_HISTOGRAM_BUCKETS; b++) {
+      out.printf(" <%lu", (unsigned long)SCHEDULER_HISTOGRAM_US[b]);
+    }
+    out.printf(" >=%lu\n", (unsigned long)SCHEDULER_HISTOGRAM_US[SCHEDULER_HISTOGRAM_BUCKETS - 2]);
+    for (uint8_t i = 0; i < jobCount_; i++) {
+      const ControlJob &job = jobs_[i];
+      const ControlJobStats &s = job.stats;
+      out.printf("Sched | %-8s period=%lu ms deadline=%lu ms runs=%lu misses=%lu skipped=%lu "
+                 "exec avg=%lu max=%lu us late avg=%lu max=%lu us\n",
+                 job.name, (unsigned long)(job.periodUs / 1000UL), (unsigned long)(job.deadlineUs / 1000UL),
+                 (unsigned long)s.runs, (unsigned long)s.deadlineMisses, (unsigned long)s.skippedReleases,
+                 (unsigned long)(s.runs > 0 ? s.execTotalUs / s.runs : 0), (unsigned long)s.execMaxUs,
+                 (unsigned long)(s.runs > 0 ? s.latenessTotalUs / s.runs : 0), (unsigned long)s.latenessMaxUs);
+      printHistogram(out, "exec", s.execHistogram);
+      printHistogram(out, "late", s.latenessHistogram);
+    }
+  }
+
+  void resetStats() {
+    for (uint8_t i = 0; i < jobCount_; i++) {
+      jobs_[i].stats = {};
+    }
+  }
+
+  uint8_t jobCount() const { return jobCount_; }
+  const ControlJob &job(uint8_t index) const { return jobs_[index]; }
+
+ private:
+  static uint8_t histogramBucket(uint32_t valueUs) {
+    uint8_t bucket = 0;
+    while (bucket + 1 < SCHEDULER_HISTOGRAM_BUCKETS && valueUs >= SCHEDULER_HISTOGRAM_US[bucket]) {
+      bucket++;
+    }
+    return bucket;
+  }
+
+  static void recordRun(ControlJobStats &s, uint32_t execUs, uint32_t latenessUs, bool missed) {
+    s.runs++;
+    s.execTotalUs += execUs;
+    s.latenessTotalUs += latenessUs;
+    if (execUs > s.execMaxUs) {
+      s.execMaxUs = execUs;
+    }
+    if (latenessUs > s.latenessMaxUs) {
+      s.latenessMaxUs = latenessUs;
+    }
+    if (missed) {
+      s.deadlineMisses++;
+    }
+    s.execHistogram[histogramBucket(execUs)]++;
+    s.latenessHistogram[histogramBucket(latenessUs)]++;
+  }
+
+  static void printHistogram(Print &out, const char *label, const uint32_t *histogram) {
+    out.printf("Sched |          %s", label);
+    for (uint8_t b = 0; b < SCHEDULER_HISTOGRAM_BUCKETS; b++) {
+      out.printf(" %lu", (unsigned long)histogram[b]);
+    }
+    out.println();
+  }
+
+  ControlJob jobs_[MaxJobs] = {};
+  uint8_t jobCount_ = 0;
+  uint64_t (*clockUs_)() = nullptr;
+};
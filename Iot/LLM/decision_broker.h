@@ -0,0 +1,378 @@
+// =================================================
+// decision_broker.h
+// Races one constrained-choice LLM request across several backends (Gemini,
+// Foundry, Ollama, ...) and keeps the first answer that passes validation.
+//
+// Overview:
+//   Each sketch used to wait on a single backend, so that backend's tail
+//   latency decided how long the rover sat stopped.  DecisionBroker sends the
+//   same prompt to every active backend at once and returns as soon as one
+//   of them produces a valid answer; the others are told to abort and close
+//   their connections.
+//
+//       DecisionBroker<2> broker;
+//       broker.addBackend("gemini", geminiRaceCall, 8192, 1);
+//       broker.addBackend("ollama", ollamaRaceCall, 8192, 0);
+//       ...
+//       int8_t winner;
+//       if (broker.race(prompt, isValidAnswer, &safeSet, 3000, answer, sizeof(answer), winner)) { ... }
+//
+//   Every backend runs its transport in its own task, so a slow TLS handshake
+//   on one never delays the others.  A transport writes the model text into
+//   the answer buffer it is given.  It must check backend.abortRequested()
+//   while it waits for data and return false soon after it turns true,
+//   closing its socket.  A handshake or request write already in progress
+//   cannot be cut short; the abort takes effect at the next read.
+//
+//   Answers are validated (schema / allowed-choice check) on the task that
+//   called race(), in the order they arrive, so validators need not be
+//   thread-safe.  race() uses the calling task's notification value.
+//
+// Statistics and demotion:
+//   Per backend: races entered, wins, invalid answers, transport failures,
+//   aborts, and p50/p95 latency over the last DECISION_BROKER_LATENCY_SAMPLES
+//   runs.  A run still going when race() gives up on it is recorded by race()
+//   itself, before it updates demotions, as slower than the winner's p95 (or
+//   as the full wait when nothing won); its task records nothing for it.
+//   After DECISION_BROKER_MIN_RACES races, a backend that wins less than
+//   DECISION_BROKER_DEMOTE_WIN_RATE of them while its p50 is slower than the
+//   fastest backend's p95 (or that has never finished in time) is demoted.
+//   A demoted backend only enters every DECISION_BROKER_PROBE_INTERVAL-th
+//   race, and is promoted again once its numbers no longer meet the demotion
+//   rule.  At least one backend always stays active.
+//
+//   A backend registered with a LatencyBreaker (latency_breaker.h) also sits
+//   out every race its circuit refuses, and allBreakersOpen() lets a call
+//   gate go local-only when no backend is currently worth asking.  Aborting
+//   a backend releases its breaker's half-open probe, since the transport
+//   does not record a cancelled call.
+//
+// Memory: every concurrent TLS connection needs ~40 KB of heap on ESP32, so
+// keep MaxBackends small; plain-HTTP LAN backends (Ollama) cost far less.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "latency_breaker.h"
+
+#ifndef DECISION_BROKER_ANSWER_BYTES
+#define DECISION_BROKER_ANSWER_BYTES 96
+#endif
+
+static const uint8_t DECISION_BROKER_LATENCY_SAMPLES = 32;
+static const uint32_t DECISION_BROKER_MIN_RACES = 8;
+static const float DECISION_BROKER_DEMOTE_WIN_RATE = 0.20f;
+static const uint32_t DECISION_BROKER_PROBE_INTERVAL = 5;
+
+struct DecisionBackend;
+// Sends prompt to one backend and writes the model's text into answer.
+// Returns false on any transport error or once an abort was requested.
+typedef bool (*DecisionBackendCall)(DecisionBackend &backend, const char *prompt, char *answer, size_t answerSize);
+// Schema / allowed-choice check for one answer; runs on the task calling race().
+typedef bool (*DecisionAnswerValidator)(const char *answer, void *context);
+
+struct DecisionBackendStats {
+  uint32_t races;
+  uint32_t wins;
+  uint32_t invalidAnswers;
+  uint32_t failures;
+  uint32_t aborted;
+  uint32_t latencyMs[DECISION_BROKER_LATENCY_SAMPLES];
+  uint8_t latencyCount;
+  uint8_t latencyNext;
+};
+
+struct DecisionBackend {
+  const char *name;
+  DecisionBackendCall call;
+  TaskHandle_t task;
+  LatencyBreaker *breaker;  // Optional; its transport records outcomes into it
+  bool demoted;
+  // Per-race hand-off.  The caller writes these before notifying the task;
+  // the task writes the result fields and sets done last.
+  const char *prompt;
+  TaskHandle_t waiter;
+  std::atomic<bool> busy{false};
+  std::atomic<bool> abort{false};
+  std::atomic<bool> done{false};
+  bool succeeded;
+  uint32_t elapsedMs;
+  char answer[DECISION_BROKER_ANSWER_BYTES];
+  // Shared with the backend's task; guarded by lock.  settled: the task has
+  // recorded this run, so race() must not record it as aborted.
+  DecisionBackendStats stats;
+  bool settled;
+  portMUX_TYPE *lock;
+
+  bool abortRequested() const { return abort.load(std::memory_order_acquire); }
+};
+
+// Latency percentile (0-100) of a backend's recent finishes; 0 when it has none.
+inline uint32_t decisionBackendPercentileMs(const DecisionBackendStats &stats, uint8_t percentile) {
+  uint32_t sorted[DECISION_BROKER_LATENCY_SAMPLES];
+  uint8_t count = stats.latencyCount;
+  if (count == 0) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t value = stats.latencyMs[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  return sorted[((uint16_t)(count - 1) * percentile) / 100];
+}
+
+// Adds one run to a backend's latency ring; the caller holds the backend's lock.
+inline void decisionBackendRecordLatency(DecisionBackendStats &stats, uint32_t latencyMs) {
+  stats.latencyMs[stats.latencyNext] = latencyMs;
+  stats.latencyNext = (stats.latencyNext + 1) % DECISION_BROKER_LATENCY_SAMPLES;
+  if (stats.latencyCount < DECISION_BROKER_LATENCY_SAMPLES) {
+    stats.latencyCount++;
+  }
+}
+
+inline void decisionBackendTaskMain(void *arg) {
+  DecisionBackend &backend = *static_cast<DecisionBackend *>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t startUs = esp_timer_get_time();
+    backend.answer[0] = '\0';
+    bool ok = backend.call(backend, backend.prompt, backend.answer, sizeof(backend.answer));
+    backend.answer[sizeof(backend.answer) - 1] = '\0';
+    uint32_t elapsedMs = (uint32_t)((esp_timer_get_time() - startUs) / 1000);
+    // Read under the lock so this task and race() agree on who records the run.
+    portENTER_CRITICAL(backend.lock);
+    bool aborted = backend.abortRequested();
+    DecisionBackendStats &s = backend.stats;
+    if (!aborted && !ok) {
+      s.failures++;
+    } else if (!aborted) {
+      decisionBackendRecordLatency(s, elapsedMs);
+    }
+    backend.settled = true;
+    portEXIT_CRITICAL(backend.lock);
+    backend.succeeded = ok && !aborted;
+    backend.elapsedMs = elapsedMs;
+    TaskHandle_t waiter = backend.waiter;
+    backend.done.store(true, std::memory_order_release);
+    backend.busy.store(false, std::memory_order_release);
+    xTaskNotifyGive(waiter);
+  }
+}
+
+template <uint8_t MaxBackends>
+class DecisionBroker {
+ public:
+  // Registers a backend and starts its task.  Returns false when all slots
+  // are taken or the task could not be created.  A backend with a breaker
+  // only enters races its breaker allows.
+  bool addBackend(const char *name, DecisionBackendCall call, uint32_t stackBytes, BaseType_t core,
+                  UBaseType_t priority = 1, LatencyBreaker *breaker = nullptr) {
+    if (backendCount_ >= MaxBackends) {
+      return false;
+    }
+    DecisionBackend &backend = backends_[backendCount_];
+    backend.name = name;
+    backend.call = call;
+    backend.breaker = breaker;
+    backend.lock = &lock_;
+    backend.demoted = false;
+    backend.stats = {};
+    if (xTaskCreatePinnedToCore(decisionBackendTaskMain, name, stackBytes, &backend, priority, &backend.task,
+                                core) != pdPASS) {
+      backend.task = nullptr;
+      return false;
+    }
+    backendCount_++;
+    return true;
+  }
+
+  // Sends prompt to every active backend and waits up to timeoutMs for the
+  // first answer that validate() accepts.  On success the answer is copied
+  // out, winner is its backend index, and the other backends are aborted.
+  // Backends still busy with an earlier race sit this one out.
+  bool race(const char *prompt, DecisionAnswerValidator validate, void *context, uint32_t timeoutMs, char *answer,
+            size_t answerSize, int8_t &winner) {
+    winner = -1;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    while (ulTaskNotifyTake(pdTRUE, 0) > 0) {
+    }
+    bool entered[MaxBackends] = {};
+    uint8_t entrants = 0;
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      DecisionBackend &backend = backends_[i];
+      bool probe = (raceCount_ % DECISION_BROKER_PROBE_INTERVAL) == 0;
+      if (backend.busy.load(std::memory_order_acquire) || (backend.demoted && !probe)) {
+        continue;
+      }
+      if (backend.breaker != nullptr && !backend.breaker->allowRequest(millis())) {
+        continue;
+      }
+      backend.prompt = prompt;
+      backend.waiter = self;
+      backend.succeeded = false;
+      backend.settled = false;
+      backend.abort.store(false, std::memory_order_relaxed);
+      backend.done.store(false, std::memory_order_relaxed);
+      backend.busy.store(true, std::memory_order_release);
+      entered[i] = true;
+      entrants++;
+      portENTER_CRITICAL(&lock_);
+      backend.stats.races++;
+      portEXIT_CRITICAL(&lock_);
+    }
+    if (entrants == 0) {
+      return false;
+    }
+    raceCount_++;
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      if (entered[i]) {
+        xTaskNotifyGive(backends_[i].task);
+      }
+    }
+
+    bool checked[MaxBackends] = {};
+    uint8_t finished = 0;
+    uint32_t startMs = millis();
+    while (winner < 0 && finished < entrants) {
+      uint32_t waitedMs = millis() - startMs;
+      if (waitedMs >= timeoutMs) {
+        break;
+      }
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs - waitedMs));
+      for (uint8_t i = 0; i < backendCount_ && winner < 0; i++) {
+        DecisionBackend &backend = backends_[i];
+        if (!entered[i] || checked[i] || !backend.done.load(std::memory_order_acquire)) {
+          continue;
+        }
+        checked[i] = true;
+        finished++;
+        if (!backend.succeeded) {
+          continue;
+        }
+        if (validate != nullptr && !validate(backend.answer, context)) {
+          portENTER_CRITICAL(&lock_);
+          backend.stats.invalidAnswers++;
+          portEXIT_CRITICAL(&lock_);
+          continue;
+        }
+        winner = (int8_t)i;
+        snprintf(answer, answerSize, "%s", backend.answer);
+      }
+    }
+    // A loser still running is recorded here, not by its task, so this race's demotion
+    // check already counts it: slower than the winner's p95, or the full wait without a winner.
+    uint32_t lostMs = millis() - startMs;
+    if (winner >= 0) {
+      uint32_t winnerP95 = decisionBackendPercentileMs(snapshotStats(winner), 95);
+      lostMs = lostMs > winnerP95 ? lostMs : winnerP95 + 1;
+    }
+    bool released[MaxBackends] = {};
+    portENTER_CRITICAL(&lock_);
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      DecisionBackend &backend = backends_[i];
+      if (!entered[i] || (int8_t)i == winner || backend.settled) {
+        continue;
+      }
+      backend.abort.store(true, std::memory_order_release);
+      backend.stats.aborted++;
+      decisionBackendRecordLatency(backend.stats, lostMs);
+      released[i] = true;
+    }
+    if (winner >= 0) {
+      backends_[winner].stats.wins++;
+    }
+    portEXIT_CRITICAL(&lock_);
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      if (released[i] && backends_[i].breaker != nullptr) {
+        backends_[i].breaker->releaseProbe();
+      }
+    }
+    updateDemotions();
+    return winner >= 0;
+  }
+
+  // One line per backend: state, races, win rate, failures, p50/p95.
+  void printStats(Print &out) {
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      DecisionBackendStats s = snapshotStats(i);
+      out.printf("Race | %-8s %s races=%lu wins=%lu (%.0f%%) invalid=%lu failed=%lu aborted=%lu p50=%lu p95=%lu ms\n",
+                 backends_[i].name, backends_[i].demoted ? "demoted" : "active ", (unsigned long)s.races,
+                 (unsigned long)s.wins, s.races > 0 ? (100.0f * s.wins) / s.races : 0.0f,
+                 (unsigned long)s.invalidAnswers, (unsigned long)s.failures, (unsigned long)s.aborted,
+                 (unsigned long)decisionBackendPercentileMs(s, 50), (unsigned long)decisionBackendPercentileMs(s, 95));
+    }
+  }
+
+  // True when every backend has a breaker and all of them refuse calls right
+  // now, so a race would only wait for the timeout.  The skipped call is
+  // counted against each breaker; refuseIfOpen() checks and counts in one
+  // step and never takes a half-open probe that no call would use.
+  bool allBreakersOpen(uint32_t nowMs) {
+    if (backendCount_ == 0) {
+      return false;
+    }
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      if (backends_[i].breaker == nullptr || !backends_[i].breaker->isRefusing(nowMs)) {
+        return false;
+      }
+    }
+    bool allOpen = true;
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      allOpen = backends_[i].breaker->refuseIfOpen(nowMs) && allOpen;
+    }
+    return allOpen;
+  }
+
+  uint8_t backendCount() const { return backendCount_; }
+  const DecisionBackend &backend(uint8_t index) const { return backends_[index]; }
+
+ private:
+  DecisionBackendStats snapshotStats(uint8_t index) {
+    portENTER_CRITICAL(&lock_);
+    DecisionBackendStats copy = backends_[index].stats;
+    portEXIT_CRITICAL(&lock_);
+    return copy;
+  }
+
+  void updateDemotions() {
+    uint32_t fastestP95 = UINT32_MAX;
+    int8_t fastest = -1;
+    DecisionBackendStats stats[MaxBackends];
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      stats[i] = snapshotStats(i);
+      uint32_t p95 = decisionBackendPercentileMs(stats[i], 95);
+      if (stats[i].latencyCount > 0 && p95 < fastestP95) {
+        fastestP95 = p95;
+        fastest = (int8_t)i;
+      }
+    }
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < backendCount_; i++) {
+      const DecisionBackendStats &s = stats[i];
+      bool slowLoser = s.races >= DECISION_BROKER_MIN_RACES && (int8_t)i != fastest &&
+                       (float)s.wins < DECISION_BROKER_DEMOTE_WIN_RATE * (float)s.races &&
+                       (s.latencyCount == 0 || decisionBackendPercentileMs(s, 50) > fastestP95);
+      backends_[i].demoted = slowLoser;
+      if (!slowLoser) {
+        active++;
+      }
+    }
+    if (active == 0 && backendCount_ > 0) {
+      backends_[fastest >= 0 ? fastest : 0].demoted = false;
+    }
+  }
+
+  DecisionBackend backends_[MaxBackends];
+  uint8_t backendCount_ = 0;
+  uint32_t raceCount_ = 0;
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
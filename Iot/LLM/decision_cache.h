@@ -0,0 +1,339 @@
+// =================================================
+// decision_cache.h
+// Remembers cloud maneuver plans under a quantized snapshot of the planner
+// inputs, so a situation the rover has already asked about is answered
+// locally in microseconds.
+//
+// Overview:
+//   llm-foundry and llm-nav-max each carried their own copy of this cache.
+//   The sketch owns the plan type and its sanitizing; the cache only keeps
+//   the plan's motions and durations, with a confidence that decays with
+//   age and is pushed up or down by the measured outcome of each plan it
+//   answered:
+//
+//       DecisionCache<ManeuverType, 24> decisionCache;
+//       decisionCache.begin(DECISION_CACHE_CONFIG);  // setup(): restore from NVS
+//       ...
+//       uint32_t key = decisionCache.key(left, front, right, trend, oscillation, repeatedTrap);
+//       if (decisionCache.lookup(key, millis(), plan)) { re-sanitize and run plan }
+//       ...
+//       int8_t slot = decisionCache.store(foundryPlan, key, millis());
+//       decisionCache.setActive(slot);               // this plan's outcome goes to the entry
+//       ...
+//       decisionCache.noteOutcome(lastPlanOutcome, millis());
+//       decisionCache.saveIfDirty(millis());
+//
+//   Key layout (32 bits):
+//     bits 0-3 left bucket, 4-7 front bucket, 8-11 right bucket,
+//     12-13 front trend (0 closing, 1 flat, 2 opening), 14-15 oscillation
+//     (capped at 3), bit 16 repeated trap.  Distance bucket 0 is an invalid
+//     reading, then one bucket per distanceBucketCm up to maxDistanceBucket.
+//
+//   Entries are replaced least recently used first.  A lookup is a linear
+//   pass over Size entries.  The NVS image is the entry array itself, so
+//   bump nvsVersion whenever DecisionCacheEntry changes layout.
+//
+// Not thread-safe: call everything from loop().
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+
+struct DecisionCacheConfig {
+  float minValidCm;              // Readings below this are invalid (distance bucket 0)
+  float distanceBucketCm;        // Width of one distance bucket
+  uint8_t maxDistanceBucket;     // Bucket for every distance beyond the last full one
+  float trendDeadbandCm;         // Front trend within ± this counts as flat
+  float minConfidence;           // Decayed confidence needed to answer (and to be stored)
+  unsigned long halfLifeMs;      // Cached confidence halves every halfLifeMs
+  float reward;                  // Confidence added when a cached plan improved clearance
+  float neutralDecay;            // Multiplier when a cached plan made no difference
+  float penalty;                 // Multiplier when a cached plan worsened clearance
+  float reloadDecay;             // Confidence multiplier for entries restored from NVS
+  bool persistToNvs;             // Keep the cache across reboots
+  const char *nvsNamespace;      // Preferences namespace for the entry array
+  unsigned long saveIntervalMs;  // Minimum gap between NVS writes (flash wear)
+  uint16_t nvsVersion;           // Stored with the entries; a mismatch discards them
+};
+
+struct DecisionCacheStats {
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t inserts;
+  uint32_t evictions;
+  uint32_t invalidations;        // Entries dropped after their plan worsened clearance
+  uint32_t foundryCalls;         // Cloud round-trips actually made this run
+  uint32_t foundryRoundTripTotalMs;
+  uint32_t lastLookupUs;
+};
+
+// One remembered plan.  Confidence is stored as of storedMs and decays with
+// age when read; lastUsedMs drives least-recently-used eviction.
+template <typename Motion>
+struct DecisionCacheEntry {
+  uint32_t key;                 // Packed quantized inputs (see DecisionCache::key)
+  Motion primary;               // Cached plan motions and durations
+  uint16_t primaryDurationMs;
+  Motion secondary;
+  uint16_t secondaryDurationMs;
+  float confidence;             // Confidence at storedMs, before age decay
+  unsigned long storedMs;       // When confidence was last set
+  unsigned long lastUsedMs;     // When the entry was last stored or hit
+  uint16_t hits;                // Times this entry answered instead of the cloud
+  bool valid;
+};
+
+template <typename Motion, uint8_t Size>
+class DecisionCache {
+ public:
+  // Restores the cache from NVS.  Timestamps from the previous run are
+  // meaningless after a reset, so restored entries restart their clocks now
+  // with confidence scaled by reloadDecay.
+  void begin(const DecisionCacheConfig &config) {
+    config_ = config;
+    if (!config_.persistToNvs || !prefs_.begin(config_.nvsNamespace, false)) {
+      return;
+    }
+    if (prefs_.getUShort("version", 0) != config_.nvsVersion ||
+        prefs_.getBytesLength("entries") != sizeof(entries_)) {
+      return;
+    }
+    prefs_.getBytes("entries", entries_, sizeof(entries_));
+    unsigned long nowMs = millis();
+    uint8_t restored = 0;
+    for (uint8_t i = 0; i < Size; ++i) {
+      if (!entries_[i].valid) {
+        continue;
+      }
+      entries_[i].confidence *= config_.reloadDecay;
+      entries_[i].storedMs = nowMs;
+      entries_[i].lastUsedMs = nowMs;
+      restored++;
+    }
+    Serial.print("Decision cache restored from NVS: ");
+    Serial.print(restored);
+    Serial.println(" entries");
+  }
+
+  uint32_t key(float leftCm, float frontCm, float rightCm, float frontTrendCm, uint8_t oscillation,
+               bool repeatedTrap) const {
+    uint32_t trendBucket = 1;
+    if (frontTrendCm <= -config_.trendDeadbandCm) {
+      trendBucket = 0;
+    } else if (frontTrendCm >= config_.trendDeadbandCm) {
+      trendBucket = 2;
+    }
+    if (oscillation > 3) {
+      oscillation = 3;
+    }
+    return (uint32_t)quantizeDistance(leftCm) |
+           ((uint32_t)quantizeDistance(frontCm) << 4) |
+           ((uint32_t)quantizeDistance(rightCm) << 8) |
+           (trendBucket << 12) |
+           ((uint32_t)oscillation << 14) |
+           ((uint32_t)(repeatedTrap ? 1 : 0) << 16);
+  }
+
+  // On a hit with enough decayed confidence, copies the cached motions,
+  // durations and confidence into plan (other fields are left as they are)
+  // and makes the entry the active one.  Any miss clears the active entry.
+  template <typename Plan>
+  bool lookup(uint32_t key, unsigned long nowMs, Plan &plan) {
+    unsigned long startUs = micros();
+    stats_.lookups++;
+    activeIndex_ = -1;
+    for (uint8_t i = 0; i < Size; ++i) {
+      DecisionCacheEntry<Motion> &entry = entries_[i];
+      if (!entry.valid || entry.key != key) {
+        continue;
+      }
+      float confidence = decayedConfidence(entry, nowMs);
+      if (confidence < config_.minConfidence) {
+        break;
+      }
+      plan.primary = entry.primary;
+      plan.primaryDurationMs = entry.primaryDurationMs;
+      plan.secondary = entry.secondary;
+      plan.secondaryDurationMs = entry.secondaryDurationMs;
+      plan.confidence = confidence;
+      entry.lastUsedMs = nowMs;
+      entry.hits++;
+      activeIndex_ = (int8_t)i;
+      stats_.hits++;
+      stats_.lastLookupUs = micros() - startUs;
+      return true;
+    }
+    stats_.misses++;
+    stats_.lastLookupUs = micros() - startUs;
+    return false;
+  }
+
+  // Remembers a plan for the snapshot behind key.  An existing entry for the
+  // same key is overwritten; otherwise a free slot or the least recently used
+  // entry is taken.  Returns the slot, or -1 if the plan's confidence is too
+  // low to keep.  The active entry is not changed; see setActive().
+  template <typename Plan>
+  int8_t store(const Plan &plan, uint32_t key, unsigned long nowMs) {
+    if (plan.confidence < config_.minConfidence) {
+      return -1;
+    }
+    int8_t slot = -1;
+    int8_t freeSlot = -1;
+    int8_t oldestSlot = 0;
+    for (uint8_t i = 0; i < Size; ++i) {
+      if (entries_[i].valid && entries_[i].key == key) {
+        slot = (int8_t)i;
+        break;
+      }
+      if (!entries_[i].valid) {
+        if (freeSlot < 0) {
+          freeSlot = (int8_t)i;
+        }
+      } else if ((nowMs - entries_[i].lastUsedMs) > (nowMs - entries_[oldestSlot].lastUsedMs)) {
+        oldestSlot = (int8_t)i;
+      }
+    }
+    if (slot < 0) {
+      slot = freeSlot;
+    }
+    if (slot < 0) {
+      slot = oldestSlot;
+      stats_.evictions++;
+    }
+    DecisionCacheEntry<Motion> &entry = entries_[slot];
+    entry.key = key;
+    entry.primary = plan.primary;
+    entry.primaryDurationMs = plan.primaryDurationMs;
+    entry.secondary = plan.secondary;
+    entry.secondaryDurationMs = plan.secondaryDurationMs;
+    entry.confidence = plan.confidence;
+    entry.storedMs = nowMs;
+    entry.lastUsedMs = nowMs;
+    entry.hits = 0;
+    entry.valid = true;
+    stats_.inserts++;
+    dirty_ = true;
+    return slot;
+  }
+
+  // Entry that collects the outcome of the plan about to run (-1 = none).
+  void setActive(int8_t slot) { activeIndex_ = slot; }
+
+  // Feeds the measured outcome of the executed plan back into the active
+  // entry: improved clearance (outcome > 0) reinforces it, no change decays
+  // it, and a worsened outcome scales it by penalty and drops the entry once
+  // it falls below minConfidence.  Clears the active entry.
+  void noteOutcome(int8_t outcome, unsigned long nowMs) {
+    if (activeIndex_ < 0) {
+      return;
+    }
+    DecisionCacheEntry<Motion> &entry = entries_[activeIndex_];
+    activeIndex_ = -1;
+    if (!entry.valid) {
+      return;
+    }
+    float confidence = decayedConfidence(entry, nowMs);
+    if (outcome > 0) {
+      confidence += config_.reward;
+      if (confidence > 1.0f) {
+        confidence = 1.0f;
+      }
+    } else if (outcome < 0) {
+      confidence *= config_.penalty;
+    } else {
+      confidence *= config_.neutralDecay;
+    }
+    entry.confidence = confidence;
+    entry.storedMs = nowMs;
+    if (confidence < config_.minConfidence && outcome < 0) {
+      entry.valid = false;
+      stats_.invalidations++;
+    }
+    dirty_ = true;
+  }
+
+  // Writes the entries to NVS when they changed, at most once per saveIntervalMs.
+  void saveIfDirty(unsigned long nowMs) {
+    if (!config_.persistToNvs || !dirty_) {
+      return;
+    }
+    if (savedMs_ != 0 && (nowMs - savedMs_) < config_.saveIntervalMs) {
+      return;
+    }
+    prefs_.putUShort("version", config_.nvsVersion);
+    prefs_.putBytes("entries", entries_, sizeof(entries_));
+    dirty_ = false;
+    savedMs_ = nowMs;
+  }
+
+  // Counts a cloud round trip the cache did not save, for the estimate in printStats().
+  void recordFoundryCall(uint32_t roundTripMs) {
+    stats_.foundryCalls++;
+    stats_.foundryRoundTripTotalMs += roundTripMs;
+  }
+
+  const DecisionCacheStats &stats() const { return stats_; }
+
+  // One telemetry line: hit rate, live entries, and how many cloud calls
+  // (and roughly how much round-trip time) the cache has saved this run.
+  void printStats(Print &out) const {
+    uint8_t liveEntries = 0;
+    for (uint8_t i = 0; i < Size; ++i) {
+      if (entries_[i].valid) {
+        liveEntries++;
+      }
+    }
+    uint32_t averageRoundTripMs = stats_.foundryCalls > 0 ? stats_.foundryRoundTripTotalMs / stats_.foundryCalls : 0;
+    out.print("Decision cache: hits=");
+    out.print(stats_.hits);
+    out.print(" misses=");
+    out.print(stats_.misses);
+    out.print(" hitRate=");
+    out.print(stats_.lookups > 0 ? (100.0f * stats_.hits / stats_.lookups) : 0.0f, 1);
+    out.print("% entries=");
+    out.print(liveEntries);
+    out.print(" inserts=");
+    out.print(stats_.inserts);
+    out.print(" evictions=");
+    out.print(stats_.evictions);
+    out.print(" invalidations=");
+    out.print(stats_.invalidations);
+    out.print(" lookupUs=");
+    out.print(stats_.lastLookupUs);
+    out.print(" foundryCalls=");
+    out.print(stats_.foundryCalls);
+    out.print(" cloudCallsSaved=");
+    out.print(stats_.hits);
+    out.print(" estSavedMs=");
+    out.println(stats_.hits * averageRoundTripMs);
+  }
+
+ private:
+  uint8_t quantizeDistance(float distanceCm) const {
+    if (distanceCm < config_.minValidCm) {
+      return 0;
+    }
+    int bucket = 1 + (int)(distanceCm / config_.distanceBucketCm);
+    if (bucket > config_.maxDistanceBucket) {
+      bucket = config_.maxDistanceBucket;
+    }
+    return (uint8_t)bucket;
+  }
+
+  // Confidence after age decay (halving every halfLifeMs).
+  float decayedConfidence(const DecisionCacheEntry<Motion> &entry, unsigned long nowMs) const {
+    float halfLives = (float)(nowMs - entry.storedMs) / (float)config_.halfLifeMs;
+    return entry.confidence * powf(0.5f, halfLives);
+  }
+
+  DecisionCacheConfig config_ = {};
+  DecisionCacheEntry<Motion> entries_[Size] = {};
+  DecisionCacheStats stats_ = {};
+  int8_t activeIndex_ = -1;
+  bool dirty_ = false;
+  unsigned long savedMs_ = 0;
+  Preferences prefs_;
+};
@@ -0,0 +1,54 @@
+// =================================================
+// distilled_policy.h
+// Generated by policy-distill.py – do not edit; re-run the tool on new logs.
+//
+// Decision tree fitted to logged Foundry decisions ("Distill sample:" lines
+// from llm-foundry.ino).  Internal nodes send a feature below threshold to
+// `below`, otherwise to `atOrAbove`; leaves hold the model's most common
+// plan there and a smoothed agreement used as the local confidence.
+//
+// Samples: 0 – placeholder until Distill sample logs are collected.  The
+// single leaf has zero confidence, so every decision still goes to Foundry.
+// =================================================
+#pragma once
+
+#include <stdint.h>
+
+// Inputs, in this order; llm-foundry.ino fills them in buildDistilledPolicyFeatures().
+enum DistilledPolicyFeature : uint8_t {
+  DISTILLED_FEATURE_LEFT_CM,
+  DISTILLED_FEATURE_FRONT_CM,
+  DISTILLED_FEATURE_RIGHT_CM,
+  DISTILLED_FEATURE_SIDE_DIFF_CM,
+  DISTILLED_FEATURE_FRONT_TREND_CM,
+  DISTILLED_FEATURE_OSCILLATION_COUNT,
+  DISTILLED_FEATURE_REPEATED_TRAP,
+  DISTILLED_FEATURE_LOCAL_PRIMARY,
+  DISTILLED_FEATURE_COUNT,
+};
+
+struct DistilledPolicyNode {
+  int8_t feature;      // DistilledPolicyFeature, or -1 for a leaf
+  float threshold;
+  uint8_t below;
+  uint8_t atOrAbove;
+  uint8_t primary;     // ManeuverType (leaves only)
+  uint8_t secondary;
+  float confidence;
+};
+
+constexpr DistilledPolicyNode DISTILLED_POLICY_NODES[] = {
+    {-1, 0.0f, 0, 0, 0, 0, 0.000f},  // 0: STOP then STOP, 0 samples
+};
+constexpr uint32_t DISTILLED_POLICY_SAMPLES = 0;
+constexpr float DISTILLED_POLICY_MIN_CONFIDENCE = 0.80f;
+
+// Leaf reached by features (DISTILLED_FEATURE_COUNT values).
+constexpr const DistilledPolicyNode &distilledPolicyLeaf(const float *features, uint8_t index = 0) {
+  return DISTILLED_POLICY_NODES[index].feature < 0
+             ? DISTILLED_POLICY_NODES[index]
+             : distilledPolicyLeaf(features, features[DISTILLED_POLICY_NODES[index].feature] <
+                                                     DISTILLED_POLICY_NODES[index].threshold
+                                                 ? DISTILLED_POLICY_NODES[index].below
+                                                 : DISTILLED_POLICY_NODES[index].atOrAbove);
+}
@@ -0,0 +1,72 @@
+// =================================================
+// llm-sweep-host.cpp
+// Linux entry point for llm-sweep's simulation and trace replay.
+//
+// Overview:
+//   The sketch is compiled unchanged against the shim headers in shim/,
+//   with ROVER_SIMULATION or ROVER_TRACE_REPLAY set by the Makefile.  main()
+//   calls setup() once and loop() until the run finishes, then turns the
+//   run's report into an exit status so `make check` can gate on it:
+//
+//     simulation – fails when the rover collided more than
+//                  ROVER_HOST_MAX_COLLISIONS times in the simulated room;
+//     replay     – fails when any pan, motor, reading or decision output
+//                  diverged from the recorded trace.
+// =================================================
+#include <unistd.h>
+#include "../llm-sweep.ino"
+
+#ifndef ROVER_HOST_MAX_COLLISIONS
+#define ROVER_HOST_MAX_COLLISIONS 0
+#endif
+
+#if ROVER_SIMULATION
+static bool hostRunFinished() {
+  return sim.finished;
+}
+static int hostExitStatus() {
+  return sim.collisions > ROVER_HOST_MAX_COLLISIONS ? 1 : 0;
+}
+#elif ROVER_TRACE_REPLAY
+static bool hostRunFinished() {
+  return replay.finished;
+}
+static int hostExitStatus() {
+  return replay.diverged ? 1 : 0;
+}
+#else
+#error "The host build runs the simulation or trace replay; set ROVER_SIMULATION or ROVER_TRACE_REPLAY to 1"
+#endif
+
+#if ROVER_SIMULATION
+// Simulated time runs thousands of times faster than the flush task's timer, so without this the
+// ring overflows at random points and two runs of the same seed record different traces.  Waiting
+// for the flush task to catch up keeps every run's trace byte-identical for `make replay`.
+static void hostDrainTraceRing(uint16_t maxQueued) {
+  while (traceFlushTaskHandle != nullptr &&
+         (uint16_t)((traceRingHead + TRACE_RING_RECORDS - traceRingTail) % TRACE_RING_RECORDS) > maxQueued) {
+    xTaskNotifyGive(traceFlushTaskHandle);
+    delay(1);
+  }
+}
+#endif
+
+int main() {
+  setup();
+  while (!hostRunFinished()) {
+    loop();
+#if ROVER_SIMULATION
+    hostDrainTraceRing(TRACE_RING_RECORDS / 4);
+#endif
+  }
+#if ROVER_SIMULATION
+  traceRecording = false;
+  hostDrainTraceRing(0);
+  traceFile.flush();
+#endif
+  // The log drain runs on a detached thread too; give it a moment to empty its ring.
+  delay(200);
+  roverReportSerial.flush();
+  fflush(stdout);
+  _exit(hostExitStatus());
+}
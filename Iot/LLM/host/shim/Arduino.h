@@ -0,0 +1,295 @@
+// =================================================
+// Arduino.h (host shim)
+// Just enough of the Arduino-ESP32 core for llm-sweep's simulation and
+// trace replay, and for the Arducam upload tests, to build and run as a
+// Linux process.
+//
+// Overview:
+//   Time comes from the host's monotonic clock, Serial writes to stdout,
+//   GPIO calls are no-ops, and random() is a seeded generator so simulated
+//   runs repeat exactly.  Only what the sketches use is here; a missing
+//   symbol is a build error, not a silent stub.
+// =================================================
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define DEC 10
+#define HEX 16
+#define IRAM_ATTR
+#define PROGMEM
+#define F(text) (text)
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+inline uint64_t hostMicros64() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+inline unsigned long millis() { return (unsigned long)(hostMicros64() / 1000); }
+inline unsigned long micros() { return (unsigned long)hostMicros64(); }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return LOW; }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void attachInterruptArg(int, void (*)(void *), void *, int) {}
+inline void detachInterrupt(int) {}
+
+inline std::mt19937 &hostRandomEngine() {
+  static std::mt19937 engine(1);
+  return engine;
+}
+inline void randomSeed(unsigned long seed) { hostRandomEngine().seed((uint32_t)seed); }
+inline long random(long low, long high) {
+  if (high <= low) {
+    return low;
+  }
+  return low + (long)(hostRandomEngine()() % (uint32_t)(high - low));
+}
+inline long random(long high) { return random(0, high); }
+
+template <class T, class U>
+auto min(T a, U b) -> decltype(a < b ? a : b) {
+  return a < b ? a : b;
+}
+template <class T, class U>
+auto max(T a, U b) -> decltype(a > b ? a : b) {
+  return a > b ? a : b;
+}
+template <class T, class L, class H>
+T constrain(T value, L low, H high) {
+  return value < low ? low : (value > high ? high : value);
+}
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+ public:
+  String(const char *text = "") : s_(text != nullptr ? text : "") {}
+  String(const std::string &text) : s_(text) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int value) : s_(std::to_string(value)) {}
+  explicit String(unsigned int value) : s_(std::to_string(value)) {}
+  explicit String(long value) : s_(std::to_string(value)) {}
+  explicit String(unsigned long value) : s_(std::to_string(value)) {}
+  explicit String(double value, unsigned char decimals = 2) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    s_ = buffer;
+  }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(unsigned int size) {
+    s_.reserve(size);
+    return true;
+  }
+  char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : '\0'; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  int indexOf(char c, unsigned int from = 0) const { return find(s_.find(c, from)); }
+  int indexOf(const String &text, unsigned int from = 0) const { return find(s_.find(text.s_, from)); }
+  int lastIndexOf(char c) const { return find(s_.rfind(c)); }
+  String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < to && from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  bool startsWith(const String &prefix) const { return s_.compare(0, prefix.s_.size(), prefix.s_) == 0; }
+  bool endsWith(const String &suffix) const {
+    return s_.size() >= suffix.s_.size() && s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+  }
+  void remove(unsigned int index) { remove(index, (unsigned int)s_.size()); }
+  void remove(unsigned int index, unsigned int count) {
+    if (index < s_.size()) {
+      s_.erase(index, count);
+    }
+  }
+  void trim() {
+    size_t first = s_.find_first_not_of(" \t\r\n");
+    size_t last = s_.find_last_not_of(" \t\r\n");
+    s_ = first == std::string::npos ? std::string() : s_.substr(first, last - first + 1);
+  }
+  void toUpperCase() {
+    for (char &c : s_) {
+      c = (char)toupper((unsigned char)c);
+    }
+  }
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  bool equals(const String &other) const { return s_ == other.s_; }
+  bool equalsIgnoreCase(const String &other) const {
+    if (s_.size() != other.s_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < s_.size(); i++) {
+      if (tolower((unsigned char)s_[i]) != tolower((unsigned char)other.s_[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  String &operator+=(const String &other) {
+    s_ += other.s_;
+    return *this;
+  }
+  String &operator+=(const char *text) {
+    s_ += text;
+    return *this;
+  }
+  String &operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  bool concat(const char *text, unsigned int length) {
+    s_.append(text, length);
+    return true;
+  }
+  bool operator==(const String &other) const { return s_ == other.s_; }
+  bool operator==(const char *text) const { return s_ == text; }
+  bool operator!=(const String &other) const { return s_ != other.s_; }
+  bool operator!=(const char *text) const { return s_ != text; }
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+  friend String operator+(const String &a, char b) { return String(a.s_ + b); }
+
+ private:
+  static int find(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written]) == 1) {
+      written++;
+    }
+    return written;
+  }
+  size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual void flush() {}
+
+  size_t print(const String &text) { return write(text.c_str()); }
+  size_t print(const char *text) { return write(text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC) { return base == DEC ? printf("%ld", value) : printf("%lx", value); }
+  size_t print(unsigned long value, int base = DEC) { return base == DEC ? printf("%lu", value) : printf("%lx", value); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+  size_t println() { return write("\r\n"); }
+  template <class T>
+  size_t println(const T &value) {
+    size_t written = print(value);
+    return written + println();
+  }
+  template <class T>
+  size_t println(T value, int format) {
+    size_t written = print(value, format);
+    return written + println();
+  }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char stackBuffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+    va_end(args);
+    if (length < 0) {
+      return 0;
+    }
+    if ((size_t)length < sizeof(stackBuffer)) {
+      return write((const uint8_t *)stackBuffer, length);
+    }
+    std::string heapBuffer(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)heapBuffer.data(), length);
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+  // Like the core's: stops at the terminator (not included) or after timeoutMs_ without a byte.
+  String readStringUntil(char terminator) {
+    std::string text;
+    unsigned long lastByteMs = millis();
+    while (millis() - lastByteMs < timeoutMs_) {
+      int c = read();
+      if (c < 0) {
+        delay(1);
+        continue;
+      }
+      if (c == terminator) {
+        break;
+      }
+      text += (char)c;
+      lastByteMs = millis();
+    }
+    return String(text);
+  }
+
+ protected:
+  unsigned long timeoutMs_ = 1000;
+};
+
+// stdout for output; input is never available, so Serial commands are not polled on the host.
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  using Print::write;
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+  void flush() override { fflush(stdout); }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  operator bool() const { return true; }
+};
+inline HardwareSerial Serial;
+
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
@@ -0,0 +1,462 @@
+// =================================================
+// ArduinoJson.h (host shim)
+// The slice of the ArduinoJson 7 API that llm-sweep and ollama_stream.h use,
+// over a small recursive JSON tree.
+//
+// Overview:
+//   JsonDocument owns the tree; doc["key"] returns a JsonVariant that looks
+//   the member up when read and creates it when assigned, like the real
+//   library.  deserializeJson() parses objects, arrays, strings, numbers,
+//   booleans and null; DeserializationOption::Filter is accepted and
+//   ignored (everything is kept).  serializeJson() writes compact JSON.
+//   The real header-only library also builds on Linux and can replace this
+//   file by putting it first on the include path.
+// =================================================
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+
+struct JsonNode {
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, OBJECT, ARRAY } type = NUL;
+  bool boolean = false;
+  double number = 0.0;
+  std::string text;
+  std::vector<std::string> keys;  // OBJECT member names, parallel to children
+  std::vector<std::shared_ptr<JsonNode>> children;
+
+  JsonNode *member(const std::string &key) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] == key) {
+        return children[i].get();
+      }
+    }
+    return nullptr;
+  }
+  JsonNode *addMember(const std::string &key) {
+    if (type != OBJECT) {
+      *this = JsonNode();
+      type = OBJECT;
+    }
+    JsonNode *existing = member(key);
+    if (existing != nullptr) {
+      return existing;
+    }
+    keys.push_back(key);
+    children.push_back(std::make_shared<JsonNode>());
+    return children.back().get();
+  }
+};
+
+class JsonObject;
+
+class JsonVariant {
+ public:
+  JsonVariant() {}
+  JsonVariant(JsonNode *node) : node_(node) {}
+  JsonVariant(JsonNode *parent, const std::string &key) : parent_(parent), key_(key) {}
+
+  JsonVariant operator[](const char *key) const { return JsonVariant(writableNode(), key); }
+  bool containsKey(const char *key) const {
+    JsonNode *node = resolve();
+    return node != nullptr && node->type == JsonNode::OBJECT && node->member(key) != nullptr;
+  }
+  size_t size() const {
+    JsonNode *node = resolve();
+    return node != nullptr ? node->children.size() : 0;
+  }
+  bool isNull() const {
+    JsonNode *node = resolve();
+    return node == nullptr || node->type == JsonNode::NUL;
+  }
+
+  template <class T>
+  bool is() const;
+  template <class T>
+  T as() const;
+  template <class T>
+  T to() const;
+
+  const char *operator|(const char *fallback) const {
+    JsonNode *node = resolve();
+    return node != nullptr && node->type == JsonNode::STRING ? node->text.c_str() : fallback;
+  }
+  bool operator|(bool fallback) const {
+    JsonNode *node = resolve();
+    return node != nullptr && node->type == JsonNode::BOOLEAN ? node->boolean : fallback;
+  }
+  double operator|(double fallback) const {
+    JsonNode *node = resolve();
+    return node != nullptr && node->type == JsonNode::NUMBER ? node->number : fallback;
+  }
+  long operator|(int fallback) const { return (long)(*this | (double)fallback); }
+
+  const JsonVariant &operator=(const char *value) const {
+    JsonNode *node = writableNode();
+    *node = JsonNode();
+    node->type = JsonNode::STRING;
+    node->text = value != nullptr ? value : "";
+    return *this;
+  }
+  const JsonVariant &operator=(bool value) const {
+    JsonNode *node = writableNode();
+    *node = JsonNode();
+    node->type = JsonNode::BOOLEAN;
+    node->boolean = value;
+    return *this;
+  }
+  const JsonVariant &operator=(double value) const {
+    JsonNode *node = writableNode();
+    *node = JsonNode();
+    node->type = JsonNode::NUMBER;
+    node->number = value;
+    return *this;
+  }
+  const JsonVariant &operator=(int value) const { return *this = (double)value; }
+  const JsonVariant &operator=(unsigned int value) const { return *this = (double)value; }
+  const JsonVariant &operator=(long value) const { return *this = (double)value; }
+  const JsonVariant &operator=(unsigned long value) const { return *this = (double)value; }
+
+  JsonNode *resolve() const {
+    if (node_ != nullptr) {
+      return node_;
+    }
+    return parent_ != nullptr && parent_->type == JsonNode::OBJECT ? parent_->member(key_) : nullptr;
+  }
+
+ protected:
+  JsonNode *writableNode() const {
+    if (node_ == nullptr && parent_ != nullptr) {
+      node_ = parent_->addMember(key_);
+    }
+    return node_;
+  }
+
+  mutable JsonNode *node_ = nullptr;
+  JsonNode *parent_ = nullptr;
+  std::string key_;
+};
+
+class JsonObject : public JsonVariant {
+ public:
+  JsonObject(JsonNode *node) : JsonVariant(node) {}
+  using JsonVariant::operator=;
+};
+
+template <>
+inline bool JsonVariant::is<const char *>() const {
+  JsonNode *node = resolve();
+  return node != nullptr && node->type == JsonNode::STRING;
+}
+template <>
+inline const char *JsonVariant::as<const char *>() const {
+  return *this | (const char *)nullptr;
+}
+template <>
+inline JsonObject JsonVariant::to<JsonObject>() const {
+  JsonNode *node = writableNode();
+  *node = JsonNode();
+  node->type = JsonNode::OBJECT;
+  return JsonObject(node);
+}
+
+class JsonDocument : public JsonVariant {
+ public:
+  JsonDocument() : root_(std::make_shared<JsonNode>()) { node_ = root_.get(); }
+  JsonDocument(const JsonDocument &) = delete;
+  JsonDocument &operator=(const JsonDocument &) = delete;
+  void clear() { *root_ = JsonNode(); }
+
+ private:
+  std::shared_ptr<JsonNode> root_;
+};
+
+template <size_t Capacity>
+class StaticJsonDocument : public JsonDocument {};
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, TooDeep };
+  DeserializationError(Code code = Ok) : code_(code) {}
+  explicit operator bool() const { return code_ != Ok; }
+  Code code() const { return code_; }
+  const char *c_str() const {
+    static const char *const names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "TooDeep"};
+    return names[code_];
+  }
+
+ private:
+  Code code_;
+};
+
+namespace DeserializationOption {
+struct Filter {
+  explicit Filter(const JsonDocument &) {}
+};
+}  // namespace DeserializationOption
+
+// Recursive-descent parser over a character source with next()/peek() (-1 at the end).
+template <class Source>
+class JsonHostParser {
+ public:
+  explicit JsonHostParser(Source &source) : source_(source) {}
+
+  DeserializationError parse(JsonNode &out) {
+    skipSpace();
+    if (source_.peek() < 0) {
+      return DeserializationError::EmptyInput;
+    }
+    return value(out, 0);
+  }
+
+ private:
+  static const int MAX_DEPTH = 10;
+
+  void skipSpace() {
+    while (source_.peek() >= 0 && isspace(source_.peek())) {
+      source_.next();
+    }
+  }
+  DeserializationError endOrInvalid() {
+    return source_.peek() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+  }
+  bool literal(const char *word) {
+    for (const char *p = word; *p != '\0'; p++) {
+      if (source_.next() != *p) {
+        return false;
+      }
+    }
+    return true;
+  }
+  DeserializationError string(std::string &out) {
+    source_.next();  // opening quote
+    while (true) {
+      int c = source_.next();
+      if (c < 0) {
+        return DeserializationError::IncompleteInput;
+      }
+      if (c == '"') {
+        return DeserializationError::Ok;
+      }
+      if (c == '\\') {
+        c = source_.next();
+        switch (c) {
+          case 'n':
+            c = '\n';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'f':
+            c = '\f';
+            break;
+          case 'u': {
+            char hex[5] = {};
+            for (int i = 0; i < 4; i++) {
+              hex[i] = (char)source_.next();
+            }
+            c = (int)strtol(hex, nullptr, 16);
+            if (c > 0x7f) {
+              c = '?';  // Non-ASCII escapes are not needed by the sketch
+            }
+            break;
+          }
+          default:
+            if (c < 0) {
+              return DeserializationError::IncompleteInput;
+            }
+            break;  // \" \\ \/
+        }
+      }
+      out += (char)c;
+    }
+  }
+  DeserializationError value(JsonNode &out, int depth) {
+    if (depth > MAX_DEPTH) {
+      return DeserializationError::TooDeep;
+    }
+    skipSpace();
+    int c = source_.peek();
+    if (c == '{' || c == '[') {
+      bool object = c == '{';
+      int close = object ? '}' : ']';
+      out.type = object ? JsonNode::OBJECT : JsonNode::ARRAY;
+      source_.next();
+      skipSpace();
+      if (source_.peek() == close) {
+        source_.next();
+        return DeserializationError::Ok;
+      }
+      while (true) {
+        skipSpace();
+        std::string key;
+        if (object) {
+          if (source_.peek() != '"') {
+            return endOrInvalid();
+          }
+          DeserializationError err = string(key);
+          if (err) {
+            return err;
+          }
+          skipSpace();
+          if (source_.next() != ':') {
+            return endOrInvalid();
+          }
+        }
+        out.keys.push_back(key);
+        out.children.push_back(std::make_shared<JsonNode>());
+        DeserializationError err = value(*out.children.back(), depth + 1);
+        if (err) {
+          return err;
+        }
+        skipSpace();
+        int separator = source_.next();
+        if (separator == close) {
+          return DeserializationError::Ok;
+        }
+        if (separator != ',') {
+          return separator < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+        }
+      }
+    }
+    if (c == '"') {
+      out.type = JsonNode::STRING;
+      return string(out.text);
+    }
+    if (c == 't' || c == 'f') {
+      out.type = JsonNode::BOOLEAN;
+      out.boolean = c == 't';
+      return literal(out.boolean ? "true" : "false") ? DeserializationError::Ok : endOrInvalid();
+    }
+    if (c == 'n') {
+      return literal("null") ? DeserializationError::Ok : endOrInvalid();
+    }
+    std::string number;
+    while (source_.peek() >= 0 && strchr("+-0123456789.eE", source_.peek()) != nullptr) {
+      number += (char)source_.next();
+    }
+    if (number.empty()) {
+      return endOrInvalid();
+    }
+    out.type = JsonNode::NUMBER;
+    out.number = atof(number.c_str());
+    return DeserializationError::Ok;
+  }
+
+  Source &source_;
+};
+
+struct JsonHostBufferSource {
+  const char *text;
+  size_t length;
+  size_t index;
+  int peek() const { return index < length ? (unsigned char)text[index] : -1; }
+  int next() { return index < length ? (unsigned char)text[index++] : -1; }
+};
+
+// Reads one value from a Stream, waiting up to its timeout for each byte like the real library.
+struct JsonHostStreamSource {
+  Stream &stream;
+  int peeked;
+  int peek() {
+    if (peeked == -2) {
+      peeked = readWithTimeout();
+    }
+    return peeked;
+  }
+  int next() {
+    int c = peek();
+    peeked = -2;
+    return c;
+  }
+  int readWithTimeout() {
+    unsigned long startMs = millis();
+    while (stream.available() <= 0) {
+      if (millis() - startMs >= 1000) {
+        return -1;
+      }
+      delay(1);
+    }
+    return stream.read();
+  }
+};
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *text, size_t length) {
+  doc.clear();
+  JsonHostBufferSource source = {text, length, 0};
+  return JsonHostParser<JsonHostBufferSource>(source).parse(*doc.resolve());
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, Stream &stream, DeserializationOption::Filter) {
+  doc.clear();
+  JsonHostStreamSource source = {stream, -2};
+  return JsonHostParser<JsonHostStreamSource>(source).parse(*doc.resolve());
+}
+
+inline void serializeJsonNode(const JsonNode &node, std::string &out) {
+  switch (node.type) {
+    case JsonNode::BOOLEAN:
+      out += node.boolean ? "true" : "false";
+      return;
+    case JsonNode::NUMBER: {
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "%.9g", node.number);
+      out += buffer;
+      return;
+    }
+    case JsonNode::STRING:
+      out += '"';
+      for (char c : node.text) {
+        if (c == '"' || c == '\\') {
+          out += '\\';
+          out += c;
+        } else if (c == '\n') {
+          out += "\\n";
+        } else if ((unsigned char)c < 0x20) {
+          char escape[8];
+          snprintf(escape, sizeof(escape), "\\u%04x", c);
+          out += escape;
+        } else {
+          out += c;
+        }
+      }
+      out += '"';
+      return;
+    case JsonNode::OBJECT:
+    case JsonNode::ARRAY:
+      out += node.type == JsonNode::OBJECT ? '{' : '[';
+      for (size_t i = 0; i < node.children.size(); i++) {
+        if (i > 0) {
+          out += ',';
+        }
+        if (node.type == JsonNode::OBJECT) {
+          JsonNode key;
+          key.type = JsonNode::STRING;
+          key.text = node.keys[i];
+          serializeJsonNode(key, out);
+          out += ':';
+        }
+        serializeJsonNode(*node.children[i], out);
+      }
+      out += node.type == JsonNode::OBJECT ? '}' : ']';
+      return;
+    default:
+      out += "null";
+      return;
+  }
+}
+
+inline size_t serializeJson(const JsonDocument &doc, String &out) {
+  std::string text;
+  serializeJsonNode(*doc.resolve(), text);
+  out = String(text);
+  return text.size();
+}
@@ -0,0 +1,19 @@
+// ESP32Servo.h (host shim): a servo that remembers its last angle.  The
+// simulation reads pan angles through the sketch's HAL, not from here.
+#pragma once
+
+class Servo {
+ public:
+  void setPeriodHertz(int) {}
+  int attach(int pin, int = 500, int = 2500) {
+    attached_ = true;
+    return pin;
+  }
+  bool attached() const { return attached_; }
+  void write(int angleDeg) { angleDeg_ = angleDeg; }
+  int read() const { return angleDeg_; }
+
+ private:
+  bool attached_ = false;
+  int angleDeg_ = 90;
+};
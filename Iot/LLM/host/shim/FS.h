@@ -0,0 +1,94 @@
+// =================================================
+// FS.h (host shim)
+// Arduino fs::File / fs::FS over ordinary host files.
+//
+// Overview:
+//   Paths are resolved under the directory in $ROVER_HOST_FS (default
+//   ./littlefs), so "/trace.bin" on the rover is littlefs/trace.bin here.
+//   File is a shared handle like the ESP32 core's, so copies refer to the
+//   same open file.
+// =================================================
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <string>
+#include <Arduino.h>
+
+namespace fs {
+
+inline std::string hostPath(const char *path) {
+  const char *root = getenv("ROVER_HOST_FS");
+  return std::string(root != nullptr ? root : "littlefs") + path;
+}
+
+class File : public Stream {
+ public:
+  File() {}
+  explicit File(FILE *handle) : handle_(handle, fclose) {}
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return handle_ ? fwrite(buffer, 1, size, handle_.get()) : 0;
+  }
+  size_t read(uint8_t *buffer, size_t size) { return handle_ ? fread(buffer, 1, size, handle_.get()) : 0; }
+  int read() override {
+    uint8_t c = 0;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int peek() override {
+    int c = read();
+    if (c >= 0) {
+      ungetc(c, handle_.get());
+    }
+    return c;
+  }
+  int available() override { return handle_ ? (int)(size() - position()) : 0; }
+  void flush() override {
+    if (handle_) {
+      fflush(handle_.get());
+    }
+  }
+  bool seek(uint32_t position) { return handle_ && fseek(handle_.get(), position, SEEK_SET) == 0; }
+  size_t position() const { return handle_ ? (size_t)ftell(handle_.get()) : 0; }
+  size_t size() const {
+    if (!handle_) {
+      return 0;
+    }
+    long here = ftell(handle_.get());
+    fseek(handle_.get(), 0, SEEK_END);
+    long end = ftell(handle_.get());
+    fseek(handle_.get(), here, SEEK_SET);
+    return (size_t)end;
+  }
+  void close() { handle_.reset(); }
+  operator bool() const { return (bool)handle_; }
+
+ private:
+  std::shared_ptr<FILE> handle_;
+};
+
+class FS {
+ public:
+  File open(const char *path, const char *mode = "r") {
+    std::string fopenMode = std::string(mode) + "b";
+    FILE *handle = fopen(hostPath(path).c_str(), fopenMode.c_str());
+    return handle != nullptr ? File(handle) : File();
+  }
+  bool exists(const char *path) {
+    FILE *handle = fopen(hostPath(path).c_str(), "rb");
+    if (handle == nullptr) {
+      return false;
+    }
+    fclose(handle);
+    return true;
+  }
+  bool remove(const char *path) { return ::remove(hostPath(path).c_str()) == 0; }
+  bool rename(const char *from, const char *to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+};
+
+}  // namespace fs
+
+using fs::File;
@@ -0,0 +1,20 @@
+// HTTPClient.h (host shim): every request fails to connect.
+#pragma once
+
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient {
+ public:
+  bool begin(const String &) { return true; }
+  void end() {}
+  void addHeader(const String &, const String &) {}
+  void setTimeout(uint16_t) {}
+  void useHTTP10(bool = true) {}
+  int POST(const String &) { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  String getString() { return String(); }
+  WiFiClient *getStreamPtr() { return nullptr; }
+};
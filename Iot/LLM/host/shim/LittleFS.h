@@ -0,0 +1,19 @@
+// LittleFS.h (host shim): the LittleFS mount is the $ROVER_HOST_FS directory.
+#pragma once
+
+#include <sys/stat.h>
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+ public:
+  // Like the real mount, begin(true) "formats" (creates) a missing root.
+  bool begin(bool formatOnFail = false) {
+    struct stat info;
+    std::string root = fs::hostPath("");
+    if (stat(root.c_str(), &info) == 0) {
+      return S_ISDIR(info.st_mode);
+    }
+    return formatOnFail && mkdir(root.c_str(), 0755) == 0;
+  }
+};
+inline LittleFSFS LittleFS;
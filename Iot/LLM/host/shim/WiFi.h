@@ -0,0 +1,40 @@
+// =================================================
+// WiFi.h (host shim)
+// A station that never associates and a client that never connects, so the
+// host build always runs llm-sweep's local-only decision path.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+
+#define WIFI_STA 1
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class IPAddress {
+ public:
+  operator String() const { return String("0.0.0.0"); }
+};
+
+class WiFiClient : public Stream {
+ public:
+  virtual int connect(const char *, uint16_t) { return 0; }
+  virtual uint8_t connected() { return 0; }
+  virtual void stop() {}
+  using Print::write;
+  size_t write(uint8_t) override { return 0; }
+  size_t write(const uint8_t *, size_t) override { return 0; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+class WiFiClass {
+ public:
+  void mode(int) {}
+  void begin(const char *, const char *) {}
+  int status() { return WL_DISCONNECTED; }
+  IPAddress localIP() { return IPAddress(); }
+};
+inline WiFiClass WiFi;
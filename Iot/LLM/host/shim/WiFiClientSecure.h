@@ -0,0 +1,9 @@
+// WiFiClientSecure.h (host shim): TLS client that, like WiFiClient here, never connects.
+#pragma once
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setInsecure() {}
+};
@@ -0,0 +1,6 @@
+// driver/gpio.h (host shim): no pins on the host; every input reads low.
+#pragma once
+
+typedef int gpio_num_t;
+
+inline int gpio_get_level(gpio_num_t) { return 0; }
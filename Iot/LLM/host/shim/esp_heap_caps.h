@@ -0,0 +1,44 @@
+// esp_heap_caps.h (host shim): heap diagnostics and the ESP object.  The host
+// heap is not the rover's, so the figures are fixed placeholders.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+static const size_t HOST_REPORTED_FREE_HEAP = 256 * 1024;
+
+// Capability flags are ignored; every request comes from the host heap.
+inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void heap_caps_free(void *block) { free(block); }
+inline size_t heap_caps_get_free_size(uint32_t) { return HOST_REPORTED_FREE_HEAP; }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return HOST_REPORTED_FREE_HEAP; }
+inline void heap_caps_get_info(multi_heap_info_t *info, uint32_t) {
+  *info = {HOST_REPORTED_FREE_HEAP, 0, HOST_REPORTED_FREE_HEAP, HOST_REPORTED_FREE_HEAP, 0, 1, 1};
+}
+
+struct EspClass {
+  uint32_t getFreeHeap() { return HOST_REPORTED_FREE_HEAP; }
+  uint32_t getMinFreeHeap() { return HOST_REPORTED_FREE_HEAP; }
+  // Nanoseconds stand in for CPU cycles, so cycle counts read as ns on the host.
+  uint32_t getCycleCount() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+};
+inline EspClass ESP;
@@ -0,0 +1,9 @@
+// esp_system.h (host shim): hardware RNG stand-in.
+#pragma once
+
+#include <random>
+
+inline uint32_t esp_random() {
+  static std::random_device device;
+  return device();
+}
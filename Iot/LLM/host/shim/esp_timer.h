@@ -0,0 +1,6 @@
+// esp_timer.h (host shim): microseconds since the process started.
+#pragma once
+
+#include <Arduino.h>
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMicros64(); }
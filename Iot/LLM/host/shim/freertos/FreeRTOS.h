@@ -0,0 +1,39 @@
+// =================================================
+// freertos/FreeRTOS.h (host shim)
+// FreeRTOS types and critical sections for the Linux build of llm-sweep.
+//
+// Overview:
+//   Tasks are std::threads (freertos/task.h) and queues are mutex-guarded
+//   FIFOs (freertos/queue.h).  A portMUX spinlock becomes a recursive mutex,
+//   so critical sections still exclude the other "tasks".  One tick is one
+//   millisecond.
+// =================================================
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define tskIDLE_PRIORITY 0
+
+struct portMUX_TYPE {
+  std::recursive_mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+#define portYIELD_FROM_ISR(...)
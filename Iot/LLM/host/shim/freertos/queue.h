@@ -0,0 +1,76 @@
+// =================================================
+// freertos/queue.h (host shim)
+// Fixed-depth, copy-by-value FreeRTOS queues over a mutex and condition
+// variable.  The FromISR variants behave like their task versions.
+// =================================================
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <vector>
+#include "FreeRTOS.h"
+
+struct HostQueue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t depth;
+  UBaseType_t itemSize;
+};
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t depth, UBaseType_t itemSize) {
+  HostQueue *queue = new HostQueue();
+  queue->depth = depth;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+inline BaseType_t hostQueuePush(QueueHandle_t queue, const void *item, bool overwrite) {
+  {
+    std::lock_guard<std::mutex> guard(queue->mutex);
+    if (queue->items.size() >= queue->depth) {
+      if (!overwrite) {
+        return pdFAIL;
+      }
+      queue->items.pop_front();
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  }
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+// Sends never block on the host; the sketch only sends with a zero wait.
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t) {
+  return hostQueuePush(queue, item, false);
+}
+inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken != nullptr) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+  return hostQueuePush(queue, item, false);
+}
+inline BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) { return hostQueuePush(queue, item, true); }
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  auto ready = [queue]() { return !queue->items.empty(); };
+  if (ticksToWait == portMAX_DELAY) {
+    queue->changed.wait(lock, ready);
+  } else if (!queue->changed.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready)) {
+    return pdFAIL;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdPASS;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->mutex);
+  queue->items.clear();
+  return pdPASS;
+}
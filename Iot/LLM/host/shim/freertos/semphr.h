@@ -0,0 +1,53 @@
+// =================================================
+// freertos/semphr.h (host shim)
+// Binary, counting and mutex semaphores as a count under a mutex and
+// condition variable.  A mutex is a binary semaphore that starts given;
+// priority inheritance does not exist on the host.
+// =================================================
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "FreeRTOS.h"
+
+struct HostSemaphore {
+  std::mutex mutex;
+  std::condition_variable given;
+  UBaseType_t count;
+  UBaseType_t maxCount;
+};
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+  HostSemaphore *semaphore = new HostSemaphore();
+  semaphore->count = initialCount;
+  semaphore->maxCount = maxCount;
+  return semaphore;
+}
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  {
+    std::lock_guard<std::mutex> guard(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount) {
+      return pdFAIL;
+    }
+    semaphore->count++;
+  }
+  semaphore->given.notify_one();
+  return pdPASS;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  auto available = [semaphore]() { return semaphore->count > 0; };
+  if (ticksToWait == portMAX_DELAY) {
+    semaphore->given.wait(lock, available);
+  } else if (!semaphore->given.wait_for(lock, std::chrono::milliseconds(ticksToWait), available)) {
+    return pdFAIL;
+  }
+  semaphore->count--;
+  return pdPASS;
+}
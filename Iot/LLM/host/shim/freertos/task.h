@@ -0,0 +1,86 @@
+// =================================================
+// freertos/task.h (host shim)
+// Tasks as detached std::threads with FreeRTOS-style direct notifications.
+//
+// Overview:
+//   Priorities, core affinity and stack sizes are ignored; the host
+//   scheduler runs every task.  Each task (and the thread that runs setup()
+//   and loop()) has a notification counter that xTaskNotifyGive() bumps and
+//   ulTaskNotifyTake() waits on.
+// =================================================
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "FreeRTOS.h"
+
+struct HostTask {
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notifyCount = 0;
+};
+typedef HostTask *TaskHandle_t;
+
+inline HostTask *&hostCurrentTask() {
+  thread_local HostTask *current = nullptr;
+  return current;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  HostTask *&current = hostCurrentTask();
+  if (current == nullptr) {
+    current = new HostTask();  // setup()/loop() thread, or a thread not started by xTaskCreate*
+  }
+  return current;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *, uint32_t, void *parameter,
+                                          UBaseType_t, TaskHandle_t *handle, BaseType_t) {
+  HostTask *task = new HostTask();
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  std::thread([function, parameter, task]() {
+    hostCurrentTask() = task;
+    function(parameter);
+  }).detach();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackBytes, void *parameter,
+                              UBaseType_t priority, TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(function, name, stackBytes, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+// Only a task deleting itself is supported, and it must be the task function's last statement:
+// the thread ends when the function returns.
+inline void vTaskDelete(TaskHandle_t task) { (void)task; }
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> guard(task->mutex);
+    task->notifyCount++;
+  }
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  auto pending = [task]() { return task->notifyCount > 0; };
+  if (ticksToWait == portMAX_DELAY) {
+    task->notified.wait(lock, pending);
+  } else {
+    task->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait), pending);
+  }
+  uint32_t count = task->notifyCount;
+  if (count > 0) {
+    task->notifyCount = clearOnExit ? 0 : count - 1;
+  }
+  return count;
+}
@@ -0,0 +1,6 @@
+// gemini_config.h (host shim): placeholder used only when the sketch folder has
+// no gemini_config.h; the host build never reaches the network.
+#pragma once
+
+#define GEMINI_URL "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent"
+#define GEMINI_API_KEY ""
@@ -0,0 +1,10 @@
+// ultrasonic.h (host shim): a sensor that never hears an echo.  Simulation and
+// replay supply ranging through the sketch's HAL instead.
+#pragma once
+
+class ultrasonic {
+ public:
+  void Init(int, int) {}
+  float Ranging() { return -1.0f; }
+  unsigned long LastPulseWidthUs() { return 0; }
+};
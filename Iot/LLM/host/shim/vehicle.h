@@ -0,0 +1,19 @@
+// vehicle.h (host shim): the ACEBOTT direction codes llm-sweep uses (the
+// values trace-decode.py decodes) and a chassis that ignores motor commands.
+// The simulation drives its own kinematics through the sketch's HAL.
+#pragma once
+
+enum {
+  Stop = 0,
+  Backward = 92,
+  Move_Left = 106,
+  Move_Right = 149,
+  Forward = 163,
+};
+
+class vehicle {
+ public:
+  void Init() {}
+  void Move(int, int) {}
+  void MoveBalanced(int, int, int) {}
+};
@@ -0,0 +1,5 @@
+// wifi_config.h (host shim): placeholder used only when the sketch folder has no wifi_config.h.
+#pragma once
+
+#define WIFI_SSID ""
+#define WIFI_PASSWORD ""
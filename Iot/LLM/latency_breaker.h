@@ -0,0 +1,322 @@
+// =================================================
+// latency_breaker.h
+// Latency-budget circuit breaker for one cloud backend (Gemini, Foundry,
+// Ollama, ...).
+//
+// Overview:
+//   The sketches' call gates look only at sensor state, so on bad Wi-Fi the
+//   rover keeps waiting out a full HTTP timeout (plus retry) on every hazard.
+//   A LatencyBreaker remembers the last LATENCY_BREAKER_WINDOW calls of one
+//   backend and opens when they break the backend's budget:
+//
+//       LatencyBreaker foundryBreaker("foundry", {6000, 0.30f, 0.40f, 5, 30000, 240000});
+//       foundryBreaker.setLog(&Serial);  // print state transitions
+//       ...
+//       if (!foundryBreaker.allowRequest(millis())) { use the local plan }
+//       ...
+//       foundryBreaker.record(LATENCY_BREAKER_TIMEOUT, roundTripMs, millis());
+//
+//   States:
+//     CLOSED    – calls go through; the window is checked after each one.
+//     OPEN      – calls are refused (the rover stays local-only) until the
+//                 cool-down ends.
+//     HALF_OPEN – one probe call is let through.  A probe within the latency
+//                 budget closes the circuit with a fresh window; a failed or
+//                 slow probe reopens it with the cool-down doubled, up to
+//                 maxOpenMs.
+//
+//   The circuit opens once the window holds minSamples calls and any of these
+//   is over budget: p95 latency, timeout rate, HTTP error rate.  Every refused
+//   call adds the average cost of the failing calls that tripped the breaker
+//   to savedMs, which estimates the time not spent waiting on a bad link.
+//
+// record() and allowRequest() may be called from different tasks; state is
+// guarded by a spinlock.  Time is whatever clock the caller passes (millis()).
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+static const uint8_t LATENCY_BREAKER_WINDOW = 16;
+
+enum LatencyBreakerState : uint8_t {
+  LATENCY_BREAKER_CLOSED,
+  LATENCY_BREAKER_OPEN,
+  LATENCY_BREAKER_HALF_OPEN,
+};
+
+enum LatencyBreakerOutcome : uint8_t {
+  LATENCY_BREAKER_OK,          // 2xx reply
+  LATENCY_BREAKER_TIMEOUT,     // no complete reply before the transport's deadline
+  LATENCY_BREAKER_HTTP_ERROR,  // connect failure or non-2xx status
+};
+
+struct LatencyBreakerBudget {
+  uint32_t p95Ms;          // Rolling p95 above this opens the circuit
+  float maxTimeoutRate;    // Share of windowed calls that timed out
+  float maxErrorRate;      // Share of windowed calls that failed with an HTTP/connect error
+  uint8_t minSamples;      // Calls needed in the window before it is judged
+  uint32_t openMs;         // First cool-down before a half-open probe
+  uint32_t maxOpenMs;      // Cool-down cap after repeated failed probes
+};
+
+struct LatencyBreakerStats {
+  uint32_t opened;         // CLOSED/HALF_OPEN -> OPEN transitions
+  uint32_t probes;         // Half-open probe calls let through
+  uint32_t closed;         // HALF_OPEN -> CLOSED transitions
+  uint32_t refused;        // Calls skipped while open
+  uint32_t savedMs;        // Estimated wait avoided by the refused calls
+};
+
+inline const char *latencyBreakerStateString(LatencyBreakerState state) {
+  switch (state) {
+    case LATENCY_BREAKER_CLOSED:
+      return "CLOSED";
+    case LATENCY_BREAKER_OPEN:
+      return "OPEN";
+    default:
+      return "HALF_OPEN";
+  }
+}
+
+class LatencyBreaker {
+ public:
+  LatencyBreaker(const char *name, const LatencyBreakerBudget &budget) : name_(name), budget_(budget) {}
+
+  // True when a call may be made now.  Moves OPEN to HALF_OPEN once the
+  // cool-down has passed and hands out the single probe; every refusal is
+  // counted as a skipped call.
+  bool allowRequest(uint32_t nowMs) {
+    bool allowed = false;
+    LatencyBreakerState from = LATENCY_BREAKER_CLOSED;
+    LatencyBreakerState to = LATENCY_BREAKER_CLOSED;
+    portENTER_CRITICAL(&lock_);
+    from = state_;
+    if (state_ == LATENCY_BREAKER_OPEN && nowMs - openedMs_ >= openForMs_) {
+      state_ = LATENCY_BREAKER_HALF_OPEN;
+      probeInFlight_ = false;
+    }
+    if (state_ == LATENCY_BREAKER_CLOSED) {
+      allowed = true;
+    } else if (state_ == LATENCY_BREAKER_HALF_OPEN && (!probeInFlight_ || nowMs - probeStartedMs_ >= openForMs_)) {
+      // A probe whose caller never reported back (e.g. it was not sent) expires after one cool-down.
+      probeInFlight_ = true;
+      probeStartedMs_ = nowMs;
+      stats_.probes++;
+      allowed = true;
+    } else {
+      stats_.refused++;
+      stats_.savedMs += tripCostMs_;
+    }
+    to = state_;
+    portEXIT_CRITICAL(&lock_);
+    if (from != to) {
+      logTransition(from, to, nullptr);
+    }
+    return allowed;
+  }
+
+  // Reports the result of a call that allowRequest() let through.  Calls that
+  // were cancelled on purpose should not be recorded; see releaseProbe().
+  void record(LatencyBreakerOutcome outcome, uint32_t latencyMs, uint32_t nowMs) {
+    LatencyBreakerState from = LATENCY_BREAKER_CLOSED;
+    LatencyBreakerState to = LATENCY_BREAKER_CLOSED;
+    const char *reason = nullptr;
+    portENTER_CRITICAL(&lock_);
+    from = state_;
+    if (state_ == LATENCY_BREAKER_HALF_OPEN) {
+      probeInFlight_ = false;
+      if (outcome == LATENCY_BREAKER_OK && latencyMs <= budget_.p95Ms) {
+        state_ = LATENCY_BREAKER_CLOSED;
+        openForMs_ = budget_.openMs;
+        count_ = 0;
+        next_ = 0;
+        stats_.closed++;
+        reason = "probe within budget";
+      } else {
+        openForMs_ = openForMs_ * 2 < budget_.maxOpenMs ? openForMs_ * 2 : budget_.maxOpenMs;
+        tripCostMs_ = latencyMs;
+        openLocked(nowMs);
+        reason = outcome == LATENCY_BREAKER_OK ? "probe too slow" : "probe failed";
+      }
+    } else if (state_ == LATENCY_BREAKER_CLOSED) {
+      window_[next_] = {latencyMs, outcome};
+      next_ = (next_ + 1) % LATENCY_BREAKER_WINDOW;
+      if (count_ < LATENCY_BREAKER_WINDOW) {
+        count_++;
+      }
+      reason = overBudgetLocked();
+      if (reason != nullptr) {
+        openForMs_ = budget_.openMs;
+        tripCostMs_ = failingCallCostLocked();
+        openLocked(nowMs);
+      }
+    }
+    to = state_;
+    portEXIT_CRITICAL(&lock_);
+    if (from != to) {
+      logTransition(from, to, reason);
+    }
+  }
+
+  // For a call that allowRequest() let through but that was cancelled on
+  // purpose (e.g. it lost a race): if it held the half-open probe, the next
+  // allowRequest() may hand out a new one right away instead of waiting for
+  // the probe to expire.  The cancelled call says nothing about the link, so
+  // the window and the state are left alone.
+  void releaseProbe() {
+    portENTER_CRITICAL(&lock_);
+    if (state_ == LATENCY_BREAKER_HALF_OPEN) {
+      probeInFlight_ = false;
+    }
+    portEXIT_CRITICAL(&lock_);
+  }
+
+  // Counts a skipped call and returns true when allowRequest() would refuse
+  // now.  Otherwise returns false and changes nothing: unlike allowRequest()
+  // it never hands out the half-open probe, so a caller that only wants to
+  // know whether to skip cannot strand it.
+  bool refuseIfOpen(uint32_t nowMs) {
+    portENTER_CRITICAL(&lock_);
+    bool refusing = refusingLocked(nowMs);
+    if (refusing) {
+      stats_.refused++;
+      stats_.savedMs += tripCostMs_;
+    }
+    portEXIT_CRITICAL(&lock_);
+    return refusing;
+  }
+
+  // True while allowRequest() would refuse: open and cooling down, or
+  // half-open with the probe still out.  Does not count anything.
+  bool isRefusing(uint32_t nowMs) {
+    portENTER_CRITICAL(&lock_);
+    bool refusing = refusingLocked(nowMs);
+    portEXIT_CRITICAL(&lock_);
+    return refusing;
+  }
+
+  LatencyBreakerState state() const { return state_; }
+  const char *name() const { return name_; }
+
+  // Sends transition lines ("Breaker | gemini CLOSED -> OPEN (...)") to out.
+  void setLog(Print *out) { log_ = out; }
+
+  // One line: state, window p95 and rates, transitions, refused calls and time saved.
+  void printStats(Print &out) {
+    portENTER_CRITICAL(&lock_);
+    LatencyBreakerState state = state_;
+    LatencyBreakerStats stats = stats_;
+    uint32_t p95 = percentileLocked(95);
+    float timeoutRate = rateLocked(LATENCY_BREAKER_TIMEOUT);
+    float errorRate = rateLocked(LATENCY_BREAKER_HTTP_ERROR);
+    uint8_t count = count_;
+    portEXIT_CRITICAL(&lock_);
+    out.printf("Breaker | %-8s %-9s calls=%u p95=%lu ms timeouts=%.0f%% errors=%.0f%% opened=%lu probes=%lu "
+               "closed=%lu refused=%lu savedMs=%lu\n",
+               name_, latencyBreakerStateString(state), (unsigned)count, (unsigned long)p95, 100.0f * timeoutRate,
+               100.0f * errorRate, (unsigned long)stats.opened, (unsigned long)stats.probes,
+               (unsigned long)stats.closed, (unsigned long)stats.refused, (unsigned long)stats.savedMs);
+  }
+
+ private:
+  struct Sample {
+    uint32_t latencyMs;
+    LatencyBreakerOutcome outcome;
+  };
+
+  bool refusingLocked(uint32_t nowMs) const {
+    return (state_ == LATENCY_BREAKER_OPEN && nowMs - openedMs_ < openForMs_) ||
+           (state_ == LATENCY_BREAKER_HALF_OPEN && probeInFlight_ && nowMs - probeStartedMs_ < openForMs_);
+  }
+
+  void openLocked(uint32_t nowMs) {
+    state_ = LATENCY_BREAKER_OPEN;
+    openedMs_ = nowMs;
+    stats_.opened++;
+  }
+
+  uint32_t percentileLocked(uint8_t percentile) const {
+    uint32_t sorted[LATENCY_BREAKER_WINDOW];
+    for (uint8_t i = 0; i < count_; i++) {
+      uint32_t value = window_[i].latencyMs;
+      uint8_t j = i;
+      while (j > 0 && sorted[j - 1] > value) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = value;
+    }
+    return count_ > 0 ? sorted[((uint16_t)(count_ - 1) * percentile) / 100] : 0;
+  }
+
+  float rateLocked(LatencyBreakerOutcome outcome) const {
+    uint8_t hits = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+      if (window_[i].outcome == outcome) {
+        hits++;
+      }
+    }
+    return count_ > 0 ? (float)hits / count_ : 0.0f;
+  }
+
+  // Name of the first budget the window breaks, or nullptr while it is within budget.
+  const char *overBudgetLocked() const {
+    if (count_ < budget_.minSamples) {
+      return nullptr;
+    }
+    if (rateLocked(LATENCY_BREAKER_TIMEOUT) > budget_.maxTimeoutRate) {
+      return "timeout rate over budget";
+    }
+    if (rateLocked(LATENCY_BREAKER_HTTP_ERROR) > budget_.maxErrorRate) {
+      return "HTTP error rate over budget";
+    }
+    if (percentileLocked(95) > budget_.p95Ms) {
+      return "p95 latency over budget";
+    }
+    return nullptr;
+  }
+
+  // Average latency of the calls that failed or ran over the p95 budget.
+  uint32_t failingCallCostLocked() const {
+    uint32_t totalMs = 0;
+    uint8_t failing = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+      if (window_[i].outcome != LATENCY_BREAKER_OK || window_[i].latencyMs > budget_.p95Ms) {
+        totalMs += window_[i].latencyMs;
+        failing++;
+      }
+    }
+    return failing > 0 ? totalMs / failing : budget_.p95Ms;
+  }
+
+  void logTransition(LatencyBreakerState from, LatencyBreakerState to, const char *reason) {
+    if (log_ == nullptr) {
+      return;
+    }
+    log_->printf("Breaker | %s %s -> %s", name_, latencyBreakerStateString(from), latencyBreakerStateString(to));
+    if (to == LATENCY_BREAKER_OPEN) {
+      log_->printf(" for %lu ms", (unsigned long)openForMs_);
+    }
+    if (reason != nullptr) {
+      log_->printf(" (%s)", reason);
+    }
+    log_->println();
+  }
+
+  const char *name_;
+  LatencyBreakerBudget budget_;
+  Print *log_ = nullptr;
+  Sample window_[LATENCY_BREAKER_WINDOW] = {};
+  uint8_t count_ = 0;
+  uint8_t next_ = 0;
+  LatencyBreakerState state_ = LATENCY_BREAKER_CLOSED;
+  uint32_t openedMs_ = 0;
+  uint32_t openForMs_ = 0;
+  uint32_t tripCostMs_ = 0;
+  bool probeInFlight_ = false;
+  uint32_t probeStartedMs_ = 0;
+  LatencyBreakerStats stats_ = {};
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
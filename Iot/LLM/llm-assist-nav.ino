@@ -8,6 +8,9 @@
 #include <ultrasonic.h>
 #include <vehicle.h>
 #include "gemini_config.h"
+#include "maneuver_executor.h"
+#include "prompt_buffer.h"
+#include "ultrasonic_echo.h"
 #include "wifi_config.h"
 
 /*
@@ -22,7 +25,12 @@
     local safety guardrails and falls back to local logic whenever confidence is low or
     responses are invalid.
   5) Executes one or two-step maneuvers, then rescans and records outcome quality so
-    future decisions can avoid oscillation/trap patterns.
+    future decisions can avoid oscillation/trap patterns. Maneuvers run through
+    maneuver_executor.h, which keeps sampling the front sensor from loop(): a move ends
+    early once the front is clear, and a newly close obstacle aborts the rest of the plan.
+  6) Never waits for an ultrasonic echo: ultrasonic_echo.h triggers the sensor and an echo-pin
+    interrupt times the pulse. The stop-and-look scan is a small state machine that loop()
+    advances one servo settle or reading at a time.
 
   High-level design goals:
   - Prefer collision avoidance and recovery over aggressive movement.
@@ -31,7 +39,8 @@
 */
 
 vehicle myCar;
-ultrasonic sensor;
+ultrasonic sensor;         // Blocking fallback when echoRanger cannot start.
+UltrasonicEcho echoRanger; // Interrupt-timed echoes for the same sensor.
 Servo panServo;
 
 // Action is a simple left/right/stop/backward direction abstraction used by fallback logic.
@@ -42,6 +51,20 @@ enum Action {
   ACTION_BACKWARD,
 };
 
+// Step of the stop-and-look scan; each waits for the servo to settle, then for one echo.
+enum HazardScanStep {
+  HAZARD_SCAN_IDLE = 0,
+  HAZARD_SCAN_LEFT,
+  HAZARD_SCAN_RIGHT,
+  HAZARD_SCAN_FRONT,
+};
+
+// What loop() does with a finished scan: choose a plan, or score the plan that just ran.
+enum HazardScanPurpose {
+  HAZARD_SCAN_FOR_DECISION = 0,
+  HAZARD_SCAN_FOR_OUTCOME,
+};
+
 // ManeuverType is the concrete motion primitive vocabulary used in executable plans.
 enum ManeuverType {
   MANEUVER_STOP = 0,
@@ -111,6 +134,7 @@ const unsigned long STRAFE_DURATION_MS = 450;
 const unsigned long BACKUP_DURATION_MS = 380;
 const unsigned long GEMINI_HTTP_TIMEOUT_MS = 12000;
 const unsigned long GEMINI_HTTP_TIMEOUT_TIGHT_MS = 3800;
+const size_t GEMINI_REQUEST_BODY_CAPACITY = 3072;
 const unsigned long HAZARD_DECISION_COOLDOWN_MS = 800;
 const unsigned long FRONT_STALE_MS = 450;
 const unsigned long HAZARD_BURST_WINDOW_MS = 3000;
@@ -132,11 +156,24 @@ const float PLAN_IMPROVEMENT_MARGIN_CM = 5.0f;
 const uint16_t MIN_MANEUVER_DURATION_MS = 180;
 const uint16_t MAX_MANEUVER_DURATION_MS = 700;
 
+// Time-sliced maneuvers: forward readings every SENSOR_INTERVAL_MS; a move may end once two in a
+// row show MANEUVER_CLEAR_CM (after at least half its duration), and two readings at or under
+// EMERGENCY_REVERSE_CM abort the plan.
+const float MANEUVER_CLEAR_CM = 50.0f;
+const ManeuverExecutorConfig MANEUVER_EXECUTOR_CONFIG = {
+    (uint16_t)SENSOR_INTERVAL_MS, MANEUVER_CLEAR_CM, EMERGENCY_REVERSE_CM, 2, 50};
+
 // Runtime state for hazard sensing/decision cadence.
 bool obstacleNearby = false;
 bool previousObstacleNearby = false;
 unsigned long lastSensorMs = 0;
 unsigned long lastPanStepMs = 0;
+bool sweepRangingPending = false;
+int sweepRangingDeg = PAN_CENTER_DEG;
+HazardScanStep hazardScanStep = HAZARD_SCAN_IDLE;
+HazardScanPurpose hazardScanPurpose = HAZARD_SCAN_FOR_DECISION;
+unsigned long hazardScanSettleUntilMs = 0;
+unsigned long hazardScanStartedMs = 0;
 unsigned long lastHazardDecisionMs = 0;
 unsigned long hazardBurstWindowStartMs = 0;
 uint8_t hazardBurstCount = 0;
@@ -161,6 +198,8 @@ uint8_t recentPlanWriteIndex = 0;
 int8_t lastPlanOutcome = 0;
 float lastPlanFrontBeforeCm = -1.0f;
 float lastPlanFrontAfterCm = -1.0f;
+ManeuverExecutor<2> maneuverExecutor;
+char geminiRequestBody[GEMINI_REQUEST_BODY_CAPACITY];
 
 // Writes both direction LEDs in one call, honoring active-high/low wiring.
 void setBothLeds(bool on) {
@@ -283,13 +322,11 @@ ManeuverPlan buildRecoveryPlan(Action action) {
 }
 
 // Serializes plan fields into compact text for the Gemini prompt context.
-String planToPromptText(const char *label, const ManeuverPlan &plan) {
-  return String(label) + "={primary:" + maneuverTypeToString(plan.primary) +
-         ",primary_ms:" + String(plan.primaryDurationMs) +
-         ",secondary:" + maneuverTypeToString(plan.secondary) +
-         ",secondary_ms:" + String(plan.secondaryDurationMs) +
-         ",confidence:" + String(plan.confidence, 2) +
-         ",risk:" + String(plan.riskScore, 2) + "}";
+void appendPlanPromptText(PromptBuffer &out, const char *label, const ManeuverPlan &plan) {
+  out.appendf("%s={primary:%s,primary_ms:%u,secondary:%s,secondary_ms:%u,confidence:%.2f,risk:%.2f}", label,
+              maneuverTypeToString(plan.primary), (unsigned)plan.primaryDurationMs,
+              maneuverTypeToString(plan.secondary), (unsigned)plan.secondaryDurationMs, plan.confidence,
+              plan.riskScore);
 }
 
 // Heuristic local scorer for candidate maneuvers based on clearance, trend, and oscillation.
@@ -478,36 +515,26 @@ bool detectRepeatedTrap(float leftCm, float frontCm, float rightCm) {
   return similarCount >= TRAP_REPEAT_THRESHOLD;
 }
 
-// Produces CSV-like summary of recent plans for prompt/debug visibility.
-String buildRecentPlanSummary() {
-  String summary;
+// Appends CSV-like summary of recent plans to the prompt.
+void appendRecentPlanSummary(PromptBuffer &out) {
   for (uint8_t i = 0; i < 4; ++i) {
-    if (i > 0) {
-      summary += ",";
-    }
     uint8_t idx = (recentPlanWriteIndex + i) % 4;
-    summary += maneuverTypeToString(recentPlans[idx]);
+    out.appendf(i > 0 ? ",%s" : "%s", maneuverTypeToString(recentPlans[idx]));
   }
-  return summary;
 }
 
-// Produces compact rolling L/F/R history string for logs and LLM grounding.
-String buildHistorySummary() {
-  String summary;
+// Appends compact rolling L/F/R history to the prompt for LLM grounding.
+void appendHistorySummary(PromptBuffer &out) {
+  if (navHistoryCount == 0) {
+    out.append("none");
+    return;
+  }
   uint8_t start = (navHistoryCount == NAV_HISTORY_SIZE) ? navHistoryWriteIndex : 0;
   for (uint8_t i = 0; i < navHistoryCount; ++i) {
     uint8_t idx = (start + i) % NAV_HISTORY_SIZE;
-    if (summary.length() > 0) {
-      summary += " | ";
-    }
-    summary += "L=" + String(navHistory[idx].leftCm, 1);
-    summary += ",F=" + String(navHistory[idx].frontCm, 1);
-    summary += ",R=" + String(navHistory[idx].rightCm, 1);
+    out.appendf(i > 0 ? " | L=%.1f,F=%.1f,R=%.1f" : "L=%.1f,F=%.1f,R=%.1f", navHistory[idx].leftCm,
+                navHistory[idx].frontCm, navHistory[idx].rightCm);
   }
-  if (summary.length() == 0) {
-    summary = "none";
-  }
-  return summary;
 }
 
 // Positive means front clearance improved over history window; negative means worsening.
@@ -739,6 +766,75 @@ void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan) {
   }
 }
 
+// Gemini request template, pre-escaped for a JSON string; the instructions are constant flash
+// text so every request body starts with the same bytes.
+static const char GEMINI_BODY_OPEN[] PROGMEM = "{\"contents\":[{\"parts\":[{\"text\":\"";
+static const char GEMINI_PROMPT_INSTRUCTIONS[] PROGMEM =
+    "You are a safety-first indoor navigation planner for a robot. "
+    "Choose the safest maneuver that is most likely to increase front clearance and break oscillation. "
+    "You may only use these maneuvers: STRAFE_LEFT, STRAFE_RIGHT, BACKWARD, TURN_LEFT_90, TURN_RIGHT_90, RESCAN, STOP. "
+    "Never invent a new action. Do not use STOP unless all motion options are blocked or unsafe. "
+    "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
+    "Prefer the more open side when choosing between left and right. "
+    "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
+    "Return strict JSON only, no markdown, with keys primary, primary_duration_ms, secondary, secondary_duration_ms, confidence, risk, reason. "
+    "Example JSON: {\\\"primary\\\":\\\"BACKWARD\\\",\\\"primary_duration_ms\\\":350,"
+    "\\\"secondary\\\":\\\"TURN_LEFT_90\\\",\\\"secondary_duration_ms\\\":520,"
+    "\\\"confidence\\\":0.82,\\\"risk\\\":0.74,\\\"reason\\\":\\\"recovery_from_trap\\\"}. ";
+static const char GEMINI_PROMPT_STATE_FORMAT[] PROGMEM =
+    "Current distances cm: front=%.1f, left=%.1f, right=%.1f. Repeated trap=%s. "
+    "Front trend cm over recent history=%.1f. Left-right oscillation count=%u. Last plan outcome=%s. "
+    "Last plan front before=%.1f, after=%.1f. Baseline primary=%s, baseline secondary=%s. Candidate plans: ";
+// responseMimeType requests JSON, but code still validates/guards against malformed output.
+static const char GEMINI_BODY_CLOSE[] PROGMEM =
+    ".\"}]}],\"generationConfig\":{\"temperature\":0.15,\"maxOutputTokens\":160,\"responseMimeType\":\"application/json\"}}";
+
+// Writes the Gemini request body and logs build time, size, and heap held; false if it overflowed.
+bool buildGeminiRequestBody(PromptBuffer &body, const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
+  PromptHeapProbe heapProbe;
+  heapProbe.start();
+  unsigned long buildStartUs = micros();
+  Action openSideAction = chooseFallbackTurn();
+  ManeuverPlan localStrafePlan = buildStrafePlan(openSideAction, fallbackPlan.primaryDurationMs);
+  ManeuverPlan localTurnPlan = buildTurnPlan(openSideAction);
+  ManeuverPlan localRecoveryPlan = buildRecoveryPlan(openSideAction);
+  localStrafePlan.riskScore = estimateLocalRiskScore();
+  localTurnPlan.riskScore = estimateLocalRiskScore();
+  localRecoveryPlan.riskScore = estimateLocalRiskScore();
+  body.clear();
+  body.append(GEMINI_BODY_OPEN);
+  body.append(GEMINI_PROMPT_INSTRUCTIONS);
+  size_t staticPrefixLength = body.length();
+  body.appendf(GEMINI_PROMPT_STATE_FORMAT, frontDistanceCm, leftDistanceCm, rightDistanceCm,
+               repeatedTrap ? "true" : "false", frontTrendCm(), (unsigned)detectPlanOscillationCount(),
+               lastPlanOutcomeString(), lastPlanFrontBeforeCm, lastPlanFrontAfterCm,
+               maneuverTypeToString(fallbackPlan.primary), maneuverTypeToString(fallbackPlan.secondary));
+  appendPlanPromptText(body, "baseline", fallbackPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "strafe", localStrafePlan);
+  body.append("; ");
+  appendPlanPromptText(body, "turn", localTurnPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "recovery", localRecoveryPlan);
+  body.append(". Recent hazard history=");
+  appendHistorySummary(body);
+  body.append(". Recent plans=");
+  appendRecentPlanSummary(body);
+  body.append(GEMINI_BODY_CLOSE);
+  uint32_t buildUs = micros() - buildStartUs;
+  int heapBlocksHeld = 0;
+  int heapBytesHeld = 0;
+  heapProbe.measure(heapBlocksHeld, heapBytesHeld);
+  Serial.printf("Gemini prompt build: %lu us, %u bytes (static prefix %u), heap held %+d blocks / %+d bytes%s\n",
+                (unsigned long)buildUs, (unsigned)body.length(), (unsigned)staticPrefixLength, heapBlocksHeld,
+                heapBytesHeld, body.overflowed() ? ", OVERFLOW" : "");
+  if (heapProbe.counted) {
+    Serial.printf("Gemini prompt heap: %lu allocations (%lu bytes), %lu frees\n", (unsigned long)heapProbe.allocations,
+                  (unsigned long)heapProbe.allocatedBytes, (unsigned long)heapProbe.frees);
+  }
+  return !body.overflowed();
+}
+
 // Calls Gemini for plan refinement; never bypasses local fallbacks/safety sanitization.
 ManeuverPlan queryGeminiForNavigationPlan(const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
   flashGeminiThinkingLeds();
@@ -753,49 +849,19 @@ ManeuverPlan queryGeminiForNavigationPlan(const ManeuverPlan &fallbackPlan, bool
     Serial.println("Gemini: HTTP begin failed");
     return fallbackPlan;
   }
-  Action openSideAction = chooseFallbackTurn();
-  ManeuverPlan localStrafePlan = buildStrafePlan(openSideAction, fallbackPlan.primaryDurationMs);
-  ManeuverPlan localTurnPlan = buildTurnPlan(openSideAction);
-  ManeuverPlan localRecoveryPlan = buildRecoveryPlan(openSideAction);
-  localStrafePlan.riskScore = estimateLocalRiskScore();
-  localTurnPlan.riskScore = estimateLocalRiskScore();
-  localRecoveryPlan.riskScore = estimateLocalRiskScore();
-  String candidateSummary = planToPromptText("baseline", fallbackPlan) + "; " +
-                            planToPromptText("strafe", localStrafePlan) + "; " +
-                            planToPromptText("turn", localTurnPlan) + "; " +
-                            planToPromptText("recovery", localRecoveryPlan);
-  String prompt =
-      "You are a safety-first indoor navigation planner for a robot. "
-      "Choose the safest maneuver that is most likely to increase front clearance and break oscillation. "
-      "You may only use these maneuvers: STRAFE_LEFT, STRAFE_RIGHT, BACKWARD, TURN_LEFT_90, TURN_RIGHT_90, RESCAN, STOP. "
-      "Never invent a new action. Do not use STOP unless all motion options are blocked or unsafe. "
-      "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
-      "Prefer the more open side when choosing between left and right. "
-      "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
-      "Return strict JSON only, no markdown, with keys primary, primary_duration_ms, secondary, secondary_duration_ms, confidence, risk, reason. "
-      "Current distances cm: front=" + String(frontDistanceCm, 1) +
-      ", left=" + String(leftDistanceCm, 1) +
-      ", right=" + String(rightDistanceCm, 1) +
-      ". Repeated trap=" + String(repeatedTrap ? "true" : "false") +
-      ". Front trend cm over recent history=" + String(frontTrendCm(), 1) +
-      ". Left-right oscillation count=" + String(detectPlanOscillationCount()) +
-      ". Last plan outcome=" + String(lastPlanOutcomeString()) +
-      ". Last plan front before=" + String(lastPlanFrontBeforeCm, 1) +
-      ", after=" + String(lastPlanFrontAfterCm, 1) +
-      ". Baseline primary=" + String(maneuverTypeToString(fallbackPlan.primary)) +
-      ", baseline secondary=" + String(maneuverTypeToString(fallbackPlan.secondary)) +
-      ". Candidate plans: " + candidateSummary +
-      ". Recent hazard history=" + buildHistorySummary() +
-      ". Recent plans=" + buildRecentPlanSummary() +
-      ". Example JSON: {\"primary\":\"BACKWARD\",\"primary_duration_ms\":350,\"secondary\":\"TURN_LEFT_90\",\"secondary_duration_ms\":520,\"confidence\":0.82,\"risk\":0.74,\"reason\":\"recovery_from_trap\"}.";
-  // responseMimeType requests JSON, but code still validates/guards against malformed output.
-  String body = String("{\"contents\":[{\"parts\":[{\"text\":\"") + prompt +
-          "\"}]}],\"generationConfig\":{\"temperature\":0.15,\"maxOutputTokens\":160,\"responseMimeType\":\"application/json\"}}";
+  PromptBuffer body(geminiRequestBody, sizeof(geminiRequestBody));
+  if (!buildGeminiRequestBody(body, fallbackPlan, repeatedTrap)) {
+    http.end();
+    return fallbackPlan;
+  }
   http.addHeader("Content-Type", "application/json");
   http.setTimeout(GEMINI_HTTP_TIMEOUT_TIGHT_MS);
-  int statusCode = http.POST(body);
+  unsigned long requestStartedMs = millis();
+  int statusCode = http.POST(body.bytes(), body.length());
   String responseBody = http.getString();
   http.end();
+  Serial.print("Gemini round-trip ms: ");
+  Serial.println(millis() - requestStartedMs);
   if (statusCode < 200 || statusCode >= 300) {
     Serial.print("Gemini HTTP error: ");
     Serial.println(statusCode);
@@ -836,35 +902,82 @@ void movePanToCenter() {
   panServo.write(panCurrentDeg);
 }
 
-// Takes an explicit left-right-front snapshot used right before/after maneuvers.
-void refreshHazardScanSnapshot() {
+// Non-blocking ultrasonic read: the first call triggers a measurement, later calls return false
+// until its echo (or the no-echo timeout) is in, then set distanceCm (negative without an echo).
+// Without the echo engine this is one blocking sensor.Ranging() call that always completes.
+bool pollUltrasonicCm(float &distanceCm) {
+  if (!echoRanger.ready()) {
+    distanceCm = sensor.Ranging();
+    return true;
+  }
+  if (!echoRanger.busy()) {
+    echoRanger.start();
+  }
+  unsigned long pulseWidthUs = 0;
+  return echoRanger.poll(distanceCm, pulseWidthUs);
+}
+
+// Starts an explicit left-right-front snapshot used right before/after maneuvers; loop()
+// advances it with serviceHazardScan().
+void startHazardScan(HazardScanPurpose purpose) {
+  unsigned long nowMs = millis();
+  // A sweep reading still in flight was aimed wherever the servo pointed before; drop it.
+  echoRanger.cancel();
+  sweepRangingPending = false;
+  hazardScanPurpose = purpose;
+  hazardScanStartedMs = nowMs;
   if (!panServoReady) {
-    float front = sensor.Ranging();
-    if (isValidDistance(front)) {
-      frontDistanceCm = front;
-      frontUpdatedMs = millis();
-    }
+    hazardScanStep = HAZARD_SCAN_FRONT;
+    hazardScanSettleUntilMs = nowMs;
     return;
   }
   panServo.write(PAN_LEFT_DEG);
   panCurrentDeg = PAN_LEFT_DEG;
-  delay(PAN_SETTLE_MS);
-  float left = sensor.Ranging();
-  if (isValidDistance(left)) {
-    leftDistanceCm = left;
-  }
-  panServo.write(PAN_RIGHT_DEG);
-  panCurrentDeg = PAN_RIGHT_DEG;
-  delay(PAN_SETTLE_MS);
-  float right = sensor.Ranging();
-  if (isValidDistance(right)) {
-    rightDistanceCm = right;
+  hazardScanStep = HAZARD_SCAN_LEFT;
+  hazardScanSettleUntilMs = nowMs + PAN_SETTLE_MS;
+}
+
+// Advances the snapshot by at most one servo move or reading; returns true while it is running.
+bool serviceHazardScan(unsigned long nowMs) {
+  if (hazardScanStep == HAZARD_SCAN_IDLE) {
+    return false;
   }
-  movePanToCenter();
-  delay(PAN_SETTLE_MS);
-  float front = sensor.Ranging();
-  if (isValidDistance(front)) {
-    frontDistanceCm = front;
+  if ((long)(nowMs - hazardScanSettleUntilMs) < 0) {
+    return true;
+  }
+  float distanceCm = -1.0f;
+  if (!pollUltrasonicCm(distanceCm)) {
+    return true;
+  }
+  if (hazardScanStep == HAZARD_SCAN_LEFT) {
+    if (isValidDistance(distanceCm)) {
+      leftDistanceCm = distanceCm;
+    }
+    panServo.write(PAN_RIGHT_DEG);
+    panCurrentDeg = PAN_RIGHT_DEG;
+    hazardScanStep = HAZARD_SCAN_RIGHT;
+    hazardScanSettleUntilMs = millis() + PAN_SETTLE_MS;
+    return true;
+  }
+  if (hazardScanStep == HAZARD_SCAN_RIGHT) {
+    if (isValidDistance(distanceCm)) {
+      rightDistanceCm = distanceCm;
+    }
+    movePanToCenter();
+    hazardScanStep = HAZARD_SCAN_FRONT;
+    hazardScanSettleUntilMs = millis() + PAN_SETTLE_MS;
+    return true;
+  }
+  hazardScanStep = HAZARD_SCAN_IDLE;
+  if (!panServoReady) {
+    if (isValidDistance(distanceCm)) {
+      frontDistanceCm = distanceCm;
+      frontUpdatedMs = millis();
+    }
+    return false;
+  }
+  if (isValidDistance(distanceCm)) {
+    frontDistanceCm = distanceCm;
     frontUpdatedMs = millis();
   } else {
     frontDistanceCm = -1.0f;
@@ -877,6 +990,7 @@ void refreshHazardScanSnapshot() {
   Serial.print(frontDistanceCm, 1);
   Serial.print("/");
   Serial.println(rightDistanceCm, 1);
+  return false;
 }
 
 // Runs continuous servo sweep so periodic samples can approximate L/F/R zones.
@@ -904,26 +1018,36 @@ void updatePanSweep(unsigned long nowMs) {
   panServo.write(panCurrentDeg);
 }
 
-// Updates rolling scan values and derives current hazard state from fresh front data.
+// Updates rolling scan values and derives current hazard state from fresh front data. A reading
+// is triggered every SENSOR_INTERVAL_MS and binned by the servo angle it was triggered at, on the
+// pass its echo arrives.
 void updateScanAndHazard() {
   unsigned long nowMs = millis();
   updatePanSweep(nowMs);
-  if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
+  if (!sweepRangingPending) {
+    if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
+      return;
+    }
+    lastSensorMs = nowMs;
+    sweepRangingPending = true;
+    sweepRangingDeg = panCurrentDeg;
+  }
+  float distanceCm = -1.0f;
+  if (!pollUltrasonicCm(distanceCm)) {
     return;
   }
-  lastSensorMs = nowMs;
-  float distanceCm = sensor.Ranging();
+  sweepRangingPending = false;
   if (isValidDistance(distanceCm)) {
-    if (panCurrentDeg >= (PAN_CENTER_DEG + PAN_CENTER_BUCKET_DEG)) {
+    if (sweepRangingDeg >= (PAN_CENTER_DEG + PAN_CENTER_BUCKET_DEG)) {
       leftDistanceCm = distanceCm;
-    } else if (panCurrentDeg <= (PAN_CENTER_DEG - PAN_CENTER_BUCKET_DEG)) {
+    } else if (sweepRangingDeg <= (PAN_CENTER_DEG - PAN_CENTER_BUCKET_DEG)) {
       rightDistanceCm = distanceCm;
     } else {
       frontDistanceCm = distanceCm;
       frontUpdatedMs = nowMs;
     }
-  } else if (panCurrentDeg > (PAN_CENTER_DEG - PAN_CENTER_BUCKET_DEG) &&
-             panCurrentDeg < (PAN_CENTER_DEG + PAN_CENTER_BUCKET_DEG)) {
+  } else if (sweepRangingDeg > (PAN_CENTER_DEG - PAN_CENTER_BUCKET_DEG) &&
+             sweepRangingDeg < (PAN_CENTER_DEG + PAN_CENTER_BUCKET_DEG)) {
     frontDistanceCm = -1.0f;
   }
   bool frontFresh = (frontUpdatedMs != 0 && (nowMs - frontUpdatedMs) <= FRONT_STALE_MS);
@@ -976,56 +1100,103 @@ int computeManeuverSpeed(const ManeuverPlan &plan) {
   return speed;
 }
 
-// Executes a single motion primitive for a bounded duration, then hard-stops.
-void executeManeuver(ManeuverType maneuver, uint16_t durationMs, int speed) {
+// Maps a motion primitive to an executor segment. Strafes may end early once the front is clear
+// and abort on a new close obstacle; backing up may only end early. A 90-degree turn reads clear
+// partway round but must finish to reach the new heading, so it may only abort. Pauses and
+// rescans always run their full time.
+ManeuverSegment maneuverSegment(ManeuverType maneuver, uint16_t durationMs, int speed) {
+  uint8_t tag = (uint8_t)maneuver;
   switch (maneuver) {
     case MANEUVER_STRAFE_LEFT:
-      myCar.Move(Move_Left, speed);
-      delay(durationMs);
-      break;
+      return {Move_Left, speed, durationMs, true, true, tag};
     case MANEUVER_STRAFE_RIGHT:
-      myCar.Move(Move_Right, speed);
-      delay(durationMs);
-      break;
+      return {Move_Right, speed, durationMs, true, true, tag};
     case MANEUVER_BACKWARD:
-      myCar.Move(Backward, speed);
-      delay(durationMs);
-      break;
+      return {Backward, speed, durationMs, true, false, tag};
     case MANEUVER_TURN_LEFT_90:
-      myCar.Move(Contrarotate, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Contrarotate, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_TURN_RIGHT_90:
-      myCar.Move(Clockwise, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Clockwise, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_RESCAN:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs);
-      refreshHazardScanSnapshot();
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs), false, false, tag};
     default:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? 180 : durationMs);
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? 180 : durationMs), false, false, tag};
   }
-  myCar.Move(Stop, 0);
 }
 
-// Executes primary and optional secondary maneuver; updates directional memory.
-void executePlan(const ManeuverPlan &plan) {
+// Queues primary and optional secondary maneuver and starts them; updates directional memory.
+// loop() advances the plan, then rescans and calls finishPlanExecution() once the scan is done.
+void startPlanExecution(const ManeuverPlan &plan) {
   int maneuverSpeed = computeManeuverSpeed(plan);
-  executeManeuver(plan.primary, plan.primaryDurationMs, maneuverSpeed);
-  rememberPlan(plan.primary);
+  maneuverExecutor.queue(maneuverSegment(plan.primary, plan.primaryDurationMs, maneuverSpeed));
   if (plan.secondary != MANEUVER_STOP) {
-    executeManeuver(plan.secondary, plan.secondaryDurationMs, maneuverSpeed);
-    rememberPlan(plan.secondary);
+    maneuverExecutor.queue(maneuverSegment(plan.secondary, plan.secondaryDurationMs, maneuverSpeed));
   }
   if (plan.primary == MANEUVER_STRAFE_LEFT || plan.primary == MANEUVER_TURN_LEFT_90) {
     lastNonStopDecision = ACTION_LEFT;
   } else if (plan.primary == MANEUVER_STRAFE_RIGHT || plan.primary == MANEUVER_TURN_RIGHT_90) {
     lastNonStopDecision = ACTION_RIGHT;
   }
+  // Readings taken during the maneuver must look along the heading.
+  movePanToCenter();
+  echoRanger.cancel();
+  sweepRangingPending = false;
+  maneuverExecutor.start(millis());
+}
+
+// Executor hook: drives the motors for a segment.
+void driveManeuverSegment(int direction, int speed) {
+  myCar.Move(direction, speed);
+}
+
+// Executor hook: hard-stops at the end of a segment.
+void stopManeuverSegment() {
+  myCar.Move(Stop, 0);
+}
+
+// Executor hook: the forward reading triggered on the previous sample, or -1 while it is still in
+// flight or got no echo. The next reading is triggered right away, so its echo is in by the time
+// the executor samples again.
+float sampleManeuverFrontCm() {
+  float distanceCm = -1.0f;
+  bool ready = pollUltrasonicCm(distanceCm);
+  if (ready && echoRanger.ready()) {
+    echoRanger.start();
+  }
+  return ready && isValidDistance(distanceCm) ? distanceCm : -1.0f;
+}
+
+// Executor hook: records the maneuver that just ran. A RESCAN pause needs no scan of its own: the
+// scan after the plan (or before the next decision) covers it.
+void onManeuverSegmentEnded(const ManeuverSegment &segment, ManeuverEnd end) {
+  ManeuverType maneuver = (ManeuverType)segment.tag;
+  rememberPlan(maneuver);
+  if (end != MANEUVER_END_COMPLETED) {
+    Serial.print("Maneuver ");
+    Serial.print(maneuverTypeToString(maneuver));
+    Serial.print(" ended early: ");
+    Serial.println(maneuverEndString(end));
+  }
+}
+
+// Scores whether front clearance got better/worse; called once the scan that loop() started
+// after the plan has finished.
+void finishPlanExecution() {
+  lastPlanFrontAfterCm = frontDistanceCm;
+  if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
+    // Post-action scoring tracks whether front clearance got better/worse for future decisions.
+    float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
+    if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = 1;
+    } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = -1;
+    } else {
+      lastPlanOutcome = 0;
+    }
+  } else {
+    lastPlanOutcome = 0;
+  }
+  maneuverExecutor.printStats(Serial);
 }
 
 // Hardware/network initialization and initial calibration logging.
@@ -1036,6 +1207,9 @@ void setup() {
   setBothLeds(false);
   myCar.Init();
   sensor.Init(TRIG_PIN, ECHO_PIN);
+  if (!echoRanger.begin(TRIG_PIN, ECHO_PIN)) {
+    Serial.println("Echo timer start failed; ultrasonic readings stay blocking");
+  }
   panServo.setPeriodHertz(50);
   panServo.attach(ULTRASONIC_PAN_PIN, 500, 2500);
   panServoReady = panServo.attached();
@@ -1050,68 +1224,78 @@ void setup() {
   Serial.print("/");
   Serial.println(PAN_RIGHT_DEG);
   delay(250);
+  maneuverExecutor.begin({driveManeuverSegment, stopManeuverSegment, sampleManeuverFrontCm, onManeuverSegmentEnded},
+                         MANEUVER_EXECUTOR_CONFIG);
   connectWiFi();
   Serial.println("LLM-assisted navigation planner enabled");
 }
 
+// Chooses a plan from the finished decision scan and starts it; nowMs is when the hazard was detected.
+void decideAndStartPlan(unsigned long nowMs) {
+  recordHazardSnapshot(leftDistanceCm, frontDistanceCm, rightDistanceCm, nowMs);
+  ManeuverPlan plan;
+  bool repeatedTrap = detectRepeatedTrap(leftDistanceCm, frontDistanceCm, rightDistanceCm);
+  // These branches are hard safety overrides that bypass LLM planning entirely.
+  if (isHeadOnWall(frontDistanceCm, leftDistanceCm, rightDistanceCm)) {
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    Serial.println("Head-on wall escape: local forced plan");
+  } else if (isValidDistance(frontDistanceCm) && frontDistanceCm <= EMERGENCY_REVERSE_CM) {
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    Serial.println("Emergency close obstacle: local forced plan");
+  } else if (shouldForceBackward(nowMs)) {
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    Serial.println("Burst hazard escalation: local forced plan");
+  } else {
+    // Normal path: create local baseline plan, then allow Gemini to refine within guardrails.
+    ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
+    plan = queryGeminiForNavigationPlan(localPlan, repeatedTrap);
+  }
+  lastPlanFrontBeforeCm = frontDistanceCm;
+  startPlanExecution(plan);
+  lastHazardDecisionMs = nowMs;
+}
+
 // Main control loop: scan -> detect hazard -> decide plan -> execute -> learn outcome.
 void loop() {
+  // A running plan owns the motors; each pass advances it by one slice (at most one reading).
+  if (maneuverExecutor.active()) {
+    if (maneuverExecutor.service(millis())) {
+      return;
+    }
+    startHazardScan(HAZARD_SCAN_FOR_OUTCOME);
+  }
+  // The stop-and-look scan also advances one settle or reading per pass; act on it once it is done.
+  if (hazardScanStep != HAZARD_SCAN_IDLE) {
+    if (serviceHazardScan(millis())) {
+      return;
+    }
+    if (hazardScanPurpose == HAZARD_SCAN_FOR_OUTCOME) {
+      finishPlanExecution();
+    } else {
+      decideAndStartPlan(hazardScanStartedMs);
+      return;
+    }
+  }
   updateScanAndHazard();
   unsigned long nowMs = millis();
   if (obstacleNearby && (!previousObstacleNearby || (nowMs - lastHazardDecisionMs) >= HAZARD_DECISION_COOLDOWN_MS)) {
     myCar.Move(Stop, 0);
-    refreshHazardScanSnapshot();
-    recordHazardSnapshot(leftDistanceCm, frontDistanceCm, rightDistanceCm, nowMs);
-    ManeuverPlan plan;
-    bool repeatedTrap = detectRepeatedTrap(leftDistanceCm, frontDistanceCm, rightDistanceCm);
-    // These branches are hard safety overrides that bypass LLM planning entirely.
-    if (isHeadOnWall(frontDistanceCm, leftDistanceCm, rightDistanceCm)) {
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      Serial.println("Head-on wall escape: local forced plan");
-    } else if (isValidDistance(frontDistanceCm) && frontDistanceCm <= EMERGENCY_REVERSE_CM) {
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      Serial.println("Emergency close obstacle: local forced plan");
-    } else if (shouldForceBackward(nowMs)) {
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      Serial.println("Burst hazard escalation: local forced plan");
-    } else {
-      // Normal path: create local baseline plan, then allow Gemini to refine within guardrails.
-      ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
-      plan = queryGeminiForNavigationPlan(localPlan, repeatedTrap);
-    }
-    lastPlanFrontBeforeCm = frontDistanceCm;
-    executePlan(plan);
-    refreshHazardScanSnapshot();
-    lastPlanFrontAfterCm = frontDistanceCm;
-    if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
-      // Post-action scoring tracks whether front clearance got better/worse for future decisions.
-      float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
-      if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = 1;
-      } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = -1;
-      } else {
-        lastPlanOutcome = 0;
-      }
-    } else {
-      lastPlanOutcome = 0;
-    }
-    lastHazardDecisionMs = nowMs;
+    startHazardScan(HAZARD_SCAN_FOR_DECISION);
   }
   if (!obstacleNearby) {
     if (hazardClearSinceMs == 0) {
@@ -1125,6 +1309,10 @@ void loop() {
     hazardClearSinceMs = 0;
   }
   previousObstacleNearby = obstacleNearby;
+  // A scan just started keeps the car stopped until the plan chosen from it takes the motors.
+  if (hazardScanStep != HAZARD_SCAN_IDLE) {
+    return;
+  }
   // Cruise forward only when no front hazard is active.
   if (obstacleNearby) {
     myCar.Move(Stop, 0);
@@ -10,7 +10,14 @@
 //     • Origin      (0, 0)  – home position
 //     • Patrol point (4, 3) – far waypoint
 //   If the LLM is unreachable or returns an invalid move, a deterministic
-//   Manhattan-distance fallback ensures the robot always makes progress.
+//   shortest-path fallback (a Manhattan walk when the map has no obstacles)
+//   ensures the robot always makes progress.
+//   Replies are streamed token by token (ollama_stream.h) and the request is
+//   closed as soon as the chosen action is unambiguous.
+//   With PIPELINE_QUERIES the query for the next cell runs on a background
+//   task while the current move is still driving.
+//   With LOCAL_PLANNER_ENABLED the route is planned on-device (BFS over the
+//   obstacle map) and the LLM is only consulted when the plan breaks.
 //
 // Dependencies (install via Arduino Library Manager or PlatformIO):
 //   • Arduino.h      – core Arduino API
@@ -18,12 +25,15 @@
 //   • HTTPClient.h   – ESP32 built-in HTTP client
 //   • ArduinoJson    – JSON serialisation / deserialisation (v7+)
 //   • vehicle.h      – custom motor-shield wrapper for this robot chassis
+//   • ollama_stream.h – NDJSON stream reader shared with the other Ollama sketches
 // =================================================
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <vehicle.h>
+#include <atomic>
+#include "ollama_stream.h"
 // =================================================
 // WIFI SETTINGS
 // Replace these placeholders with your actual network credentials before flashing.
@@ -58,8 +68,14 @@ vehicle myCar;
 //   • X increases going EAST; Y increases going NORTH.
 //   • The robot tracks its position and destination as integer cell coords.
 //   • Physical movement for one cell = STEP_MOVE_MS milliseconds of motor run.
+//   • GRID_WIDTH/GRID_HEIGHT size the map at compile time (see GridPlanner).
 // =================================================
 
+// Grid dimensions in cells.  Both are template arguments of the planner, so
+// a larger map only grows static storage – nothing is allocated at runtime.
+const int GRID_WIDTH = 5;
+const int GRID_HEIGHT = 5;
+
 // Current robot position on the grid (updated after each successful move).
 int robotX = 0;
 int robotY = 0;
@@ -78,6 +94,154 @@ int targetY = patrolY;
 // true  = heading to patrol point; false = heading back to origin.
 bool headingToPatrol = true;
 
+// A grid position plus the destination it is heading for.  The query and
+// validation helpers take one of these instead of reading the globals so the
+// pipelined prefetch can plan from a predicted position.
+struct GridPose {
+  int x;
+  int y;
+  int targetX;
+  int targetY;
+};
+
+// =================================================
+// LOCAL GRID PLANNER
+// Breadth-first search over the free cells of a W×H grid.  Every move costs
+// one step, so BFS distances are exact shortest-path lengths (with no
+// obstacles they equal the Manhattan distance).  The search runs backwards
+// from the target, giving a distance for every cell; a route is then the
+// chain of neighbours whose distance drops by one each step.
+//
+// W and H are template parameters and all storage (obstacle map, route, BFS
+// queue and distance buffers) is fixed-size and static, so no heap is used
+// and the task stacks do not grow with the map.  Cells are indexed with
+// 16 bits, which caps the map at 65534 cells; the obstacle map, route and
+// two GridSearch buffers cost about 9 bytes per cell of RAM.
+// =================================================
+
+// One grid cell coordinate.
+struct GridCell {
+  int16_t x;
+  int16_t y;
+};
+
+// Neighbour order used by every search: EAST, WEST, NORTH, SOUTH.  Trying X
+// first reproduces the old greedy fallback (close the X gap, then Y).
+const int8_t GRID_STEP_DX[4] = {1, -1, 0, 0};
+const int8_t GRID_STEP_DY[4] = {0, 0, 1, -1};
+const char *const GRID_STEP_ACTIONS[4] = {"MOVE_EAST", "MOVE_WEST", "MOVE_NORTH", "MOVE_SOUTH"};
+
+// BFS scratch for one caller: the distance field and the cell queue.  Both
+// are too big for a task stack on a large map, so each task that searches
+// owns one in static storage (see gridSearchForCurrentTask()).
+template <int W, int H>
+struct GridSearch {
+  static_assert(W > 0 && H > 0, "grid needs at least one cell");
+  static_assert((long)W * H < 0xFFFF, "grid too large for 16-bit cell indices and BFS distances");
+
+  uint16_t dist[W][H];  // Steps to the target; GridPlanner::UNREACHABLE if none.
+  uint16_t queue[W * H];  // Cells as x * H + y; each is queued at most once.
+};
+
+template <int W, int H>
+struct GridPlanner {
+  static_assert((long)W * H < 0xFFFF, "grid too large for 16-bit cell indices and BFS distances");
+  static const uint16_t UNREACHABLE = 0xFFFF;
+
+  bool blocked[W][H] = {};  // Obstacle map: true = the robot must never enter.
+  GridCell route[W * H];    // Planned cells, start cell first.
+  uint16_t routeLength = 0;
+  uint16_t routeIndex = 0;  // route[routeIndex] is where the robot should be now.
+  int routeTargetX = -1;    // Destination route[] was planned for.
+  int routeTargetY = -1;
+
+  bool inBounds(int x, int y) const { return x >= 0 && x < W && y >= 0 && y < H; }
+  bool isFree(int x, int y) const { return inBounds(x, y) && !blocked[x][y]; }
+
+  // Fill search.dist with the number of steps from every cell to (tx, ty);
+  // UNREACHABLE for obstacles and cells cut off from the target.
+  void computeDistances(int tx, int ty, GridSearch<W, H> &search) const {
+    uint16_t (&dist)[W][H] = search.dist;
+    for (int x = 0; x < W; x++) {
+      for (int y = 0; y < H; y++) {
+        dist[x][y] = UNREACHABLE;
+      }
+    }
+    if (!isFree(tx, ty)) {
+      return;
+    }
+    uint16_t *queue = search.queue;
+    uint16_t head = 0;
+    uint16_t tail = 0;
+    dist[tx][ty] = 0;
+    queue[tail++] = tx * H + ty;
+    while (head < tail) {
+      int cx = queue[head] / H;
+      int cy = queue[head] % H;
+      head++;
+      for (int k = 0; k < 4; k++) {
+        int nx = cx + GRID_STEP_DX[k];
+        int ny = cy + GRID_STEP_DY[k];
+        if (isFree(nx, ny) && dist[nx][ny] == UNREACHABLE) {
+          dist[nx][ny] = dist[cx][cy] + 1;
+          queue[tail++] = nx * H + ny;
+        }
+      }
+    }
+  }
+
+  // Index into GRID_STEP_* of the first neighbour of (x, y) that is one step
+  // closer in dist, or -1 at the target or when (x, y) is cut off.
+  int nextStep(int x, int y, const uint16_t (&dist)[W][H]) const {
+    if (!inBounds(x, y) || dist[x][y] == UNREACHABLE || dist[x][y] == 0) {
+      return -1;
+    }
+    for (int k = 0; k < 4; k++) {
+      int nx = x + GRID_STEP_DX[k];
+      int ny = y + GRID_STEP_DY[k];
+      if (inBounds(nx, ny) && dist[nx][ny] == dist[x][y] - 1) {
+        return k;
+      }
+    }
+    return -1;
+  }
+
+  // Plan the whole route from (sx, sy) to (tx, ty) into route[].
+  // Returns false (and leaves no route) if the target cannot be reached.
+  bool buildRoute(int sx, int sy, int tx, int ty, GridSearch<W, H> &search) {
+    computeDistances(tx, ty, search);
+    const uint16_t (&dist)[W][H] = search.dist;
+    routeLength = 0;
+    routeIndex = 0;
+    routeTargetX = tx;
+    routeTargetY = ty;
+    if (!inBounds(sx, sy) || dist[sx][sy] == UNREACHABLE) {
+      return false;
+    }
+    int x = sx;
+    int y = sy;
+    route[routeLength++] = {(int16_t)x, (int16_t)y};
+    int k;
+    while ((k = nextStep(x, y, dist)) >= 0) {
+      x += GRID_STEP_DX[k];
+      y += GRID_STEP_DY[k];
+      route[routeLength++] = {(int16_t)x, (int16_t)y};
+    }
+    return true;
+  }
+};
+
+GridPlanner<GRID_WIDTH, GRID_HEIGHT> planner;
+
+// BFS scratch for loop() and for the prefetch task, which may search at the
+// same time (its getNextAction() validates the LLM's move).
+GridSearch<GRID_WIDTH, GRID_HEIGHT> loopSearch;
+GridSearch<GRID_WIDTH, GRID_HEIGHT> prefetchSearch;
+
+// Cells blocked at boot, as space-separated "x,y" pairs (e.g. "2,1 2,2").
+// More can be added or cleared at runtime over Serial – see pollObstacleCommands().
+const char *GRID_OBSTACLE_CELLS = "";
+
 // Timestamp (millis) of the last LLM request; used to throttle requests.
 unsigned long lastRequest = 0;
 
@@ -105,6 +269,95 @@ const int MAX_HTTP_ATTEMPTS = 2;
 // subsequent requests use the shorter HTTP_TIMEOUT_MS instead of cold-start.
 bool ollamaWarmed = false;
 
+// Stream the reply (NDJSON) and hang up as soon as the action prefix is
+// unambiguous.  false = wait for the whole reply with http.getString().
+const bool OLLAMA_STREAM_RESPONSES = true;
+
+// Benchmark mode: alternate streaming and blocking requests on every step so
+// the time-to-decision averages printed after each query compare like with like.
+const bool OLLAMA_BENCHMARK_ALTERNATE = false;
+
+// Time-to-decision telemetry (POST sent → reply text in hand) for one mode.
+struct DecisionTiming {
+  uint32_t count;
+  uint32_t totalMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+};
+DecisionTiming streamingTiming = {0, 0, 0, 0};
+DecisionTiming blockingTiming = {0, 0, 0, 0};
+
+// Number of queries sent so far; drives the benchmark alternation.
+uint32_t ollamaQueryCount = 0;
+
+// One Ollama query.  loop() picks the mode (beginOllamaQuery), getNextAction()
+// fills in the result, and loop() folds the result into ollamaWarmed and the
+// timing averages (noteOllamaQuery).  The prefetch task runs getNextAction()
+// too, so it must never touch those shared counters itself.
+struct OllamaQuery {
+  bool streaming;       // NDJSON stream, or one blocking reply.
+  bool coldStart;       // Use the cold-start budget: the model may not be loaded.
+  bool answered;        // Ollama replied, so the model is loaded now.
+  bool timed;           // decisionMs holds a time-to-decision sample.
+  uint32_t decisionMs;  // POST sent → reply text in hand.
+};
+
+// =================================================
+// PIPELINING
+// With PIPELINE_QUERIES enabled, the query for the next cell is sent while
+// the current move is still driving: a background task asks Ollama from the
+// pose the robot is predicted to reach when the move ends.  If the move ends
+// on that pose the prefetched action is used directly; otherwise it is
+// discarded and the robot queries again from where it actually is.
+// Set to false for the original strictly sequential query → move cycle.
+// =================================================
+const bool PIPELINE_QUERIES = true;
+
+// Stack size for the prefetch task (HTTP client, JSON documents, prompt).
+const uint32_t PREFETCH_TASK_STACK_BYTES = 8192;
+
+// Longest action string ("MOVE_NORTH" etc.) plus the terminator.
+const size_t PREFETCH_ACTION_CHARS = 16;
+
+// Hand-off between loop() and the prefetch task.  loop() owns pose, active
+// and unsettled; the task owns action and query until it publishes them by
+// setting done (release), and loop() reads them only after seeing done
+// (acquire).  action is a fixed buffer so no heap String crosses between the tasks.
+struct PrefetchSlot {
+  GridPose pose;                         // Predicted pose the query was built for.
+  char action[PREFETCH_ACTION_CHARS];    // Validated action returned by getNextAction(pose).
+  OllamaQuery query;                     // Mode set by startPrefetch(), result by the task.
+  bool active = false;                   // A prefetch was started and not consumed yet.
+  bool unsettled = false;                // Started, and its query result not applied yet.
+  std::atomic<bool> done{true};          // false while the task is still querying.
+};
+PrefetchSlot prefetch;
+TaskHandle_t prefetchTaskHandle = nullptr;
+
+// =================================================
+// LOCAL PLANNER MODE
+// With LOCAL_PLANNER_ENABLED the robot follows a route planned on-device and
+// only asks the LLM when that route stops being usable: no route yet, the
+// destination changed, the robot is off the route, or a cell on the rest of
+// the route became blocked.  After the LLM's step the route is re-planned.
+// Most steps need no query at all; when the route is predicted to break at
+// the end of the running move, that query is prefetched like any other.
+// Set to false to consult the LLM on every step.
+// =================================================
+const bool LOCAL_PLANNER_ENABLED = true;
+
+// Stall telemetry: how long each step sat waiting for its action, plus the
+// same figures per patrol lap (origin → patrol point → origin).
+uint32_t stepCount = 0;
+uint32_t stallTotalMs = 0;
+uint32_t prefetchHits = 0;
+uint32_t prefetchMisses = 0;
+unsigned long lapStartMs = 0;
+uint32_t lapSteps = 0;
+uint32_t lapStallMs = 0;
+uint32_t lapLlmCalls = 0;      // getNextAction() calls during the current lap (loop() side only).
+uint32_t lapPlannedSteps = 0;  // Steps taken straight from the local route.
+
 // =================================================
 // MOTOR TUNING
 // Physical motors are never perfectly matched, so trim factors compensate
@@ -292,78 +545,96 @@ void runMotorSelfTest() {
 }
 // =================================================
 // -------------------------------------------------
-// getValidMovesForCurrentPosition()
+// getValidMovesForPose(pose)
 // Returns a space-separated string listing only the moves that keep the
-// robot inside the 5×5 grid from its current position.
+// robot inside the grid and off blocked cells from the given position.
 //
 // This string is injected into the LLM prompt so the model never suggests
-// a move that would walk off the edge of the grid.
+// a move that would walk off the edge of the grid or into an obstacle.
 //
 // Example: if the robot is at (0,2) the result is "MOVE_NORTH MOVE_SOUTH MOVE_EAST"
 // because MOVE_WEST would require X=-1 which is out of bounds.
 // -------------------------------------------------
-String getValidMovesForCurrentPosition() {
+String getValidMovesForPose(const GridPose &pose) {
   String moves = "";
-  if (robotY < 4) moves += "MOVE_NORTH ";  // Can move north if not at top row.
-  if (robotY > 0) moves += "MOVE_SOUTH ";  // Can move south if not at bottom row.
-  if (robotX < 4) moves += "MOVE_EAST ";   // Can move east if not at right column.
-  if (robotX > 0) moves += "MOVE_WEST ";   // Can move west if not at left column.
+  if (planner.isFree(pose.x, pose.y + 1)) moves += "MOVE_NORTH ";  // Row above is open.
+  if (planner.isFree(pose.x, pose.y - 1)) moves += "MOVE_SOUTH ";  // Row below is open.
+  if (planner.isFree(pose.x + 1, pose.y)) moves += "MOVE_EAST ";   // Column right is open.
+  if (planner.isFree(pose.x - 1, pose.y)) moves += "MOVE_WEST ";   // Column left is open.
   moves.trim();  // Remove the trailing space after the last entry.
   return moves;
 }
 // -------------------------------------------------
-// getFallbackAction()
+// getBlockedCellsText()
+// Space-separated "x,y" list of obstacle cells for the LLM prompt,
+// or "" when the map is clear.
+// -------------------------------------------------
+String getBlockedCellsText() {
+  String cells = "";
+  for (int x = 0; x < GRID_WIDTH; x++) {
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+      if (planner.blocked[x][y]) {
+        cells += String(x) + "," + String(y) + " ";
+      }
+    }
+  }
+  cells.trim();
+  return cells;
+}
+// -------------------------------------------------
+// gridSearchForCurrentTask()
+// BFS scratch owned by the calling task: the prefetch task's validation and
+// fallback searches must not share buffers with a search on loop().
+// -------------------------------------------------
+GridSearch<GRID_WIDTH, GRID_HEIGHT> &gridSearchForCurrentTask() {
+  if (prefetchTaskHandle != nullptr && xTaskGetCurrentTaskHandle() == prefetchTaskHandle) {
+    return prefetchSearch;
+  }
+  return loopSearch;
+}
+// -------------------------------------------------
+// getFallbackAction(pose)
 // Deterministic fallback navigator used when the LLM is unavailable,
 // returns an invalid move, or times out.
 //
-// Strategy: greedy Manhattan-distance reduction.
-//   1. Close the X gap first (move east or west).
-//   2. Then close the Y gap (move north or south).
-//   3. Return STOP only if already at the target.
+// Strategy: first step of a shortest path over the obstacle map.
+//   1. Prefer closing the X gap (move east or west) when that is shortest.
+//   2. Otherwise close the Y gap (move north or south).
+//   3. Return STOP if already at the target or the target is cut off.
+// On an obstacle-free map this is the same greedy Manhattan-distance walk.
 //
 // This guarantees the robot always makes progress even without the LLM.
 // -------------------------------------------------
-String getFallbackAction() {
-  if (robotX < targetX) return "MOVE_EAST";   // Target is to the right.
-  if (robotX > targetX) return "MOVE_WEST";   // Target is to the left.
-  if (robotY < targetY) return "MOVE_NORTH";  // Target is above.
-  if (robotY > targetY) return "MOVE_SOUTH";  // Target is below.
-  return "STOP";                               // Already at destination.
+String getFallbackAction(const GridPose &pose) {
+  GridSearch<GRID_WIDTH, GRID_HEIGHT> &search = gridSearchForCurrentTask();
+  planner.computeDistances(pose.targetX, pose.targetY, search);
+  int k = planner.nextStep(pose.x, pose.y, search.dist);
+  return (k >= 0) ? GRID_STEP_ACTIONS[k] : "STOP";  // STOP at destination or when cut off.
 }
 // -------------------------------------------------
-// manhattanDistance(x1, y1, x2, y2)
-// Returns the Manhattan ("taxicab") distance between two grid cells.
-// On a grid where you can only move in 4 cardinal directions, this is the
-// minimum number of steps required to travel from (x1,y1) to (x2,y2).
-// Used by isActionValidAndImproving() to verify that the LLM's chosen move
-// actually reduces the distance to the target rather than wasting a step.
-// -------------------------------------------------
-int manhattanDistance(int x1, int y1, int x2, int y2) {
-  return abs(x1 - x2) + abs(y1 - y2);
-}
-// -------------------------------------------------
-// isActionValidAndImproving(action)
+// isActionValidAndImproving(action, pose)
 // Safety gate that validates the action chosen by the LLM before the robot
 // commits to executing it.  Returns true only if the action:
 //   1. Is a recognised command string.
-//   2. Keeps the resulting position within the 5×5 grid bounds.
-//   3. Strictly reduces the Manhattan distance to the current target
-//      (i.e. the robot gets closer — sideways or backward moves are rejected).
+//   2. Keeps the resulting position within the grid and off blocked cells.
+//   3. Strictly reduces the shortest-path distance to the current target
+//      (i.e. the robot gets closer — sideways or backward moves are rejected;
+//      without obstacles this is the Manhattan distance).
 //
 // STOP is accepted only when the robot is already at the target, which is
 // the only situation where stopping is the correct action.
 //
 // Any action that fails these checks is replaced by the deterministic
-// fallback from getFallbackAction().
+// fallback from getFallbackAction(pose).
 // -------------------------------------------------
-bool isActionValidAndImproving(const String &action) {
+bool isActionValidAndImproving(const String &action, const GridPose &pose) {
   // STOP is valid only if the robot has already reached its destination.
   if (action == "STOP") {
-    return robotX == targetX && robotY == targetY;
+    return pose.x == pose.targetX && pose.y == pose.targetY;
   }
   // Simulate where this action would place the robot.
-  int nextX = robotX;
-  int nextY = robotY;
+  int nextX = pose.x;
+  int nextY = pose.y;
   if      (action == "MOVE_EAST")  { nextX++; }
   else if (action == "MOVE_WEST")  { nextX--; }
   else if (action == "MOVE_NORTH") { nextY++; }
@@ -371,14 +642,14 @@ bool isActionValidAndImproving(const String &action) {
   else {
     return false;  // Unknown action string — reject immediately.
   }
-  // Reject moves that leave the grid boundaries.
-  if (nextX < 0 || nextX > 4 || nextY < 0 || nextY > 4) {
+  // Reject moves that leave the grid boundaries or enter an obstacle.
+  if (!planner.isFree(nextX, nextY)) {
     return false;
   }
   // Accept the action only if it strictly closes the gap to the target.
-  int currentDist = manhattanDistance(robotX, robotY, targetX, targetY);
-  int nextDist    = manhattanDistance(nextX,   nextY,  targetX, targetY);
-  return nextDist < currentDist;
+  GridSearch<GRID_WIDTH, GRID_HEIGHT> &search = gridSearchForCurrentTask();
+  planner.computeDistances(pose.targetX, pose.targetY, search);
+  return search.dist[nextX][nextY] < search.dist[pose.x][pose.y];
 }
 // -------------------------------------------------
 // showGridState(action)
@@ -419,20 +690,21 @@ void applyAction(const String &action) {
   bool shouldMove = false;  // Set true only if the move is grid-legal.
 
   // Map the action string to a vehicle direction and update the logical position.
-  // Each branch also checks the boundary to prevent moving off the grid.
-  if (action == "MOVE_EAST" && robotX < 4) {
+  // Each branch also checks the boundary and obstacle map to prevent moving
+  // off the grid or into a blocked cell.
+  if (action == "MOVE_EAST" && planner.isFree(robotX + 1, robotY)) {
     moveCommand = Move_Right;
     shouldMove = true;
     robotX++;  // Advance one cell east.
-  } else if (action == "MOVE_WEST" && robotX > 0) {
+  } else if (action == "MOVE_WEST" && planner.isFree(robotX - 1, robotY)) {
     moveCommand = Move_Left;
     shouldMove = true;
     robotX--;  // Retreat one cell west.
-  } else if (action == "MOVE_NORTH" && robotY < 4) {
+  } else if (action == "MOVE_NORTH" && planner.isFree(robotX, robotY + 1)) {
     moveCommand = Forward;
     shouldMove = true;
     robotY++;  // Advance one cell north.
-  } else if (action == "MOVE_SOUTH" && robotY > 0) {
+  } else if (action == "MOVE_SOUTH" && planner.isFree(robotX, robotY - 1)) {
     moveCommand = Backward;
     shouldMove = true;
     robotY--;  // Retreat one cell south.
@@ -485,7 +757,7 @@ void applyAction(const String &action) {
     myCar.Move(Stop, 0);
 
   } else {
-    // Action was blocked by a boundary check – log and stay put.
+    // Action was blocked by a boundary or obstacle check – log and stay put.
     Serial.printf("Action blocked: %s at position %d,%d (target %d,%d)\n", action.c_str(),
                   robotX, robotY, targetX, targetY);
     myCar.Move(Stop, 0);
@@ -557,9 +829,153 @@ void connectWiFi() {
   delay(2000);  // Brief pause to let the stack stabilise before HTTP use.
 }
 // -------------------------------------------------
-// getNextAction()
-// Queries the Ollama LLM server for the next movement action and returns
-// a validated action string ("MOVE_NORTH", "MOVE_SOUTH", etc.).
+// matchStreamedAction(text)
+// Looks at a partial model reply and returns the action it is spelling out
+// as soon as the prefix can only end one way, or "" if more tokens are needed.
+//
+// Every allowed action except STOP starts with "MOVE_", and the first letter
+// after "MOVE_" (N/S/E/W) already picks the direction.  STOP is the only
+// allowed value starting with 'S', so inside {"action":"S... it is decided
+// by its first letter; outside a JSON value the full word is required.
+// -------------------------------------------------
+String matchStreamedAction(const String &text) {
+  int keyPos = text.indexOf("\"action\"");
+  int from = (keyPos >= 0) ? keyPos + 8 : 0;
+
+  int movePos = text.indexOf("MOVE_", from);
+  if (movePos >= 0) {
+    if (movePos + 5 >= (int)text.length()) {
+      return "";  // "MOVE_" seen but the direction letter has not arrived yet.
+    }
+    switch (text.charAt(movePos + 5)) {
+      case 'N': return "MOVE_NORTH";
+      case 'S': return "MOVE_SOUTH";
+      case 'E': return "MOVE_EAST";
+      case 'W': return "MOVE_WEST";
+      default:  return "";  // Unknown move – let the full-reply parser decide.
+    }
+  }
+
+  if (keyPos >= 0) {
+    // Find the opening quote of the "action" value.
+    int colonPos = text.indexOf(':', from);
+    int valuePos = (colonPos >= 0) ? text.indexOf('"', colonPos + 1) : -1;
+    if (valuePos >= 0 && valuePos + 1 < (int)text.length() && text.charAt(valuePos + 1) == 'S') {
+      return "STOP";
+    }
+    return "";
+  }
+  return (text.indexOf("STOP") >= 0) ? "STOP" : "";
+}
+// -------------------------------------------------
+// onStreamedActionToken(textSoFar, context)
+// OllamaTokenCallback used by getNextAction(): stores the early match in the
+// String pointed to by context and stops the stream once one is found.
+// -------------------------------------------------
+bool onStreamedActionToken(const String &textSoFar, void *context) {
+  String *earlyAction = static_cast<String *>(context);
+  *earlyAction = matchStreamedAction(textSoFar);
+  return earlyAction->length() == 0;  // Keep reading until an action is decided.
+}
+// -------------------------------------------------
+// resolveModelAction(actionText, pose)
+// Turns the model's reply text into a validated action string.
+//   1. Strict JSON parse of {"action":"..."}.
+//   2. Keyword search for a recognised action anywhere in the text.
+//   3. getFallbackAction(pose) if the result is invalid or non-improving.
+// -------------------------------------------------
+String resolveModelAction(const String &actionText, const GridPose &pose) {
+  // ---- Attempt 1: strict JSON parse of the model output ----
+  // Expected format: {"action":"MOVE_NORTH"}
+  JsonDocument actionDoc;
+  if (deserializeJson(actionDoc, actionText) == DeserializationError::Ok) {
+    String action = actionDoc["action"] | "STOP";
+    action.trim();
+    if (isActionValidAndImproving(action, pose)) {
+      return action;  // Valid JSON action accepted.
+    }
+    // The JSON parsed but the action is invalid or non-improving.
+    Serial.print("Rejected LLM action: "); Serial.println(action);
+    String fallback = getFallbackAction(pose);
+    Serial.print("Fallback action: "); Serial.println(fallback);
+    return fallback;
+  }
+
+  // ---- Attempt 2: keyword search in raw response text ----
+  // The model sometimes wraps its answer in prose (e.g. "I recommend MOVE_NORTH"),
+  // and a stream stopped early leaves only the matched action.
+  // Search for any recognised keyword and extract it.
+  String parsedAction = "STOP";  // Default if no keyword is found.
+  if      (actionText.indexOf("MOVE_NORTH") >= 0) parsedAction = "MOVE_NORTH";
+  else if (actionText.indexOf("MOVE_SOUTH") >= 0) parsedAction = "MOVE_SOUTH";
+  else if (actionText.indexOf("MOVE_EAST")  >= 0) parsedAction = "MOVE_EAST";
+  else if (actionText.indexOf("MOVE_WEST")  >= 0) parsedAction = "MOVE_WEST";
+
+  if (isActionValidAndImproving(parsedAction, pose)) {
+    return parsedAction;  // Keyword-extracted action accepted.
+  }
+
+  // Keyword action is also invalid — fall back to deterministic logic.
+  Serial.print("Rejected LLM action: "); Serial.println(parsedAction);
+  String fallback = getFallbackAction(pose);
+  Serial.print("Fallback action: "); Serial.println(fallback);
+  return fallback;
+}
+// -------------------------------------------------
+// recordDecisionTiming(timing, elapsedMs) / printDecisionTiming()
+// Accumulate and report time-to-decision for streaming vs blocking replies.
+// -------------------------------------------------
+void recordDecisionTiming(DecisionTiming &timing, uint32_t elapsedMs) {
+  if (timing.count == 0 || elapsedMs < timing.minMs) { timing.minMs = elapsedMs; }
+  if (elapsedMs > timing.maxMs) { timing.maxMs = elapsedMs; }
+  timing.count++;
+  timing.totalMs += elapsedMs;
+}
+
+void printDecisionTiming() {
+  const DecisionTiming *modes[2] = {&streamingTiming, &blockingTiming};
+  const char *labels[2] = {"streaming", "blocking"};
+  for (int i = 0; i < 2; i++) {
+    const DecisionTiming &t = *modes[i];
+    if (t.count == 0) { continue; }
+    Serial.printf("Time-to-decision %-9s n=%lu avg=%lu ms min=%lu ms max=%lu ms\n", labels[i],
+                  (unsigned long)t.count, (unsigned long)(t.totalMs / t.count),
+                  (unsigned long)t.minMs, (unsigned long)t.maxMs);
+  }
+}
+// -------------------------------------------------
+// beginOllamaQuery() / noteOllamaQuery(query)
+// loop()-side bookkeeping around getNextAction(): pick the reply mode and
+// budget before a query, and apply its result (model warmed, time-to-decision)
+// after it, whichever task ran it.
+// -------------------------------------------------
+OllamaQuery beginOllamaQuery() {
+  OllamaQuery query = {OLLAMA_STREAM_RESPONSES, !ollamaWarmed, false, false, 0};
+  if (OLLAMA_BENCHMARK_ALTERNATE) {
+    // Benchmark mode alternates so both averages fill up.
+    query.streaming = (ollamaQueryCount % 2) == 0;
+  }
+  ollamaQueryCount++;
+  return query;
+}
+
+void noteOllamaQuery(const OllamaQuery &query) {
+  if (query.answered) {
+    ollamaWarmed = true;  // Future calls use the shorter timeout.
+  }
+  if (query.timed) {
+    recordDecisionTiming(query.streaming ? streamingTiming : blockingTiming, query.decisionMs);
+    printDecisionTiming();
+  }
+}
+// -------------------------------------------------
+// getNextAction(pose, query)
+// Queries the Ollama LLM server for the next movement action from the given
+// pose and returns a validated action string ("MOVE_NORTH", "MOVE_SOUTH", etc.).
+// The pose is normally currentPose(); the pipelined prefetch passes the
+// position the robot is predicted to reach at the end of the running move.
+// The reply mode and budget come from query, and the outcome goes back in it
+// for noteOllamaQuery(); no shared state is written here.
 //
 // Flow:
 //   1. Ensure Wi-Fi is connected; reconnect if the link dropped.
@@ -570,25 +986,29 @@ void connectWiFi() {
 //        • Which moves are currently in-bounds.
 //        • That it must respond with a single JSON object {"action":"..."}.
 //   3. POST the request to the Ollama /api/generate endpoint.
-//   4. On the first call (cold start), the model must load into memory which
+//   4. On a cold start (query.coldStart), the model must load into memory which
 //      can take up to HTTP_COLD_START_BUDGET_MS ms. This is handled by
 //      splitting the budget into multiple shorter attempts (each ≤ 65 s)
 //      because HTTPClient::setTimeout() takes a uint16_t.
-//   5. Parse the response:
-//        a. Try strict JSON parsing: extract res["response"] then parse the
-//           inner JSON for the "action" key.
+//   5. Read the response:
+//        • Streaming (OLLAMA_STREAM_RESPONSES): feed each NDJSON token to
+//          matchStreamedAction() and close the request as soon as the
+//          action is unambiguous; the model stops generating when we hang up.
+//        • Blocking: read the whole body and extract res["response"].
+//   6. Parse the reply text with resolveModelAction():
+//        a. Strict JSON parse of the "action" key.
 //        b. If strict parse fails, fall back to substring search for any
 //           recognised action keyword in the raw response text.
-//   6. Validate the parsed action with isActionValidAndImproving().
+//   7. Validate the parsed action with isActionValidAndImproving().
 //      If invalid, or if any HTTP/JSON error occurs, fall back to the
-//      deterministic getFallbackAction().
+//      deterministic getFallbackAction(pose).
 //
 // LLM parameters used:
 //   temperature = 0.2  – low temperature for more deterministic output.
 //   num_predict = 16   – tiny token limit; we only need a short JSON object.
 //   keep_alive  = 30m  – keep the model loaded in VRAM between requests.
 // -------------------------------------------------
-String getNextAction() {
+String getNextAction(const GridPose &pose, OllamaQuery &query) {
   // Ensure the network is up before attempting any HTTP calls.
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi dropped, reconnecting...");
@@ -602,7 +1022,7 @@ String getNextAction() {
   // full cold-start budget without exceeding the uint16_t limit of setTimeout.
   uint16_t requestTimeoutMs = HTTP_TIMEOUT_MS;
   int maxAttempts = MAX_HTTP_ATTEMPTS;
-  if (!ollamaWarmed) {
+  if (query.coldStart) {
     // Cap each attempt at 65 s (safe uint16_t ceiling) and calculate how many
     // attempts are needed to cover the full cold-start budget.
     requestTimeoutMs = 65000;
@@ -612,28 +1032,36 @@ String getNextAction() {
                   HTTP_COLD_START_BUDGET_MS, maxAttempts, requestTimeoutMs);
   }
 
+  bool streaming = query.streaming;
+
   // ---- Build the JSON request body ----
   JsonDocument req;
   req["model"] = OLLAMA_MODEL;
 
   // Construct the natural-language prompt.
   // Keeping the prompt concise reduces token usage and response latency.
-  String prompt = "You are controlling a robot on a 5 by 5 grid.\n\n";
+  String prompt = "You are controlling a robot on a " + String(GRID_WIDTH) + " by " +
+                  String(GRID_HEIGHT) + " grid.\n\n";
   prompt += "Current robot position:\n";
-  prompt += "X=" + String(robotX) + "\n";
-  prompt += "Y=" + String(robotY) + "\n\n";
+  prompt += "X=" + String(pose.x) + "\n";
+  prompt += "Y=" + String(pose.y) + "\n\n";
   prompt += "Destination:\n";
-  prompt += "X=" + String(targetX) + "\n";
-  prompt += "Y=" + String(targetY) + "\n\n";
+  prompt += "X=" + String(pose.targetX) + "\n";
+  prompt += "Y=" + String(pose.targetY) + "\n\n";
   prompt += "Rules:\n";
   prompt += "X increases to the EAST.\n";
   prompt += "Y increases to the NORTH.\n";
-  prompt += "Grid limits are 0<=X<=4 and 0<=Y<=4.\n";
+  prompt += "Grid limits are 0<=X<=" + String(GRID_WIDTH - 1) + " and 0<=Y<=" +
+            String(GRID_HEIGHT - 1) + ".\n";
   prompt += "Never choose a move that would place X or Y outside those limits.\n";
+  String blockedCells = getBlockedCellsText();
+  if (blockedCells.length() > 0) {
+    prompt += "Blocked cells (never enter these): " + blockedCells + "\n";
+  }
   prompt += "Only choose valid in-bounds moves.\n\n";
   // Provide only the moves that are actually legal from the current cell.
   prompt += "Valid moves from current position:\n";
-  prompt += getValidMovesForCurrentPosition() + "\n\n";
+  prompt += getValidMovesForPose(pose) + "\n\n";
   prompt += "Allowed actions:\n";
   prompt += "MOVE_NORTH\n";
   prompt += "MOVE_SOUTH\n";
@@ -641,14 +1069,14 @@ String getNextAction() {
   prompt += "MOVE_WEST\n";
   prompt += "STOP\n\n";
   prompt += "Choose exactly one action that gets closer to the destination.\n";
-  prompt += "Never choose a move that increases or keeps the same Manhattan distance.\n";
+  prompt += "Never choose a move that increases or keeps the same shortest-path distance.\n";
   // Ask for JSON output so parsing is straightforward.  Provide an example
   // to anchor the model's output format.
   prompt += "Return JSON only:\n";
   prompt += "{\"action\":\"MOVE_NORTH\"}";
 
   req["prompt"]     = prompt;
-  req["stream"]     = false;   // Collect the full response before returning.
+  req["stream"]     = streaming;  // NDJSON token stream, or one full reply.
   req["keep_alive"] = "30m";   // Keep model in VRAM for 30 minutes.
 
   // Low temperature → more deterministic token selection (less creative).
@@ -667,13 +1095,18 @@ String getNextAction() {
     // Begin the connection to the Ollama endpoint.
     if (!http.begin(OLLAMA_URL)) {
       Serial.println("HTTP begin failed");
-      String fallback = getFallbackAction();
+      String fallback = getFallbackAction(pose);
       Serial.print("Fallback action: "); Serial.println(fallback);
       return fallback;
     }
 
     http.addHeader("Content-Type", "application/json");  // Required by Ollama API.
     http.setTimeout(requestTimeoutMs);
+    if (streaming) {
+      // HTTP/1.0 stops Ollama from chunk-encoding the stream, so the NDJSON
+      // lines can be parsed straight off the socket.
+      http.useHTTP10(true);
+    }
 
     Serial.printf("Sending Ollama request (attempt %d/%d)...\n", attempt, maxAttempts);
     unsigned long t0 = millis();
@@ -686,16 +1119,38 @@ String getNextAction() {
       Serial.println(http.errorToString(httpCode));
       http.end();
       if (attempt < maxAttempts) { delay(500); continue; }  // Retry.
-      String fallback = getFallbackAction();
+      String fallback = getFallbackAction(pose);
       Serial.print("Fallback action: "); Serial.println(fallback);
       return fallback;
     }
 
+    if (streaming) {
+      // ---- Streaming reply: stop reading once the action is decided ----
+      String earlyAction;
+      OllamaStreamResult streamed;
+      bool streamOk = readOllamaStream(http, onStreamedActionToken, &earlyAction, streamed);
+      http.end();  // Closing mid-stream makes Ollama abandon the rest of the generation.
+      if (!streamOk && streamed.text.length() == 0) {
+        Serial.printf("Stream error (attempt %d/%d): %s\n", attempt, maxAttempts, streamed.error.c_str());
+        if (attempt < maxAttempts) { delay(300); continue; }  // Retry.
+        String fallback = getFallbackAction(pose);
+        Serial.print("Fallback action: "); Serial.println(fallback);
+        return fallback;
+      }
+      query.answered = true;
+      query.timed = true;
+      query.decisionMs = millis() - t0;
+      Serial.printf("Ollama stream: %u lines, first token %lu ms, %s\n", streamed.lines,
+                    streamed.firstTokenMs, streamed.stoppedEarly ? "stopped early" : "read to end");
+      // An early match is the action itself; otherwise parse everything received.
+      return resolveModelAction(earlyAction.length() > 0 ? earlyAction : streamed.text, pose);
+    }
+
     // Successful HTTP response – read the body.
     String response = http.getString();
     http.end();
     Serial.println("Ollama response received.");
-    ollamaWarmed = true;  // Mark model as loaded so future calls use shorter timeout.
+    query.answered = true;  // Model is loaded; noteOllamaQuery() switches to the shorter timeout.
 
     // ---- Parse the Ollama response envelope ----
     // Ollama wraps the model output in:  { "response": "<model text>", ... }
@@ -704,56 +1159,339 @@ String getNextAction() {
     if (err) {
       Serial.printf("JSON parse error (attempt %d/%d): %s\n", attempt, maxAttempts, err.c_str());
       if (attempt < maxAttempts) { delay(300); continue; }  // Retry.
-      String fallback = getFallbackAction();
+      String fallback = getFallbackAction(pose);
       Serial.print("Fallback action: "); Serial.println(fallback);
       return fallback;
     }
+    query.timed = true;
+    query.decisionMs = millis() - t0;
 
     // Extract the model's text output from the "response" field.
     String actionText = res["response"] | "";
     actionText.trim();
-
-    // ---- Attempt 1: strict JSON parse of the model output ----
-    // Expected format: {"action":"MOVE_NORTH"}
-    JsonDocument actionDoc;
-    if (deserializeJson(actionDoc, actionText) == DeserializationError::Ok) {
-      String action = actionDoc["action"] | "STOP";
-      action.trim();
-      if (isActionValidAndImproving(action)) {
-        return action;  // Valid JSON action accepted.
-      }
-      // The JSON parsed but the action is invalid or non-improving.
-      Serial.print("Rejected LLM action: "); Serial.println(action);
-      String fallback = getFallbackAction();
-      Serial.print("Fallback action: "); Serial.println(fallback);
-      return fallback;
-    }
-
-    // ---- Attempt 2: keyword search in raw response text ----
-    // The model sometimes wraps its answer in prose (e.g. "I recommend MOVE_NORTH").
-    // Search for any recognised keyword and extract it.
-    String parsedAction = "STOP";  // Default if no keyword is found.
-    if      (actionText.indexOf("MOVE_NORTH") >= 0) parsedAction = "MOVE_NORTH";
-    else if (actionText.indexOf("MOVE_SOUTH") >= 0) parsedAction = "MOVE_SOUTH";
-    else if (actionText.indexOf("MOVE_EAST")  >= 0) parsedAction = "MOVE_EAST";
-    else if (actionText.indexOf("MOVE_WEST")  >= 0) parsedAction = "MOVE_WEST";
-
-    if (isActionValidAndImproving(parsedAction)) {
-      return parsedAction;  // Keyword-extracted action accepted.
-    }
-
-    // Keyword action is also invalid — fall back to deterministic logic.
-    Serial.print("Rejected LLM action: "); Serial.println(parsedAction);
-    String fallback = getFallbackAction();
-    Serial.print("Fallback action: "); Serial.println(fallback);
-    return fallback;
+    return resolveModelAction(actionText, pose);
   }
 
   // All retry attempts exhausted – use the deterministic fallback.
-  String fallback = getFallbackAction();
+  String fallback = getFallbackAction(pose);
   Serial.print("Fallback action: "); Serial.println(fallback);
   return fallback;
 }
+// -------------------------------------------------
+// currentPose()
+// Snapshot of the live grid position and destination.
+// -------------------------------------------------
+GridPose currentPose() {
+  GridPose pose = {robotX, robotY, targetX, targetY};
+  return pose;
+}
+// -------------------------------------------------
+// predictPoseAfter(action, pose)
+// Where the robot will be once applyAction(action) and
+// updateDestinationIfReached() have run from the given pose: the same
+// boundary/obstacle checks as applyAction(), and the same waypoint flip on arrival.
+// -------------------------------------------------
+GridPose predictPoseAfter(const String &action, const GridPose &pose) {
+  GridPose next = pose;
+  if      (action == "MOVE_EAST"  && planner.isFree(next.x + 1, next.y)) { next.x++; }
+  else if (action == "MOVE_WEST"  && planner.isFree(next.x - 1, next.y)) { next.x--; }
+  else if (action == "MOVE_NORTH" && planner.isFree(next.x, next.y + 1)) { next.y++; }
+  else if (action == "MOVE_SOUTH" && planner.isFree(next.x, next.y - 1)) { next.y--; }
+  if (next.x == next.targetX && next.y == next.targetY) {
+    bool reachedPatrol = (next.targetX == patrolX && next.targetY == patrolY);
+    next.targetX = reachedPatrol ? originX : patrolX;
+    next.targetY = reachedPatrol ? originY : patrolY;
+  }
+  return next;
+}
+
+bool samePose(const GridPose &a, const GridPose &b) {
+  return a.x == b.x && a.y == b.y && a.targetX == b.targetX && a.targetY == b.targetY;
+}
+// -------------------------------------------------
+// prefetchTask(param)
+// Background task: waits for startPrefetch() and runs getNextAction() for
+// the predicted pose while loop() is busy driving the current move.
+// -------------------------------------------------
+void prefetchTask(void *param) {
+  (void)param;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    String action = getNextAction(prefetch.pose, prefetch.query);
+    strncpy(prefetch.action, action.c_str(), PREFETCH_ACTION_CHARS - 1);
+    prefetch.action[PREFETCH_ACTION_CHARS - 1] = '\0';
+    prefetch.done.store(true, std::memory_order_release);
+  }
+}
+// -------------------------------------------------
+// settlePrefetch()
+// Waits for the prefetch task's query, if one is still in flight, and applies
+// its result on the loop() side.  Every synchronous query settles first, so two
+// Ollama requests never run at once, even after the prefetch was discarded.
+// -------------------------------------------------
+void settlePrefetch() {
+  if (!prefetch.unsettled) {
+    return;
+  }
+  while (!prefetch.done.load(std::memory_order_acquire)) {
+    delay(10);  // Query still in flight – it is already part-way done.
+  }
+  noteOllamaQuery(prefetch.query);
+  prefetch.unsettled = false;
+}
+// -------------------------------------------------
+// startPrefetch(action)
+// Called just before applyAction(action): predicts the post-move pose and
+// hands it to the prefetch task.  Skipped if the task is still busy with an
+// older query (its answer will be discarded by takeNextAction()).
+// In planner mode it only prefetches when the stored route will not cover
+// the next step from the predicted pose (typically arrival at a waypoint),
+// so the LLM query for a planner exception overlaps the move as well.
+// The LLM call is counted here, on the loop() side, not in the task.
+// -------------------------------------------------
+void startPrefetch(const String &action) {
+  if (!PIPELINE_QUERIES || prefetchTaskHandle == nullptr ||
+      !prefetch.done.load(std::memory_order_acquire)) {
+    return;
+  }
+  GridPose predicted = predictPoseAfter(action, currentPose());
+  if (LOCAL_PLANNER_ENABLED && routeInvalidReason(predicted) == nullptr) {
+    return;  // The route covers the next step; no LLM call needed.
+  }
+  settlePrefetch();
+  prefetch.pose = predicted;
+  prefetch.query = beginOllamaQuery();
+  prefetch.active = true;
+  prefetch.unsettled = true;
+  prefetch.done.store(false, std::memory_order_relaxed);
+  lapLlmCalls++;
+  Serial.printf("Prefetching next move from predicted %d,%d (target %d,%d)\n", prefetch.pose.x,
+                prefetch.pose.y, prefetch.pose.targetX, prefetch.pose.targetY);
+  xTaskNotifyGive(prefetchTaskHandle);
+}
+// -------------------------------------------------
+// routeInvalidReason(pose)
+// Checks whether the stored route can still be followed from this pose.
+// Returns nullptr if it can, otherwise a short reason for the Serial log.
+// -------------------------------------------------
+const char *routeInvalidReason(const GridPose &pose) {
+  if (planner.routeLength == 0) {
+    return "no route";
+  }
+  if (planner.routeTargetX != pose.targetX || planner.routeTargetY != pose.targetY) {
+    return "destination changed";
+  }
+  const GridCell &expected = planner.route[planner.routeIndex];
+  if (expected.x != pose.x || expected.y != pose.y) {
+    return "robot is off the route";
+  }
+  if (planner.routeIndex + 1 >= planner.routeLength) {
+    return "route finished";
+  }
+  for (uint16_t i = planner.routeIndex + 1; i < planner.routeLength; i++) {
+    if (planner.blocked[planner.route[i].x][planner.route[i].y]) {
+      return "blocked cell on route";
+    }
+  }
+  return nullptr;
+}
+// -------------------------------------------------
+// takePlannedAction()
+// Action for the next leg of the stored route; advances the route index.
+// Only call after routeInvalidReason() returned nullptr.
+// -------------------------------------------------
+String takePlannedAction() {
+  const GridCell &from = planner.route[planner.routeIndex];
+  const GridCell &to = planner.route[planner.routeIndex + 1];
+  planner.routeIndex++;
+  for (int k = 0; k < 4; k++) {
+    if (from.x + GRID_STEP_DX[k] == to.x && from.y + GRID_STEP_DY[k] == to.y) {
+      return GRID_STEP_ACTIONS[k];
+    }
+  }
+  return "STOP";
+}
+// -------------------------------------------------
+// replanAfter(action, pose)
+// Plans the full route to the current destination from the cell the robot
+// will occupy after action.  The destination is deliberately not flipped
+// here: on arrival the waypoint change invalidates the route, which is one
+// of the events that hands the next step to the LLM.
+// -------------------------------------------------
+void replanAfter(const String &action, const GridPose &pose) {
+  GridPose moved = predictPoseAfter(action, pose);
+  if (!planner.buildRoute(moved.x, moved.y, pose.targetX, pose.targetY, loopSearch)) {
+    Serial.printf("Planner: target %d,%d unreachable from %d,%d\n", pose.targetX, pose.targetY,
+                  moved.x, moved.y);
+    return;
+  }
+  Serial.printf("Planner: %u-step route from %d,%d to %d,%d\n", planner.routeLength - 1, moved.x,
+                moved.y, pose.targetX, pose.targetY);
+}
+// -------------------------------------------------
+// takeNextAction()
+// Returns the action for the step that is about to start.
+//   • Planner mode with a usable route → next leg of the route, no LLM call.
+//   • Otherwise the LLM decides (in planner mode the route is then re-planned):
+//       – prefetch for exactly this pose → use it, waiting if still in flight;
+//       – no prefetch, or the move ended somewhere unexpected → discard it,
+//         wait for it if still in flight, and query synchronously from the
+//         actual pose.
+// The time spent here is the step's stall: the robot is stopped and waiting
+// for a decision.  It is printed per step and summed per lap.
+// -------------------------------------------------
+String takeNextAction() {
+  unsigned long waitStartMs = millis();
+  GridPose pose = currentPose();
+  String action;
+  const char *source = "queried";
+  const char *routeProblem = LOCAL_PLANNER_ENABLED ? routeInvalidReason(pose) : nullptr;
+  if (LOCAL_PLANNER_ENABLED && routeProblem == nullptr) {
+    action = takePlannedAction();
+    source = "planned";
+    lapPlannedSteps++;
+  } else {
+    if (LOCAL_PLANNER_ENABLED) {
+      Serial.printf("Route invalid (%s): consulting LLM\n", routeProblem);
+    }
+    if (prefetch.active && samePose(prefetch.pose, pose)) {
+      settlePrefetch();
+      action = String(prefetch.action);
+      source = "prefetched";
+      prefetchHits++;
+    } else {
+      if (prefetch.active) {
+        prefetchMisses++;
+        Serial.println("Prefetched move discarded: robot is not where the prediction expected");
+      }
+      if (!prefetch.done.load(std::memory_order_acquire)) {
+        Serial.println("Waiting for the in-flight prefetch before querying");
+      }
+      settlePrefetch();
+      OllamaQuery query = beginOllamaQuery();
+      action = getNextAction(pose, query);
+      noteOllamaQuery(query);
+      lapLlmCalls++;
+    }
+    if (LOCAL_PLANNER_ENABLED) {
+      replanAfter(action, pose);
+    }
+  }
+  prefetch.active = false;
+
+  uint32_t stallMs = millis() - waitStartMs;
+  stepCount++;
+  stallTotalMs += stallMs;
+  lapSteps++;
+  lapStallMs += stallMs;
+  Serial.printf("Step stall: %lu ms (%s) | avg %lu ms over %lu steps | prefetch hits %lu misses %lu\n",
+                (unsigned long)stallMs, source,
+                (unsigned long)(stallTotalMs / stepCount), (unsigned long)stepCount,
+                (unsigned long)prefetchHits, (unsigned long)prefetchMisses);
+  return action;
+}
+// -------------------------------------------------
+// reportLap()
+// Prints the time for a full patrol lap, the stall share of it and how many
+// LLM calls it took, then starts the next lap.  Called each time the robot
+// arrives back at origin.
+// -------------------------------------------------
+void reportLap() {
+  unsigned long lapMs = millis() - lapStartMs;
+  const char *mode = LOCAL_PLANNER_ENABLED ? "local planner"
+                     : (PIPELINE_QUERIES ? "LLM every step, pipelined" : "LLM every step, sequential");
+  Serial.printf("Patrol lap: %lu ms, %lu steps, stalled %lu ms (avg %lu ms/step), "
+                "LLM calls %lu, planned steps %lu [%s]\n",
+                lapMs, (unsigned long)lapSteps, (unsigned long)lapStallMs,
+                (unsigned long)(lapSteps > 0 ? lapStallMs / lapSteps : 0),
+                (unsigned long)lapLlmCalls, (unsigned long)lapPlannedSteps, mode);
+  lapStartMs = millis();
+  lapSteps = 0;
+  lapStallMs = 0;
+  lapLlmCalls = 0;
+  lapPlannedSteps = 0;
+}
+// -------------------------------------------------
+// setObstacleCell(x, y, isBlocked)
+// Marks or clears one obstacle cell.  A stored route crossing a newly
+// blocked cell is caught by routeInvalidReason() on the next step.
+// The robot's own cell and the two waypoints can never be blocked.
+// -------------------------------------------------
+bool setObstacleCell(int x, int y, bool isBlocked) {
+  if (!planner.inBounds(x, y)) {
+    return false;
+  }
+  bool reserved = (x == robotX && y == robotY) || (x == originX && y == originY) ||
+                  (x == patrolX && y == patrolY);
+  if (isBlocked && reserved) {
+    return false;
+  }
+  planner.blocked[x][y] = isBlocked;
+  return true;
+}
+// -------------------------------------------------
+// loadObstacleCells(list)
+// Applies a space-separated "x,y" list such as GRID_OBSTACLE_CELLS.
+// -------------------------------------------------
+void loadObstacleCells(const char *list) {
+  String cells = list;
+  cells.trim();
+  while (cells.length() > 0) {
+    int spacePos = cells.indexOf(' ');
+    String cell = (spacePos >= 0) ? cells.substring(0, spacePos) : cells;
+    cells = (spacePos >= 0) ? cells.substring(spacePos + 1) : "";
+    cells.trim();
+    int commaPos = cell.indexOf(',');
+    if (commaPos <= 0 || !setObstacleCell(cell.substring(0, commaPos).toInt(),
+                                          cell.substring(commaPos + 1).toInt(), true)) {
+      Serial.printf("Ignoring obstacle cell '%s'\n", cell.c_str());
+    }
+  }
+}
+// -------------------------------------------------
+// pollObstacleCommands()
+// Serial console for editing the obstacle map while the robot runs:
+//   B x,y  – block a cell      U x,y  – clear a cell
+// There is no obstacle sensor on this chassis, so this is how blocked
+// cells are reported to the planner.
+// -------------------------------------------------
+void pollObstacleCommands() {
+  if (!Serial.available()) {
+    return;
+  }
+  String line = Serial.readStringUntil('\n');
+  line.trim();
+  if (line.length() < 2 || (line[0] != 'B' && line[0] != 'U')) {
+    return;
+  }
+  String cell = line.substring(1);
+  cell.trim();
+  int commaPos = cell.indexOf(',');
+  bool isBlocked = (line[0] == 'B');
+  if (commaPos > 0 && setObstacleCell(cell.substring(0, commaPos).toInt(),
+                                      cell.substring(commaPos + 1).toInt(), isBlocked)) {
+    Serial.printf("Obstacle map: %s %s | blocked: %s\n", isBlocked ? "blocked" : "cleared",
+                  cell.c_str(), getBlockedCellsText().c_str());
+  } else {
+    Serial.printf("Obstacle command rejected: %s\n", line.c_str());
+  }
+}
+// -------------------------------------------------
+// runNavigationStep()
+// One grid step: get the action, start the prefetch for the following
+// step, drive the move, flip the waypoint if reached, and report.
+// -------------------------------------------------
+void runNavigationStep() {
+  String action = takeNextAction();   // Prefetched, or ask LLM (or fallback) now.
+  startPrefetch(action);              // Next query runs while this move drives.
+  bool wasHeadingToPatrol = headingToPatrol;
+  applyAction(action);                // Drive the motors for one grid step.
+  updateDestinationIfReached();       // Flip target if waypoint was reached.
+  showGridState(action);              // Print position summary to Serial.
+  if (!wasHeadingToPatrol && headingToPatrol) {
+    reportLap();                      // Back at origin: one full lap done.
+  }
+}
 // =================================================
 // setup()
 // Arduino entry point – runs once after power-on or reset.
@@ -762,7 +1500,7 @@ String getNextAction() {
 //   2. Initialise the motor controller and ensure motors are stopped.
 //   3. Configure the buzzer pin and play a startup beep.
 //   4. Optionally run the motor self-test (see RUN_MOTOR_SELF_TEST_ON_BOOT).
-//   5. Connect to Wi-Fi.
+//   5. Connect to Wi-Fi and start the prefetch task (PIPELINE_QUERIES).
 //   6. Perform the very first LLM query and execute the resulting move.
 //      Running one move in setup() means the robot begins navigating
 //      immediately rather than waiting for the first loop() interval.
@@ -788,13 +1526,22 @@ void setup() {
 
   connectWiFi();  // Block until Wi-Fi is connected.
 
+  loadObstacleCells(GRID_OBSTACLE_CELLS);  // Static obstacles for the planner.
+
+  // Background task that queries Ollama for the next cell during each move
+  // (in planner mode, only for the steps where the route is about to break).
+  if (PIPELINE_QUERIES &&
+      xTaskCreatePinnedToCore(prefetchTask, "OllamaPrefetch", PREFETCH_TASK_STACK_BYTES, nullptr, 1,
+                              &prefetchTaskHandle, 0) != pdPASS) {
+    prefetchTaskHandle = nullptr;
+    Serial.println("Prefetch task failed to start, running sequentially");
+  }
+
   // Execute the first navigation step immediately so the robot begins moving
   // without waiting for the first REQUEST_INTERVAL in loop().
   Serial.println("Consulting the AI oracle...");
-  String action = getNextAction();
-  applyAction(action);
-  updateDestinationIfReached();
-  showGridState(action);
+  lapStartMs = millis();
+  runNavigationStep();
   lastRequest = millis();  // Seed the timer so loop() waits a full interval.
 }
 // =================================================
@@ -803,22 +1550,21 @@ void setup() {
 // Only runs the navigation pipeline when REQUEST_INTERVAL ms have elapsed
 // since the last step, effectively rate-limiting how fast the robot moves.
 //
-// Each iteration of the navigation pipeline:
-//   1. Query the LLM (or fallback) for the next action.
-//   2. Execute the physical motor move via applyAction().
-//   3. Check whether a waypoint was reached and flip the target if so.
-//   4. Print the current grid state to Serial.
-//   5. Reset the timer for the next interval.
+// Each iteration of the navigation pipeline (runNavigationStep()):
+//   1. Take the prefetched action, or query the LLM (or fallback) now.
+//   2. Start the prefetch for the cell after this move.
+//   3. Execute the physical motor move via applyAction().
+//   4. Check whether a waypoint was reached and flip the target if so.
+//   5. Print the current grid state to Serial.
+//   6. Reset the timer for the next interval.
 // =================================================
 void loop() {
+  pollObstacleCommands();  // Apply any B/U obstacle edits typed on Serial.
   // Rate-limit: only act when enough time has passed since the last move.
   if (millis() - lastRequest > REQUEST_INTERVAL) {
     Serial.println("Consulting the AI oracle...");
-    String action = getNextAction();    // Ask LLM (or fallback) what to do.
-    applyAction(action);                // Drive the motors for one grid step.
-    updateDestinationIfReached();       // Flip target if waypoint was reached.
-    showGridState(action);              // Print position summary to Serial.
+    runNavigationStep();                // Decide, drive, and report one grid step.
     lastRequest = millis();             // Reset the interval timer.
   }
-  // The robot is idle between steps; no other background work is needed.
+  // Between steps the prefetch task (if any) is already querying the next move.
 }
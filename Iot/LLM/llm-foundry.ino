@@ -3,12 +3,30 @@
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
 #include <HTTPClient.h>
+#include <Preferences.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include <atomic>
 #include <ultrasonic.h>
 #include <vehicle.h>
+#include "control_scheduler.h"
+#include "decision_cache.h"
+#include "distilled_policy.h"
 #include "foundry_config.h"
+#include "maneuver_executor.h"
+#include "prompt_buffer.h"
+#include "ultrasonic_echo.h"
 #include "wifi_config.h"
+// Per-decision log lines are queued and printed by rover_log.h's drain task, so a plan starts
+// executing without waiting for the UART.
+#define ROVER_LOG_RING_RECORDS 16
+#define ROVER_LOG_MAX_ARGS 10
+#define ROVER_LOG_TEXT_BYTES 64
+#define ROVER_LOG_FORMATS(X)                                                                         \
+  X(LOG_DECISION_TELEMETRY, "Decision telemetry: status=%s, requestSent=%s, responseOk=%s, planParsed=%s") \
+  X(LOG_EXECUTING_PLAN, "Executing plan source=%s primary=%s secondary=%s")                          \
+  X(LOG_MANEUVER_ENDED_EARLY, "Maneuver %s ended early: %s")
+#include "rover_log.h"
 
 /*
  * What this sketch does
@@ -22,11 +40,40 @@
  * 3) Optionally ask Azure AI Foundry to arbitrate among maneuver candidates.
  * 4) Validate/sanitize model output and execute the selected primary/secondary plan.
  * 5) Track outcomes to reduce oscillation and repeated trap patterns over time.
+ *
+ * Foundry plans are cached under a quantized snapshot of the planner inputs, so repeat
+ * situations are answered locally; cached confidence decays with age and bad outcomes,
+ * and the cache is persisted to NVS.
+ *
+ * While driving, the front closing rate predicts when the hazard threshold will be crossed.
+ * Shortly before that, a worker task sends the Foundry request speculatively; at the stop
+ * the answer is used only if the fresh scan still matches the inputs it was built from.
+ *
+ * Every parsed Foundry plan is also logged as a "Distill sample:" line. policy-distill.py
+ * fits a small decision tree to those samples and regenerates distilled_policy.h; when the
+ * tree's leaf for the current situation is confident enough, the rover uses it instead of
+ * calling Foundry, and otherwise compares it with Foundry's answer to track agreement.
+ *
+ * Plans run through maneuver_executor.h instead of drive-then-delay(): loop() keeps coming
+ * back every pass while a maneuver runs, and each pass takes a forward reading. A move ends
+ * early once the front is clear, and a newly close obstacle aborts the rest of the plan.
+ * "Maneuver |" lines report early ends and the time saved against fixed-duration moves.
+ *
+ * Ultrasonic readings never block the loop: ultrasonic_echo.h triggers the sensor and an
+ * echo-pin interrupt times the pulse, so each pass only checks whether the echo is in. The
+ * stop-and-look left/right/front scan is a small state machine that loop() advances one
+ * settle or reading at a time; the plan is chosen (or the last plan scored) once it is done.
+ *
+ * loop() runs the control step as a periodic job through control_scheduler.h; "Sched |" lines
+ * every 30 s show its execution time, lateness and deadline misses (a synchronous Foundry call
+ * shows up as a miss).
  */
 
-// Hardware control objects.
+// Hardware control objects. echoRanger times echoes by interrupt; sensor.Ranging() is the
+// blocking fallback when it cannot start.
 vehicle myCar;
 ultrasonic sensor;
+UltrasonicEcho echoRanger;
 Servo panServo;
 
 // Coarse directional decision memory for local fallback behavior.
@@ -67,6 +114,76 @@ struct ManeuverPlan {
   bool repeatedTrap;
 };
 
+// Result of one Foundry HTTP round trip, filled without touching navigation globals. Text lives in
+// fixed buffers so a result the worker fills never hands heap blocks over to loop().
+const size_t FOUNDRY_STATUS_CHARS = 48;
+const size_t FOUNDRY_MODEL_TEXT_CHARS = 768;
+struct FoundryCallResult {
+  bool requestSent;
+  bool responseOk;
+  bool textOk;
+  uint32_t roundTripMs;
+  char status[FOUNDRY_STATUS_CHARS];
+  char modelText[FOUNDRY_MODEL_TEXT_CHARS];
+};
+
+// Step of the stop-and-look scan; each waits for the servo to settle, then for one echo.
+enum HazardScanStep {
+  HAZARD_SCAN_IDLE = 0,
+  HAZARD_SCAN_LEFT,
+  HAZARD_SCAN_RIGHT,
+  HAZARD_SCAN_FRONT,
+};
+
+// What loop() does with a finished scan: choose a plan, or score the plan that just ran.
+enum HazardScanPurpose {
+  HAZARD_SCAN_FOR_DECISION = 0,
+  HAZARD_SCAN_FOR_OUTCOME,
+};
+
+// Lifecycle of the single speculative Foundry request.
+enum SpeculativeQueryState {
+  SPECULATIVE_IDLE = 0,
+  SPECULATIVE_RUNNING,
+  SPECULATIVE_READY,
+  SPECULATIVE_ABANDONED,
+};
+
+// Planner inputs a speculative request was built from, plus its worker-filled result.
+struct SpeculativeQuery {
+  float leftCm;
+  float frontCm;
+  float rightCm;
+  bool repeatedTrap;
+  uint8_t oscillationCount;
+  ManeuverType localPrimary;
+  unsigned long startedMs;
+  unsigned long readyMs;
+  FoundryCallResult result;
+  // Worker stores true (release) after filling result; loop() loads it (acquire) before reading.
+  std::atomic<bool> done{true};
+};
+
+// Speculation hit/waste telemetry for the current run.
+struct SpeculativeQueryStats {
+  uint32_t started;
+  uint32_t used;
+  uint32_t discarded;
+  uint32_t expired;
+  uint32_t failed;
+  uint32_t savedStopMsTotal;
+};
+
+// Distilled-policy answers vs. escalations, and shadow agreement with Foundry on escalations.
+struct DistilledPolicyStats {
+  uint32_t lookups;
+  uint32_t answered;
+  uint32_t escalated;
+  uint32_t shadowComparisons;
+  uint32_t shadowAgreements;
+  uint32_t lastLookupUs;
+};
+
 // Motion tuning constants.
 const int FORWARD_SPEED = 190;
 const int TURN_SPEED = 240;
@@ -107,11 +224,26 @@ const unsigned long STRAFE_DURATION_MS = 450;
 const unsigned long BACKUP_DURATION_MS = 380;
 const uint8_t ALL_UNKNOWN_STREAK_THRESHOLD = 8;
 
+// Time-sliced maneuvers: forward readings every SENSOR_INTERVAL_MS; a move may end once two in a
+// row show MANEUVER_CLEAR_CM (after at least half its duration), and two readings at or under
+// EMERGENCY_REVERSE_CM abort the plan.
+const float MANEUVER_CLEAR_CM = 70.0f;
+const ManeuverExecutorConfig MANEUVER_EXECUTOR_CONFIG = {
+    (uint16_t)SENSOR_INTERVAL_MS, MANEUVER_CLEAR_CM, EMERGENCY_REVERSE_CM, 2, 50};
+
+// Periodic jobs (period / deadline, ms). The control step replaces the old loop() and its delay(20);
+// the report job prints the scheduler statistics.
+const uint32_t CONTROL_JOB_PERIOD_MS = 5;
+const uint32_t CONTROL_JOB_DEADLINE_MS = 20;
+const uint32_t REPORT_JOB_DEADLINE_MS = 100;
+const unsigned long SCHEDULER_REPORT_INTERVAL_MS = 30000;
+
 // Foundry request limits/timeouts.
 const uint16_t FOUNDRY_MAX_OUTPUT_TOKENS = 160;
 const uint16_t FOUNDRY_RETRY_OUTPUT_TOKENS = 120;
 const unsigned long FOUNDRY_HTTP_TIMEOUT_TIGHT_MS = 3800;
 const unsigned long FOUNDRY_HTTP_TIMEOUT_RETRY_MS = 9000;
+const size_t FOUNDRY_REQUEST_BODY_CAPACITY = 3072;
 
 // Decision pacing and stale-data handling.
 const unsigned long HAZARD_DECISION_COOLDOWN_MS = 800;
@@ -140,10 +272,38 @@ const float PLAN_IMPROVEMENT_MARGIN_CM = 5.0f;
 const uint16_t MIN_MANEUVER_DURATION_MS = 180;
 const uint16_t MAX_MANEUVER_DURATION_MS = 700;
 
+// Decision cache sizing, quantization, confidence decay, and NVS persistence (decision_cache.h).
+const uint8_t DECISION_CACHE_SIZE = 24;
+const DecisionCacheConfig DECISION_CACHE_CONFIG = {
+    ULTRASONIC_MIN_VALID_CM, 15.0f, 11, 8.0f, 0.60f, 600000UL, 0.10f, 0.90f, 0.50f, 0.80f,
+    true, "navcache", 60000UL, 1};
+
+// Distilled policy (distilled_policy.h); its confidence threshold is generated with the tree.
+const bool DISTILLED_POLICY_ENABLED = true;
+
+// Speculative Foundry query trigger, snapshot matching, and worker settings.
+const bool SPECULATIVE_QUERY_ENABLED = true;
+const float FRONT_CLOSING_RATE_EMA_ALPHA = 0.40f;
+const float SPECULATIVE_MIN_CLOSING_RATE_CM_S = 8.0f;
+const unsigned long SPECULATIVE_LOOKAHEAD_MS = 600;
+const unsigned long SPECULATIVE_NEGATIVE_TREND_BONUS_MS = 300;
+const unsigned long SPECULATIVE_MIN_INTERVAL_MS = 1500;
+const unsigned long SPECULATIVE_RESULT_TTL_MS = 2500;
+const float SPECULATIVE_MATCH_SIDE_CM = 20.0f;
+const float SPECULATIVE_MATCH_FRONT_CM = 30.0f;
+const unsigned long SPECULATIVE_WAIT_LIMIT_MS = FOUNDRY_HTTP_TIMEOUT_TIGHT_MS + FOUNDRY_HTTP_TIMEOUT_RETRY_MS + 500;
+const uint32_t SPECULATIVE_WORKER_STACK_BYTES = 8192;
+
 // Runtime state and rolling telemetry/history.
 bool obstacleNearby = false;
 bool previousObstacleNearby = false;
 unsigned long lastSensorMs = 0;
+bool frontRangingPending = false;
+bool frontRetryUsed = false;
+HazardScanStep hazardScanStep = HAZARD_SCAN_IDLE;
+HazardScanPurpose hazardScanPurpose = HAZARD_SCAN_FOR_DECISION;
+unsigned long hazardScanSettleUntilMs = 0;
+unsigned long hazardScanStartedMs = 0;
 unsigned long lastPanStepMs = 0;
 unsigned long lastHazardDecisionMs = 0;
 unsigned long hazardBurstWindowStartMs = 0;
@@ -159,6 +319,7 @@ float rightDistanceCm = -1.0f;
 float frontFilteredCm = -1.0f;
 bool frontFilterReady = false;
 unsigned long frontUpdatedMs = 0;
+float frontClosingRateCmPerSec = 0.0f;
 HazardSnapshot navHistory[NAV_HISTORY_SIZE];
 uint8_t navHistoryCount = 0;
 uint8_t navHistoryWriteIndex = 0;
@@ -173,6 +334,20 @@ bool foundryRequestSent = false;
 bool foundryResponseOk = false;
 bool foundryPlanParsed = false;
 String foundryDecisionStatus = "idle";
+DecisionCache<ManeuverType, DECISION_CACHE_SIZE> decisionCache;
+DistilledPolicyStats distilledPolicyStats = {};
+int8_t distilledShadowPrimary = -1;
+SpeculativeQuery speculativeQuery;
+// Request bodies: one for loop() and one the speculative worker reads while loop() keeps running.
+char foundryRequestStorage[FOUNDRY_REQUEST_BODY_CAPACITY];
+char speculativeRequestStorage[FOUNDRY_REQUEST_BODY_CAPACITY];
+PromptBuffer foundryRequestBody(foundryRequestStorage, sizeof(foundryRequestStorage));
+PromptBuffer speculativeRequestBody(speculativeRequestStorage, sizeof(speculativeRequestStorage));
+volatile SpeculativeQueryState speculativeQueryState = SPECULATIVE_IDLE;
+SpeculativeQueryStats speculativeQueryStats = {};
+TaskHandle_t speculativeQueryTaskHandle = nullptr;
+ManeuverExecutor<2> maneuverExecutor;
+ControlScheduler<2> controlScheduler;
 
 // Turn both status LEDs on/off, honoring active-high vs active-low wiring.
 void setBothLeds(bool on) {
@@ -271,8 +446,17 @@ void updateFrontDistanceEstimate(float measuredCm, unsigned long nowMs, bool res
   if (resetFilter || !frontFilterReady || !isValidDistance(frontFilteredCm)) {
     frontFilteredCm = measuredCm;
     frontFilterReady = true;
+    frontClosingRateCmPerSec = 0.0f;
   } else {
+    float previousCm = frontFilteredCm;
     frontFilteredCm = (FRONT_EMA_ALPHA * measuredCm) + ((1.0f - FRONT_EMA_ALPHA) * frontFilteredCm);
+    unsigned long elapsedMs = nowMs - frontUpdatedMs;
+    if (frontUpdatedMs != 0 && elapsedMs > 0) {
+      // Positive rate means the obstacle ahead is getting closer.
+      float instantRate = (previousCm - frontFilteredCm) * 1000.0f / elapsedMs;
+      frontClosingRateCmPerSec = (FRONT_CLOSING_RATE_EMA_ALPHA * instantRate) +
+                                 ((1.0f - FRONT_CLOSING_RATE_EMA_ALPHA) * frontClosingRateCmPerSec);
+    }
   }
   frontDistanceCm = frontFilteredCm;
   frontUpdatedMs = nowMs;
@@ -322,13 +506,11 @@ ManeuverPlan buildRecoveryPlan(Action action) {
 }
 
 // Compact candidate-plan serialization used in the LLM prompt.
-String planToPromptText(const char *label, const ManeuverPlan &plan) {
-  return String(label) + "={primary:" + maneuverTypeToString(plan.primary) +
-         ",primary_ms:" + String(plan.primaryDurationMs) +
-         ",secondary:" + maneuverTypeToString(plan.secondary) +
-         ",secondary_ms:" + String(plan.secondaryDurationMs) +
-         ",confidence:" + String(plan.confidence, 2) +
-         ",risk:" + String(plan.riskScore, 2) + "}";
+void appendPlanPromptText(PromptBuffer &out, const char *label, const ManeuverPlan &plan) {
+  out.appendf("%s={primary:%s,primary_ms:%u,secondary:%s,secondary_ms:%u,confidence:%.2f,risk:%.2f}", label,
+              maneuverTypeToString(plan.primary), (unsigned)plan.primaryDurationMs,
+              maneuverTypeToString(plan.secondary), (unsigned)plan.secondaryDurationMs, plan.confidence,
+              plan.riskScore);
 }
 
 // Heuristic candidate scoring for local planning when cloud guidance is absent/untrusted.
@@ -517,36 +699,26 @@ bool detectRepeatedTrap(float leftCm, float frontCm, float rightCm) {
   return similarCount >= TRAP_REPEAT_THRESHOLD;
 }
 
-// Build compact CSV-style summary of recent plans for telemetry/prompt context.
-String buildRecentPlanSummary() {
-  String summary;
+// Append compact CSV-style summary of recent plans for prompt context.
+void appendRecentPlanSummary(PromptBuffer &out) {
   for (uint8_t i = 0; i < 4; ++i) {
-    if (i > 0) {
-      summary += ",";
-    }
     uint8_t idx = (recentPlanWriteIndex + i) % 4;
-    summary += maneuverTypeToString(recentPlans[idx]);
+    out.appendf(i > 0 ? ",%s" : "%s", maneuverTypeToString(recentPlans[idx]));
   }
-  return summary;
 }
 
-// Build compact textual summary of hazard snapshots for telemetry/prompt context.
-String buildHistorySummary() {
-  String summary;
+// Append compact textual summary of hazard snapshots for prompt context.
+void appendHistorySummary(PromptBuffer &out) {
+  if (navHistoryCount == 0) {
+    out.append("none");
+    return;
+  }
   uint8_t start = (navHistoryCount == NAV_HISTORY_SIZE) ? navHistoryWriteIndex : 0;
   for (uint8_t i = 0; i < navHistoryCount; ++i) {
     uint8_t idx = (start + i) % NAV_HISTORY_SIZE;
-    if (summary.length() > 0) {
-      summary += " | ";
-    }
-    summary += "L=" + String(navHistory[idx].leftCm, 1);
-    summary += ",F=" + String(navHistory[idx].frontCm, 1);
-    summary += ",R=" + String(navHistory[idx].rightCm, 1);
+    out.appendf(i > 0 ? " | L=%.1f,F=%.1f,R=%.1f" : "L=%.1f,F=%.1f,R=%.1f", navHistory[idx].leftCm,
+                navHistory[idx].frontCm, navHistory[idx].rightCm);
   }
-  if (summary.length() == 0) {
-    summary = "none";
-  }
-  return summary;
 }
 
 // Measure front clearance trend across history window (positive is improving).
@@ -904,24 +1076,135 @@ void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan) {
   }
 }
 
-// Ask Foundry for maneuver arbitration; always degrade safely to local fallback plan.
-ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
-  foundryRequestSent = false;
-  foundryResponseOk = false;
-  foundryPlanParsed = false;
-  foundryDecisionStatus = "init";
-  flashFoundryThinkingLeds();
-  if (WiFi.status() != WL_CONNECTED) {
-    foundryDecisionStatus = "wifi_disconnected_local_fallback";
-    Serial.println("Foundry skipped: WiFi disconnected, using local fallback plan");
-    return fallbackPlan;
+// Pack quantized L/F/R buckets, trend, oscillation, and trap flag into one cache key.
+uint32_t buildDecisionCacheKey(bool repeatedTrap) {
+  return decisionCache.key(leftDistanceCm, frontDistanceCm, rightDistanceCm, frontTrendCm(),
+                           detectPlanOscillationCount(), repeatedTrap);
+}
+// Answer a repeat situation from the cache; the cached plan is re-sanitized against the local plan.
+bool lookupDecisionCache(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &cachedPlan) {
+  ManeuverPlan plan = localPlan;
+  if (!decisionCache.lookup(buildDecisionCacheKey(repeatedTrap), millis(), plan)) {
+    return false;
   }
-  HTTPClient http;
-  if (!http.begin(FOUNDRY_RESPONSES_URL)) {
-    foundryDecisionStatus = "http_begin_failed_local_fallback";
-    Serial.println("Foundry: HTTP begin failed");
-    return fallbackPlan;
+  plan.riskScore = estimateLocalRiskScore();
+  plan.repeatedTrap = repeatedTrap;
+  sanitizePlan(plan, localPlan);
+  cachedPlan = plan;
+  return true;
+}
+// Planner inputs in DistilledPolicyFeature order, the same values the Distill sample line logs.
+void buildDistilledPolicyFeatures(const ManeuverPlan &localPlan, bool repeatedTrap, float *features) {
+  int leftEff = effectiveDistance(leftDistanceCm);
+  int rightEff = effectiveDistance(rightDistanceCm);
+  features[DISTILLED_FEATURE_LEFT_CM] = (float)leftEff;
+  features[DISTILLED_FEATURE_FRONT_CM] = (float)effectiveDistance(frontDistanceCm);
+  features[DISTILLED_FEATURE_RIGHT_CM] = (float)rightEff;
+  features[DISTILLED_FEATURE_SIDE_DIFF_CM] = (float)(leftEff - rightEff);
+  features[DISTILLED_FEATURE_FRONT_TREND_CM] = frontTrendCm();
+  features[DISTILLED_FEATURE_OSCILLATION_COUNT] = (float)detectPlanOscillationCount();
+  features[DISTILLED_FEATURE_REPEATED_TRAP] = repeatedTrap ? 1.0f : 0.0f;
+  features[DISTILLED_FEATURE_LOCAL_PRIMARY] = (float)localPlan.primary;
+}
+// Default duration for a maneuver the tree chose when it differs from the local candidate.
+uint16_t distilledManeuverDurationMs(ManeuverType maneuver, const ManeuverPlan &localPlan) {
+  if (maneuver == localPlan.primary) {
+    return localPlan.primaryDurationMs;
+  }
+  switch (maneuver) {
+    case MANEUVER_STRAFE_LEFT:
+    case MANEUVER_STRAFE_RIGHT:
+      return STRAFE_DURATION_MS;
+    case MANEUVER_BACKWARD:
+      return BACKUP_DURATION_MS;
+    case MANEUVER_TURN_LEFT_90:
+    case MANEUVER_TURN_RIGHT_90:
+      return TURN_90_DURATION_MS;
+    case MANEUVER_RESCAN:
+      return RESCAN_PAUSE_MS;
+    default:
+      return 0;
+  }
+}
+// Answer from the distilled tree when its leaf is confident; otherwise remember its guess so the
+// Foundry answer can be scored against it.
+bool lookupDistilledPolicy(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &plan) {
+  distilledShadowPrimary = -1;
+  if (!DISTILLED_POLICY_ENABLED) {
+    return false;
   }
+  unsigned long startUs = micros();
+  float features[DISTILLED_FEATURE_COUNT];
+  buildDistilledPolicyFeatures(localPlan, repeatedTrap, features);
+  const DistilledPolicyNode &leaf = distilledPolicyLeaf(features);
+  distilledPolicyStats.lookups++;
+  distilledPolicyStats.lastLookupUs = micros() - startUs;
+  if (leaf.confidence < DISTILLED_POLICY_MIN_CONFIDENCE) {
+    distilledPolicyStats.escalated++;
+    distilledShadowPrimary = (int8_t)leaf.primary;
+    return false;
+  }
+  plan = localPlan;
+  plan.primary = (ManeuverType)leaf.primary;
+  plan.primaryDurationMs = distilledManeuverDurationMs(plan.primary, localPlan);
+  plan.secondary = (ManeuverType)leaf.secondary;
+  plan.secondaryDurationMs = distilledManeuverDurationMs(plan.secondary, localPlan);
+  plan.confidence = leaf.confidence;
+  plan.riskScore = estimateLocalRiskScore();
+  plan.repeatedTrap = repeatedTrap;
+  sanitizePlan(plan, localPlan);
+  distilledPolicyStats.answered++;
+  return true;
+}
+void printDistilledPolicyStats() {
+  Serial.print("Distilled policy: samples=");
+  Serial.print(DISTILLED_POLICY_SAMPLES);
+  Serial.print(" answered=");
+  Serial.print(distilledPolicyStats.answered);
+  Serial.print(" escalated=");
+  Serial.print(distilledPolicyStats.escalated);
+  Serial.print(" cloudCallsAvoided=");
+  Serial.print(distilledPolicyStats.lookups > 0 ? (100.0f * distilledPolicyStats.answered / distilledPolicyStats.lookups) : 0.0f, 1);
+  Serial.print("% shadowAgreement=");
+  Serial.print(distilledPolicyStats.shadowComparisons > 0
+                   ? (100.0f * distilledPolicyStats.shadowAgreements / distilledPolicyStats.shadowComparisons)
+                   : 0.0f,
+               1);
+  Serial.print("% (");
+  Serial.print(distilledPolicyStats.shadowComparisons);
+  Serial.print(") lookupUs=");
+  Serial.println(distilledPolicyStats.lastLookupUs);
+}
+// Request body template, pre-escaped for a JSON string. Everything up to the end of the
+// instructions is constant flash text, so every request starts with the same bytes.
+static const char FOUNDRY_BODY_MODEL_OPEN[] PROGMEM = "{\"model\":\"";
+static const char FOUNDRY_BODY_INPUT_OPEN[] PROGMEM =
+    "\",\"reasoning\":{\"effort\":\"minimal\"},"
+    "\"text\":{\"format\":{\"type\":\"json_object\"},\"verbosity\":\"low\"},\"input\":\"";
+static const char FOUNDRY_PROMPT_INSTRUCTIONS[] PROGMEM =
+    "You are a safety-first indoor navigation planner for a robot. "
+    "Choose the safest maneuver that is most likely to increase front clearance and break oscillation. "
+    "You may only use these maneuvers: STRAFE_LEFT, STRAFE_RIGHT, BACKWARD, TURN_LEFT_90, TURN_RIGHT_90, RESCAN, STOP. "
+    "Never invent a new action. Do not use STOP unless all motion options are blocked or unsafe. "
+    "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
+    "Prefer the more open side when choosing between left and right. "
+    "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
+    "Return strict JSON only, no markdown, with keys primary, primary_duration_ms, secondary, secondary_duration_ms, confidence, risk. "
+    "Example JSON: {\\\"primary\\\":\\\"BACKWARD\\\",\\\"primary_duration_ms\\\":350,"
+    "\\\"secondary\\\":\\\"TURN_LEFT_90\\\",\\\"secondary_duration_ms\\\":520,"
+    "\\\"confidence\\\":0.82,\\\"risk\\\":0.74}. ";
+static const char FOUNDRY_PROMPT_STATE_FORMAT[] PROGMEM =
+    "Current distances cm: front=%.1f, left=%.1f, right=%.1f. Repeated trap=%s. "
+    "Front trend cm over recent history=%.1f. Left-right oscillation count=%u. Last plan outcome=%s. "
+    "Last plan front before=%.1f, after=%.1f. Baseline primary=%s, baseline secondary=%s. Candidate plans: ";
+static const char FOUNDRY_BODY_TOKENS_FORMAT[] PROGMEM = "\",\"max_output_tokens\":%u}";
+
+// Build the Foundry request body (up to, not including, the max_output_tokens tail) from the
+// current scan, history, and local candidates. Returns false if the body did not fit.
+bool buildFoundryRequestBody(PromptBuffer &body, const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
+  PromptHeapProbe heapProbe;
+  heapProbe.start();
+  unsigned long buildStartUs = micros();
   Action openSideAction = chooseFallbackTurn();
   ManeuverPlan localStrafePlan = buildStrafePlan(openSideAction, fallbackPlan.primaryDurationMs);
   ManeuverPlan localTurnPlan = buildTurnPlan(openSideAction);
@@ -929,93 +1212,160 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
   localStrafePlan.riskScore = estimateLocalRiskScore();
   localTurnPlan.riskScore = estimateLocalRiskScore();
   localRecoveryPlan.riskScore = estimateLocalRiskScore();
-  String candidateSummary = planToPromptText("baseline", fallbackPlan) + "; " +
-                            planToPromptText("strafe", localStrafePlan) + "; " +
-                            planToPromptText("turn", localTurnPlan) + "; " +
-                            planToPromptText("recovery", localRecoveryPlan);
-  String prompt =
-      "You are a safety-first indoor navigation planner for a robot. "
-      "Choose the safest maneuver that is most likely to increase front clearance and break oscillation. "
-      "You may only use these maneuvers: STRAFE_LEFT, STRAFE_RIGHT, BACKWARD, TURN_LEFT_90, TURN_RIGHT_90, RESCAN, STOP. "
-      "Never invent a new action. Do not use STOP unless all motion options are blocked or unsafe. "
-      "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
-      "Prefer the more open side when choosing between left and right. "
-      "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
-      "Return strict JSON only, no markdown, with keys primary, primary_duration_ms, secondary, secondary_duration_ms, confidence, risk. "
-      "Current distances cm: front=" + String(frontDistanceCm, 1) +
-      ", left=" + String(leftDistanceCm, 1) +
-      ", right=" + String(rightDistanceCm, 1) +
-      ". Repeated trap=" + String(repeatedTrap ? "true" : "false") +
-      ". Front trend cm over recent history=" + String(frontTrendCm(), 1) +
-      ". Left-right oscillation count=" + String(detectPlanOscillationCount()) +
-      ". Last plan outcome=" + String(lastPlanOutcomeString()) +
-      ". Last plan front before=" + String(lastPlanFrontBeforeCm, 1) +
-      ", after=" + String(lastPlanFrontAfterCm, 1) +
-      ". Baseline primary=" + String(maneuverTypeToString(fallbackPlan.primary)) +
-      ", baseline secondary=" + String(maneuverTypeToString(fallbackPlan.secondary)) +
-      ". Candidate plans: " + candidateSummary +
-      ". Recent hazard history=" + buildHistorySummary() +
-      ". Recent plans=" + buildRecentPlanSummary() +
-      ". Example JSON: {\"primary\":\"BACKWARD\",\"primary_duration_ms\":350,\"secondary\":\"TURN_LEFT_90\",\"secondary_duration_ms\":520,\"confidence\":0.82,\"risk\":0.74}.";
-  JsonDocument requestDoc;
-  requestDoc["model"] = FOUNDRY_MODEL;
-  requestDoc["input"] = prompt;
-  requestDoc["max_output_tokens"] = FOUNDRY_MAX_OUTPUT_TOKENS;
-  requestDoc["reasoning"]["effort"] = "minimal";
-  requestDoc["text"]["format"]["type"] = "json_object";
-  requestDoc["text"]["verbosity"] = "low";
-  String body;
-  serializeJson(requestDoc, body);
-  requestDoc["max_output_tokens"] = FOUNDRY_RETRY_OUTPUT_TOKENS;
-  String retryBody;
-  serializeJson(requestDoc, retryBody);
+  body.clear();
+  body.append(FOUNDRY_BODY_MODEL_OPEN);
+  body.append(FOUNDRY_MODEL);
+  body.append(FOUNDRY_BODY_INPUT_OPEN);
+  body.append(FOUNDRY_PROMPT_INSTRUCTIONS);
+  size_t staticPrefixLength = body.length();
+  body.appendf(FOUNDRY_PROMPT_STATE_FORMAT, frontDistanceCm, leftDistanceCm, rightDistanceCm,
+               repeatedTrap ? "true" : "false", frontTrendCm(), (unsigned)detectPlanOscillationCount(),
+               lastPlanOutcomeString(), lastPlanFrontBeforeCm, lastPlanFrontAfterCm,
+               maneuverTypeToString(fallbackPlan.primary), maneuverTypeToString(fallbackPlan.secondary));
+  appendPlanPromptText(body, "baseline", fallbackPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "strafe", localStrafePlan);
+  body.append("; ");
+  appendPlanPromptText(body, "turn", localTurnPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "recovery", localRecoveryPlan);
+  body.append(". Recent hazard history=");
+  appendHistorySummary(body);
+  body.append(". Recent plans=");
+  appendRecentPlanSummary(body);
+  body.append(".");
+  uint32_t buildUs = micros() - buildStartUs;
+  int heapBlocksHeld = 0;
+  int heapBytesHeld = 0;
+  heapProbe.measure(heapBlocksHeld, heapBytesHeld);
+  Serial.printf("Foundry prompt build: %lu us, %u bytes (static prefix %u), heap held %+d blocks / %+d bytes%s\n",
+                (unsigned long)buildUs, (unsigned)body.length(), (unsigned)staticPrefixLength, heapBlocksHeld,
+                heapBytesHeld, body.overflowed() ? ", OVERFLOW" : "");
+  if (heapProbe.counted) {
+    Serial.printf("Foundry prompt heap: %lu allocations (%lu bytes), %lu frees\n", (unsigned long)heapProbe.allocations,
+                  (unsigned long)heapProbe.allocatedBytes, (unsigned long)heapProbe.frees);
+  }
+  return !body.overflowed();
+}
+
+// Close the body after the prompt with a max_output_tokens tail, replacing any earlier tail.
+// Returns false if the closed body did not fit; a cut-off body is never sent.
+bool appendFoundryBodyTail(PromptBuffer &body, size_t promptEndLength, unsigned maxOutputTokens) {
+  body.truncate(promptEndLength);
+  body.appendf(FOUNDRY_BODY_TOKENS_FORMAT, maxOutputTokens);
+  return !body.overflowed();
+}
+
+// Status strings are short literals or one formatted code; longer ones are cut, never overrun.
+void setFoundryCallStatus(FoundryCallResult &result, const char *status) {
+  snprintf(result.status, sizeof(result.status), "%s", status);
+}
+
+// Send one prebuilt request body to Foundry and extract the model text. Touches no navigation
+// state, so the speculative worker can run it while loop() keeps driving.
+void runFoundryCall(PromptBuffer &body, FoundryCallResult &result) {
+  result.requestSent = false;
+  result.responseOk = false;
+  result.textOk = false;
+  result.roundTripMs = 0;
+  setFoundryCallStatus(result, "init");
+  result.modelText[0] = '\0';
+  if (WiFi.status() != WL_CONNECTED) {
+    setFoundryCallStatus(result, "wifi_disconnected_local_fallback");
+    Serial.println("Foundry skipped: WiFi disconnected, using local fallback plan");
+    return;
+  }
+  size_t promptEndLength = body.length();
+  if (!appendFoundryBodyTail(body, promptEndLength, (unsigned)FOUNDRY_MAX_OUTPUT_TOKENS)) {
+    setFoundryCallStatus(result, "prompt_overflow_local_fallback");
+    Serial.println("Foundry request body overflowed, using local fallback plan");
+    return;
+  }
+  HTTPClient http;
+  if (!http.begin(FOUNDRY_RESPONSES_URL)) {
+    setFoundryCallStatus(result, "http_begin_failed_local_fallback");
+    Serial.println("Foundry: HTTP begin failed");
+    return;
+  }
   http.addHeader("Content-Type", "application/json");
   http.addHeader("api-key", FOUNDRY_API_KEY);
   http.setTimeout(FOUNDRY_HTTP_TIMEOUT_TIGHT_MS);
-  foundryRequestSent = true;
-  foundryDecisionStatus = "request_sent";
+  result.requestSent = true;
+  setFoundryCallStatus(result, "request_sent");
   Serial.println("Foundry request sent");
   unsigned long requestStartedMs = millis();
-  int statusCode = http.POST(body);
+  int statusCode = http.POST(body.bytes(), body.length());
   String responseBody = http.getString();
   if (statusCode == HTTPC_ERROR_READ_TIMEOUT) {
     Serial.println("Foundry read timeout, retrying once with longer timeout and smaller output budget");
     http.setTimeout(FOUNDRY_HTTP_TIMEOUT_RETRY_MS);
-    foundryDecisionStatus = "request_timeout_retry";
-    statusCode = http.POST(retryBody);
+    setFoundryCallStatus(result, "request_timeout_retry");
+    // Same prompt with a smaller output budget: only the tail changes.
+    if (!appendFoundryBodyTail(body, promptEndLength, (unsigned)FOUNDRY_RETRY_OUTPUT_TOKENS)) {
+      result.roundTripMs = millis() - requestStartedMs;
+      http.end();
+      setFoundryCallStatus(result, "prompt_overflow_local_fallback");
+      Serial.println("Foundry retry body overflowed, using local fallback plan");
+      return;
+    }
+    statusCode = http.POST(body.bytes(), body.length());
     responseBody = http.getString();
   }
+  result.roundTripMs = millis() - requestStartedMs;
   Serial.print("Foundry round-trip ms: ");
-  Serial.println(millis() - requestStartedMs);
+  Serial.println(result.roundTripMs);
   http.end();
   if (statusCode < 200 || statusCode >= 300) {
-    foundryDecisionStatus = String("http_error_") + String(statusCode) + "_local_fallback";
+    snprintf(result.status, sizeof(result.status), "http_error_%d_local_fallback", statusCode);
     Serial.print("Foundry HTTP error: ");
     Serial.println(statusCode);
     Serial.print("Foundry error body: ");
     Serial.println(responseBody);
-    return fallbackPlan;
+    return;
   }
-  foundryResponseOk = true;
+  result.responseOk = true;
   JsonDocument responseDoc;
   DeserializationError err = deserializeJson(responseDoc, responseBody);
   if (err) {
-    foundryDecisionStatus = "response_json_parse_error_local_fallback";
+    setFoundryCallStatus(result, "response_json_parse_error_local_fallback");
     Serial.print("Foundry response parse error: ");
     Serial.println(err.c_str());
-    return fallbackPlan;
+    return;
   }
   String modelText;
   if (!extractFoundryModelText(responseDoc, modelText)) {
     if (!extractFoundryModelTextFromRawResponse(responseBody, modelText)) {
-      foundryDecisionStatus = "no_model_text_local_fallback";
+      setFoundryCallStatus(result, "no_model_text_local_fallback");
       Serial.println("Foundry response had no extractable model text, using local fallback plan");
       Serial.print("Foundry raw response body: ");
       Serial.println(responseBody);
-      return fallbackPlan;
+      return;
     }
     Serial.println("Recovered model text from raw response fallback");
   }
+  if (modelText.length() >= sizeof(result.modelText)) {
+    setFoundryCallStatus(result, "model_text_too_long_local_fallback");
+    Serial.print("Foundry model text too long: ");
+    Serial.println(modelText.length());
+    return;
+  }
+  memcpy(result.modelText, modelText.c_str(), modelText.length() + 1);
+  result.textOk = true;
+}
+
+// Turn a finished Foundry call into a sanitized plan and publish its telemetry.
+ManeuverPlan applyFoundryCallResult(const FoundryCallResult &call, const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
+  foundryRequestSent = call.requestSent;
+  foundryResponseOk = call.responseOk;
+  foundryPlanParsed = false;
+  foundryDecisionStatus = call.status;
+  if (call.requestSent) {
+    decisionCache.recordFoundryCall(call.roundTripMs);
+  }
+  if (!call.textOk) {
+    return fallbackPlan;
+  }
+  String modelText = call.modelText;
   Serial.print("Foundry raw text: ");
   Serial.println(modelText);
   ManeuverPlan plan = fallbackPlan;
@@ -1025,8 +1375,24 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
     return fallbackPlan;
   }
   foundryPlanParsed = true;
+  // Log the model's own choice (before sanitizing) as a training sample for policy-distill.py.
+  // Printed directly, not through the log ring: a full ring drops records, and every sample counts.
+  // The line follows a Foundry round trip of seconds, so the UART wait does not matter here.
+  Serial.printf("Distill sample: left=%d front=%d right=%d trend=%.1f osc=%u trap=%u local=%s llm=%s then %s conf=%.2f\n",
+                effectiveDistance(leftDistanceCm), effectiveDistance(frontDistanceCm), effectiveDistance(rightDistanceCm),
+                frontTrendCm(), (unsigned)detectPlanOscillationCount(), (unsigned)repeatedTrap,
+                maneuverTypeToString(fallbackPlan.primary), maneuverTypeToString(plan.primary),
+                maneuverTypeToString(plan.secondary), plan.confidence);
+  if (distilledShadowPrimary >= 0) {
+    distilledPolicyStats.shadowComparisons++;
+    if (distilledShadowPrimary == (int8_t)plan.primary) {
+      distilledPolicyStats.shadowAgreements++;
+    }
+    distilledShadowPrimary = -1;
+  }
   plan.repeatedTrap = repeatedTrap;
   sanitizePlan(plan, fallbackPlan);
+  decisionCache.setActive(decisionCache.store(plan, buildDecisionCacheKey(repeatedTrap), millis()));
   foundryDecisionStatus = "plan_parsed_and_applied";
   flashDecisionDirectionLed(plan.primary);
   Serial.print("Foundry plan: ");
@@ -1038,6 +1404,189 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
   return plan;
 }
 
+// Ask Foundry for maneuver arbitration; always degrade safely to local fallback plan.
+ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
+  foundryRequestSent = false;
+  foundryResponseOk = false;
+  foundryPlanParsed = false;
+  foundryDecisionStatus = "init";
+  flashFoundryThinkingLeds();
+  // Static: the fixed text buffers are too large to put on the loop task's stack each decision.
+  static FoundryCallResult call;
+  if (!buildFoundryRequestBody(foundryRequestBody, fallbackPlan, repeatedTrap)) {
+    foundryDecisionStatus = "prompt_overflow_local_fallback";
+    return fallbackPlan;
+  }
+  runFoundryCall(foundryRequestBody, call);
+  return applyFoundryCallResult(call, fallbackPlan, repeatedTrap);
+}
+
+// Worker task: run each speculative prompt off the loop so the car keeps driving meanwhile.
+void speculativeQueryTask(void *param) {
+  (void)param;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    runFoundryCall(speculativeRequestBody, speculativeQuery.result);
+    speculativeQuery.done.store(true, std::memory_order_release);
+  }
+}
+
+bool startSpeculativeQueryWorker() {
+  BaseType_t taskCreated = xTaskCreatePinnedToCore(speculativeQueryTask, "FoundrySpeculate",
+                                                   SPECULATIVE_WORKER_STACK_BYTES, nullptr, 1,
+                                                   &speculativeQueryTaskHandle, 0);
+  if (taskCreated != pdPASS) {
+    speculativeQueryTaskHandle = nullptr;
+    return false;
+  }
+  return true;
+}
+
+// Predicted ms until the front reading crosses the hazard threshold; 0 when not closing in.
+unsigned long predictMsToHazard() {
+  if (!isValidDistance(frontDistanceCm) || frontClosingRateCmPerSec < SPECULATIVE_MIN_CLOSING_RATE_CM_S) {
+    return 0;
+  }
+  float marginCm = frontDistanceCm - ULTRASONIC_ALERT_CM;
+  if (marginCm <= 0.0f) {
+    return 0;
+  }
+  return (unsigned long)(marginCm * 1000.0f / frontClosingRateCmPerSec);
+}
+
+// Advance the speculative request: collect finished work, expire stale answers, or start a new one.
+void serviceSpeculativeQuery(unsigned long nowMs) {
+  if (speculativeQueryState == SPECULATIVE_RUNNING && speculativeQuery.done.load(std::memory_order_acquire)) {
+    speculativeQueryState = SPECULATIVE_READY;
+    speculativeQuery.readyMs = nowMs;
+  } else if (speculativeQueryState == SPECULATIVE_ABANDONED && speculativeQuery.done.load(std::memory_order_acquire)) {
+    speculativeQueryState = SPECULATIVE_IDLE;
+  }
+  if (speculativeQueryState == SPECULATIVE_READY && (nowMs - speculativeQuery.readyMs) >= SPECULATIVE_RESULT_TTL_MS) {
+    speculativeQueryStats.expired++;
+    speculativeQueryState = SPECULATIVE_IDLE;
+    Serial.println("Speculative Foundry answer expired before any hazard");
+  }
+  if (!SPECULATIVE_QUERY_ENABLED || speculativeQueryTaskHandle == nullptr || obstacleNearby ||
+      speculativeQueryState != SPECULATIVE_IDLE || WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  if (speculativeQueryStats.started > 0 && (nowMs - speculativeQuery.startedMs) < SPECULATIVE_MIN_INTERVAL_MS) {
+    return;
+  }
+  unsigned long msToHazard = predictMsToHazard();
+  unsigned long lookaheadMs = SPECULATIVE_LOOKAHEAD_MS;
+  if (frontTrendCm() < 0.0f) {
+    lookaheadMs += SPECULATIVE_NEGATIVE_TREND_BONUS_MS;
+  }
+  if (msToHazard == 0 || msToHazard > lookaheadMs) {
+    return;
+  }
+  bool repeatedTrap = detectRepeatedTrap(leftDistanceCm, frontDistanceCm, rightDistanceCm);
+  ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
+  // The worker is idle here (state is IDLE only after an abandoned run finished), so its body is free.
+  if (!buildFoundryRequestBody(speculativeRequestBody, localPlan, repeatedTrap)) {
+    return;
+  }
+  speculativeQuery.leftCm = leftDistanceCm;
+  speculativeQuery.frontCm = frontDistanceCm;
+  speculativeQuery.rightCm = rightDistanceCm;
+  speculativeQuery.repeatedTrap = repeatedTrap;
+  speculativeQuery.oscillationCount = detectPlanOscillationCount();
+  speculativeQuery.localPrimary = localPlan.primary;
+  speculativeQuery.startedMs = nowMs;
+  speculativeQuery.done.store(false, std::memory_order_relaxed);
+  speculativeQueryState = SPECULATIVE_RUNNING;
+  speculativeQueryStats.started++;
+  xTaskNotifyGive(speculativeQueryTaskHandle);
+  Serial.print("Speculative Foundry request started, predicted ms to hazard=");
+  Serial.print(msToHazard);
+  Serial.print(" closingRateCmPerSec=");
+  Serial.println(frontClosingRateCmPerSec, 1);
+}
+
+bool distancesMatch(float speculativeCm, float currentCm, float toleranceCm) {
+  if (!isValidDistance(speculativeCm) || !isValidDistance(currentCm)) {
+    return isValidDistance(speculativeCm) == isValidDistance(currentCm);
+  }
+  return fabsf(speculativeCm - currentCm) <= toleranceCm;
+}
+
+// Drop a pending speculative request; a running one is left to finish and then ignored.
+void discardSpeculativeQuery(const char *reason) {
+  if (speculativeQueryState == SPECULATIVE_IDLE) {
+    return;
+  }
+  speculativeQueryStats.discarded++;
+  speculativeQueryState = (speculativeQueryState == SPECULATIVE_RUNNING) ? SPECULATIVE_ABANDONED : SPECULATIVE_IDLE;
+  if (speculativeQueryState == SPECULATIVE_ABANDONED && speculativeQuery.done.load(std::memory_order_acquire)) {
+    speculativeQueryState = SPECULATIVE_IDLE;
+  }
+  Serial.print("Speculative Foundry answer discarded: ");
+  Serial.println(reason);
+}
+
+// Use the speculative answer if the fresh stop-time scan still matches its inputs.
+bool takeSpeculativePlan(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &plan) {
+  if (speculativeQueryState != SPECULATIVE_RUNNING && speculativeQueryState != SPECULATIVE_READY) {
+    return false;
+  }
+  bool inputsMatch = distancesMatch(speculativeQuery.leftCm, leftDistanceCm, SPECULATIVE_MATCH_SIDE_CM) &&
+                     distancesMatch(speculativeQuery.rightCm, rightDistanceCm, SPECULATIVE_MATCH_SIDE_CM) &&
+                     distancesMatch(speculativeQuery.frontCm, frontDistanceCm, SPECULATIVE_MATCH_FRONT_CM) &&
+                     speculativeQuery.repeatedTrap == repeatedTrap &&
+                     speculativeQuery.oscillationCount == detectPlanOscillationCount() &&
+                     speculativeQuery.localPrimary == localPlan.primary;
+  if (!inputsMatch) {
+    discardSpeculativeQuery("scan no longer matches speculative inputs");
+    return false;
+  }
+  unsigned long stopMs = millis();
+  uint32_t savedMs = (speculativeQueryState == SPECULATIVE_READY) ? speculativeQuery.result.roundTripMs
+                                                                   : (uint32_t)(stopMs - speculativeQuery.startedMs);
+  while (!speculativeQuery.done.load(std::memory_order_acquire) && (millis() - stopMs) < SPECULATIVE_WAIT_LIMIT_MS) {
+    delay(10);
+  }
+  if (!speculativeQuery.done.load(std::memory_order_acquire)) {
+    discardSpeculativeQuery("worker did not finish in time");
+    return false;
+  }
+  speculativeQueryState = SPECULATIVE_IDLE;
+  if (!speculativeQuery.result.textOk) {
+    speculativeQueryStats.failed++;
+    Serial.print("Speculative Foundry request failed: ");
+    Serial.println(speculativeQuery.result.status);
+    return false;
+  }
+  plan = applyFoundryCallResult(speculativeQuery.result, localPlan, repeatedTrap);
+  speculativeQueryStats.used++;
+  speculativeQueryStats.savedStopMsTotal += savedMs;
+  Serial.print("Speculative Foundry answer used, stop ms saved=");
+  Serial.println(savedMs);
+  return true;
+}
+
+// Speculation usefulness: how often early answers were used vs wasted, and stop time saved.
+void printSpeculativeQueryStats() {
+  uint32_t wasted = speculativeQueryStats.discarded + speculativeQueryStats.expired + speculativeQueryStats.failed;
+  Serial.print("Speculative Foundry: started=");
+  Serial.print(speculativeQueryStats.started);
+  Serial.print(" used=");
+  Serial.print(speculativeQueryStats.used);
+  Serial.print(" discarded=");
+  Serial.print(speculativeQueryStats.discarded);
+  Serial.print(" expired=");
+  Serial.print(speculativeQueryStats.expired);
+  Serial.print(" failed=");
+  Serial.print(speculativeQueryStats.failed);
+  Serial.print(" wasted=");
+  Serial.print(speculativeQueryStats.started > 0 ? (100.0f * wasted / speculativeQueryStats.started) : 0.0f, 1);
+  Serial.print("% savedStopMs=");
+  Serial.print(speculativeQueryStats.savedStopMsTotal);
+  Serial.print(" avgSavedMs=");
+  Serial.println(speculativeQueryStats.used > 0 ? speculativeQueryStats.savedStopMsTotal / speculativeQueryStats.used : 0);
+}
+
 // Center ultrasonic pan servo so forward readings align with heading.
 void movePanToCenter() {
   if (!panServoReady) {
@@ -1047,40 +1596,23 @@ void movePanToCenter() {
   panServo.write(panCurrentDeg);
 }
 
-// Perform a deliberate left-right-front snapshot before making a hazard decision.
-void refreshHazardScanSnapshot() {
-  if (!panServoReady) {
-    float front = sensor.Ranging();
-    if (isValidDistance(front)) {
-      updateFrontDistanceEstimate(front, millis(), true);
-    } else {
-      frontDistanceCm = -1.0f;
-      frontFilteredCm = -1.0f;
-      frontFilterReady = false;
-    }
-    return;
+// Non-blocking ultrasonic read: the first call triggers a measurement, later calls return false
+// until its echo (or the no-echo timeout) is in, then set distanceCm (negative without an echo).
+// Without the echo engine this is one blocking sensor.Ranging() call that always completes.
+bool pollUltrasonicCm(float &distanceCm) {
+  if (!echoRanger.ready()) {
+    distanceCm = sensor.Ranging();
+    return true;
   }
-  panServo.write(PAN_LEFT_DEG);
-  panCurrentDeg = PAN_LEFT_DEG;
-  delay(PAN_SETTLE_MS);
-  float left = sensor.Ranging();
-  if (isValidDistance(left)) {
-    leftDistanceCm = left;
-  } else {
-    leftDistanceCm = -1.0f;
-  }
-  panServo.write(PAN_RIGHT_DEG);
-  panCurrentDeg = PAN_RIGHT_DEG;
-  delay(PAN_SETTLE_MS);
-  float right = sensor.Ranging();
-  if (isValidDistance(right)) {
-    rightDistanceCm = right;
-  } else {
-    rightDistanceCm = -1.0f;
+  if (!echoRanger.busy()) {
+    echoRanger.start();
   }
-  movePanToCenter();
-  delay(PAN_SETTLE_MS);
-  float front = sensor.Ranging();
+  unsigned long pulseWidthUs = 0;
+  return echoRanger.poll(distanceCm, pulseWidthUs);
+}
+
+// Apply a focused-scan front reading, or mark the front unknown without an echo.
+void applyScanFrontReading(float front) {
   if (isValidDistance(front)) {
     updateFrontDistanceEstimate(front, millis(), true);
   } else {
@@ -1088,6 +1620,60 @@ void refreshHazardScanSnapshot() {
     frontFilteredCm = -1.0f;
     frontFilterReady = false;
   }
+}
+
+// Start a deliberate left-right-front snapshot; loop() advances it with serviceHazardScan().
+// The first servo move overlaps pauseMs (the car coming to rest), so the wait is the longer of the two.
+void startHazardScan(HazardScanPurpose purpose, unsigned long pauseMs) {
+  unsigned long nowMs = millis();
+  // A reading still in flight was aimed wherever the servo pointed before; drop it.
+  echoRanger.cancel();
+  frontRangingPending = false;
+  hazardScanPurpose = purpose;
+  hazardScanStartedMs = nowMs;
+  if (!panServoReady) {
+    hazardScanStep = HAZARD_SCAN_FRONT;
+    hazardScanSettleUntilMs = nowMs + pauseMs;
+    return;
+  }
+  panServo.write(PAN_LEFT_DEG);
+  panCurrentDeg = PAN_LEFT_DEG;
+  hazardScanStep = HAZARD_SCAN_LEFT;
+  hazardScanSettleUntilMs = nowMs + (pauseMs > PAN_SETTLE_MS ? pauseMs : PAN_SETTLE_MS);
+}
+
+// Advance the snapshot by at most one servo move or reading. Returns true while it is still running.
+bool serviceHazardScan(unsigned long nowMs) {
+  if (hazardScanStep == HAZARD_SCAN_IDLE) {
+    return false;
+  }
+  if ((long)(nowMs - hazardScanSettleUntilMs) < 0) {
+    return true;
+  }
+  float distanceCm = -1.0f;
+  if (!pollUltrasonicCm(distanceCm)) {
+    return true;
+  }
+  if (hazardScanStep == HAZARD_SCAN_LEFT) {
+    leftDistanceCm = isValidDistance(distanceCm) ? distanceCm : -1.0f;
+    panServo.write(PAN_RIGHT_DEG);
+    panCurrentDeg = PAN_RIGHT_DEG;
+    hazardScanStep = HAZARD_SCAN_RIGHT;
+    hazardScanSettleUntilMs = millis() + PAN_SETTLE_MS;
+    return true;
+  }
+  if (hazardScanStep == HAZARD_SCAN_RIGHT) {
+    rightDistanceCm = isValidDistance(distanceCm) ? distanceCm : -1.0f;
+    movePanToCenter();
+    hazardScanStep = HAZARD_SCAN_FRONT;
+    hazardScanSettleUntilMs = millis() + PAN_SETTLE_MS;
+    return true;
+  }
+  applyScanFrontReading(distanceCm);
+  hazardScanStep = HAZARD_SCAN_IDLE;
+  if (!panServoReady) {
+    return false;
+  }
   panSweepTowardLeft = true;
   lastPanStepMs = millis();
   Serial.print("Decision scan L/F/R: ");
@@ -1096,6 +1682,7 @@ void refreshHazardScanSnapshot() {
   Serial.print(frontDistanceCm, 1);
   Serial.print("/");
   Serial.println(rightDistanceCm, 1);
+  return false;
 }
 
 // Continuous sweep movement for the pan servo between configured left/right limits.
@@ -1123,26 +1710,32 @@ void updatePanSweep(unsigned long nowMs) {
   panServo.write(panCurrentDeg);
 }
 
-// Periodic sensor update with stale/front-blind handling and hazard hysteresis.
+// Periodic sensor update with stale/front-blind handling and hazard hysteresis. The reading is
+// triggered every SENSOR_INTERVAL_MS and evaluated on the pass its echo arrives.
 void updateScanAndHazard() {
   unsigned long nowMs = millis();
-  if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
+  if (!frontRangingPending) {
+    if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
+      return;
+    }
+    lastSensorMs = nowMs;
+    frontRangingPending = true;
+    frontRetryUsed = false;
+  }
+  float distanceCm = -1.0f;
+  if (!pollUltrasonicCm(distanceCm)) {
     return;
   }
-  lastSensorMs = nowMs;
-  float distanceCm = sensor.Ranging();
   if (isValidDistance(distanceCm)) {
     updateFrontDistanceEstimate(distanceCm, nowMs, false);
   }
   bool frontFresh = (frontUpdatedMs != 0 && (nowMs - frontUpdatedMs) <= FRONT_STALE_MS);
-  if (!frontFresh) {
+  if (!frontFresh && !frontRetryUsed) {
     // One immediate retry reduces false "hazard" triggers from occasional echo dropouts.
-    float retryFrontCm = sensor.Ranging();
-    if (isValidDistance(retryFrontCm)) {
-      updateFrontDistanceEstimate(retryFrontCm, nowMs, false);
-      frontFresh = true;
-    }
+    frontRetryUsed = true;
+    return;
   }
+  frontRangingPending = false;
   if (frontFresh && isValidDistance(frontDistanceCm)) {
     frontBlindStreak = 0;
     if (obstacleNearby) {
@@ -1213,66 +1806,120 @@ int computeManeuverSpeed(const ManeuverPlan &plan) {
   return speed;
 }
 
-// Execute a single maneuver primitive, then ensure vehicle stops at segment end.
-void executeManeuver(ManeuverType maneuver, uint16_t durationMs, int speed) {
+// Map a maneuver primitive to an executor segment. Strafes may end early once the front is clear
+// and abort on a new close obstacle; backing up moves away from the front reading, so it may only
+// end early. A 90-degree turn must run its full time to reach the new heading (the front reads
+// clear partway round), so it may only abort. Pauses and rescans always run their full time.
+ManeuverSegment maneuverSegment(ManeuverType maneuver, uint16_t durationMs, int speed) {
+  uint8_t tag = (uint8_t)maneuver;
   switch (maneuver) {
     case MANEUVER_STRAFE_LEFT:
-      myCar.Move(Move_Left, speed);
-      delay(durationMs);
-      break;
+      return {Move_Left, speed, durationMs, true, true, tag};
     case MANEUVER_STRAFE_RIGHT:
-      myCar.Move(Move_Right, speed);
-      delay(durationMs);
-      break;
+      return {Move_Right, speed, durationMs, true, true, tag};
     case MANEUVER_BACKWARD:
-      myCar.Move(Backward, speed);
-      delay(durationMs);
-      break;
+      return {Backward, speed, durationMs, true, false, tag};
     case MANEUVER_TURN_LEFT_90:
-      myCar.Move(Contrarotate, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Contrarotate, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_TURN_RIGHT_90:
-      myCar.Move(Clockwise, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Clockwise, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_RESCAN:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs);
-      refreshHazardScanSnapshot();
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs), false, false, tag};
     default:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? 180 : durationMs);
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? 180 : durationMs), false, false, tag};
   }
-  myCar.Move(Stop, 0);
 }
 
-// Execute primary and optional secondary maneuvers; update directional memory.
-void executePlan(const ManeuverPlan &plan) {
+// Queue primary and optional secondary maneuvers and start them; update directional memory.
+// loop() advances the plan, then rescans and calls finishPlanExecution() once the scan is done.
+void startPlanExecution(const ManeuverPlan &plan) {
   int maneuverSpeed = computeManeuverSpeed(plan);
-  executeManeuver(plan.primary, plan.primaryDurationMs, maneuverSpeed);
-  rememberPlan(plan.primary);
+  maneuverExecutor.queue(maneuverSegment(plan.primary, plan.primaryDurationMs, maneuverSpeed));
   if (plan.secondary != MANEUVER_STOP) {
-    executeManeuver(plan.secondary, plan.secondaryDurationMs, maneuverSpeed);
-    rememberPlan(plan.secondary);
+    maneuverExecutor.queue(maneuverSegment(plan.secondary, plan.secondaryDurationMs, maneuverSpeed));
   }
   if (plan.primary == MANEUVER_STRAFE_LEFT || plan.primary == MANEUVER_TURN_LEFT_90) {
     lastNonStopDecision = ACTION_LEFT;
   } else if (plan.primary == MANEUVER_STRAFE_RIGHT || plan.primary == MANEUVER_TURN_RIGHT_90) {
     lastNonStopDecision = ACTION_RIGHT;
   }
+  // Readings taken during the maneuver must look along the heading.
+  movePanToCenter();
+  echoRanger.cancel();
+  frontRangingPending = false;
+  maneuverExecutor.start(millis());
+}
+
+// Executor hook: drive the motors for a segment.
+void driveManeuverSegment(int direction, int speed) {
+  myCar.Move(direction, speed);
+}
+
+// Executor hook: stop the motors at the end of a segment.
+void stopManeuverSegment() {
+  myCar.Move(Stop, 0);
+}
+
+// Executor hook: the forward reading triggered on the previous sample, or -1 while it is still in
+// flight or got no echo. The next reading is triggered right away, so its echo is in by the time
+// the executor samples again.
+float sampleManeuverFrontCm() {
+  float distanceCm = -1.0f;
+  bool ready = pollUltrasonicCm(distanceCm);
+  if (ready && echoRanger.ready()) {
+    echoRanger.start();
+  }
+  return ready && isValidDistance(distanceCm) ? distanceCm : -1.0f;
+}
+
+// Executor hook: record the maneuver that just ran. A RESCAN pause needs no scan of its own: the
+// scan after the plan (or before the next decision) covers it.
+void onManeuverSegmentEnded(const ManeuverSegment &segment, ManeuverEnd end) {
+  ManeuverType maneuver = (ManeuverType)segment.tag;
+  rememberPlan(maneuver);
+  if (end != MANEUVER_END_COMPLETED) {
+    ROVER_LOG_INFO(LOG_MANEUVER_ENDED_EARLY, maneuverTypeToString(maneuver), maneuverEndString(end));
+  }
+}
+
+// Score whether the plan materially improved front clearance; called once the scan that
+// loop() started after the plan has finished.
+void finishPlanExecution() {
+  lastPlanFrontAfterCm = frontDistanceCm;
+  if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
+    float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
+    if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = 1;
+    } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = -1;
+    } else {
+      lastPlanOutcome = 0;
+    }
+  } else {
+    lastPlanOutcome = 0;
+  }
+  decisionCache.noteOutcome(lastPlanOutcome, millis());
+  decisionCache.saveIfDirty(millis());
+  decisionCache.printStats(Serial);
+  printDistilledPolicyStats();
+  printSpeculativeQueryStats();
+  maneuverExecutor.printStats(Serial);
 }
 
 // Initialize serial, GPIO, drive train, ultrasonic sensor, servo, and Wi-Fi.
 void setup() {
   Serial.begin(115200);
+  if (!roverLogBegin(Serial)) {
+    Serial.println("Log drain task start failed; decision telemetry will not be printed");
+  }
   pinMode(LEFT_LED_PIN, OUTPUT);
   pinMode(RIGHT_LED_PIN, OUTPUT);
   setBothLeds(false);
   myCar.Init();
   sensor.Init(TRIG_PIN, ECHO_PIN);
+  if (!echoRanger.begin(TRIG_PIN, ECHO_PIN)) {
+    Serial.println("Echo timer start failed; ultrasonic readings stay blocking");
+  }
   panServo.setPeriodHertz(50);
   panServo.attach(ULTRASONIC_PAN_PIN, 500, 2500);
   panServoReady = panServo.attached();
@@ -1287,105 +1934,127 @@ void setup() {
   Serial.print("/");
   Serial.println(PAN_RIGHT_DEG);
   delay(250);
+  decisionCache.begin(DECISION_CACHE_CONFIG);
+  maneuverExecutor.begin({driveManeuverSegment, stopManeuverSegment, sampleManeuverFrontCm, onManeuverSegmentEnded},
+                         MANEUVER_EXECUTOR_CONFIG);
   connectWiFi();
+  if (SPECULATIVE_QUERY_ENABLED && !startSpeculativeQueryWorker()) {
+    Serial.println("Speculative Foundry worker failed to start, queries stay synchronous");
+  }
+  registerControlJobs();
   Serial.println("Azure AI Foundry-assisted navigation planner enabled");
 }
 
-// Main runtime loop: sense -> detect hazard -> plan -> execute -> learn outcome.
-void loop() {
-  updateScanAndHazard();
-  unsigned long nowMs = millis();
-  if (obstacleNearby && (!previousObstacleNearby || (nowMs - lastHazardDecisionMs) >= HAZARD_DECISION_COOLDOWN_MS)) {
-    myCar.Move(Stop, 0);
-    Serial.println("Hazard detected: STOP -> SCAN -> DECIDE");
-    delay(DECISION_STOP_PAUSE_MS);
-
-    // Capture a focused scan and add it to rolling trap/history telemetry.
-    refreshHazardScanSnapshot();
-    recordHazardSnapshot(leftDistanceCm, frontDistanceCm, rightDistanceCm, nowMs);
-    ManeuverPlan plan;
-    String decisionSource;
-    bool repeatedTrap = detectRepeatedTrap(leftDistanceCm, frontDistanceCm, rightDistanceCm);
-    if (allDistancesUnknown()) {
-      // Sensor-blind mode: avoid committed movement, request rescan first.
-      plan = defaultPlan();
-      plan.primary = MANEUVER_RESCAN;
-      plan.primaryDurationMs = RESCAN_PAUSE_MS + 80;
-      plan.secondary = MANEUVER_STOP;
-      plan.secondaryDurationMs = 0;
-      plan.confidence = 1.0f;
-      decisionSource = "local_sensor_blind";
-      Serial.println("Sensor blind state: local forced rescan plan");
-    } else if (isHeadOnWall(frontDistanceCm, leftDistanceCm, rightDistanceCm)) {
-      // Symmetric close side walls + close front implies head-on wall escape.
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      decisionSource = "local_head_on_wall";
-      Serial.println("Head-on wall escape: local forced plan");
-    } else if (isValidDistance(frontDistanceCm) && frontDistanceCm <= EMERGENCY_REVERSE_CM) {
-      // Immediate hard safety override when obstacle is critically close.
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      decisionSource = "local_emergency_close";
-      Serial.println("Emergency close obstacle: local forced plan");
-    } else if (shouldForceBackward(nowMs)) {
-      // Repeated hazards in burst window trigger deterministic recovery.
-      plan = defaultPlan();
-      plan.primary = MANEUVER_BACKWARD;
-      plan.primaryDurationMs = BACKUP_DURATION_MS;
-      plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
-      plan.secondaryDurationMs = TURN_90_DURATION_MS;
-      plan.confidence = 1.0f;
-      decisionSource = "local_burst_escalation";
-      Serial.println("Burst hazard escalation: local forced plan");
+// Choose a plan from the finished decision scan and start it; nowMs is when the hazard was detected.
+void decideAndStartPlan(unsigned long nowMs) {
+  // Add the focused scan to rolling trap/history telemetry.
+  recordHazardSnapshot(leftDistanceCm, frontDistanceCm, rightDistanceCm, nowMs);
+  ManeuverPlan plan;
+  String decisionSource;
+  bool repeatedTrap = detectRepeatedTrap(leftDistanceCm, frontDistanceCm, rightDistanceCm);
+  bool forcedLocalPlan = true;
+  if (allDistancesUnknown()) {
+    // Sensor-blind mode: avoid committed movement, request rescan first.
+    plan = defaultPlan();
+    plan.primary = MANEUVER_RESCAN;
+    plan.primaryDurationMs = RESCAN_PAUSE_MS + 80;
+    plan.secondary = MANEUVER_STOP;
+    plan.secondaryDurationMs = 0;
+    plan.confidence = 1.0f;
+    decisionSource = "local_sensor_blind";
+    Serial.println("Sensor blind state: local forced rescan plan");
+  } else if (isHeadOnWall(frontDistanceCm, leftDistanceCm, rightDistanceCm)) {
+    // Symmetric close side walls + close front implies head-on wall escape.
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    decisionSource = "local_head_on_wall";
+    Serial.println("Head-on wall escape: local forced plan");
+  } else if (isValidDistance(frontDistanceCm) && frontDistanceCm <= EMERGENCY_REVERSE_CM) {
+    // Immediate hard safety override when obstacle is critically close.
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    decisionSource = "local_emergency_close";
+    Serial.println("Emergency close obstacle: local forced plan");
+  } else if (shouldForceBackward(nowMs)) {
+    // Repeated hazards in burst window trigger deterministic recovery.
+    plan = defaultPlan();
+    plan.primary = MANEUVER_BACKWARD;
+    plan.primaryDurationMs = BACKUP_DURATION_MS;
+    plan.secondary = (chooseFallbackTurn() == ACTION_LEFT) ? MANEUVER_TURN_LEFT_90 : MANEUVER_TURN_RIGHT_90;
+    plan.secondaryDurationMs = TURN_90_DURATION_MS;
+    plan.confidence = 1.0f;
+    decisionSource = "local_burst_escalation";
+    Serial.println("Burst hazard escalation: local forced plan");
+  } else {
+    // Normal decision path: cached answer for a known situation, else a confident distilled-policy
+    // answer, else an early speculative answer, else local candidate + cloud arbitration.
+    forcedLocalPlan = false;
+    ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
+    if (lookupDecisionCache(localPlan, repeatedTrap, plan)) {
+      decisionSource = "decision_cache_hit";
+      Serial.println("Decision path: decision cache hit, Foundry skipped");
+      discardSpeculativeQuery("decision cache hit");
+    } else if (lookupDistilledPolicy(localPlan, repeatedTrap, plan)) {
+      decisionSource = "distilled_policy";
+      Serial.println("Decision path: distilled policy, Foundry skipped");
+      discardSpeculativeQuery("distilled policy");
+    } else if (takeSpeculativePlan(localPlan, repeatedTrap, plan)) {
+      decisionSource = String("speculative_") + foundryDecisionStatus;
+      Serial.println("Decision path: speculative Foundry answer");
     } else {
-      // Normal decision path: local candidate + cloud arbitration.
-      ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
       Serial.println("Decision path: local candidate + Foundry arbitration");
       plan = queryFoundryForNavigationPlan(localPlan, repeatedTrap);
       decisionSource = foundryDecisionStatus;
-      Serial.print("Decision telemetry: status=");
-      Serial.print(foundryDecisionStatus);
-      Serial.print(", requestSent=");
-      Serial.print(foundryRequestSent ? "true" : "false");
-      Serial.print(", responseOk=");
-      Serial.print(foundryResponseOk ? "true" : "false");
-      Serial.print(", planParsed=");
-      Serial.println(foundryPlanParsed ? "true" : "false");
+      ROVER_LOG_INFO(LOG_DECISION_TELEMETRY, foundryDecisionStatus, foundryRequestSent ? "true" : "false",
+                     foundryResponseOk ? "true" : "false", foundryPlanParsed ? "true" : "false");
     }
-    Serial.print("Executing plan source=");
-    Serial.print(decisionSource);
-    Serial.print(" primary=");
-    Serial.print(maneuverTypeToString(plan.primary));
-    Serial.print(" secondary=");
-    Serial.println(maneuverTypeToString(plan.secondary));
-    lastPlanFrontBeforeCm = frontDistanceCm;
-    executePlan(plan);
-
-    // Re-scan and score whether this plan materially improved front clearance.
-    refreshHazardScanSnapshot();
-    lastPlanFrontAfterCm = frontDistanceCm;
-    if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
-      float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
-      if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = 1;
-      } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = -1;
-      } else {
-        lastPlanOutcome = 0;
-      }
+  }
+  if (forcedLocalPlan) {
+    discardSpeculativeQuery("local forced plan");
+  }
+  ROVER_LOG_INFO(LOG_EXECUTING_PLAN, decisionSource, maneuverTypeToString(plan.primary),
+                 maneuverTypeToString(plan.secondary));
+  lastPlanFrontBeforeCm = frontDistanceCm;
+  startPlanExecution(plan);
+  lastHazardDecisionMs = nowMs;
+}
+
+// One control step: sense -> detect hazard -> plan -> execute -> learn outcome.
+void roverControlStep() {
+  // A running plan owns the motors; each pass advances it by one slice (at most one reading).
+  if (maneuverExecutor.active()) {
+    if (maneuverExecutor.service(millis())) {
+      return;
+    }
+    startHazardScan(HAZARD_SCAN_FOR_OUTCOME, 0);
+  }
+  // The stop-and-look scan also advances one settle or reading per pass; act on it once it is done.
+  if (hazardScanStep != HAZARD_SCAN_IDLE) {
+    if (serviceHazardScan(millis())) {
+      return;
+    }
+    if (hazardScanPurpose == HAZARD_SCAN_FOR_OUTCOME) {
+      finishPlanExecution();
     } else {
-      lastPlanOutcome = 0;
+      decideAndStartPlan(hazardScanStartedMs);
+      return;
     }
-    lastHazardDecisionMs = nowMs;
+  }
+  updateScanAndHazard();
+  unsigned long nowMs = millis();
+  serviceSpeculativeQuery(nowMs);
+  if (obstacleNearby && (!previousObstacleNearby || (nowMs - lastHazardDecisionMs) >= HAZARD_DECISION_COOLDOWN_MS)) {
+    myCar.Move(Stop, 0);
+    Serial.println("Hazard detected: STOP -> SCAN -> DECIDE");
+    startHazardScan(HAZARD_SCAN_FOR_DECISION, DECISION_STOP_PAUSE_MS);
   }
 
   // Reset burst-escalation window after sustained clear path.
@@ -1402,11 +2071,38 @@ void loop() {
   }
   previousObstacleNearby = obstacleNearby;
 
+  // A scan just started keeps the car stopped until the plan chosen from it takes the motors.
+  if (hazardScanStep != HAZARD_SCAN_IDLE) {
+    return;
+  }
+
   // Cruise behavior outside hazard mode.
   if (obstacleNearby) {
     myCar.Move(Stop, 0);
   } else {
     myCar.Move(Forward, FORWARD_SPEED);
   }
-  delay(20);
+}
+
+// Scheduler job: the control step. It reads the clock itself as it goes.
+void controlJob(unsigned long nowMs) {
+  (void)nowMs;
+  roverControlStep();
+}
+
+// Scheduler job: prints per-job execution time, lateness and deadline misses.
+void schedulerReportJob(unsigned long nowMs) {
+  (void)nowMs;
+  controlScheduler.printStats(Serial);
+}
+
+// Registers the periodic jobs; registration order is run order within a pass.
+void registerControlJobs() {
+  controlScheduler.addJob("control", CONTROL_JOB_PERIOD_MS, CONTROL_JOB_DEADLINE_MS, controlJob);
+  controlScheduler.addJob("sched", SCHEDULER_REPORT_INTERVAL_MS, REPORT_JOB_DEADLINE_MS, schedulerReportJob);
+}
+
+// Main runtime loop: runs whichever periodic jobs are due.
+void loop() {
+  controlScheduler.runDue(esp_timer_get_time());
 }
@@ -13,6 +13,9 @@
     3) deterministic local fallback if Wi-Fi/API/JSON parsing fails.
   - Executes the selected maneuver, and if it had to reverse, performs a
     follow-up ~90-degree turn to establish a safer new heading.
+  - Runs maneuvers through maneuver_executor.h, which keeps reading the front
+    sensor from loop(): a move ends early once the front is clear, and a newly
+    close obstacle aborts the rest of the maneuver.
   - Uses onboard LEDs to indicate "thinking" and left/right decision direction.
 
   Control strategy summary:
@@ -37,6 +40,7 @@
 #include <ultrasonic.h>
 #include <vehicle.h>
 #include "gemini_config.h"
+#include "maneuver_executor.h"
 #include "wifi_config.h"
 
 // Robot hardware abstractions.
@@ -98,6 +102,13 @@ const unsigned long THINK_LED_ON_MS = 140;
 const unsigned long THINK_LED_OFF_MS = 80;
 const unsigned long DECISION_LED_MS = 220;
 
+// Time-sliced maneuvers: front readings every SENSOR_INTERVAL_MS; a move may end once two in a
+// row show MANEUVER_CLEAR_CM (after at least half its duration), and two readings at or under
+// EMERGENCY_REVERSE_CM abort the rest of the maneuver.
+const float MANEUVER_CLEAR_CM = 50.0f;
+const ManeuverExecutorConfig MANEUVER_EXECUTOR_CONFIG = {
+    (uint16_t)SENSOR_INTERVAL_MS, MANEUVER_CLEAR_CM, EMERGENCY_REVERSE_CM, 2, 50};
+
 // Runtime state tracked across loop iterations.
 // - obstacle flags drive stop/forward behavior
 // - timestamps enforce non-blocking timing windows
@@ -126,6 +137,7 @@ float leftDistanceCm = -1.0f;
 float frontDistanceCm = -1.0f;
 float rightDistanceCm = -1.0f;
 unsigned long frontUpdatedMs = 0;
+ManeuverExecutor<2> maneuverExecutor;
 
 // Helper to switch both LEDs together (used for status signaling patterns).
 void setBothLeds(bool on) {
@@ -330,42 +342,71 @@ ScanPose nextPose(ScanPose pose) {
   return SCAN_LEFT;
 }
 
-// Execute a short avoidance maneuver, then always stop at the end.
-// Stops are explicit to prevent drift between control decisions.
-void executeManeuver(Action action) {
+// Queue a short avoidance maneuver. Lateral moves may end early once the front is clear and
+// abort on a new close obstacle; backing up moves away from the front reading, so it may only
+// end early. The executor always stops at the end to prevent drift between control decisions.
+void queueManeuver(Action action) {
   switch (action) {
     case ACTION_LEFT:
       // Normal left avoidance is a short lateral move.
-      myCar.Move(Move_Left, TURN_SPEED);
-      delay(MANEUVER_DURATION_MS);
+      maneuverExecutor.queue({Move_Left, TURN_SPEED, (uint16_t)MANEUVER_DURATION_MS, true, true, ACTION_LEFT});
       break;
     case ACTION_RIGHT:
       // Normal right avoidance is a short lateral move.
-      myCar.Move(Move_Right, TURN_SPEED);
-      delay(MANEUVER_DURATION_MS);
+      maneuverExecutor.queue({Move_Right, TURN_SPEED, (uint16_t)MANEUVER_DURATION_MS, true, true, ACTION_RIGHT});
       break;
     case ACTION_BACKWARD:
-      myCar.Move(Backward, TURN_SPEED);
-      delay(MANEUVER_DURATION_MS);
+      maneuverExecutor.queue({Backward, TURN_SPEED, (uint16_t)MANEUVER_DURATION_MS, true, false, ACTION_BACKWARD});
       break;
     default:
-      myCar.Move(Stop, 0);
-      delay(200);
+      maneuverExecutor.queue({Stop, 0, 200, false, false, ACTION_STOP});
       break;
   }
+}
+
+// Queue an in-place rotation of approximately 90 degrees to establish a new heading.
+// Used after backing away from a blocked front path. The front reads clear partway round,
+// so the turn never ends early (that would leave a partial heading); it may only abort.
+void queueTurn90(Action turnDirection) {
+  int direction = (turnDirection == ACTION_LEFT) ? Contrarotate : Clockwise;
+  maneuverExecutor.queue({direction, TURN_SPEED, (uint16_t)TURN_90_DURATION_MS, false, true, (uint8_t)turnDirection});
+}
+
+// Executor hook: drive the motors for a segment.
+void driveManeuverSegment(int direction, int speed) {
+  myCar.Move(direction, speed);
+}
+
+// Executor hook: stop at the end of every segment.
+void stopManeuverSegment() {
   myCar.Move(Stop, 0);
 }
 
-// Rotate in place approximately 90 degrees to establish a new heading.
-// Used after backing away from a blocked front path.
-void executeTurn90(Action turnDirection) {
-  if (turnDirection == ACTION_LEFT) {
-    myCar.Move(Contrarotate, TURN_SPEED);
-  } else {
-    myCar.Move(Clockwise, TURN_SPEED);
+// Executor hook: one front reading with the pan servo centered, or -1 without an echo.
+float sampleManeuverFrontCm() {
+  float distanceCm = sensor.Ranging();
+  return isValidDistance(distanceCm) ? distanceCm : -1.0f;
+}
+
+// Executor hook: report segments that ended before their fixed duration.
+void onManeuverSegmentEnded(const ManeuverSegment &segment, ManeuverEnd end) {
+  if (end == MANEUVER_END_COMPLETED) {
+    return;
   }
-  delay(TURN_90_DURATION_MS);
-  myCar.Move(Stop, 0);
+  const char *name = "STOP";
+  if (segment.direction == Contrarotate || segment.direction == Clockwise) {
+    name = (segment.tag == ACTION_LEFT) ? "TURN_LEFT_90" : "TURN_RIGHT_90";
+  } else if (segment.tag == ACTION_LEFT) {
+    name = "LEFT";
+  } else if (segment.tag == ACTION_RIGHT) {
+    name = "RIGHT";
+  } else if (segment.tag == ACTION_BACKWARD) {
+    name = "BACKWARD";
+  }
+  Serial.print("Maneuver ");
+  Serial.print(name);
+  Serial.print(" ended early: ");
+  Serial.println(maneuverEndString(end));
 }
 
 // Escalation strategy for repeated hazards:
@@ -518,6 +559,8 @@ void setup() {
   Serial.print("/");
   Serial.println(PAN_RIGHT_DEG);
   delay(250);
+  maneuverExecutor.begin({driveManeuverSegment, stopManeuverSegment, sampleManeuverFrontCm, onManeuverSegmentEnded},
+                         MANEUVER_EXECUTOR_CONFIG);
   connectWiFi();
   Serial.println("Robot servo scan + Gemini hazard decisions enabled");
 }
@@ -528,6 +571,14 @@ void setup() {
 // - Apply burst/reset logic to prevent repeated near-collisions
 // - Drive forward only while hazard-free
 void loop() {
+  // A running maneuver owns the motors; each pass advances it by one slice (at most one reading).
+  if (maneuverExecutor.active()) {
+    if (maneuverExecutor.service(millis())) {
+      return;
+    }
+    maneuverExecutor.printStats(Serial);
+    // Return to scan loop; forward resumes when hazard clears.
+  }
   updateScanAndHazard();
   unsigned long now = millis();
   if (obstacleNearby && (!previousObstacleNearby || (now - lastHazardDecisionMs) >= HAZARD_DECISION_COOLDOWN_MS)) {
@@ -559,16 +610,18 @@ void loop() {
     } else {
       decision = queryGeminiForHazardDecision(frontDistanceCm, leftDistanceCm, rightDistanceCm);
     }
-    executeManeuver(decision);
+    queueManeuver(decision);
     if (decision == ACTION_BACKWARD) {
       // Any backward move means front path is not viable; pick a new heading with a 90-degree turn.
       Action turnDirection = chooseFallbackFromScan();
       Serial.print("Post-backward 90 turn: ");
       Serial.println(turnDirection == ACTION_LEFT ? "LEFT" : "RIGHT");
-      executeTurn90(turnDirection);
+      queueTurn90(turnDirection);
     }
+    // Readings taken during the maneuver must look along the heading.
+    movePanToPose(SCAN_CENTER);
+    maneuverExecutor.start(millis());
     lastHazardDecisionMs = now;
-    // Return to scan loop; forward resumes when hazard clears.
   }
   if (!obstacleNearby) {
     if (hazardClearSinceMs == 0) {
@@ -583,6 +636,10 @@ void loop() {
     hazardClearSinceMs = 0;
   }
   previousObstacleNearby = obstacleNearby;
+  // The maneuver just started keeps the motors until it ends.
+  if (maneuverExecutor.active()) {
+    return;
+  }
   if (obstacleNearby) {
     myCar.Move(Stop, 0);
   } else {
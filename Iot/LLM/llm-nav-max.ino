@@ -20,8 +20,52 @@
  * After every maneuver the robot re-scans, records the front-clearance delta, and
  * feeds plan quality (improved / worsened) back into the next decision cycle.
  *
- * Required libraries : ArduinoJson, ESP32Servo, HTTPClient, WiFi, WiFiClientSecure,
- *                      ultrasonic (custom), vehicle (custom)
+ * Foundry answers are also kept in a small decision cache (decision_cache.h)
+ * keyed on a quantized snapshot of the planner inputs.  The bypass gate consults it first, so a
+ * situation the rover has already asked about skips the round-trip.  Cached
+ * confidence decays with age and with poor outcomes, and the cache is saved
+ * to NVS so it survives a reboot.
+ *
+ * The Foundry request body is assembled in a static buffer from a flash-resident
+ * template (prompt_buffer.h): the instruction text is a constant prefix that is
+ * byte-identical on every call, and only the sensor numbers and plan names are
+ * formatted in after it.
+ *
+ * The work is split across both cores (rover_runtime.h).  A fixed-rate safety
+ * task on core 1 owns the ultrasonic sensor, the pan servo and the motors: it
+ * latches hazards, vetoes forward motion the moment one is confirmed, and
+ * publishes sensor snapshots.  Foundry requests run in a networking task on
+ * core 0, so TLS handshakes and HTTP timeouts never delay an emergency stop.
+ * loop() stays the decision layer; it reads snapshots, posts motion commands
+ * and Foundry jobs through lock-free single-producer/single-consumer mailboxes,
+ * and prints per-task CPU load and the worst hazard-to-stop latency.  The safety
+ * task never waits for an echo either: ultrasonic_echo.h triggers the sensor and
+ * an echo-pin interrupt times the pulse, so a tick only checks whether it is in.
+ *
+ * Foundry calls also pass a latency-budget circuit breaker (latency_breaker.h).
+ * It tracks the rolling p95 round-trip, timeout rate and HTTP error rate of the
+ * last calls.  When they break FOUNDRY_BREAKER_BUDGET the circuit opens and the
+ * bypass gate goes local-only instead of waiting out the timeout and retry on
+ * every hazard.  After a cool-down, one half-open probe decides whether the
+ * circuit closes.  Transitions and the estimated time saved are printed as
+ * "Breaker |" lines.
+ *
+ * Plans run through a time-sliced maneuver executor (maneuver_executor.h)
+ * instead of commanding a move and delay()ing for its full length.  loop()
+ * services the executor on every pass and feeds it the front distance from
+ * each new safety-task snapshot, so a strafe or backup ends as soon as the
+ * front is clear (a 90-degree turn always finishes its rotation) and a newly
+ * close obstacle aborts the rest of the plan.
+ * "Maneuver |" lines report early ends and the time saved against the fixed
+ * durations.
+ *
+ * Required libraries : ArduinoJson, ESP32Servo, HTTPClient, Preferences, WiFi,
+ *                      WiFiClientSecure, ultrasonic (custom), vehicle (custom)
+ * Local headers      : latency_breaker.h – Foundry latency-budget circuit breaker
+ *                      maneuver_executor.h – time-sliced maneuver segments
+ *                      prompt_buffer.h   – fixed-capacity request body writer
+ *                      rover_runtime.h   – two-core task split and SPSC mailboxes
+ *                      ultrasonic_echo.h – interrupt-timed ultrasonic echoes
  * Config headers     : foundry_config.h  – FOUNDRY_RESPONSES_URL, FOUNDRY_MODEL,
  *                                          FOUNDRY_API_KEY
  *                      wifi_config.h     – WIFI_SSID, WIFI_PASSWORD
@@ -30,15 +74,23 @@
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
 #include <HTTPClient.h>
+#include <Preferences.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <ultrasonic.h>
 #include <vehicle.h>
+#include "decision_cache.h"
 #include "foundry_config.h"
+#include "latency_breaker.h"
+#include "maneuver_executor.h"
+#include "prompt_buffer.h"
+#include "rover_runtime.h"
+#include "ultrasonic_echo.h"
 #include "wifi_config.h"
 // ─── Hardware instances ──────────────────────────────────────────────────────
 vehicle myCar;     // 4-wheel-drive chassis abstraction (forward, backward, strafe, turn)
-ultrasonic sensor; // HC-SR04 ultrasonic distance sensor
+ultrasonic sensor; // HC-SR04 ultrasonic distance sensor (blocking fallback)
+UltrasonicEcho echoRanger; // Interrupt-timed echoes for the same sensor
 Servo panServo;    // Servo motor that rotates the sensor for left / front / right scans
 
 // ─── Coarse directional intent ───────────────────────────────────────────────
@@ -76,7 +128,7 @@ struct HazardSnapshot {
 
 // ─── Complete maneuver plan ──────────────────────────────────────────────────
 // Produced by the local planner or the Azure AI Foundry arbiter and consumed
-// by executePlan().  Carries both the motion instructions and the metadata
+// by startPlanExecution().  Carries both the motion instructions and the metadata
 // (confidence, risk, trap flag) used by the decision logic.
 struct ManeuverPlan {
   ManeuverType primary;           // First motion to execute
@@ -87,6 +139,54 @@ struct ManeuverPlan {
   float riskScore;                // Estimated environmental risk (0 = safe, 1 = critical)
   bool repeatedTrap;              // True when a repeated-trap pattern was detected
 };
+
+// ─── Task hand-off messages ──────────────────────────────────────────────────
+// Values passed between the safety task, loop() and the networking task through
+// SpscMailbox (rover_runtime.h).  Each mailbox has exactly one writer and one reader.
+
+// Safety task → loop(): latest distances and hazard latch after a sensor read.
+struct SafetySnapshot {
+  float leftCm;             // Left clearance from the last decision scan (cm; -1 = invalid)
+  float frontCm;            // EMA-filtered front clearance (cm; -1 = invalid)
+  float rightCm;            // Right clearance from the last decision scan
+  bool obstacleNearby;      // Hazard latch as evaluated by the safety task
+  bool sensorBlind;         // All three directions persistently invalid
+  uint32_t scanSequence;    // Last decision scan completed (matches refreshHazardScanSnapshot requests)
+  bool fromDecisionScan;    // True on the snapshot published as that scan completed
+};
+
+// loop() → safety task: the motion loop() wants.  The safety task applies it on its
+// next tick, replacing Forward with Stop while a hazard is latched.
+struct MotionCommand {
+  int direction;            // vehicle direction code (Forward, Backward, Move_Left, ..., Stop)
+  int speed;                // PWM speed 0–255
+};
+
+// loop() → networking task: one Foundry arbitration request, with a snapshot of
+// every loop-side input the call reads (see prepareFoundryJob).
+struct FoundryJob {
+  uint32_t sequence;
+  ManeuverPlan localPlan;
+  bool repeatedTrap;
+  ManeuverPlan strafePlan;      // Candidate plans offered to the model
+  ManeuverPlan turnPlan;
+  ManeuverPlan recoveryPlan;
+  float frontDistanceCm;        // Front reading sanitizePlan checks the choice against
+  uint32_t cacheKey;            // Decision cache key of the snapshot the prompt describes
+  size_t promptEndLength;       // Prompt length in foundryRequestPrompt, before the tokens tail
+};
+
+// Networking task → loop(): the sanitized plan for the job with the same sequence,
+// plus the side effects loop() applies when it takes the result.
+struct FoundryJobResult {
+  uint32_t sequence;
+  ManeuverPlan plan;
+  uint32_t cacheKey;
+  bool cacheable;                         // plan is a parsed Foundry choice worth caching
+  bool called;                            // An HTTP round trip was made
+  LatencyBreakerOutcome breakerOutcome;   // Valid when called
+  uint32_t roundTripMs;                   // Valid when called
+};
 // ─── Motor speeds (PWM range 0–255) ───────────────────────────────────────────────
 const int FORWARD_SPEED = 190;              // Speed when driving straight ahead
 const int TURN_SPEED = 240;                 // Speed during turns and strafes
@@ -147,6 +247,22 @@ const uint16_t FOUNDRY_MAX_OUTPUT_TOKENS = 160;           // Token budget for th
 const uint16_t FOUNDRY_RETRY_OUTPUT_TOKENS = 120;         // Reduced budget for the single retry attempt
 const unsigned long FOUNDRY_HTTP_TIMEOUT_TIGHT_MS = 3800; // Tight HTTP timeout aiming for fast turnaround
 const unsigned long FOUNDRY_HTTP_TIMEOUT_RETRY_MS = 9000; // Longer timeout used on the retry after a timeout
+const unsigned long FOUNDRY_JOB_MARGIN_MS = 1500;         // Connect, TLS and parse time on top of both HTTP timeouts
+const unsigned long FOUNDRY_JOB_DEADLINE_MS =
+    FOUNDRY_HTTP_TIMEOUT_TIGHT_MS + FOUNDRY_HTTP_TIMEOUT_RETRY_MS + FOUNDRY_JOB_MARGIN_MS; // loop() stops waiting after this
+const size_t FOUNDRY_REQUEST_BODY_CAPACITY = 3072;        // Static request body buffer (prompt + JSON envelope)
+
+// ─── Foundry circuit breaker ─────────────────────────────────────────────────────
+// On a bad link every ambiguous hazard would wait out the tight timeout plus the
+// retry.  When the recent calls break this budget the circuit opens and the
+// rover plans locally until a half-open probe comes back within p95Ms.
+const LatencyBreakerBudget FOUNDRY_BREAKER_BUDGET = {
+    6000,     // Rolling p95 round-trip (ms) above which the circuit opens
+    0.30f,    // Timeout share of recent calls (each can cost TIGHT + RETRY ms)
+    0.40f,    // HTTP / connect error share of recent calls
+    4,        // Calls needed before the window is judged
+    30000,    // First cool-down (ms) before a half-open probe
+    240000};  // Cool-down cap (ms) after repeated failed probes
 
 // ─── Decision-loop timing ───────────────────────────────────────────────────────
 const unsigned long HAZARD_DECISION_COOLDOWN_MS = 800;  // Minimum gap between consecutive hazard decisions
@@ -190,14 +306,59 @@ const float PLAN_IMPROVEMENT_MARGIN_CM = 5.0f;  // Front clearance gain (cm) cou
 const uint16_t MIN_MANEUVER_DURATION_MS = 180;  // Durations shorter than this fall back to the default
 const uint16_t MAX_MANEUVER_DURATION_MS = 700;  // Durations longer than this fall back to the default
 const uint8_t MAX_SAME_TURN_STREAK = 2;         // Anti-spin: max consecutive same-direction turns before switching
+
+// ─── Time-sliced maneuver executor ───────────────────────────────────────────────
+// A move may end once two front readings in a row show MANEUVER_CLEAR_CM (after at
+// least half its duration); two readings at or under EMERGENCY_REVERSE_CM abort the plan.
+const float MANEUVER_CLEAR_CM = 70.0f;          // Front clearance that ends a strafe or backup early
+const ManeuverExecutorConfig MANEUVER_EXECUTOR_CONFIG = {
+    (uint16_t)SENSOR_INTERVAL_MS,  // Gap between forward readings
+    MANEUVER_CLEAR_CM,             // Clearance that ends a segment early
+    EMERGENCY_REVERSE_CM,          // New hazard that aborts the plan
+    2,                             // Consecutive readings to confirm either
+    50};                           // Percent of each segment that always runs
+
+// ─── Decision cache ───────────────────────────────────────────────────────────────
+// Foundry plans are remembered under a quantized snapshot of the inputs that drive
+// them (L/F/R distance buckets, repeated trap, front trend, oscillation count), so a
+// situation the rover has already asked about is answered locally in microseconds.
+const uint8_t DECISION_CACHE_SIZE = 24;        // Entries kept in RAM (least recently used is evicted)
+const DecisionCacheConfig DECISION_CACHE_CONFIG = {
+    ULTRASONIC_MIN_VALID_CM,  // Readings below this fall in bucket 0
+    15.0f,                    // Width of one distance bucket (cm)
+    11,                       // Bucket for 150 cm and beyond
+    8.0f,                     // Front trend within ± this counts as flat (cm)
+    0.60f,                    // Decayed confidence needed to answer from the cache
+    600000UL,                 // Cached confidence halves every 10 min unused
+    0.10f,                    // Confidence added when a cached plan improved clearance
+    0.90f,                    // Multiplier when a cached plan made no difference
+    0.50f,                    // Multiplier when a cached plan worsened clearance
+    0.80f,                    // Confidence multiplier for entries restored from NVS
+    true,                     // Keep the cache across reboots
+    "navcache",               // NVS namespace
+    60000UL,                  // Minimum gap between NVS writes
+    1};                       // NVS layout version; bump when DecisionCacheEntry changes
+
+// ─── Dual-core runtime ─────────────────────────────────────────────────────────────
+// The safety task shares core 1 with loop() but runs at a higher priority, so it
+// preempts the decision code; Wi-Fi, TLS and HTTP stay on core 0.
+const uint32_t SAFETY_TASK_PERIOD_MS = 20;               // Safety tick: motion commands, hazard veto, scan steps
+const BaseType_t SAFETY_TASK_CORE = 1;                   // Same core as loop()
+const UBaseType_t SAFETY_TASK_PRIORITY = 3;              // Above loop() (1) so decisions never delay a stop
+const uint32_t SAFETY_TASK_STACK_BYTES = 4096;
+const BaseType_t NETWORK_TASK_CORE = 0;                  // Core that runs the Wi-Fi / lwIP stack
+const UBaseType_t NETWORK_TASK_PRIORITY = 1;
+const uint32_t NETWORK_TASK_STACK_BYTES = 12288;         // TLS handshake + HTTPClient + ArduinoJson
+const unsigned long DECISION_SCAN_TIMEOUT_MS = 1500;     // Give up waiting for an L/R/C scan after this long
+const unsigned long RUNTIME_REPORT_INTERVAL_MS = 5000;   // Period of the "Runtime |" telemetry line
 // ─── Runtime state ─────────────────────────────────────────────────────────────────
+// Unless marked as safety-task state, everything below belongs to loop() (and to
+// the networking task while loop() waits for a Foundry result).
 
 // --- Obstacle / hazard flags ---
 bool obstacleNearby = false;         // True when a close obstacle has been confirmed
 bool previousObstacleNearby = false; // Value from the previous loop iteration (detects transitions)
 // --- Timing bookmarks ---
-unsigned long lastSensorMs = 0;            // When the sensor was last polled
-unsigned long lastPanStepMs = 0;           // When the pan servo last moved one step
 unsigned long lastHazardDecisionMs = 0;    // When the last hazard decision was made
 
 // --- Hazard-burst (rapid-repeat) tracking ---
@@ -208,18 +369,10 @@ unsigned long hazardClearSinceMs = 0;       // When the path last became clear (
 // --- Turn direction memory ---
 Action lastNonStopDecision = ACTION_LEFT;   // Last lateral direction chosen; used for tie-breaking
 
-// --- Pan servo state ---
-bool panServoReady = false;           // True if the servo successfully attached at startup
-int panCurrentDeg = PAN_CENTER_DEG;   // Current servo angle (degrees)
-bool panSweepTowardLeft = true;       // Sweep direction: true = moving toward left endpoint
-
-// --- Distance readings (cm; -1 = invalid / no echo) ---
+// --- Distance readings (cm; -1 = invalid / no echo), copied from the latest SafetySnapshot ---
 float leftDistanceCm = -1.0f;    // Last valid left-side reading
 float frontDistanceCm = -1.0f;   // EMA-filtered front reading (see updateFrontDistanceEstimate)
 float rightDistanceCm = -1.0f;   // Last valid right-side reading
-float frontFilteredCm = -1.0f;   // Internal EMA accumulator for the front sensor
-bool frontFilterReady = false;   // True once the EMA has been seeded with at least one reading
-unsigned long frontUpdatedMs = 0; // Timestamp of the last front-distance update
 
 // --- Navigation history ring buffer ---
 HazardSnapshot navHistory[NAV_HISTORY_SIZE]; // Circular buffer of recent hazard snapshots
@@ -235,17 +388,63 @@ int8_t lastPlanOutcome = 0;            // +1 = improved clearance, -1 = worsened
 float lastPlanFrontBeforeCm = -1.0f;   // Front clearance immediately before the last maneuver
 float lastPlanFrontAfterCm = -1.0f;    // Front clearance immediately after the last maneuver
 
-// --- Sensor streak counters ---
-uint8_t allUnknownStreak = 0;     // Consecutive cycles where all three distances were invalid
-uint8_t frontBlindStreak = 0;     // Consecutive cycles with a stale/invalid front reading
-uint8_t nearObstacleStreak = 0;   // Consecutive cycles with front <= ULTRASONIC_ALERT_CM
+// --- Safety task state (written only by the safety task) ---
+bool panServoReady = false;           // True if the servo successfully attached at startup
+int panCurrentDeg = PAN_CENTER_DEG;   // Current servo angle (degrees)
+bool panSweepTowardLeft = true;       // Sweep direction: true = moving toward left endpoint
+unsigned long lastSensorMs = 0;       // When the sensor was last polled
+bool frontRangingPending = false;     // A routine front reading is waiting for its echo
+bool frontRetryUsed = false;          // The one immediate retry of that reading was spent
+unsigned long lastPanStepMs = 0;      // When the pan servo last moved one step
+float safetyLeftCm = -1.0f;           // Sensor-side copies of the L/F/R distances
+float safetyFrontCm = -1.0f;
+float safetyRightCm = -1.0f;
+bool safetyObstacleNearby = false;    // Hazard latch that drives the forward-motion veto
+float frontFilteredCm = -1.0f;        // Internal EMA accumulator for the front sensor
+bool frontFilterReady = false;        // True once the EMA has been seeded with at least one reading
+unsigned long frontUpdatedMs = 0;     // Timestamp of the last front-distance update
+uint8_t allUnknownStreak = 0;         // Consecutive cycles where all three distances were invalid
+uint8_t frontBlindStreak = 0;         // Consecutive cycles with a stale/invalid front reading
+uint8_t nearObstacleStreak = 0;       // Consecutive cycles with front <= ULTRASONIC_ALERT_CM
 unsigned long lastOpenSpaceSeenMs = 0; // Timestamp of the last open-space detection
+int64_t safetyHazardOnsetUs = 0;      // First reading of the hazard now building or latched (0 = none)
+uint8_t decisionScanStep = 0;         // DecisionScanStep of the scan in progress
+unsigned long decisionScanStepMs = 0; // When the servo was moved for the current scan step
+uint32_t decisionScanSequence = 0;    // Scan request being served
+uint32_t decisionScanCompleted = 0;   // Last scan request finished
+MotionCommand safetyMotionCommand = {Stop, 0}; // Latest motion requested by loop()
+int appliedMotorDirection = Stop;     // What the motors were last told
+int appliedMotorSpeed = 0;
 
 // --- Foundry (LLM) request telemetry ---
 bool foundryRequestSent = false;      // True if an HTTP request was sent this cycle
 bool foundryResponseOk = false;       // True if a 2xx HTTP response was received
 bool foundryPlanParsed = false;       // True if the model text was successfully parsed
 String foundryDecisionStatus = "idle"; // Human-readable status for Serial telemetry
+LatencyBreaker foundryBreaker("foundry", FOUNDRY_BREAKER_BUDGET); // Opens on a slow or failing link
+ManeuverExecutor<2> maneuverExecutor;         // Runs the current plan's primary and secondary segments
+
+// --- Decision cache ---
+DecisionCache<ManeuverType, DECISION_CACHE_SIZE> decisionCache; // Quantized-snapshot → plan memory, kept in NVS
+char foundryRequestBody[FOUNDRY_REQUEST_BODY_CAPACITY]; // Request body, rebuilt in place for each Foundry call
+PromptBuffer foundryRequestPrompt(foundryRequestBody, sizeof(foundryRequestBody)); // Owned by the running Foundry job
+
+// --- Dual-core runtime ---
+void safetyTaskTick();
+RoverPeriodicTask safetyTask = {"Safety", SAFETY_TASK_PERIOD_MS, safetyTaskTick};
+RoverTaskStats networkTaskStats;                 // Foundry jobs run by the networking task
+TaskHandle_t networkTaskHandle = nullptr;        // nullptr = task not running, Foundry is called inline
+RoverStopLatency hazardStopLatency;              // Hazard onset → motor stop, measured by the safety task
+SpscMailbox<SafetySnapshot> safetySnapshotMailbox;  // Safety task → loop()
+SpscMailbox<MotionCommand> motionCommandMailbox;    // loop() → safety task
+SpscMailbox<uint32_t> decisionScanMailbox;          // loop() → safety task: scan request sequence
+SpscMailbox<FoundryJob> foundryJobMailbox;          // loop() → networking task
+SpscMailbox<FoundryJobResult> foundryResultMailbox; // Networking task → loop()
+uint32_t decisionScanRequested = 0;             // Last scan sequence requested by loop()
+uint32_t decisionScanApplied = 0;               // Last scan sequence loop() has seen completed
+uint32_t foundryJobSequence = 0;
+uint32_t foundryJobAbandoned = 0;               // Job loop() stopped waiting for; 0 = none still running
+unsigned long lastRuntimeReportMs = 0;
 // ─── LED helpers ────────────────────────────────────────────────────────────────────
 
 // Sets both left and right status LEDs to the same on/off state,
@@ -328,6 +527,10 @@ int effectiveDistance(float distanceCm) {
   }
   return SAFE_UNKNOWN_DISTANCE_CM;
 }
+// Safety-task counterpart of allDistancesUnknown(), over the sensor-side copies.
+bool safetyDistancesUnknown() {
+  return !isValidDistance(safetyLeftCm) && !isValidDistance(safetyFrontCm) && !isValidDistance(safetyRightCm);
+}
 // Picks a fallback turn direction based on which side has more clearance.
 // Breaks ties by alternating from the last non-stop decision to avoid spin.
 Action chooseFallbackTurn() {
@@ -350,7 +553,7 @@ uint8_t countRecentSameTurnStreak(ManeuverType turnManeuver);
 // ─── Front-distance EMA filter ─────────────────────────────────────────────────────
 
 // Applies an exponential moving average to a raw front-sensor reading to
-// reduce noise while still tracking genuine distance changes.  When resetFilter
+// reduce noise while still tracking genuine distance changes (safety task only).  When resetFilter
 // is true (e.g., right after a maneuver) the accumulator is reinitialised from
 // the new reading so stale history does not pollute the fresh estimate.
 void updateFrontDistanceEstimate(float measuredCm, unsigned long nowMs, bool resetFilter) {
@@ -363,7 +566,7 @@ void updateFrontDistanceEstimate(float measuredCm, unsigned long nowMs, bool res
   } else {
     frontFilteredCm = (FRONT_EMA_ALPHA * measuredCm) + ((1.0f - FRONT_EMA_ALPHA) * frontFilteredCm);
   }
-  frontDistanceCm = frontFilteredCm;
+  safetyFrontCm = frontFilteredCm;
   frontUpdatedMs = nowMs;
 }
 // ─── Plan builder helpers ───────────────────────────────────────────────────────────
@@ -409,15 +612,13 @@ ManeuverPlan buildRecoveryPlan(Action action) {
   plan.confidence = 0.0f;
   return plan;
 }
-// Formats a ManeuverPlan into a compact key=value string for inclusion in the
-// Foundry prompt so the LLM can compare the candidate options by name.
-String planToPromptText(const char *label, const ManeuverPlan &plan) {
-  return String(label) + "={primary:" + maneuverTypeToString(plan.primary) +
-         ",primary_ms:" + String(plan.primaryDurationMs) +
-         ",secondary:" + maneuverTypeToString(plan.secondary) +
-         ",secondary_ms:" + String(plan.secondaryDurationMs) +
-         ",confidence:" + String(plan.confidence, 2) +
-         ",risk:" + String(plan.riskScore, 2) + "}";
+// Appends a ManeuverPlan as a compact key=value entry to the Foundry prompt
+// so the LLM can compare the candidate options by name.
+void appendPlanPromptText(PromptBuffer &out, const char *label, const ManeuverPlan &plan) {
+  out.appendf("%s={primary:%s,primary_ms:%u,secondary:%s,secondary_ms:%u,confidence:%.2f,risk:%.2f}", label,
+              maneuverTypeToString(plan.primary), (unsigned)plan.primaryDurationMs,
+              maneuverTypeToString(plan.secondary), (unsigned)plan.secondaryDurationMs, plan.confidence,
+              plan.riskScore);
 }
 // ─── Local plan scoring ─────────────────────────────────────────────────────────────
 
@@ -658,37 +859,27 @@ bool detectRepeatedTrap(float leftCm, float frontCm, float rightCm) {
   }
   return similarCount >= TRAP_REPEAT_THRESHOLD;
 }
-// Builds a comma-separated string of the four most recent plan names
-// (oldest first) for inclusion in the Foundry prompt.
-String buildRecentPlanSummary() {
-  String summary;
+// Appends a comma-separated list of the four most recent plan names
+// (oldest first) to the Foundry prompt.
+void appendRecentPlanSummary(PromptBuffer &out) {
   for (uint8_t i = 0; i < 4; ++i) {
-    if (i > 0) {
-      summary += ",";
-    }
     uint8_t idx = (recentPlanWriteIndex + i) % 4;
-    summary += maneuverTypeToString(recentPlans[idx]);
+    out.appendf(i > 0 ? ",%s" : "%s", maneuverTypeToString(recentPlans[idx]));
   }
-  return summary;
 }
-// Builds a pipe-separated string of all stored L/F/R history snapshots
-// (oldest first) for inclusion in the Foundry prompt as context.
-String buildHistorySummary() {
-  String summary;
+// Appends a pipe-separated list of all stored L/F/R history snapshots
+// (oldest first) to the Foundry prompt as context, or "none".
+void appendHistorySummary(PromptBuffer &out) {
+  if (navHistoryCount == 0) {
+    out.append("none");
+    return;
+  }
   uint8_t start = (navHistoryCount == NAV_HISTORY_SIZE) ? navHistoryWriteIndex : 0;
   for (uint8_t i = 0; i < navHistoryCount; ++i) {
     uint8_t idx = (start + i) % NAV_HISTORY_SIZE;
-    if (summary.length() > 0) {
-      summary += " | ";
-    }
-    summary += "L=" + String(navHistory[idx].leftCm, 1);
-    summary += ",F=" + String(navHistory[idx].frontCm, 1);
-    summary += ",R=" + String(navHistory[idx].rightCm, 1);
+    out.appendf(i > 0 ? " | L=%.1f,F=%.1f,R=%.1f" : "L=%.1f,F=%.1f,R=%.1f", navHistory[idx].leftCm,
+                navHistory[idx].frontCm, navHistory[idx].rightCm);
   }
-  if (summary.length() == 0) {
-    summary = "none";
-  }
-  return summary;
 }
 // Returns the change in front clearance from the oldest to the newest history
 // snapshot (positive = path opening up, negative = closing in / getting worse).
@@ -932,15 +1123,35 @@ bool plansDisagreeDirection(const ManeuverPlan &a, const ManeuverPlan &b) {
   bool bRight = isPlanDirectionRight(b.primary);
   return (aLeft && bRight) || (aRight && bLeft);
 }
-// Returns true when the local plan is confident enough that the ~4 s Foundry
-// round-trip can be skipped.  All of the following must hold:
+// ─── Decision cache ─────────────────────────────────────────────────────────────────
+
+// Cache key for the current snapshot (layout in decision_cache.h).
+uint32_t buildDecisionCacheKey(bool repeatedTrap) {
+  return decisionCache.key(leftDistanceCm, frontDistanceCm, rightDistanceCm, frontTrendCm(),
+                           detectPlanOscillationCount(), repeatedTrap);
+}
+// Looks up the current snapshot.  On a hit the cached motions are rebuilt with
+// live risk/trap fields, re-sanitized against the local plan, and returned in
+// cachedPlan.
+bool lookupDecisionCache(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &cachedPlan) {
+  ManeuverPlan plan = localPlan;
+  if (!decisionCache.lookup(buildDecisionCacheKey(repeatedTrap), millis(), plan)) {
+    return false;
+  }
+  plan.riskScore = estimateLocalRiskScore();
+  plan.repeatedTrap = repeatedTrap;
+  sanitizePlan(plan, localPlan, frontDistanceCm);
+  cachedPlan = plan;
+  return true;
+}
+// True when the local plan is clearly correct, i.e. all of the following hold:
 //   - Not a repeated-trap situation
 //   - Last plan did not worsen clearance
 //   - No detected L/R oscillation
 //   - Local confidence >= OBVIOUS_LOCAL_CONFIDENCE_MIN
 //   - Risk score <= OBVIOUS_LOCAL_RISK_MAX
 //   - If the plan is a turn, the current snapshot is not open space
-bool shouldBypassFoundry(const ManeuverPlan &localPlan, bool repeatedTrap) {
+bool isObviousLocalPlan(const ManeuverPlan &localPlan, bool repeatedTrap) {
   if (repeatedTrap) {
     return false;
   }
@@ -967,6 +1178,28 @@ bool shouldBypassFoundry(const ManeuverPlan &localPlan, bool repeatedTrap) {
   }
   return true;
 }
+// Returns true when the ~4 s Foundry round-trip can be skipped, with the plan to
+// run in bypassPlan.  The decision cache is consulted first; a hit answers any
+// situation Foundry has already arbitrated, repeated traps included.  Next an
+// obvious local plan is used (isObviousLocalPlan).  Last, the local plan is used
+// when the Foundry circuit breaker refuses the call; this check comes after the
+// others so a half-open probe is only handed out for a call that will be made.
+bool shouldBypassFoundry(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &bypassPlan) {
+  if (lookupDecisionCache(localPlan, repeatedTrap, bypassPlan)) {
+    foundryDecisionStatus = "decision_cache_hit";
+    return true;
+  }
+  bypassPlan = localPlan;
+  if (isObviousLocalPlan(localPlan, repeatedTrap)) {
+    foundryDecisionStatus = "local_obvious_bypass";
+    return true;
+  }
+  if (!foundryBreaker.allowRequest(millis())) {
+    foundryDecisionStatus = "circuit_open_local_fallback";
+    return true;
+  }
+  return false;
+}
 // Walks the structured JSON response document to extract the model's text output.
 // Tries multiple known Azure AI Foundry response shapes in order:
 //   1. Top-level "output_text" field (simplest format)
@@ -1084,11 +1317,11 @@ bool extractFoundryModelTextFromRawResponse(const String &responseBody, String &
 //   - Replaces a STOP primary with the fallback plan
 //   - Replaces RESCAN primary with the fallback's primary
 //   - Fixes turn durations to the calibrated TURN_90_DURATION_MS constant
-//   - Rejects backward plans when front is already clear
+//   - Rejects backward plans when front (frontCm) is already clear
 //   - Falls back when LLM confidence is below MIN_LLM_CONFIDENCE
 //   - Falls back when the LLM disagrees with the local planner on direction
 //     and confidence is below MIN_LLM_CONFIDENCE_FOR_DISAGREEMENT
-void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan) {
+void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan, float frontCm) {
   if (plan.primary == MANEUVER_STOP && fallbackPlan.primary != MANEUVER_STOP) {
     plan = fallbackPlan;
     return;
@@ -1100,7 +1333,7 @@ void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan) {
   if (plan.primary == MANEUVER_TURN_LEFT_90 || plan.primary == MANEUVER_TURN_RIGHT_90) {
     plan.primaryDurationMs = TURN_90_DURATION_MS;
   }
-  if (plan.primary == MANEUVER_BACKWARD && isValidDistance(frontDistanceCm) && frontDistanceCm > ULTRASONIC_ALERT_CM) {
+  if (plan.primary == MANEUVER_BACKWARD && isValidDistance(frontCm) && frontCm > ULTRASONIC_ALERT_CM) {
     plan = fallbackPlan;
   }
   if (plan.secondary == MANEUVER_TURN_LEFT_90 || plan.secondary == MANEUVER_TURN_RIGHT_90) {
@@ -1117,77 +1350,150 @@ void sanitizePlan(ManeuverPlan &plan, const ManeuverPlan &fallbackPlan) {
 }
 // ─── Azure AI Foundry arbiter ──────────────────────────────────────────────────────────
 
-// Posts the current sensor state, history, and all four candidate plans to the
-// Azure AI Foundry Responses API.  The LLM picks one candidate by name and
-// returns a confidence score.  The chosen plan is sanitized before being
-// returned.  Falls back to fallbackPlan on any of:
+// Request body template.  Everything from the opening brace through the
+// instruction text is constant and lives in flash, so the start of every request
+// is byte-identical and server-side prompt caching can reuse it; the per-decision
+// state follows in FOUNDRY_PROMPT_STATE_FORMAT.  max_output_tokens comes last so
+// the retry body only swaps the tail.  All text is pre-escaped for a JSON string.
+static const char FOUNDRY_BODY_MODEL_OPEN[] PROGMEM = "{\"model\":\"";
+static const char FOUNDRY_BODY_INPUT_OPEN[] PROGMEM =
+    "\",\"reasoning\":{\"effort\":\"minimal\"},"
+    "\"text\":{\"format\":{\"type\":\"json_object\"},\"verbosity\":\"low\"},\"input\":\"";
+static const char FOUNDRY_PROMPT_INSTRUCTIONS[] PROGMEM =
+    "You are a safety-first indoor navigation planner for a robot. "
+    "Do not invent maneuvers or durations. "
+    "Choose only one candidate from: baseline, strafe, turn, recovery. "
+    "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
+    "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
+    "Return strict JSON only, no markdown, with keys choice and confidence. "
+    "Example JSON: {\\\"choice\\\":\\\"recovery\\\",\\\"confidence\\\":0.82}. ";
+static const char FOUNDRY_PROMPT_STATE_FORMAT[] PROGMEM =
+    "Current distances cm: front=%.1f, left=%.1f, right=%.1f. Repeated trap=%s. "
+    "Front trend cm over recent history=%.1f. Left-right oscillation count=%u. Last plan outcome=%s. "
+    "Last plan front before=%.1f, after=%.1f. Baseline primary=%s, baseline secondary=%s. Candidate plans: ";
+static const char FOUNDRY_BODY_TOKENS_FORMAT[] PROGMEM = "\",\"max_output_tokens\":%u}";
+
+// Writes the Foundry request body into foundryRequestBody, stopping before the
+// max_output_tokens tail (the caller appends it, and swaps it for the retry).
+// Prints the build time, body size, static prefix size and any heap left held
+// by the build (expected to be zero).  Returns false if the buffer overflowed.
+bool buildFoundryRequestBody(PromptBuffer &body, const ManeuverPlan &fallbackPlan, const ManeuverPlan &strafePlan,
+                             const ManeuverPlan &turnPlan, const ManeuverPlan &recoveryPlan, bool repeatedTrap) {
+  PromptHeapProbe heapProbe;
+  heapProbe.start();
+  unsigned long buildStartUs = micros();
+  body.clear();
+  body.append(FOUNDRY_BODY_MODEL_OPEN);
+  body.append(FOUNDRY_MODEL);
+  body.append(FOUNDRY_BODY_INPUT_OPEN);
+  body.append(FOUNDRY_PROMPT_INSTRUCTIONS);
+  size_t staticPrefixLength = body.length();
+  body.appendf(FOUNDRY_PROMPT_STATE_FORMAT, frontDistanceCm, leftDistanceCm, rightDistanceCm,
+               repeatedTrap ? "true" : "false", frontTrendCm(), (unsigned)detectPlanOscillationCount(),
+               lastPlanOutcomeString(), lastPlanFrontBeforeCm, lastPlanFrontAfterCm,
+               maneuverTypeToString(fallbackPlan.primary), maneuverTypeToString(fallbackPlan.secondary));
+  appendPlanPromptText(body, "baseline", fallbackPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "strafe", strafePlan);
+  body.append("; ");
+  appendPlanPromptText(body, "turn", turnPlan);
+  body.append("; ");
+  appendPlanPromptText(body, "recovery", recoveryPlan);
+  body.append(". Recent hazard history=");
+  appendHistorySummary(body);
+  body.append(". Recent plans=");
+  appendRecentPlanSummary(body);
+  body.append(".");
+  uint32_t buildUs = micros() - buildStartUs;
+  int heapBlocksHeld = 0;
+  int heapBytesHeld = 0;
+  heapProbe.measure(heapBlocksHeld, heapBytesHeld);
+  Serial.printf("Foundry prompt build: %lu us, %u bytes (static prefix %u), heap held %+d blocks / %+d bytes%s\n",
+                (unsigned long)buildUs, (unsigned)body.length(), (unsigned)staticPrefixLength, heapBlocksHeld,
+                heapBytesHeld, body.overflowed() ? ", OVERFLOW" : "");
+  if (heapProbe.counted) {
+    Serial.printf("Foundry prompt heap: %lu allocations (%lu bytes), %lu frees\n", (unsigned long)heapProbe.allocations,
+                  (unsigned long)heapProbe.allocatedBytes, (unsigned long)heapProbe.frees);
+  }
+  return !body.overflowed();
+}
+
+// Closes the body after the prompt with a max_output_tokens tail, replacing any
+// earlier tail.  Returns false if the closed body did not fit; a cut-off body is
+// never sent.
+bool appendFoundryBodyTail(PromptBuffer &body, size_t promptEndLength, unsigned maxOutputTokens) {
+  body.truncate(promptEndLength);
+  body.appendf(FOUNDRY_BODY_TOKENS_FORMAT, maxOutputTokens);
+  return !body.overflowed();
+}
+// Snapshots everything the Foundry call reads from loop-side state into job:
+// the candidate plans, the front distance sanitizePlan checks, the decision
+// cache key, and the request body (built into foundryRequestPrompt, which the
+// job owns until its result is taken).  Runs on loop().  Returns false if the
+// prompt overflowed; the caller then keeps the local plan.
+bool prepareFoundryJob(const ManeuverPlan &localPlan, bool repeatedTrap, FoundryJob &job) {
+  foundryRequestSent = false;
+  foundryResponseOk = false;
+  foundryPlanParsed = false;
+  foundryDecisionStatus = "init";
+  job.localPlan = localPlan;
+  job.repeatedTrap = repeatedTrap;
+  Action openSideAction = chooseFallbackTurn();
+  job.strafePlan = buildStrafePlan(openSideAction, localPlan.primaryDurationMs);
+  job.turnPlan = buildTurnPlan(openSideAction);
+  job.recoveryPlan = buildRecoveryPlan(openSideAction);
+  float riskScore = estimateLocalRiskScore();
+  job.strafePlan.riskScore = riskScore;
+  job.turnPlan.riskScore = riskScore;
+  job.recoveryPlan.riskScore = riskScore;
+  job.frontDistanceCm = frontDistanceCm;
+  job.cacheKey = buildDecisionCacheKey(repeatedTrap);
+  if (!buildFoundryRequestBody(foundryRequestPrompt, localPlan, job.strafePlan, job.turnPlan, job.recoveryPlan,
+                               repeatedTrap)) {
+    foundryDecisionStatus = "prompt_overflow_local_fallback";
+    return false;
+  }
+  job.promptEndLength = foundryRequestPrompt.length();
+  return true;
+}
+
+// Posts the prepared request body to the Azure AI Foundry Responses API.  The
+// LLM picks one candidate by name and returns a confidence score.  The chosen
+// plan is sanitized against the job's snapshot before being returned in
+// result.plan.  Reads only the job, so it can run on the networking task while
+// loop() keeps updating distances and history.  Falls back to job.localPlan on
+// any of:
 //   - WiFi not connected
+//   - Request body (with its output-token tail) does not fit the buffer
 //   - HTTP begin / send failure
 //   - Non-2xx status code (one timeout retry is attempted)
 //   - JSON parse or model-text extraction failure
 //   - Choice parse failure
-ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, bool repeatedTrap) {
-  foundryRequestSent = false;
-  foundryResponseOk = false;
-  foundryPlanParsed = false;
-  foundryDecisionStatus = "init";
+void runFoundryJob(const FoundryJob &job, FoundryJobResult &result) {
+  const ManeuverPlan &fallbackPlan = job.localPlan;
+  result.sequence = job.sequence;
+  result.plan = fallbackPlan;
+  result.cacheKey = job.cacheKey;
+  result.cacheable = false;
+  result.called = false;
   flashFoundryThinkingLeds();
   if (WiFi.status() != WL_CONNECTED) {
     foundryDecisionStatus = "wifi_disconnected_local_fallback";
     Serial.println("Foundry skipped: WiFi disconnected, using local fallback plan");
-    return fallbackPlan;
+    return;
+  }
+  PromptBuffer &body = foundryRequestPrompt;
+  if (!appendFoundryBodyTail(body, job.promptEndLength, (unsigned)FOUNDRY_MAX_OUTPUT_TOKENS)) {
+    foundryDecisionStatus = "prompt_overflow_local_fallback";
+    Serial.println("Foundry request body overflowed, using local fallback plan");
+    return;
   }
   HTTPClient http;
   if (!http.begin(FOUNDRY_RESPONSES_URL)) {
     foundryDecisionStatus = "http_begin_failed_local_fallback";
     Serial.println("Foundry: HTTP begin failed");
-    return fallbackPlan;
+    return;
   }
-  Action openSideAction = chooseFallbackTurn();
-  ManeuverPlan localStrafePlan = buildStrafePlan(openSideAction, fallbackPlan.primaryDurationMs);
-  ManeuverPlan localTurnPlan = buildTurnPlan(openSideAction);
-  ManeuverPlan localRecoveryPlan = buildRecoveryPlan(openSideAction);
-  localStrafePlan.riskScore = estimateLocalRiskScore();
-  localTurnPlan.riskScore = estimateLocalRiskScore();
-  localRecoveryPlan.riskScore = estimateLocalRiskScore();
-  String candidateSummary = planToPromptText("baseline", fallbackPlan) + "; " +
-                            planToPromptText("strafe", localStrafePlan) + "; " +
-                            planToPromptText("turn", localTurnPlan) + "; " +
-                            planToPromptText("recovery", localRecoveryPlan);
-  String prompt =
-      "You are a safety-first indoor navigation planner for a robot. "
-      "Do not invent maneuvers or durations. "
-      "Choose only one candidate from: baseline, strafe, turn, recovery. "
-      "If repeatedTrap is true or front trend is negative, prefer a recovery maneuver that backs up before turning. "
-      "If the baseline candidate is already safe, keep it unless another candidate clearly improves clearance. "
-      "Return strict JSON only, no markdown, with keys choice and confidence. "
-      "Current distances cm: front=" + String(frontDistanceCm, 1) +
-      ", left=" + String(leftDistanceCm, 1) +
-      ", right=" + String(rightDistanceCm, 1) +
-      ". Repeated trap=" + String(repeatedTrap ? "true" : "false") +
-      ". Front trend cm over recent history=" + String(frontTrendCm(), 1) +
-      ". Left-right oscillation count=" + String(detectPlanOscillationCount()) +
-      ". Last plan outcome=" + String(lastPlanOutcomeString()) +
-      ". Last plan front before=" + String(lastPlanFrontBeforeCm, 1) +
-      ", after=" + String(lastPlanFrontAfterCm, 1) +
-      ". Baseline primary=" + String(maneuverTypeToString(fallbackPlan.primary)) +
-      ", baseline secondary=" + String(maneuverTypeToString(fallbackPlan.secondary)) +
-      ". Candidate plans: " + candidateSummary +
-      ". Recent hazard history=" + buildHistorySummary() +
-      ". Recent plans=" + buildRecentPlanSummary() +
-      ". Example JSON: {\"choice\":\"recovery\",\"confidence\":0.82}.";
-  JsonDocument requestDoc;
-  requestDoc["model"] = FOUNDRY_MODEL;
-  requestDoc["input"] = prompt;
-  requestDoc["max_output_tokens"] = FOUNDRY_MAX_OUTPUT_TOKENS;
-  requestDoc["reasoning"]["effort"] = "minimal";
-  requestDoc["text"]["format"]["type"] = "json_object";
-  requestDoc["text"]["verbosity"] = "low";
-  String body;
-  serializeJson(requestDoc, body);
-  requestDoc["max_output_tokens"] = FOUNDRY_RETRY_OUTPUT_TOKENS;
-  String retryBody;
-  serializeJson(requestDoc, retryBody);
   http.addHeader("Content-Type", "application/json");
   http.addHeader("api-key", FOUNDRY_API_KEY);
   http.setTimeout(FOUNDRY_HTTP_TIMEOUT_TIGHT_MS);
@@ -1195,17 +1501,36 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
   foundryDecisionStatus = "request_sent";
   Serial.println("Foundry request sent");
   unsigned long requestStartedMs = millis();
-  int statusCode = http.POST(body);
+  int statusCode = http.POST(body.bytes(), body.length());
   String responseBody = http.getString();
   if (statusCode == HTTPC_ERROR_READ_TIMEOUT) {
     Serial.println("Foundry read timeout, retrying once with longer timeout and smaller output budget");
     http.setTimeout(FOUNDRY_HTTP_TIMEOUT_RETRY_MS);
     foundryDecisionStatus = "request_timeout_retry";
-    statusCode = http.POST(retryBody);
+    // Same prompt, smaller output budget: only the tail after the prompt changes.
+    if (!appendFoundryBodyTail(body, job.promptEndLength, (unsigned)FOUNDRY_RETRY_OUTPUT_TOKENS)) {
+      // The first attempt still counts against the breaker as the timeout it was.
+      result.roundTripMs = millis() - requestStartedMs;
+      result.called = true;
+      result.breakerOutcome = LATENCY_BREAKER_TIMEOUT;
+      http.end();
+      foundryDecisionStatus = "prompt_overflow_local_fallback";
+      Serial.println("Foundry retry body overflowed, using local fallback plan");
+      return;
+    }
+    statusCode = http.POST(body.bytes(), body.length());
     responseBody = http.getString();
   }
+  result.roundTripMs = millis() - requestStartedMs;
+  result.called = true;
+  result.breakerOutcome = LATENCY_BREAKER_HTTP_ERROR;
+  if (statusCode == HTTPC_ERROR_READ_TIMEOUT) {
+    result.breakerOutcome = LATENCY_BREAKER_TIMEOUT;
+  } else if (statusCode >= 200 && statusCode < 300) {
+    result.breakerOutcome = LATENCY_BREAKER_OK;
+  }
   Serial.print("Foundry round-trip ms: ");
-  Serial.println(millis() - requestStartedMs);
+  Serial.println(result.roundTripMs);
   http.end();
   if (statusCode < 200 || statusCode >= 300) {
     foundryDecisionStatus = String("http_error_") + String(statusCode) + "_local_fallback";
@@ -1213,7 +1538,7 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
     Serial.println(statusCode);
     Serial.print("Foundry error body: ");
     Serial.println(responseBody);
-    return fallbackPlan;
+    return;
   }
   foundryResponseOk = true;
   JsonDocument responseDoc;
@@ -1222,7 +1547,7 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
     foundryDecisionStatus = "response_json_parse_error_local_fallback";
     Serial.print("Foundry response parse error: ");
     Serial.println(err.c_str());
-    return fallbackPlan;
+    return;
   }
   String modelText;
   if (!extractFoundryModelText(responseDoc, modelText)) {
@@ -1231,7 +1556,7 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
       Serial.println("Foundry response had no extractable model text, using local fallback plan");
       Serial.print("Foundry raw response body: ");
       Serial.println(responseBody);
-      return fallbackPlan;
+      return;
     }
     Serial.println("Recovered model text from raw response fallback");
   }
@@ -1242,20 +1567,22 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
   if (!parseChoiceFromJsonText(modelText, choice, confidence)) {
     foundryDecisionStatus = "choice_json_parse_error_local_fallback";
     Serial.println("Foundry choice parse failed, using local fallback plan");
-    return fallbackPlan;
+    return;
   }
   foundryPlanParsed = true;
   ManeuverPlan plan = fallbackPlan;
   if (choice == "strafe") {
-    plan = localStrafePlan;
+    plan = job.strafePlan;
   } else if (choice == "turn") {
-    plan = localTurnPlan;
+    plan = job.turnPlan;
   } else if (choice == "recovery") {
-    plan = localRecoveryPlan;
+    plan = job.recoveryPlan;
   }
   plan.confidence = confidence;
-  plan.repeatedTrap = repeatedTrap;
-  sanitizePlan(plan, fallbackPlan);
+  plan.repeatedTrap = job.repeatedTrap;
+  sanitizePlan(plan, fallbackPlan, job.frontDistanceCm);
+  result.plan = plan;
+  result.cacheable = true;
   foundryDecisionStatus = "choice_parsed_and_applied";
   flashDecisionDirectionLed(plan.primary);
   Serial.print("Foundry choice: ");
@@ -1266,9 +1593,126 @@ ManeuverPlan queryFoundryForNavigationPlan(const ManeuverPlan &fallbackPlan, boo
   Serial.print(maneuverTypeToString(plan.secondary));
   Serial.print(" conf=");
   Serial.println(plan.confidence, 2);
-  return plan;
 }
-// ─── Pan servo and sensor scanning ──────────────────────────────────────────────────
+
+// Applies a finished job's side effects on loop(): the breaker outcome, the
+// round-trip statistics, and the decision cache insert under the key snapshot
+// taken when the job was prepared.  planWillRun is false for a late result
+// whose plan is dropped, so its entry does not collect this plan's outcome.
+void applyFoundryJobResult(const FoundryJobResult &result, bool planWillRun) {
+  if (result.called) {
+    foundryBreaker.record(result.breakerOutcome, result.roundTripMs, millis());
+    decisionCache.recordFoundryCall(result.roundTripMs);
+  }
+  if (!result.cacheable) {
+    return;
+  }
+  int8_t slot = decisionCache.store(result.plan, result.cacheKey, millis());
+  if (planWillRun) {
+    decisionCache.setActive(slot);
+  }
+}
+// ─── Networking task (core 0) ──────────────────────────────────────────────────────────
+
+// Waits for Foundry jobs from loop() and answers each with a sanitized plan.
+// The job carries a snapshot of every loop-side input, and its breaker,
+// statistics and cache updates are applied by loop() when the result is taken,
+// so the task never touches distances, history or the decision cache.  The
+// Foundry status fields and foundryRequestPrompt belong to the task until then.
+void networkTaskMain(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    FoundryJob job;
+    if (!foundryJobMailbox.take(job)) {
+      continue;
+    }
+    int64_t startUs = esp_timer_get_time();
+    FoundryJobResult result;
+    runFoundryJob(job, result);
+    networkTaskStats.recordRun((uint32_t)(esp_timer_get_time() - startUs), false);
+    foundryResultMailbox.publish(result);
+  }
+}
+// True while the networking task is still running a job loop() gave up on.
+// Its late result is applied (breaker, statistics, cache) and its plan dropped
+// here.  Until it arrives the task still owns the Foundry status fields and
+// the request buffer, so loop() must not start another arbitration.
+bool foundryJobStillRunning() {
+  if (foundryJobAbandoned == 0) {
+    return false;
+  }
+  FoundryJobResult result;
+  if (!foundryResultMailbox.take(result) || result.sequence != foundryJobAbandoned) {
+    return true;
+  }
+  applyFoundryJobResult(result, false);
+  Serial.print("Foundry: dropped late result for job ");
+  Serial.println(result.sequence);
+  foundryJobAbandoned = 0;
+  return false;
+}
+// Hands a Foundry arbitration to the networking task and waits up to
+// FOUNDRY_JOB_DEADLINE_MS for its plan.  The motors are already stopped and
+// the safety task keeps sensing, so the wait only delays the decision, never
+// a stop.  Returns false with plan = localPlan when the deadline passes; the
+// job then keeps running and foundryJobStillRunning() drops its result.
+// Runs the job inline if the networking task did not start.
+bool requestFoundryPlan(const ManeuverPlan &localPlan, bool repeatedTrap, ManeuverPlan &plan) {
+  FoundryJob job;
+  job.sequence = ++foundryJobSequence;
+  if (!prepareFoundryJob(localPlan, repeatedTrap, job)) {
+    plan = localPlan;
+    return true;
+  }
+  FoundryJobResult result;
+  if (networkTaskHandle == nullptr) {
+    runFoundryJob(job, result);
+  } else {
+    foundryJobMailbox.publish(job);
+    xTaskNotifyGive(networkTaskHandle);
+    unsigned long startedMs = millis();
+    while (!foundryResultMailbox.take(result) || result.sequence != job.sequence) {
+      if (millis() - startedMs >= FOUNDRY_JOB_DEADLINE_MS) {
+        foundryJobAbandoned = job.sequence;
+        plan = localPlan;
+        return false;
+      }
+      delay(SAFETY_TASK_PERIOD_MS);
+    }
+  }
+  applyFoundryJobResult(result, true);
+  plan = result.plan;
+  return true;
+}
+// Prints per-task CPU load, the safety task's worst tick and deadline misses,
+// and the hazard-to-stop latency every RUNTIME_REPORT_INTERVAL_MS.
+void printRuntimeStats(unsigned long nowMs) {
+  if (lastRuntimeReportMs != 0 && nowMs - lastRuntimeReportMs < RUNTIME_REPORT_INTERVAL_MS) {
+    return;
+  }
+  lastRuntimeReportMs = nowMs;
+  int64_t nowUs = esp_timer_get_time();
+  Serial.printf("Runtime | safety core %d load=%.1f%% ticks=%lu worst_tick=%lu us misses=%lu | "
+                "network core %d load=%.1f%% jobs=%lu worst_job=%lu ms | "
+                "hazard->stop last=%.1f ms worst=%.1f ms stops=%lu\n",
+                (int)SAFETY_TASK_CORE, safetyTask.stats.takeLoadPercent(nowUs),
+                (unsigned long)safetyTask.stats.runs(), (unsigned long)safetyTask.stats.worstRunUs(),
+                (unsigned long)safetyTask.stats.deadlineMisses(), (int)NETWORK_TASK_CORE,
+                networkTaskStats.takeLoadPercent(nowUs), (unsigned long)networkTaskStats.runs(),
+                (unsigned long)(networkTaskStats.worstRunUs() / 1000UL),
+                hazardStopLatency.lastUs.load() / 1000.0f, hazardStopLatency.worstUs.load() / 1000.0f,
+                (unsigned long)hazardStopLatency.stops.load());
+}
+// ─── Pan servo and sensor scanning (safety task) ────────────────────────────────────
+
+// Steps of the L/R/C decision scan.  Each step moves the servo, waits PAN_SETTLE_MS
+// across safety ticks (never blocking the task), then takes one reading.
+enum DecisionScanStep {
+  DECISION_SCAN_IDLE = 0,
+  DECISION_SCAN_LEFT,
+  DECISION_SCAN_RIGHT,
+  DECISION_SCAN_CENTER,
+};
 
 // Moves the pan servo to the calibrated centre position and updates the
 // tracking variable.  No-ops if the servo did not attach at startup.
@@ -1279,58 +1723,76 @@ void movePanToCenter() {
   panCurrentDeg = PAN_CENTER_DEG;
   panServo.write(panCurrentDeg);
 }
-// Sweeps the pan servo to left, right, and centre positions in sequence,
-// waits PAN_SETTLE_MS after each move, then takes a distance reading.
-// Updates leftDistanceCm, frontDistanceCm (via EMA), and rightDistanceCm.
-// Called before every hazard decision to get a fresh L/F/R snapshot.
-void refreshHazardScanSnapshot() {
+// Non-blocking ultrasonic read: the first call triggers a measurement, later
+// calls return false until its echo (or the no-echo timeout) is in, then set
+// distanceCm (negative without an echo).  Without the echo engine this is one
+// blocking sensor.Ranging() call that always completes.
+bool pollUltrasonicCm(float &distanceCm) {
+  if (!echoRanger.ready()) {
+    distanceCm = sensor.Ranging();
+    return true;
+  }
+  if (!echoRanger.busy()) {
+    echoRanger.start();
+  }
+  unsigned long pulseWidthUs = 0;
+  return echoRanger.poll(distanceCm, pulseWidthUs);
+}
+// Starts a left, right, centre scan for loop()'s request number sequence.
+// Without a pan servo only the front reading is taken.
+void startDecisionScan(uint32_t sequence, unsigned long nowMs) {
+  // A routine reading still in flight was aimed wherever the sweep pointed; drop it.
+  echoRanger.cancel();
+  frontRangingPending = false;
+  decisionScanSequence = sequence;
+  decisionScanStepMs = nowMs;
   if (!panServoReady) {
-    float front = sensor.Ranging();
-    if (isValidDistance(front)) {
-      updateFrontDistanceEstimate(front, millis(), true);
-    } else {
-      frontDistanceCm = -1.0f;
-      frontFilteredCm = -1.0f;
-      frontFilterReady = false;
-    }
+    decisionScanStep = DECISION_SCAN_CENTER;
+    decisionScanStepMs = nowMs - PAN_SETTLE_MS;
     return;
   }
   panServo.write(PAN_LEFT_DEG);
   panCurrentDeg = PAN_LEFT_DEG;
-  delay(PAN_SETTLE_MS);
-  float left = sensor.Ranging();
-  if (isValidDistance(left)) {
-    leftDistanceCm = left;
-  } else {
-    leftDistanceCm = -1.0f;
-  }
-  panServo.write(PAN_RIGHT_DEG);
-  panCurrentDeg = PAN_RIGHT_DEG;
-  delay(PAN_SETTLE_MS);
-  float right = sensor.Ranging();
-  if (isValidDistance(right)) {
-    rightDistanceCm = right;
-  } else {
-    rightDistanceCm = -1.0f;
+  decisionScanStep = DECISION_SCAN_LEFT;
+}
+// Advances the decision scan by at most one reading.  Updates safetyLeftCm,
+// safetyFrontCm (EMA reset to the new reading) and safetyRightCm.
+// Returns true on the tick the scan completes.
+bool updateDecisionScan(unsigned long nowMs) {
+  if (nowMs - decisionScanStepMs < PAN_SETTLE_MS) {
+    return false;
   }
-  movePanToCenter();
-  delay(PAN_SETTLE_MS);
-  float front = sensor.Ranging();
-  if (isValidDistance(front)) {
-    updateFrontDistanceEstimate(front, millis(), true);
+  float reading = -1.0f;
+  if (!pollUltrasonicCm(reading)) {
+    return false;
+  }
+  if (decisionScanStep == DECISION_SCAN_LEFT) {
+    safetyLeftCm = isValidDistance(reading) ? reading : -1.0f;
+    panServo.write(PAN_RIGHT_DEG);
+    panCurrentDeg = PAN_RIGHT_DEG;
+    decisionScanStep = DECISION_SCAN_RIGHT;
+    decisionScanStepMs = nowMs;
+    return false;
+  }
+  if (decisionScanStep == DECISION_SCAN_RIGHT) {
+    safetyRightCm = isValidDistance(reading) ? reading : -1.0f;
+    movePanToCenter();
+    decisionScanStep = DECISION_SCAN_CENTER;
+    decisionScanStepMs = nowMs;
+    return false;
+  }
+  if (isValidDistance(reading)) {
+    updateFrontDistanceEstimate(reading, nowMs, true);
   } else {
-    frontDistanceCm = -1.0f;
+    safetyFrontCm = -1.0f;
     frontFilteredCm = -1.0f;
     frontFilterReady = false;
   }
   panSweepTowardLeft = true;
-  lastPanStepMs = millis();
-  Serial.print("Decision scan L/F/R: ");
-  Serial.print(leftDistanceCm, 1);
-  Serial.print("/");
-  Serial.print(frontDistanceCm, 1);
-  Serial.print("/");
-  Serial.println(rightDistanceCm, 1);
+  lastPanStepMs = nowMs;
+  decisionScanStep = DECISION_SCAN_IDLE;
+  decisionScanCompleted = decisionScanSequence;
+  return true;
 }
 // Advances the pan servo one PAN_STEP_DEG in the current sweep direction
 // during normal forward driving (background scanning between hazard events).
@@ -1359,65 +1821,73 @@ void updatePanSweep(unsigned long nowMs) {
   }
   panServo.write(panCurrentDeg);
 }
-// ─── Main hazard detection loop (called every iteration from loop()) ────────────
+// ─── Hazard detection (safety task) ───────────────────────────────────────────────
 
 // Polls the ultrasonic sensor, applies the EMA filter to the front reading, and
-// updates the obstacleNearby flag using hysteresis and streak counters:
-//   - nearObstacleStreak: latches obstacleNearby after NEAR_OBSTACLE_CONFIRM_STREAK
+// updates the safetyObstacleNearby latch using hysteresis and streak counters:
+//   - nearObstacleStreak: latches the hazard after NEAR_OBSTACLE_CONFIRM_STREAK
 //     consecutive close readings; clears it when front exceeds ULTRASONIC_CLEAR_CM.
 //   - frontBlindStreak: escalates to hazard after FRONT_BLIND_STREAK_THRESHOLD
 //     consecutive stale/invalid front readings.
-//   - allUnknownStreak: forces obstacleNearby when all three distances are
+//   - allUnknownStreak: forces the hazard when all three distances are
 //     persistently invalid (complete sensor blind state).
-void updateScanAndHazard() {
-  unsigned long nowMs = millis();
-  if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
-    return;
+// Also tracks safetyHazardOnsetUs for the hazard-to-stop latency.
+// A reading is triggered at most every SENSOR_INTERVAL_MS and evaluated on the
+// tick its echo arrives; returns true on that tick.
+bool updateScanAndHazard(unsigned long nowMs) {
+  if (!frontRangingPending) {
+    if (nowMs - lastSensorMs < SENSOR_INTERVAL_MS) {
+      return false;
+    }
+    lastSensorMs = nowMs;
+    frontRangingPending = true;
+    frontRetryUsed = false;
   }
-  lastSensorMs = nowMs;
-  float distanceCm = sensor.Ranging();
+  float distanceCm = -1.0f;
+  if (!pollUltrasonicCm(distanceCm)) {
+    return false;
+  }
+  int64_t readingUs = esp_timer_get_time();
   if (isValidDistance(distanceCm)) {
     updateFrontDistanceEstimate(distanceCm, nowMs, false);
   }
   bool frontFresh = (frontUpdatedMs != 0 && (nowMs - frontUpdatedMs) <= FRONT_STALE_MS);
-  if (!frontFresh) {
+  if (!frontFresh && !frontRetryUsed) {
     // One immediate retry reduces false "hazard" triggers from occasional echo dropouts.
-    float retryFrontCm = sensor.Ranging();
-    if (isValidDistance(retryFrontCm)) {
-      updateFrontDistanceEstimate(retryFrontCm, nowMs, false);
-      frontFresh = true;
-    }
+    frontRetryUsed = true;
+    return false;
   }
-  if (frontFresh && isValidDistance(frontDistanceCm)) {
-    if (frontDistanceCm >= OPEN_SPACE_DISTANCE_CM) {
+  frontRangingPending = false;
+  if (frontFresh && isValidDistance(safetyFrontCm)) {
+    if (safetyFrontCm >= OPEN_SPACE_DISTANCE_CM) {
       lastOpenSpaceSeenMs = nowMs;
     }
     frontBlindStreak = 0;
-    if (frontDistanceCm <= ULTRASONIC_ALERT_CM) {
+    if (safetyFrontCm <= ULTRASONIC_ALERT_CM) {
       if (nearObstacleStreak < 255) {
         nearObstacleStreak++;
       }
     } else {
       nearObstacleStreak = 0;
     }
-    if (obstacleNearby) {
-      obstacleNearby = (frontDistanceCm <= ULTRASONIC_CLEAR_CM) || (nearObstacleStreak > 0);
+    if (safetyObstacleNearby) {
+      safetyObstacleNearby = (safetyFrontCm <= ULTRASONIC_CLEAR_CM) || (nearObstacleStreak > 0);
     } else {
-      obstacleNearby = (nearObstacleStreak >= NEAR_OBSTACLE_CONFIRM_STREAK);
+      safetyObstacleNearby = (nearObstacleStreak >= NEAR_OBSTACLE_CONFIRM_STREAK);
     }
   } else {
     nearObstacleStreak = 0;
     if (lastOpenSpaceSeenMs != 0 && (nowMs - lastOpenSpaceSeenMs) <= OPEN_SPACE_HOLD_MS) {
       frontBlindStreak = 0;
-      obstacleNearby = false;
+      safetyObstacleNearby = false;
     } else {
       if (frontBlindStreak < 255) {
         frontBlindStreak++;
       }
-      obstacleNearby = (frontBlindStreak >= FRONT_BLIND_STREAK_THRESHOLD);
+      safetyObstacleNearby = (frontBlindStreak >= FRONT_BLIND_STREAK_THRESHOLD);
     }
   }
-  if (allDistancesUnknown()) {
+  if (safetyDistancesUnknown()) {
     if (allUnknownStreak < 255) {
       allUnknownStreak++;
     }
@@ -1425,7 +1895,101 @@ void updateScanAndHazard() {
     allUnknownStreak = 0;
   }
   if (allUnknownStreak >= ALL_UNKNOWN_STREAK_THRESHOLD) {
-    obstacleNearby = true;
+    safetyObstacleNearby = true;
+  }
+  // The hazard "starts" at the first reading of the streak that eventually latches it.
+  bool hazardBuilding = nearObstacleStreak > 0 || frontBlindStreak > 0 || allUnknownStreak > 0;
+  if (!hazardBuilding && !safetyObstacleNearby) {
+    safetyHazardOnsetUs = 0;
+  } else if (safetyHazardOnsetUs == 0) {
+    safetyHazardOnsetUs = readingUs;
+  }
+  return true;
+}
+// ─── Safety task ────────────────────────────────────────────────────────────────────
+
+// Drives the motors from loop()'s latest MotionCommand, replacing Forward with
+// Stop while a hazard is latched.  A stop forced by the hazard is timed from
+// safetyHazardOnsetUs.  The motors are only written when the output changes.
+void applyMotionCommand() {
+  int direction = safetyMotionCommand.direction;
+  int speed = safetyMotionCommand.speed;
+  if (direction == Forward && safetyObstacleNearby) {
+    direction = Stop;
+    speed = 0;
+  }
+  if (direction == appliedMotorDirection && speed == appliedMotorSpeed) {
+    return;
+  }
+  bool hazardStop = appliedMotorDirection == Forward && direction == Stop && safetyObstacleNearby;
+  myCar.Move(direction, speed);
+  if (hazardStop && safetyHazardOnsetUs != 0) {
+    hazardStopLatency.record(safetyHazardOnsetUs, esp_timer_get_time());
+  }
+  appliedMotorDirection = direction;
+  appliedMotorSpeed = speed;
+}
+// One SAFETY_TASK_PERIOD_MS tick: pick up motion and scan requests, take at most
+// one reading (decision scan step or routine front poll), apply the motors, and
+// publish a snapshot whenever a reading changed the state.
+void safetyTaskTick() {
+  unsigned long nowMs = millis();
+  MotionCommand command;
+  if (motionCommandMailbox.take(command)) {
+    safetyMotionCommand = command;
+  }
+  uint32_t scanRequest = 0;
+  if (decisionScanMailbox.take(scanRequest)) {
+    startDecisionScan(scanRequest, nowMs);
+  }
+  bool scanCompleted = false;
+  bool stateChanged = false;
+  if (decisionScanStep != DECISION_SCAN_IDLE) {
+    scanCompleted = updateDecisionScan(nowMs);
+    stateChanged = scanCompleted;
+  } else {
+    stateChanged = updateScanAndHazard(nowMs);
+  }
+  applyMotionCommand();
+  if (stateChanged) {
+    SafetySnapshot snapshot;
+    snapshot.leftCm = safetyLeftCm;
+    snapshot.frontCm = safetyFrontCm;
+    snapshot.rightCm = safetyRightCm;
+    snapshot.obstacleNearby = safetyObstacleNearby;
+    snapshot.sensorBlind = allUnknownStreak >= ALL_UNKNOWN_STREAK_THRESHOLD;
+    snapshot.scanSequence = decisionScanCompleted;
+    snapshot.fromDecisionScan = scanCompleted;
+    safetySnapshotMailbox.publish(snapshot);
+  }
+}
+// ─── Safety task interface (loop side) ───────────────────────────────────────────────
+
+// Asks the safety task to drive the motors; see applyMotionCommand() for the veto.
+void commandMotion(int direction, int speed) {
+  MotionCommand command = {direction, speed};
+  motionCommandMailbox.publish(command);
+}
+// Copies the newest safety snapshot into the loop-side distance and hazard
+// variables and prints it.  Returns false when nothing new was published.
+bool applySafetySnapshot() {
+  SafetySnapshot snapshot;
+  if (!safetySnapshotMailbox.take(snapshot)) {
+    return false;
+  }
+  leftDistanceCm = snapshot.leftCm;
+  frontDistanceCm = snapshot.frontCm;
+  rightDistanceCm = snapshot.rightCm;
+  obstacleNearby = snapshot.obstacleNearby;
+  decisionScanApplied = snapshot.scanSequence;
+  if (snapshot.fromDecisionScan) {
+    Serial.print("Decision scan L/F/R: ");
+    Serial.print(leftDistanceCm, 1);
+    Serial.print("/");
+    Serial.print(frontDistanceCm, 1);
+    Serial.print("/");
+    Serial.println(rightDistanceCm, 1);
+    return true;
   }
   Serial.print("Scan L/F/R: ");
   Serial.print(leftDistanceCm, 1);
@@ -1435,9 +1999,26 @@ void updateScanAndHazard() {
   Serial.print(rightDistanceCm, 1);
   Serial.print(" cm | hazard: ");
   Serial.println(obstacleNearby ? "YES" : "NO");
-  if (allUnknownStreak >= ALL_UNKNOWN_STREAK_THRESHOLD) {
+  if (snapshot.sensorBlind) {
     Serial.println("Sensor blind state detected: forcing decision cycle");
   }
+  return true;
+}
+// Has the safety task take a fresh L/F/R snapshot (servo to left, right and centre,
+// PAN_SETTLE_MS before each reading) and waits for it.  Called before every hazard
+// decision and for RESCAN maneuvers, always with the motors stopped.
+void refreshHazardScanSnapshot() {
+  uint32_t sequence = ++decisionScanRequested;
+  decisionScanMailbox.publish(sequence);
+  unsigned long startMs = millis();
+  while (decisionScanApplied != sequence) {
+    if (millis() - startMs >= DECISION_SCAN_TIMEOUT_MS) {
+      Serial.println("Decision scan timed out: keeping previous L/F/R");
+      return;
+    }
+    delay(SAFETY_TASK_PERIOD_MS);
+    applySafetySnapshot();
+  }
 }
 // ─── Hazard burst escalation ───────────────────────────────────────────────────────────
 
@@ -1479,64 +2060,106 @@ int computeManeuverSpeed(const ManeuverPlan &plan) {
   }
   return speed;
 }
-// Executes a single atomic maneuver: drives the robot for durationMs at speed,
-// then stops the motors.  RESCAN maneuvers pause the motors and call
-// refreshHazardScanSnapshot() to update L/F/R readings mid-plan.
-void executeManeuver(ManeuverType maneuver, uint16_t durationMs, int speed) {
+// Maps a maneuver to an executor segment.  Strafes may end early once the
+// front is clear and abort on a new close obstacle; backing up moves away from
+// the front reading, so it may only end early.  A 90-degree turn reads clear
+// partway round but must finish to reach the new heading, so it may only
+// abort.  Pauses and RESCAN always run their full time.
+ManeuverSegment maneuverSegment(ManeuverType maneuver, uint16_t durationMs, int speed) {
+  uint8_t tag = (uint8_t)maneuver;
   switch (maneuver) {
     case MANEUVER_STRAFE_LEFT:
-      myCar.Move(Move_Left, speed);
-      delay(durationMs);
-      break;
+      return {Move_Left, speed, durationMs, true, true, tag};
     case MANEUVER_STRAFE_RIGHT:
-      myCar.Move(Move_Right, speed);
-      delay(durationMs);
-      break;
+      return {Move_Right, speed, durationMs, true, true, tag};
     case MANEUVER_BACKWARD:
-      myCar.Move(Backward, speed);
-      delay(durationMs);
-      break;
+      return {Backward, speed, durationMs, true, false, tag};
     case MANEUVER_TURN_LEFT_90:
-      myCar.Move(Contrarotate, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Contrarotate, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_TURN_RIGHT_90:
-      myCar.Move(Clockwise, speed);
-      delay(TURN_90_DURATION_MS);
-      break;
+      return {Clockwise, speed, (uint16_t)TURN_90_DURATION_MS, false, true, tag};
     case MANEUVER_RESCAN:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs);
-      refreshHazardScanSnapshot();
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? RESCAN_PAUSE_MS : durationMs), false, false, tag};
     default:
-      myCar.Move(Stop, 0);
-      delay(durationMs == 0 ? 180 : durationMs);
-      break;
+      return {Stop, 0, (uint16_t)(durationMs == 0 ? 180 : durationMs), false, false, tag};
   }
-  myCar.Move(Stop, 0);
 }
-// Executes both the primary and secondary maneuvers in the plan at the
-// computed speed, records each to the recent-plans ring buffer, and updates
-// lastNonStopDecision for future tie-breaking.
-void executePlan(const ManeuverPlan &plan) {
+// Queues the primary and secondary maneuvers of the plan at the computed
+// speed, starts them, and updates lastNonStopDecision for future
+// tie-breaking.  loop() advances the plan and calls finishPlanExecution()
+// once it has ended.
+void startPlanExecution(const ManeuverPlan &plan) {
   int maneuverSpeed = computeManeuverSpeed(plan);
-  executeManeuver(plan.primary, plan.primaryDurationMs, maneuverSpeed);
-  rememberPlan(plan.primary);
+  maneuverExecutor.queue(maneuverSegment(plan.primary, plan.primaryDurationMs, maneuverSpeed));
   if (plan.secondary != MANEUVER_STOP) {
-    executeManeuver(plan.secondary, plan.secondaryDurationMs, maneuverSpeed);
-    rememberPlan(plan.secondary);
+    maneuverExecutor.queue(maneuverSegment(plan.secondary, plan.secondaryDurationMs, maneuverSpeed));
   }
   if (plan.primary == MANEUVER_STRAFE_LEFT || plan.primary == MANEUVER_TURN_LEFT_90) {
     lastNonStopDecision = ACTION_LEFT;
   } else if (plan.primary == MANEUVER_STRAFE_RIGHT || plan.primary == MANEUVER_TURN_RIGHT_90) {
     lastNonStopDecision = ACTION_RIGHT;
   }
+  maneuverExecutor.start(millis());
+}
+// Executor hook: hands a segment's motion to the safety task.
+void driveManeuverSegment(int direction, int speed) {
+  commandMotion(direction, speed);
+}
+// Executor hook: stops the motors at the end of a segment.
+void stopManeuverSegment() {
+  commandMotion(Stop, 0);
+}
+// Executor hook: front distance from the next safety-task snapshot, or -1
+// when no new snapshot has arrived (the safety task owns the sensor).
+float sampleManeuverFrontCm() {
+  if (!applySafetySnapshot() || !isValidDistance(frontDistanceCm)) {
+    return -1.0f;
+  }
+  return frontDistanceCm;
+}
+// Executor hook: records each maneuver that ran to the recent-plans ring
+// buffer, reports early ends, and refreshes the L/F/R readings after RESCAN.
+void onManeuverSegmentEnded(const ManeuverSegment &segment, ManeuverEnd end) {
+  ManeuverType maneuver = (ManeuverType)segment.tag;
+  rememberPlan(maneuver);
+  if (end != MANEUVER_END_COMPLETED) {
+    Serial.print("Maneuver ");
+    Serial.print(maneuverTypeToString(maneuver));
+    Serial.print(" ended early: ");
+    Serial.println(maneuverEndString(end));
+  }
+  if (maneuver == MANEUVER_RESCAN) {
+    refreshHazardScanSnapshot();
+  }
+}
+// Re-scans once the plan has ended, records the front-clearance delta for
+// outcome feedback, and prints the cache, breaker and maneuver statistics.
+void finishPlanExecution() {
+  refreshHazardScanSnapshot();
+  lastPlanFrontAfterCm = frontDistanceCm;
+  if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
+    float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
+    if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = 1;
+    } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
+      lastPlanOutcome = -1;
+    } else {
+      lastPlanOutcome = 0;
+    }
+  } else {
+    lastPlanOutcome = 0;
+  }
+  decisionCache.noteOutcome(lastPlanOutcome, millis());
+  decisionCache.saveIfDirty(millis());
+  decisionCache.printStats(Serial);
+  foundryBreaker.printStats(Serial);
+  maneuverExecutor.printStats(Serial);
 }
 // ─── Arduino entry points ────────────────────────────────────────────────────────────────
 
 // Initialises hardware peripherals (Serial, GPIO, chassis, sensor, pan servo),
-// connects to WiFi, and prints a pan-servo calibration report to Serial.
+// connects to WiFi, prints a pan-servo calibration report to Serial, and starts
+// the networking task (core 0) and the safety task (core 1).
 void setup() {
   Serial.begin(115200);
   pinMode(LEFT_LED_PIN, OUTPUT);
@@ -1544,6 +2167,9 @@ void setup() {
   setBothLeds(false);
   myCar.Init();
   sensor.Init(TRIG_PIN, ECHO_PIN);
+  if (!echoRanger.begin(TRIG_PIN, ECHO_PIN)) {
+    Serial.println("Echo timer not started: ultrasonic readings stay blocking");
+  }
   panServo.setPeriodHertz(50);
   panServo.attach(ULTRASONIC_PAN_PIN, 500, 2500);
   panServoReady = panServo.attached();
@@ -1558,14 +2184,31 @@ void setup() {
   Serial.print("/");
   Serial.println(PAN_RIGHT_DEG);
   delay(250);
+  decisionCache.begin(DECISION_CACHE_CONFIG);
+  foundryBreaker.setLog(&Serial);
+  maneuverExecutor.begin({driveManeuverSegment, stopManeuverSegment, sampleManeuverFrontCm, onManeuverSegmentEnded},
+                         MANEUVER_EXECUTOR_CONFIG);
   connectWiFi();
+  if (xTaskCreatePinnedToCore(networkTaskMain, "Network", NETWORK_TASK_STACK_BYTES, nullptr, NETWORK_TASK_PRIORITY,
+                              &networkTaskHandle, NETWORK_TASK_CORE) != pdPASS) {
+    networkTaskHandle = nullptr;
+    Serial.println("Networking task not started: Foundry calls run inline in loop()");
+  }
+  if (!startRoverPeriodicTask(safetyTask, SAFETY_TASK_STACK_BYTES, SAFETY_TASK_PRIORITY, SAFETY_TASK_CORE)) {
+    // Without the safety task nothing reads the sensor or drives the motors.
+    Serial.println("Safety task not started: halting");
+    while (true) {
+      delay(1000);
+    }
+  }
   Serial.println("Azure AI Foundry-assisted navigation planner enabled");
 }
 // Main control loop executed repeatedly by the Arduino runtime.
 //
 // Normal operation (no obstacle):
-//   - Calls updateScanAndHazard() each iteration to poll the sensor.
-//   - Drives the car forward at FORWARD_SPEED.
+//   - Applies the latest safety-task snapshot (the safety task polls the sensor
+//     and stops the motors on its own when a hazard latches).
+//   - Requests forward motion at FORWARD_SPEED.
 //
 // Hazard response (obstacle detected OR cooldown expired):
 //   1. Stops the car.
@@ -1575,14 +2218,23 @@ void setup() {
 //        a. Immediate forced plans for edge cases (blind sensor, head-on wall,
 //           emergency close obstacle, hazard burst).
 //        b. Local planner scores candidates; if "obvious", skips Foundry.
-//        c. Otherwise posts to Azure AI Foundry and uses the LLM's choice.
-//   5. Executes the chosen plan.
+//        c. Otherwise hands the request to the networking task and uses the LLM's choice.
+//   5. Starts the chosen plan; later passes service it until it ends.
 //   6. Re-scans and records the front-clearance delta for outcome feedback.
 void loop() {
-  updateScanAndHazard();
+  // A running plan owns the motors; each pass advances it by one slice.
+  if (maneuverExecutor.active()) {
+    if (maneuverExecutor.service(millis())) {
+      printRuntimeStats(millis());
+      delay(5);
+      return;
+    }
+    finishPlanExecution();
+  }
+  applySafetySnapshot();
   unsigned long nowMs = millis();
   if (obstacleNearby && (!previousObstacleNearby || (nowMs - lastHazardDecisionMs) >= HAZARD_DECISION_COOLDOWN_MS)) {
-    myCar.Move(Stop, 0);
+    commandMotion(Stop, 0);
     Serial.println("Hazard detected: STOP -> SCAN -> DECIDE");
     delay(DECISION_STOP_PAUSE_MS);
     refreshHazardScanSnapshot();
@@ -1628,26 +2280,42 @@ void loop() {
       Serial.println("Burst hazard escalation: local forced plan");
     } else {
       ManeuverPlan localPlan = chooseLocalPlan(repeatedTrap);
-      if (shouldBypassFoundry(localPlan, repeatedTrap)) {
+      ManeuverPlan bypassPlan;
+      if (foundryJobStillRunning()) {
         plan = localPlan;
-        decisionSource = "local_obvious_bypass";
+        decisionSource = "foundry_busy_local_fallback";
+        Serial.println("Decision path: earlier Foundry job still running, local plan");
+      } else if (shouldBypassFoundry(localPlan, repeatedTrap, bypassPlan)) {
+        plan = bypassPlan;
+        decisionSource = foundryDecisionStatus;
         foundryRequestSent = false;
         foundryResponseOk = false;
         foundryPlanParsed = false;
-        foundryDecisionStatus = decisionSource;
-        Serial.println("Decision path: local obvious answer, Foundry bypassed");
+        if (decisionSource == "decision_cache_hit") {
+          Serial.println("Decision path: decision cache hit, Foundry bypassed");
+        } else if (decisionSource == "circuit_open_local_fallback") {
+          Serial.println("Decision path: Foundry circuit open, local plan");
+        } else {
+          Serial.println("Decision path: local obvious answer, Foundry bypassed");
+        }
       } else {
         Serial.println("Decision path: ambiguous/trap state, Foundry arbitration");
-        plan = queryFoundryForNavigationPlan(localPlan, repeatedTrap);
-        decisionSource = foundryDecisionStatus;
-        Serial.print("Decision telemetry: status=");
-        Serial.print(foundryDecisionStatus);
-        Serial.print(", requestSent=");
-        Serial.print(foundryRequestSent ? "true" : "false");
-        Serial.print(", responseOk=");
-        Serial.print(foundryResponseOk ? "true" : "false");
-        Serial.print(", planParsed=");
-        Serial.println(foundryPlanParsed ? "true" : "false");
+        if (!requestFoundryPlan(localPlan, repeatedTrap, plan)) {
+          decisionSource = "foundry_deadline_local_fallback";
+          Serial.print("Foundry: no plan within ");
+          Serial.print(FOUNDRY_JOB_DEADLINE_MS);
+          Serial.println(" ms, using local plan");
+        } else {
+          decisionSource = foundryDecisionStatus;
+          Serial.print("Decision telemetry: status=");
+          Serial.print(foundryDecisionStatus);
+          Serial.print(", requestSent=");
+          Serial.print(foundryRequestSent ? "true" : "false");
+          Serial.print(", responseOk=");
+          Serial.print(foundryResponseOk ? "true" : "false");
+          Serial.print(", planParsed=");
+          Serial.println(foundryPlanParsed ? "true" : "false");
+        }
       }
     }
     Serial.print("Executing plan source=");
@@ -1657,21 +2325,7 @@ void loop() {
     Serial.print(" secondary=");
     Serial.println(maneuverTypeToString(plan.secondary));
     lastPlanFrontBeforeCm = frontDistanceCm;
-    executePlan(plan);
-    refreshHazardScanSnapshot();
-    lastPlanFrontAfterCm = frontDistanceCm;
-    if (isValidDistance(lastPlanFrontBeforeCm) && isValidDistance(lastPlanFrontAfterCm)) {
-      float gain = lastPlanFrontAfterCm - lastPlanFrontBeforeCm;
-      if (gain >= PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = 1;
-      } else if (gain <= -PLAN_IMPROVEMENT_MARGIN_CM) {
-        lastPlanOutcome = -1;
-      } else {
-        lastPlanOutcome = 0;
-      }
-    } else {
-      lastPlanOutcome = 0;
-    }
+    startPlanExecution(plan);
     lastHazardDecisionMs = nowMs;
   }
   if (!obstacleNearby) {
@@ -1686,10 +2340,13 @@ void loop() {
     hazardClearSinceMs = 0;
   }
   previousObstacleNearby = obstacleNearby;
-  if (obstacleNearby) {
-    myCar.Move(Stop, 0);
+  if (maneuverExecutor.active()) {
+    // The plan just started keeps the motors until it ends.
+  } else if (obstacleNearby) {
+    commandMotion(Stop, 0);
   } else {
-    myCar.Move(Forward, FORWARD_SPEED);
+    commandMotion(Forward, FORWARD_SPEED);
   }
+  printRuntimeStats(nowMs);
   delay(20);
 }
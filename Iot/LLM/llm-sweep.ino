@@ -7,19 +7,137 @@
 // - Stop immediately when hazards are detected and choose a bounded escape maneuver.
 // - Optionally ask Gemini for a turn decision only when the local data is fresh but ambiguous.
 // - Fall back to fully local safety logic whenever Wi-Fi, sensor quality, or response timing is not good enough.
+//
+// Simulation:
+// - All sensor, motor, servo, and clock access goes through the rover* HAL functions.
+// - Set ROVER_SIMULATION to 1 to run the unchanged navigation loop on a bare ESP32 against a
+//   simulated room (ray-cast ultrasonic, differential-drive kinematics) on a virtual clock.
+//   The run is far faster than real time and reports loop latency, distance, and collisions over Serial.
+// - host/ builds the same simulation (and trace replay) as a Linux program against small shims of the
+//   Arduino, FreeRTOS, and LittleFS APIs; `make -C host check` runs the room and replays its trace, and
+//   fails on extra collisions or any divergence, so navigation changes can be regression-tested off the car.
+//
+// Trace record/replay:
+// - Ranging results, directional readings, pan angles, motor commands, decisions, and Gemini replies are
+//   recorded as 16-byte binary records into a RAM ring that a background task appends to LittleFS.
+// - Send 'S' over Serial for recorder stats, 'T' / 'P' to hex-dump the current / previous run's trace
+//   (decode the captured log with trace-decode.py).
+// - Set ROVER_TRACE_REPLAY to 1 to feed the recorded trace back through the navigation loop and report
+//   where its pan, motor, reading, and decision outputs diverge from the recording.
+//
+// Ranging:
+// - With ULTRASONIC_ASYNC_RANGING the loop only triggers the HC-SR04; an echo-pin interrupt (ultrasonic_echo.h) timestamps
+//   both edges and queues the pulse width, so no loop pass ever waits for an echo. Samples per second
+//   and loop-time jitter are printed every few seconds ("Ranging |"), in either mode, for comparison.
+//
+// Scheduling:
+// - loop() runs registered periodic jobs through control_scheduler.h, each with its own period and
+//   deadline: the control pipeline's safety, sensing, sweep, and decision stages, the buzzer, Serial
+//   commands, and (on the rover) the reports. Execution time, release-to-start lateness, and
+//   deadline-miss counts per job are printed as "Sched |" lines every 30 s and on 'S'.
+// - Simulation and replay run the same jobs against the virtual clock, which ranging moves forward
+//   while a stage runs, so a slow sweep stage makes the decision stage late exactly as on the rover.
+//
+// Decision racing:
+// - The worker builds one prompt and decision_broker.h sends it to Gemini and, when OLLAMA_URL is set,
+//   a local Ollama server at the same time. The first answer naming a safe action wins; the other
+//   request is aborted at its next socket read. "Race |" lines give each backend's win rate and p50/p95
+//   latency, and a backend that keeps losing while slower than the fastest one is demoted to occasional
+//   probe races.
+// - Each backend also has a latency-budget circuit breaker (latency_breaker.h). Too many timeouts or
+//   HTTP errors, or a p95 over budget, opens it: the backend sits out races, and with every circuit
+//   open the gate goes local-only. After a cool-down one half-open probe decides whether it closes.
+//   Transitions print as "Breaker |" lines; 'S' adds each breaker's state, refused calls and time saved.
+// Logging:
+// - Per-sample lines (ranging, radar snapshots, motor requests, braking) go through rover_log.h: the
+//   control step stores a format id and raw arguments in a RAM ring, and a low-priority task formats
+//   and prints them. If the ring fills, lines are dropped and counted instead of stalling the loop.
+//   'S' also prints "Log |" written/drained/dropped counts.
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
-#include <HTTPClient.h>
 #include <esp_heap_caps.h>
+#include <LittleFS.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include <atomic>
 #include <ultrasonic.h>
 #include <vehicle.h>
+#include "control_scheduler.h"
+#include "decision_broker.h"
 #include "gemini_config.h"
+#include "latency_breaker.h"
+#include "ollama_stream.h"
+#include "ultrasonic_echo.h"
 #include "wifi_config.h"
 
+// 0 = drive the real rover, 1 = run the navigation loop against the simulated world below.
+// host/Makefile sets this (or ROVER_TRACE_REPLAY) on the command line for the Linux build.
+#ifndef ROVER_SIMULATION
+#define ROVER_SIMULATION 0
+#endif
+// In simulation, navigation logging is dropped unless this is 1; printing every sample would
+// throttle the run to UART speed. Simulation reports always go out on the real Serial port.
+#define SIM_VERBOSE_LOG 0
+// 1 = record the binary trace to flash during normal and simulated runs.
+#define ROVER_TRACE_RECORD 1
+// 1 = replay TRACE_REPLAY_FILE_PATH through the navigation loop instead of driving hardware.
+#ifndef ROVER_TRACE_REPLAY
+#define ROVER_TRACE_REPLAY 0
+#endif
+#define ROVER_VIRTUAL_HARDWARE (ROVER_SIMULATION || ROVER_TRACE_REPLAY)
+// 1 = interrupt-timed ultrasonic echoes (loop never blocks), 0 = the library's blocking sensor.Ranging().
+// Simulation and replay always use the blocking path, which completes on the virtual clock.
+#define ULTRASONIC_ASYNC_RANGING 1
+#if ROVER_SIMULATION && ROVER_TRACE_REPLAY
+#error "ROVER_SIMULATION and ROVER_TRACE_REPLAY are mutually exclusive"
+#endif
+// Hot-path log lines: queued by rover_log.h and printed by its drain task, so the control
+// step never waits on the UART. Set ROVER_LOG_COMPACT 1 and decode with log-decode.py for
+// the shortest serial output.
+#define ROVER_LOG_LEVEL ROVER_LOG_LEVEL_INFO
+#define ROVER_LOG_COMPACT 0
+#define ROVER_LOG_FORMATS(X)                                                                          \
+  X(LOG_ULTRASONIC_RANGE, "Ultrasonic: %.2f cm | pulseWidthUs=%lu")                                  \
+  X(LOG_ULTRASONIC_NO_ECHO, "Ultrasonic: no echo | pulseWidthUs=%lu")                                \
+  X(LOG_RADAR_SNAPSHOT, "Radar snapshot: left=%.2fcm right=%.2fcm best=%s gap=%ddeg/%udeg")          \
+  X(LOG_APPLY_REQUEST, "Applying request: %s | drive mode: %s")                                     \
+  X(LOG_APPLY_STEERING_REQUEST, "Applying steering request: %s | drive mode: %s")                   \
+  X(LOG_STOPPING_BRAKE,                                                                               \
+    "Stopping-distance brake: front=%.2fcm closing=%.2fcm/s stopDist=%.2fcm available=%.2fcm ttc=%.2fms" \
+    " -> emergency reverse")
+#include "rover_log.h"
+
+#if ROVER_VIRTUAL_HARDWARE
+class RoverSimConsole : public Print {
+ public:
+  void begin(unsigned long baud) {
+    Serial.begin(baud);
+  }
+  size_t write(uint8_t c) override {
+    return SIM_VERBOSE_LOG ? Serial.write(c) : 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return SIM_VERBOSE_LOG ? Serial.write(buffer, size) : size;
+  }
+  int available() {
+    return Serial.available();
+  }
+  int read() {
+    return Serial.read();
+  }
+};
+RoverSimConsole roverSimConsole;
+Print &roverReportSerial = Serial;
+#ifdef Serial
+#undef Serial
+#endif
+#define Serial roverSimConsole
+#else
+Print &roverReportSerial = Serial;
+#endif
+
 // Hardware abstractions for the ultrasonic sensor, motor chassis, and panning servo.
 ultrasonic sensor;
 vehicle robot;
@@ -46,11 +164,24 @@ enum DriveMode {
   DRIVE_PIVOT_RIGHT,
 };
 
+// Contiguous run of fresh polar-histogram bins that are all at least a clearance threshold away.
+// score sums the age-decayed confidence of the bins, so a wide, recently seen opening ranks first.
+struct RadarGap {
+  bool found;
+  uint8_t startDeg;
+  uint8_t endDeg;
+  uint8_t centerDeg;
+  uint8_t widthDeg;
+  float minClearanceCm;
+  float score;
+};
+
 // Snapshot of the latest left/right scan so escape logic can compare which side is more open.
 struct SideScanResult {
   float leftDistanceCm;
   float rightDistanceCm;
   Action bestAction;
+  RadarGap widestGap;
 };
 
 // Aggregated sensor state used by both local recovery logic and Gemini prompts.
@@ -95,6 +226,39 @@ struct DirectionalReading {
   bool valid;
 };
 
+// Ranging throughput and control-loop timing over one report window (real hardware only).
+struct RangingLoopStats {
+  uint32_t samples;
+  uint32_t noEchoSamples;
+  uint32_t loops;
+  uint64_t loopTotalUs;
+  uint64_t loopSquaredUs;
+  uint32_t loopMinUs;
+  uint32_t loopMaxUs;
+  unsigned long windowStartMs;
+};
+
+// One 5-degree slice of the polar occupancy histogram. updatedMs == 0 means never seen (or cleared).
+struct RadarBin {
+  float distanceCm;
+  unsigned long updatedMs;
+  uint8_t confidence;
+};
+
+// Pan sectors the navigation logic reasons about; each maps to a fixed range of histogram bins.
+enum RadarSector {
+  RADAR_SECTOR_RIGHT = 0,
+  RADAR_SECTOR_FRONT,
+  RADAR_SECTOR_LEFT,
+};
+
+// What one sector currently shows: its nearest fresh bin, and when the sector was last updated.
+struct RadarSectorReading {
+  float distanceCm;
+  unsigned long updatedMs;
+  uint8_t confidence;
+};
+
 // Historical record of a maneuver so the rover can penalize patterns that did not improve clearance.
 struct ManeuverOutcome {
   Action action;
@@ -163,6 +327,20 @@ const unsigned long PAN_FRONT_SETTLE_MS = 90;
 const uint8_t ULTRASONIC_NO_ECHO_RETRIES = 2;
 const unsigned long ULTRASONIC_NO_ECHO_RETRY_DELAY_MS = 40;
 const unsigned long ULTRASONIC_SAMPLE_GAP_MS = 45;
+// An echo longer than this (about 430 cm) is treated as no echo; the async engine stops waiting here.
+const unsigned long ULTRASONIC_ECHO_TIMEOUT_US = 25000;
+const uint8_t ULTRASONIC_ECHO_QUEUE_DEPTH = 4;
+const unsigned long RANGING_REPORT_INTERVAL_MS = 5000;
+// Periodic jobs (period / deadline, ms). The control stages share one period and run first every pass,
+// so the others' lateness shows how long the control pipeline held the loop.
+const uint32_t CONTROL_JOB_PERIOD_MS = 5;
+const uint32_t CONTROL_JOB_DEADLINE_MS = 5;
+const uint32_t BUZZER_JOB_PERIOD_MS = 10;
+const uint32_t BUZZER_JOB_DEADLINE_MS = 20;
+const uint32_t SERIAL_JOB_PERIOD_MS = 20;
+const uint32_t SERIAL_JOB_DEADLINE_MS = 50;
+const uint32_t REPORT_JOB_DEADLINE_MS = 100;
+const unsigned long SCHEDULER_REPORT_INTERVAL_MS = 30000;
 const uint16_t ULTRASONIC_NO_ECHO_RECOVERY_STREAK = 6;
 const unsigned long ULTRASONIC_NO_ECHO_RECOVERY_HOLD_MS = 1200;
 const float ULTRASONIC_ALERT_CM = 30.0f;
@@ -207,6 +385,33 @@ const int ADAPTIVE_FORWARD_MIN_BASE_SPEED = 98;
 const uint16_t GEMINI_HTTP_TIMEOUT_MS = 2500;
 const uint16_t GEMINI_MAX_OUTPUT_TOKENS = 12;
 const unsigned long GEMINI_DECISION_REQUEST_TIMEOUT_MS = 4000;
+const uint32_t GEMINI_WORKER_STACK_BYTES = 8192;
+// Second race backend: a local Ollama server (same API as llm-cellmove.ino). Left at the
+// placeholder host it is not registered and Gemini is raced alone.
+const char *OLLAMA_URL = "http://YOUR_OLLAMA_HOST:11434/api/generate";
+const char *OLLAMA_MODEL = "llama3.1:8b";
+const uint16_t OLLAMA_HTTP_TIMEOUT_MS = 2500;
+const uint32_t OLLAMA_RACE_STACK_BYTES = 8192;
+// Whole race, including validation; kept below GEMINI_DECISION_REQUEST_TIMEOUT_MS so the
+// worker always posts a result before loop() gives up on it.
+const unsigned long DECISION_RACE_TIMEOUT_MS = 3500;
+// Latency budgets for the race backends (latency_breaker.h): p95 ms, timeout rate, HTTP error
+// rate, calls before judging, first cool-down ms, cool-down cap ms. A backend over budget sits
+// out the races until a half-open probe comes back in time; with every circuit open the gate
+// stays local-only instead of waiting out GEMINI_HTTP_TIMEOUT_MS on each hazard.
+const LatencyBreakerBudget GEMINI_BREAKER_BUDGET = {2000, 0.25f, 0.40f, 4, 20000, 160000};
+const LatencyBreakerBudget OLLAMA_BREAKER_BUDGET = {2000, 0.25f, 0.40f, 4, 20000, 160000};
+const size_t GEMINI_PROMPT_BUFFER_BYTES = 2400;
+// Staging buffer for socket writes: small enough for the worker, large enough that the
+// request goes out in a handful of TLS records instead of one per field.
+const size_t GEMINI_TX_BUFFER_BYTES = 512;
+// The model is told to answer {"action":"LEFT"}; anything longer than this is rejected anyway.
+const size_t GEMINI_MODEL_TEXT_MAX_BYTES = 96;
+const size_t GEMINI_URL_HOST_MAX_BYTES = 96;
+const size_t GEMINI_URL_PATH_MAX_BYTES = 192;
+// Upper bounds (ms) of the Gemini round-trip latency histogram; the last bucket catches everything slower.
+const uint16_t GEMINI_LATENCY_BUCKET_LIMITS_MS[] = {250, 500, 1000, 1500, 2500, 4000};
+const uint8_t GEMINI_LATENCY_BUCKET_COUNT = sizeof(GEMINI_LATENCY_BUCKET_LIMITS_MS) / sizeof(GEMINI_LATENCY_BUCKET_LIMITS_MS[0]) + 1;
 const unsigned long MOTOR_CONTROL_HEARTBEAT_TIMEOUT_MS = 1000;
 const unsigned long RADAR_SIDE_STALE_MS = 1200;
 const unsigned long TURN_PULSE_MS = 180;
@@ -326,30 +531,180 @@ bool sensorRetryPreviousObstacle = false;
 uint8_t sensorRetryAttempt = 0;
 unsigned long sensorRetryDueMs = 0;
 unsigned long lastUltrasonicSampleMs = 0;
+bool ultrasonicRangingInFlight = false;
+uint8_t ultrasonicRangingAngleDeg = PAN_FORWARD_DEG;
+RangingLoopStats rangingLoopStats = {};
 bool startupFrontScanPending = false;
 GeminiDecisionRequestState geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
 TaskHandle_t geminiDecisionTaskHandle = nullptr;
+volatile bool geminiDecisionWorkerBusy = false;
 uint32_t geminiRequestGeneration = 0;
 Action geminiDecisionFallbackAction = ACTION_STOP;
 unsigned long geminiDecisionRequestStartedMs = 0;
 QueueHandle_t geminiDecisionResultQueue = nullptr;
-float radarFrontCm = -1.0f;
-float radarLeftCm = -1.0f;
-float radarRightCm = -1.0f;
-unsigned long radarFrontUpdatedMs = 0;
-unsigned long radarLeftUpdatedMs = 0;
-unsigned long radarRightUpdatedMs = 0;
-uint8_t radarFrontSampleConfidence = 0;
-uint8_t radarLeftSampleConfidence = 0;
-uint8_t radarRightSampleConfidence = 0;
+QueueHandle_t geminiDecisionRequestQueue = nullptr;
+// The Gemini worker task builds each prompt and races it here; every backend runs in its own task.
+DecisionBroker<2> decisionBroker;
+LatencyBreaker geminiBreaker("gemini", GEMINI_BREAKER_BUDGET);
+LatencyBreaker ollamaBreaker("ollama", OLLAMA_BREAKER_BUDGET);
+// Owned by the "gemini" race backend task: one TLS client kept alive between decisions, plus static
+// prompt and transmit buffers. The request JSON is streamed from the prompt buffer straight to
+// the socket and only the model text is pulled out of the reply, so a decision on a reused
+// connection makes no heap allocations of its own.
+WiFiClientSecure geminiSecureClient;
+char geminiPromptBuffer[GEMINI_PROMPT_BUFFER_BYTES];
+char geminiTxBuffer[GEMINI_TX_BUFFER_BYTES];
+char geminiHost[GEMINI_URL_HOST_MAX_BYTES];
+char geminiPath[GEMINI_URL_PATH_MAX_BYTES];
+// Race slot of the request in flight, so socket reads can give up once another backend has won.
+const DecisionBackend *geminiRaceBackend = nullptr;
+// Buffered writer for the Gemini request. With client == nullptr it only counts bytes, which is
+// how Content-Length is computed without materializing the body.
+struct GeminiRequestWriter {
+  WiFiClientSecure *client;
+  size_t used;
+  size_t total;
+  bool failed;
+};
+
+// Incremental scanner for the Gemini reply. It walks the JSON byte by byte and copies only the
+// first string value stored under a "text" key (candidates[0].content.parts[0].text).
+enum GeminiTextScanState {
+  GEMINI_SCAN_OUTSIDE = 0,
+  GEMINI_SCAN_KEY,
+  GEMINI_SCAN_KEY_ESCAPE,
+  GEMINI_SCAN_AFTER_KEY,
+  GEMINI_SCAN_VALUE_START,
+  GEMINI_SCAN_VALUE,
+  GEMINI_SCAN_VALUE_ESCAPE,
+  GEMINI_SCAN_DONE,
+};
+struct GeminiTextScanner {
+  GeminiTextScanState state;
+  char key[6];
+  uint8_t keyLen;
+  bool keyTooLong;
+  uint8_t unicodeDigitsToSkip;
+  char text[GEMINI_MODEL_TEXT_MAX_BYTES];
+  size_t textLen;
+  bool textTruncated;
+};
+
+// Heap usage sampled across one Gemini request (before, after connect, after send, after reply).
+struct GeminiHeapProbe {
+  size_t freeBefore;
+  size_t lowestFree;
+  size_t blocksBefore;
+  size_t peakBlocks;
+  size_t blocksAfter;
+};
+
+// Round-trip latency histograms, split by whether the pooled TLS connection was reused
+// or a fresh handshake was needed. Written by the worker, printed over Serial after each request.
+struct GeminiLatencyStats {
+  uint32_t reusedCounts[GEMINI_LATENCY_BUCKET_COUNT];
+  uint32_t handshakeCounts[GEMINI_LATENCY_BUCKET_COUNT];
+  uint32_t reusedTotalMs;
+  uint32_t handshakeTotalMs;
+  uint32_t reusedRequests;
+  uint32_t handshakeRequests;
+};
+GeminiLatencyStats geminiLatencyStats = {};
 const unsigned long RADAR_FRONT_STALE_MS = 600;
+// Polar occupancy histogram over the 0-180 degree pan range. A reading overwrites the bins inside
+// the sensor beam around its angle, so an update touches a fixed number of bins and never allocates.
+const uint8_t RADAR_BIN_DEG = 5;
+const uint8_t RADAR_BIN_COUNT = 36;
+const uint8_t RADAR_BEAM_HALF_WIDTH_DEG = 10;
+const uint8_t RADAR_BEAM_HALF_WIDTH_BINS = RADAR_BEAM_HALF_WIDTH_DEG / RADAR_BIN_DEG;
+// Narrowest opening, in degrees, that counts as a way through for the safe-action set.
+const uint8_t RADAR_MIN_GAP_DEG = 15;
+// Turn headings whose clearances differ by less than this are a tie, and the widest gap picks the side.
+const float RADAR_GAP_TIE_CM = 15.0f;
+RadarBin radarBins[RADAR_BIN_COUNT];
 const uint8_t MANEUVER_OUTCOME_HISTORY_SIZE = 8;
 ManeuverOutcome maneuverOutcomeHistory[MANEUVER_OUTCOME_HISTORY_SIZE];
 uint8_t maneuverOutcomeCount = 0;
 uint8_t maneuverOutcomeHead = 0;
 
+// Binary trace. The loop only copies one fixed-size record into a RAM ring per event; a low-priority
+// task appends the ring to flash, so recording stays far below 1% of loop time where Serial tracing
+// stalls on the UART. Record layout is little-endian and mirrored in trace-decode.py.
+enum TraceRecordType : uint8_t {
+  TRACE_RANGING = 1,     // value=distance cm (-1 no echo), c=pulse width us
+  TRACE_READING,         // value=distance cm, a=angle, b=confidence | valid << 8, c=captured ms
+  TRACE_SERVO,           // a=pan angle
+  TRACE_MOTOR,           // a=vehicle direction or TRACE_MOTOR_STOP, b=right PWM, c=left PWM
+  TRACE_DECISION,        // a=Action handed to beginDecisionManeuver
+  TRACE_GEMINI_REQUEST,  // a=1 if the worker accepted the request, 0 if it was unavailable
+  TRACE_GEMINI_RESULT,   // a=Action or TRACE_GEMINI_TIMEOUT, c=latency ms
+};
+struct TraceRecord {
+  uint32_t timeMs;
+  uint8_t type;
+  uint8_t a;
+  uint16_t b;
+  int32_t c;
+  float value;
+};
+struct TraceFileHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t recordBytes;
+  uint32_t randomSeed;
+  uint32_t reserved;
+};
+const char *TRACE_FILE_PATH = "/trace.bin";
+const char *TRACE_PREVIOUS_FILE_PATH = "/trace-prev.bin";
+const char *TRACE_REPLAY_FILE_PATH = "/trace-prev.bin";  // Replay boots fresh, so the run to replay is the previous one
+const uint16_t TRACE_FORMAT_VERSION = 1;
+const uint16_t TRACE_RING_RECORDS = 1024;                 // 16 KB, roughly 15 s of events
+const unsigned long TRACE_FLUSH_INTERVAL_MS = 500;
+const uint32_t TRACE_MAX_FILE_BYTES = 1024UL * 1024UL;    // About 15 min of driving
+const uint32_t TRACE_FLUSH_STACK_BYTES = 4096;
+const uint8_t TRACE_DUMP_LINE_BYTES = 32;
+// Only one record in this many is timed; timing every call cost about as much as the record itself.
+const uint16_t TRACE_COST_SAMPLE_INTERVAL = 64;
+const uint8_t TRACE_MOTOR_STOP = 0xFF;
+const uint8_t TRACE_GEMINI_TIMEOUT = 0xFF;
+struct TraceStats {
+  uint32_t recorded;
+  uint32_t dropped;
+  uint32_t flushedBytes;
+  uint32_t flushes;
+  uint32_t flushMaxMs;
+  uint16_t ringHighWater;
+  uint32_t costSamples;       // Records timed for the overhead estimate
+  uint64_t sampledCycles;     // CPU cycles spent inside those timed records
+  uint32_t cycleReadCycles;   // Average cost of one cycle counter read, removed from each sample
+  uint64_t loopCycles;    // CPU cycles spent inside the control stages
+};
+TraceRecord traceRing[TRACE_RING_RECORDS];
+std::atomic<uint16_t> traceRingHead{0};  // Advanced by loop() only
+std::atomic<uint16_t> traceRingTail{0};  // Advanced by the flush task only
+volatile bool traceRecording = false;
+TraceStats traceStats = {};
+ControlScheduler<8> controlScheduler;
+// Control pipeline stages, each run by its own scheduler job (see runControlStage()).
+enum ControlStage : uint8_t {
+  CONTROL_STAGE_DONE,
+  CONTROL_STAGE_SAFETY,
+  CONTROL_STAGE_SENSING,
+  CONTROL_STAGE_SWEEP,
+  CONTROL_STAGE_DECISION
+};
+struct ControlPass {
+  unsigned long nowMs;  // Control time read when the pass started; every stage decides against it
+  ControlStage next;    // Stage that runs next, or CONTROL_STAGE_DONE between passes
+  uint32_t elapsedUs;   // Time spent inside this pass's stages so far
+};
+ControlPass controlPass = {0, CONTROL_STAGE_DONE, 0};
+TaskHandle_t traceFlushTaskHandle = nullptr;
+File traceFile;
+
 // Forward declarations keep Arduino happy while letting related logic stay grouped below.
-float readUltrasonicCm();
+float recordUltrasonicRanging(float distance, unsigned long pulseWidthUs);
+bool pollDirectionalUltrasonic(uint8_t measurementAngle, DirectionalReading &reading);
 DirectionalReading readDirectionalUltrasonic(uint8_t measurementAngle);
 DirectionalReading medianOfThreeDirectionalReadings(
   const DirectionalReading &a,
@@ -362,18 +717,26 @@ void setPanAngle(uint8_t angleDeg);
 void runPanServoSelfTest();
 void updatePanSweepDebug(unsigned long nowMs);
 bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstacle);
-void updateRadarBuckets(const DirectionalReading &reading);
+void updateRadarHistogram(const DirectionalReading &reading);
+RadarSectorReading radarSectorReading(RadarSector sector, unsigned long nowMs);
+RadarGap findWidestRadarGap(uint8_t minDeg, uint8_t maxDeg, unsigned long nowMs, float clearanceCm);
+float radarHeadingClearanceCm(uint8_t headingDeg, unsigned long nowMs);
+bool radarSectorHasOpening(RadarSector sector, unsigned long nowMs);
 SideScanResult getRadarScanSnapshot();
 const char *scanBestActionString(const SideScanResult &scan);
 const char *hazardClassString(float distanceCm);
 const char *environmentHintString(float frontCm, const SideScanResult &scan);
 const char *driveModeString(DriveMode mode);
+const char *actionToString(Action action);
 bool driveModeHasForwardMotion(DriveMode mode);
 const char *geminiPromptTemplateString(GeminiPromptTemplate templateType);
 const char *escapeAttemptStageString(EscapeAttemptStage stage);
 int sensorConfidenceScore(unsigned long frontAgeMs, unsigned long leftAgeMs, unsigned long rightAgeMs, uint16_t noEchoStreak);
 int computeAdaptiveForwardBaseSpeed(float frontDistanceCm, bool closingRateCorroborated, float corroboratedClosingRateCmPerSec);
 void processDirectionalScanReading(const DirectionalReading &reading);
+void resetDirectionalSampleCollector();
+void invalidateSideScan();
+bool ultrasonicSampleGapElapsed(unsigned long nowMs);
 bool processFrontSafetyReading(unsigned long now, bool previousObstacle, const DirectionalReading &reading);
 bool handleSensorRetryState(unsigned long now);
 void setMotorAction(Action action);
@@ -381,11 +744,16 @@ void startManeuver(Action maneuverAction, unsigned long durationMs, Action resum
 float estimateFrontClearanceCm();
 void recordManeuverOutcome(Action action, bool improved, float frontBeforeCm, float frontAfterCm,
                            float turnSequenceStartCm, uint8_t pulsesUsed, unsigned long completedMs);
-String recentManeuverOutcomesString(uint8_t limit);
+void formatRecentManeuverOutcomes(char *out, size_t outSize, uint8_t limit);
 Action chooseEscapeActionForStage(const NavigationSnapshot &snapshot, const SideScanResult &scan, Action previousAction);
 Action chooseLocalEscapeActionForStage(const NavigationSnapshot &snapshot, const SideScanResult &scan,
                                        Action previousAction);
 void noteEscapeOutcome(Action action, bool improved, float frontAfterCm, unsigned long completedMs);
+void finalizeTurnSequenceOutcome(bool improved, float frontAfterCm, unsigned long completedMs);
+SafeActionSet buildSafeActionSet(const NavigationSnapshot &snapshot, const SideScanResult &scan);
+SafeActionSet buildSafeActionSet(float frontCm, const SideScanResult &scan);
+Action validateSafeAction(Action proposed, const NavigationSnapshot &snapshot, const SideScanResult &scan);
+Action validateSafeAction(Action proposed, float frontCm, const SideScanResult &scan);
 void maybeResetEscapeAttemptStages(unsigned long nowMs);
 void signalTrappedState(unsigned long nowMs);
 GeminiPromptTemplate geminiPromptTemplateForStage(EscapeAttemptStage stage);
@@ -398,6 +766,58 @@ bool startGeminiDecisionRequest(const NavigationSnapshot &snapshot, Action previ
                                 const SideScanResult &scan, GeminiPromptTemplate templateType);
 bool updateGeminiDecisionRequest(unsigned long nowMs, Action &decisionOut);
 void geminiDecisionWorkerTask(void *parameter);
+bool startGeminiDecisionWorker();
+bool decisionAnswerIsSafe(const char *answer, void *context);
+bool geminiRaceCall(DecisionBackend &backend, const char *prompt, char *answer, size_t answerSize);
+bool ollamaRaceCall(DecisionBackend &backend, const char *prompt, char *answer, size_t answerSize);
+void recordGeminiLatency(uint32_t latencyMs, bool reusedConnection);
+bool parseGeminiUrl(const char *url);
+bool ensureGeminiConnection(bool &reusedConnection);
+void writeGeminiRequestBody(GeminiRequestWriter &writer, const char *prompt);
+int sendGeminiRequest(const char *prompt);
+int readGeminiResponse(GeminiTextScanner &scanner, GeminiHeapProbe &heapProbe);
+void feedGeminiTextScanner(GeminiTextScanner &scanner, char c);
+void startGeminiHeapProbe(GeminiHeapProbe &probe);
+void sampleGeminiHeapProbe(GeminiHeapProbe &probe);
+void printGeminiHeapProbe(const GeminiHeapProbe &probe);
+void printGeminiLatencyHistogram();
+unsigned long roverNowMs();
+void roverDelay(unsigned long ms);
+float roverRangingCm(unsigned long &pulseWidthUs);
+bool roverRangingBegin();
+void roverRangingStart();
+bool roverRangingPoll(float &distanceCm, unsigned long &pulseWidthUs);
+void roverDriveMotors(int direction, int rightPwm, int leftPwm);
+void roverStopMotors();
+void roverWritePan(int angleDeg);
+void registerControlJobs();
+#if ROVER_VIRTUAL_HARDWARE
+uint64_t roverNowUs();
+#endif
+bool startTraceRecorder(uint32_t randomSeed);
+void traceRecord(TraceRecordType type, uint8_t a, uint16_t b, int32_t c, float value);
+void traceFlushTask(void *parameter);
+void flushTraceRing();
+void printTraceStats();
+void recordRangingLoopTime(uint32_t elapsedUs);
+void printRangingLoopStats(unsigned long nowMs);
+void dumpTraceFile(const char *path);
+void pollTraceSerialCommands();
+#if ROVER_TRACE_REPLAY
+bool replayInit();
+bool replayGeminiRequestAccepted();
+void replayCheckOutput(const TraceRecord &produced);
+void serviceReplayGeminiRequests(unsigned long nowMs);
+void printReplayReport(const char *label);
+#endif
+#if ROVER_SIMULATION
+void simInit();
+void simBenchmarkRadarUpdate(const DirectionalReading &reading, uint32_t histogramCycles);
+void simBenchmarkRadarInvalidate();
+void simBenchmarkRadarDecision(const SideScanResult &histogramScan, unsigned long nowMs);
+void simAdvance(unsigned long stepMs);
+void simRecordLoopLatency(unsigned long elapsedUs);
+#endif
 
 // Clamp every PWM write into the valid 8-bit range expected by the motor driver.
 int clampPwm(int pwm) {
@@ -417,7 +837,7 @@ void startBuzzer(uint16_t durationMs) {
   }
   digitalWrite(BUZZER_PIN, BUZZER_ACTIVE_HIGH ? HIGH : LOW);
   buzzerActive = true;
-  buzzerOffMs = millis() + durationMs;
+  buzzerOffMs = roverNowMs() + durationMs;
 }
 
 // Service the buzzer timer so alerts do not stall the navigation loop.
@@ -445,9 +865,9 @@ void emergencyStop(const char *reason) {
   if ((activeManeuverAction == ACTION_LEFT || activeManeuverAction == ACTION_RIGHT) &&
       turnSequenceStartCm >= ULTRASONIC_MIN_VALID_CM) {
     float abortedFrontCm = estimateFrontClearanceCm();
-    finalizeTurnSequenceOutcome(false, abortedFrontCm, millis());
+    finalizeTurnSequenceOutcome(false, abortedFrontCm, roverNowMs());
   }
-  robot.Move(Stop, 0);
+  roverStopMotors();
   requestedAction = ACTION_STOP;
   currentMotorAction = ACTION_STOP;
   currentDriveMode = DRIVE_STOPPED;
@@ -506,15 +926,23 @@ Action oppositeAction(Action action) {
       return ACTION_STOP;
   }
 }
-ParsedAction parseActionFromText(const String &text) {
+ParsedAction parseActionFromText(const char *text) {
+  // Works on the caller's buffer: trimming only moves the start/end bounds, and the JSON
+  // document lives on the stack, so parsing does not touch the heap.
   ParsedAction result = {false, ACTION_STOP};
-  String trimmed = text;
-  trimmed.trim();
-  if (!trimmed.startsWith("{") || !trimmed.endsWith("}")) {
+  size_t start = 0;
+  size_t end = strlen(text);
+  while (start < end && isspace((unsigned char)text[start])) {
+    start++;
+  }
+  while (end > start && isspace((unsigned char)text[end - 1])) {
+    end--;
+  }
+  if (end - start < 2 || text[start] != '{' || text[end - 1] != '}') {
     return result;
   }
   StaticJsonDocument<128> responseDoc;
-  DeserializationError err = deserializeJson(responseDoc, trimmed);
+  DeserializationError err = deserializeJson(responseDoc, text + start, end - start);
   if (err) {
     return result;
   }
@@ -524,29 +952,41 @@ ParsedAction parseActionFromText(const String &text) {
   if (!responseDoc["action"].is<const char *>()) {
     return result;
   }
-  String actionText = responseDoc["action"].as<const char *>();
-  actionText.trim();
-  if (actionText == "FORWARD") {
+  const char *actionValue = responseDoc["action"].as<const char *>();
+  char actionText[16];
+  size_t actionLen = 0;
+  while (isspace((unsigned char)*actionValue)) {
+    actionValue++;
+  }
+  while (actionValue[actionLen] != '\0' && actionLen < sizeof(actionText) - 1) {
+    actionText[actionLen] = actionValue[actionLen];
+    actionLen++;
+  }
+  while (actionLen > 0 && isspace((unsigned char)actionText[actionLen - 1])) {
+    actionLen--;
+  }
+  actionText[actionLen] = '\0';
+  if (strcmp(actionText, "FORWARD") == 0) {
     result.valid = true;
     result.action = ACTION_FORWARD;
     return result;
   }
-  if (actionText == "BACKWARD") {
+  if (strcmp(actionText, "BACKWARD") == 0) {
     result.valid = true;
     result.action = ACTION_BACKWARD;
     return result;
   }
-  if (actionText == "LEFT") {
+  if (strcmp(actionText, "LEFT") == 0) {
     result.valid = true;
     result.action = ACTION_LEFT;
     return result;
   }
-  if (actionText == "RIGHT") {
+  if (strcmp(actionText, "RIGHT") == 0) {
     result.valid = true;
     result.action = ACTION_RIGHT;
     return result;
   }
-  if (actionText == "STOP") {
+  if (strcmp(actionText, "STOP") == 0) {
     result.valid = true;
     result.action = ACTION_STOP;
     return result;
@@ -783,6 +1223,11 @@ GeminiGateResult evaluateGeminiGate(const NavigationSnapshot &snapshot, const Si
       gate.reason = "Gemini gate: recovery not ambiguous enough, using local decision";
     }
   }
+  // Last, so a skipped call is only counted when the sensor state alone would have made it.
+  if (gate.shouldCall && decisionBroker.allBreakersOpen(millis())) {
+    gate.shouldCall = false;
+    gate.reason = "Gemini gate: cloud circuit open, using local decision";
+  }
   gate.localRecommendation = validateSafeAction(gate.localRecommendation, snapshot, scan);
   return gate;
 }
@@ -805,43 +1250,38 @@ Action chooseSmartAction(Action preferred, Action physicallyBlockedAction, Actio
 SafeActionSet buildSafeActionSet(const NavigationSnapshot &snapshot, const SideScanResult &scan) {
   SafeActionSet safeActions = {};
   safeActions.forward = snapshot.frontValid && snapshot.frontCm >= HAZARD_CLEAR_CM;
-  safeActions.left = snapshot.leftValid && snapshot.leftCm >= HAZARD_CLEAR_CM;
-  safeActions.right = snapshot.rightValid && snapshot.rightCm >= HAZARD_CLEAR_CM;
+  // A side is also safe when its nearest return is close but the histogram shows an opening in it.
+  unsigned long nowMs = roverNowMs();
+  safeActions.left = snapshot.leftValid &&
+                     (snapshot.leftCm >= HAZARD_CLEAR_CM || radarSectorHasOpening(RADAR_SECTOR_LEFT, nowMs));
+  safeActions.right = snapshot.rightValid &&
+                      (snapshot.rightCm >= HAZARD_CLEAR_CM || radarSectorHasOpening(RADAR_SECTOR_RIGHT, nowMs));
   safeActions.backward = false;
   safeActions.stop = true;
   return safeActions;
 }
 SafeActionSet buildSafeActionSet(float frontCm, const SideScanResult &scan) {
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   snapshot.frontCm = frontCm;
   snapshot.frontValid = frontCm >= ULTRASONIC_MIN_VALID_CM;
   snapshot.frontBlocked = snapshot.frontValid && frontCm <= ULTRASONIC_ALERT_CM;
   return buildSafeActionSet(snapshot, scan);
 }
-String safeActionSetString(const SafeActionSet &safeActions) {
-  String out = "";
-  if (safeActions.forward) {
-    out += "FORWARD";
-  }
-  if (safeActions.left) {
-    if (out.length() > 0) {
-      out += ",";
-    }
-    out += "LEFT";
-  }
-  if (safeActions.right) {
-    if (out.length() > 0) {
-      out += ",";
+void formatSafeActionSet(const SafeActionSet &safeActions, char *out, size_t outSize) {
+  // Comma-separated list written into the caller's buffer, e.g. "LEFT,RIGHT,STOP".
+  size_t len = 0;
+  out[0] = '\0';
+  const bool enabled[] = {safeActions.forward, safeActions.left, safeActions.right, safeActions.stop};
+  const char *names[] = {"FORWARD", "LEFT", "RIGHT", "STOP"};
+  for (uint8_t i = 0; i < 4; i++) {
+    if (!enabled[i] || len >= outSize) {
+      continue;
     }
-    out += "RIGHT";
-  }
-  if (safeActions.stop) {
-    if (out.length() > 0) {
-      out += ",";
+    int written = snprintf(out + len, outSize - len, len > 0 ? ",%s" : "%s", names[i]);
+    if (written > 0) {
+      len += (size_t)written;
     }
-    out += "STOP";
   }
-  return out;
 }
 Action validateSafeAction(Action proposed, const NavigationSnapshot &snapshot, const SideScanResult &scan) {
   bool frontBlocked = snapshot.frontBlocked;
@@ -856,25 +1296,26 @@ Action validateSafeAction(Action proposed, const NavigationSnapshot &snapshot, c
   return proposed;
 }
 Action validateSafeAction(Action proposed, float frontCm, const SideScanResult &scan) {
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   snapshot.frontCm = frontCm;
   snapshot.frontValid = frontCm >= ULTRASONIC_MIN_VALID_CM;
   snapshot.frontBlocked = snapshot.frontValid && frontCm <= ULTRASONIC_ALERT_CM;
   return validateSafeAction(proposed, snapshot, scan);
 }
-String recentActionsString(uint8_t limit) {
+void formatRecentActions(char *out, size_t outSize, uint8_t limit) {
   if (actionHistoryCount == 0) {
-    return "NONE";
+    snprintf(out, outSize, "NONE");
+    return;
   }
-  String out = "";
+  size_t len = 0;
+  out[0] = '\0';
   uint8_t n = actionHistoryCount < limit ? actionHistoryCount : limit;
-  for (uint8_t i = 0; i < n; i++) {
-    if (i > 0) {
-      out += ",";
+  for (uint8_t i = 0; i < n && len < outSize; i++) {
+    int written = snprintf(out + len, outSize - len, i > 0 ? ",%s" : "%s", actionToString(getRecentAction(i)));
+    if (written > 0) {
+      len += (size_t)written;
     }
-    out += actionToString(getRecentAction(i));
   }
-  return out;
 }
 void recordManeuverOutcome(Action action, bool improved, float frontBeforeCm, float frontAfterCm,
                            float turnSequenceStartCm, uint8_t pulsesUsed, unsigned long completedMs) {
@@ -893,37 +1334,28 @@ void recordManeuverOutcome(Action action, bool improved, float frontBeforeCm, fl
     maneuverOutcomeCount++;
   }
 }
-String recentManeuverOutcomesString(uint8_t limit) {
+void formatRecentManeuverOutcomes(char *out, size_t outSize, uint8_t limit) {
   if (maneuverOutcomeCount == 0) {
-    return "NONE";
+    snprintf(out, outSize, "NONE");
+    return;
   }
-  String out = "";
+  size_t len = 0;
+  out[0] = '\0';
   uint8_t n = maneuverOutcomeCount < limit ? maneuverOutcomeCount : limit;
-  for (uint8_t i = 0; i < n; i++) {
-    if (i > 0) {
-      out += ";";
-    }
+  for (uint8_t i = 0; i < n && len < outSize; i++) {
     int index = (int)maneuverOutcomeHead - 1 - (int)i;
     while (index < 0) {
       index += MANEUVER_OUTCOME_HISTORY_SIZE;
     }
     ManeuverOutcome outcome = maneuverOutcomeHistory[index % MANEUVER_OUTCOME_HISTORY_SIZE];
-    out += actionToString(outcome.action);
-    out += "[";
-    out += String(outcome.frontBeforeCm, 1);
-    out += "->";
-    out += String(outcome.frontAfterCm, 1);
-    out += ",d=";
-    out += String(outcome.improvementCm, 1);
-    out += ",start=";
-    out += String(outcome.turnSequenceStartCm, 1);
-    out += ",pulses=";
-    out += String(outcome.pulsesUsed);
-    out += ",";
-    out += outcome.improved ? "OK" : "FAIL";
-    out += "]";
-  }
-  return out;
+    int written = snprintf(out + len, outSize - len, "%s%s[%.1f->%.1f,d=%.1f,start=%.1f,pulses=%u,%s]",
+                           i > 0 ? ";" : "", actionToString(outcome.action), outcome.frontBeforeCm,
+                           outcome.frontAfterCm, outcome.improvementCm, outcome.turnSequenceStartCm,
+                           outcome.pulsesUsed, outcome.improved ? "OK" : "FAIL");
+    if (written > 0) {
+      len += (size_t)written;
+    }
+  }
 }
 const char *escapeAttemptStageString(EscapeAttemptStage stage) {
   switch (stage) {
@@ -1038,7 +1470,7 @@ bool applyImmediatePostManeuverHazardCheck(const DirectionalReading &reading) {
   lastDistanceCm = reading.distanceCm;
   lastSensorMs = reading.capturedMs;
   if (reading.valid) {
-    updateRadarBuckets(reading);
+    updateRadarHistogram(reading);
   }
   return immediatePostManeuverHazard;
 }
@@ -1085,11 +1517,11 @@ Action chooseEscapeActionForStage(const NavigationSnapshot &snapshot, const Side
   return chooseLocalEscapeActionForStage(snapshot, scan, previousAction);
 }
 Action chooseLocalEscapeActionForStage(const SideScanResult &scan, Action previousAction) {
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   return chooseLocalEscapeActionForStage(snapshot, scan, previousAction);
 }
 Action chooseEscapeActionForStage(const SideScanResult &scan, Action previousAction) {
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   return chooseEscapeActionForStage(snapshot, scan, previousAction);
 }
 const char *currentTurnDirectionString(Action previousAction) {
@@ -1208,13 +1640,14 @@ int sensorConfidenceScore(unsigned long frontAgeMs, unsigned long leftAgeMs, uns
   if (rightAgeMs > 1200UL) {
     score -= 8;
   }
-  if (radarFrontSampleConfidence < 3) {
+  unsigned long nowMs = roverNowMs();
+  if (radarSectorReading(RADAR_SECTOR_FRONT, nowMs).confidence < 3) {
     score -= 12;
   }
-  if (radarLeftSampleConfidence < 3) {
+  if (radarSectorReading(RADAR_SECTOR_LEFT, nowMs).confidence < 3) {
     score -= 4;
   }
-  if (radarRightSampleConfidence < 3) {
+  if (radarSectorReading(RADAR_SECTOR_RIGHT, nowMs).confidence < 3) {
     score -= 4;
   }
   int noEchoPenalty = (int)noEchoStreak * 9;
@@ -1235,20 +1668,17 @@ NavigationSnapshot buildNavigationSnapshot(unsigned long nowMs) {
   // The snapshot normalizes raw buckets into "valid", "blocked", and confidence decisions
   // so the rest of the rover logic can avoid duplicating stale-data checks everywhere.
   NavigationSnapshot snapshot = {};
+  RadarSectorReading front = radarSectorReading(RADAR_SECTOR_FRONT, nowMs);
+  RadarSectorReading left = radarSectorReading(RADAR_SECTOR_LEFT, nowMs);
+  RadarSectorReading right = radarSectorReading(RADAR_SECTOR_RIGHT, nowMs);
   snapshot.frontCm = currentFrontDistanceCm;
-  snapshot.leftCm = radarLeftCm;
-  snapshot.rightCm = radarRightCm;
-  snapshot.frontAgeMs = (radarFrontUpdatedMs == 0) ? 9999UL : (nowMs - radarFrontUpdatedMs);
-  snapshot.leftAgeMs = (radarLeftUpdatedMs == 0) ? 9999UL : (nowMs - radarLeftUpdatedMs);
-  snapshot.rightAgeMs = (radarRightUpdatedMs == 0) ? 9999UL : (nowMs - radarRightUpdatedMs);
-  if (radarFrontUpdatedMs != 0 && snapshot.frontAgeMs <= RADAR_FRONT_STALE_MS && radarFrontCm >= ULTRASONIC_MIN_VALID_CM) {
-    snapshot.frontCm = radarFrontCm;
-  }
-  if (radarLeftUpdatedMs != 0 && snapshot.leftAgeMs <= RADAR_SIDE_STALE_MS && radarLeftCm >= ULTRASONIC_MIN_VALID_CM) {
-    snapshot.leftCm = radarLeftCm;
-  }
-  if (radarRightUpdatedMs != 0 && snapshot.rightAgeMs <= RADAR_SIDE_STALE_MS && radarRightCm >= ULTRASONIC_MIN_VALID_CM) {
-    snapshot.rightCm = radarRightCm;
+  snapshot.leftCm = left.distanceCm;
+  snapshot.rightCm = right.distanceCm;
+  snapshot.frontAgeMs = (front.updatedMs == 0) ? 9999UL : (nowMs - front.updatedMs);
+  snapshot.leftAgeMs = (left.updatedMs == 0) ? 9999UL : (nowMs - left.updatedMs);
+  snapshot.rightAgeMs = (right.updatedMs == 0) ? 9999UL : (nowMs - right.updatedMs);
+  if (front.updatedMs != 0 && snapshot.frontAgeMs <= RADAR_FRONT_STALE_MS && front.distanceCm >= ULTRASONIC_MIN_VALID_CM) {
+    snapshot.frontCm = front.distanceCm;
   }
   snapshot.frontValid = snapshot.frontAgeMs <= RADAR_FRONT_STALE_MS && snapshot.frontCm >= ULTRASONIC_MIN_VALID_CM;
   snapshot.leftValid = snapshot.leftAgeMs <= RADAR_SIDE_STALE_MS && snapshot.leftCm >= ULTRASONIC_MIN_VALID_CM;
@@ -1378,14 +1808,43 @@ int computeAdaptiveForwardBaseSpeed(float frontDistanceCm, bool closingRateCorro
   }
   return target;
 }
-DirectionalReading readDirectionalUltrasonic(uint8_t measurementAngle) {
-  DirectionalReading reading;
+bool pollDirectionalUltrasonic(uint8_t measurementAngle, DirectionalReading &reading) {
+  // Non-blocking read. The first call triggers a measurement at measurementAngle; later calls return
+  // false until its echo (or the no-echo timeout) has arrived, then fill reading and return true.
+  if (!ultrasonicRangingInFlight) {
+    roverRangingStart();
+    ultrasonicRangingInFlight = true;
+    ultrasonicRangingAngleDeg = measurementAngle;
+  }
+  float distance = -1.0f;
+  unsigned long pulseWidthUs = 0;
+  if (!roverRangingPoll(distance, pulseWidthUs)) {
+    return false;
+  }
+  ultrasonicRangingInFlight = false;
+  distance = recordUltrasonicRanging(distance, pulseWidthUs);
+  lastUltrasonicSampleMs = roverNowMs();
+  if (ultrasonicRangingAngleDeg != measurementAngle) {
+    // The scan was reset and the servo moved while this echo was in flight; it belongs to the old angle.
+    return false;
+  }
   reading.angleDeg = measurementAngle;
-  reading.distanceCm = readUltrasonicCm();
-  reading.capturedMs = millis();
+  reading.distanceCm = distance;
+  reading.capturedMs = lastUltrasonicSampleMs;
   reading.sampleConfidence = 1;
   reading.valid = reading.distanceCm >= ULTRASONIC_MIN_VALID_CM;
-  lastUltrasonicSampleMs = reading.capturedMs;
+  rangingLoopStats.samples++;
+  if (!reading.valid) {
+    rangingLoopStats.noEchoSamples++;
+  }
+  return true;
+}
+DirectionalReading readDirectionalUltrasonic(uint8_t measurementAngle) {
+  // Blocking wrapper for setup(), where nothing else needs to run while the echo is pending.
+  DirectionalReading reading;
+  while (!pollDirectionalUltrasonic(measurementAngle, reading)) {
+    roverDelay(1);
+  }
   return reading;
 }
 DirectionalReading medianOfThreeDirectionalReadings(
@@ -1448,10 +1907,11 @@ DirectionalReading filterDirectionalReadings(const DirectionalReading *samples,
   return filteredReading;
 }
 float estimateFrontClearanceCm() {
-  unsigned long nowMs = millis();
-  if (radarFrontUpdatedMs != 0 && (nowMs - radarFrontUpdatedMs) <= RADAR_FRONT_STALE_MS &&
-      radarFrontCm >= ULTRASONIC_MIN_VALID_CM) {
-    return radarFrontCm;
+  unsigned long nowMs = roverNowMs();
+  RadarSectorReading front = radarSectorReading(RADAR_SECTOR_FRONT, nowMs);
+  if (front.updatedMs != 0 && (nowMs - front.updatedMs) <= RADAR_FRONT_STALE_MS &&
+      front.distanceCm >= ULTRASONIC_MIN_VALID_CM) {
+    return front.distanceCm;
   }
   return currentFrontDistanceCm;
 }
@@ -1475,7 +1935,9 @@ void startNoEchoRecovery(unsigned long nowMs) {
 void processDirectionalScanReading(const DirectionalReading &reading) {
   // Every valid reading updates the short-lived directional radar cache.
   // Only forward-facing reads participate in time-to-collision logic.
-  updateRadarBuckets(reading);
+  traceRecord(TRACE_READING, reading.angleDeg, (uint16_t)(reading.sampleConfidence | (reading.valid ? 0x100 : 0)),
+              (int32_t)reading.capturedMs, reading.distanceCm);
+  updateRadarHistogram(reading);
   lastSensorMs = reading.capturedMs;
   if (reading.angleDeg != PAN_FORWARD_DEG) {
 bool applyMotorAction(Action action, const NavigationSnapshot &snapshot);
@@ -1525,8 +1987,9 @@ bool processFrontSafetyReading(unsigned long now, bool previousObstacle, const D
     sensorRetryDueMs = 0;
   }
   float hazardDistance = lastDistanceCm;
-  if (radarFrontUpdatedMs != 0 && (now - radarFrontUpdatedMs) <= RADAR_FRONT_STALE_MS) {
-    hazardDistance = radarFrontCm;
+  RadarSectorReading radarFront = radarSectorReading(RADAR_SECTOR_FRONT, now);
+  if (radarFront.updatedMs != 0 && (now - radarFront.updatedMs) <= RADAR_FRONT_STALE_MS) {
+    hazardDistance = radarFront.distanceCm;
     Serial.print("Using front-radar hazard distance: ");
     Serial.println(hazardDistance);
   }
@@ -1590,17 +2053,8 @@ bool processFrontSafetyReading(unsigned long now, bool previousObstacle, const D
             if (availableClearanceCm <= stoppingDistanceCm &&
                 ttcBrakeCooldownElapsed && roverState != STATE_MANEUVERING) {
               float ttcMs = (availableClearanceCm / corroboratedTtcClosingCmPerSec) * 1000.0f;
-              Serial.print("Stopping-distance brake: front=");
-              Serial.print(hazardDistance);
-              Serial.print("cm closing=");
-              Serial.print(corroboratedTtcClosingCmPerSec);
-              Serial.print("cm/s stopDist=");
-              Serial.print(stoppingDistanceCm);
-              Serial.print("cm available=");
-              Serial.print(availableClearanceCm);
-              Serial.print("cm ttc=");
-              Serial.print(ttcMs);
-              Serial.println("ms -> emergency reverse");
+              ROVER_LOG_WARN(LOG_STOPPING_BRAKE, hazardDistance, corroboratedTtcClosingCmPerSec, stoppingDistanceCm,
+                             availableClearanceCm, ttcMs);
               startBuzzer(140);
               emergencyStop("critical hazard");
               startMotionCalibrationRecord(now, hazardDistance, lastForwardCommandBaseSpeed,
@@ -1678,7 +2132,10 @@ bool handleSensorRetryState(unsigned long now) {
   if (!ultrasonicSampleGapElapsed(now)) {
     return true;
   }
-  DirectionalReading retryReading = readDirectionalUltrasonic(panCurrentDeg);
+  DirectionalReading retryReading;
+  if (!pollDirectionalUltrasonic(panCurrentDeg, retryReading)) {
+    return true;
+  }
   if (!retryReading.valid && sensorRetryAttempt < ULTRASONIC_NO_ECHO_RETRIES) {
     sensorRetryAttempt++;
     sensorRetryDueMs = now + ULTRASONIC_NO_ECHO_RETRY_DELAY_MS;
@@ -1696,7 +2153,8 @@ void setPanAngle(uint8_t angleDeg) {
     clamped = 180;
   }
   panCurrentDeg = clamped;
-  ultrasonicPanServo.write((int)clamped);
+  roverWritePan((int)clamped);
+  traceRecord(TRACE_SERVO, clamped, 0, 0, 0.0f);
 }
 void runPanServoSelfTest() {
   if (!panServoReady) {
@@ -1704,16 +2162,16 @@ void runPanServoSelfTest() {
   }
   Serial.println("Pan self-test: CENTER");
   setPanAngle(PAN_FORWARD_DEG);
-  delay(400);
+  roverDelay(400);
   Serial.println("Pan self-test: RIGHT");
   setPanAngle(PAN_RIGHT_DEG);
-  delay(500);
+  roverDelay(500);
   Serial.println("Pan self-test: LEFT");
   setPanAngle(PAN_LEFT_DEG);
-  delay(500);
+  roverDelay(500);
   Serial.println("Pan self-test: CENTER");
   setPanAngle(PAN_FORWARD_DEG);
-  delay(400);
+  roverDelay(400);
 }
 void updatePanSweepDebug(unsigned long nowMs) {
   if (!panServoReady) {
@@ -1784,7 +2242,10 @@ bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstac
         if (!ultrasonicSampleGapElapsed(nowMs)) {
           return true;
         }
-        DirectionalReading reading = readDirectionalUltrasonic(PAN_LEFT_DEG);
+        DirectionalReading reading;
+        if (!pollDirectionalUltrasonic(PAN_LEFT_DEG, reading)) {
+          return true;
+        }
         if (reading.valid && ultrasonicScanValidCount < ULTRASONIC_MEDIAN_SAMPLE_COUNT) {
           ultrasonicScanSamples[ultrasonicScanValidCount++] = reading;
         }
@@ -1818,7 +2279,10 @@ bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstac
         if (!ultrasonicSampleGapElapsed(nowMs)) {
           return true;
         }
-        DirectionalReading reading = readDirectionalUltrasonic(PAN_FORWARD_DEG);
+        DirectionalReading reading;
+        if (!pollDirectionalUltrasonic(PAN_FORWARD_DEG, reading)) {
+          return true;
+        }
         if (reading.valid && ultrasonicScanValidCount < ULTRASONIC_MEDIAN_SAMPLE_COUNT) {
           ultrasonicScanSamples[ultrasonicScanValidCount++] = reading;
         }
@@ -1852,7 +2316,10 @@ bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstac
         if (!ultrasonicSampleGapElapsed(nowMs)) {
           return true;
         }
-        DirectionalReading reading = readDirectionalUltrasonic(PAN_RIGHT_DEG);
+        DirectionalReading reading;
+        if (!pollDirectionalUltrasonic(PAN_RIGHT_DEG, reading)) {
+          return true;
+        }
         if (reading.valid && ultrasonicScanValidCount < ULTRASONIC_MEDIAN_SAMPLE_COUNT) {
           ultrasonicScanSamples[ultrasonicScanValidCount++] = reading;
         }
@@ -1885,7 +2352,10 @@ bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstac
         if (!ultrasonicSampleGapElapsed(nowMs)) {
           return true;
         }
-        DirectionalReading reading = readDirectionalUltrasonic(PAN_FORWARD_DEG);
+        DirectionalReading reading;
+        if (!pollDirectionalUltrasonic(PAN_FORWARD_DEG, reading)) {
+          return true;
+        }
         processFrontSafetyReading(nowMs, obstacleNearby, reading);
         turnLatestFrontCm = reading.distanceCm;
         turnFrontReadingReady = true;
@@ -1913,39 +2383,150 @@ bool updateStationaryUltrasonicSampling(unsigned long nowMs, bool previousObstac
   }
   return true;
 }
-void updateRadarBuckets(const DirectionalReading &reading) {
-  // Store the latest valid reading into front/left/right buckets based on servo angle.
-  // These buckets expire quickly, which prevents old side scans from driving new maneuvers.
+uint8_t radarBinForAngle(int angleDeg) {
+  if (angleDeg < 0) {
+    return 0;
+  }
+  int bin = angleDeg / RADAR_BIN_DEG;
+  return bin >= RADAR_BIN_COUNT ? RADAR_BIN_COUNT - 1 : (uint8_t)bin;
+}
+void radarSectorBins(RadarSector sector, uint8_t &firstBin, uint8_t &lastBin) {
+  // Bins whose centre lies within PAN_FRONT_WINDOW_DEG of straight ahead are front; the rest split left/right.
+  uint8_t frontFirst = radarBinForAngle(PAN_FORWARD_DEG - PAN_FRONT_WINDOW_DEG + RADAR_BIN_DEG / 2);
+  uint8_t frontLast = radarBinForAngle(PAN_FORWARD_DEG + PAN_FRONT_WINDOW_DEG - RADAR_BIN_DEG / 2);
+  if (sector == RADAR_SECTOR_FRONT) {
+    firstBin = frontFirst;
+    lastBin = frontLast;
+  } else if (sector == RADAR_SECTOR_LEFT) {
+    firstBin = frontLast + 1;
+    lastBin = RADAR_BIN_COUNT - 1;
+  } else {
+    firstBin = 0;
+    lastBin = frontFirst - 1;
+  }
+}
+void updateRadarHistogram(const DirectionalReading &reading) {
+  // Write the reading into the bins its beam covers: full confidence at the measured angle, one step
+  // less at the beam edges. Constant work per reading; old bins simply age out.
   if (!reading.valid) {
     return;
   }
-  int deltaFromFront = (int)reading.angleDeg - (int)PAN_FORWARD_DEG;
-  if (deltaFromFront < 0) {
-    deltaFromFront = -deltaFromFront;
+#if ROVER_SIMULATION
+  uint32_t updateStartCycles = ESP.getCycleCount();
+#endif
+  int centerBin = radarBinForAngle(reading.angleDeg);
+  for (int bin = centerBin - RADAR_BEAM_HALF_WIDTH_BINS; bin <= centerBin + RADAR_BEAM_HALF_WIDTH_BINS; bin++) {
+    if (bin < 0 || bin >= RADAR_BIN_COUNT) {
+      continue;
+    }
+    RadarBin &slot = radarBins[bin];
+    slot.distanceCm = reading.distanceCm;
+    slot.updatedMs = reading.capturedMs;
+    slot.confidence = (bin == centerBin || reading.sampleConfidence <= 1) ? reading.sampleConfidence
+                                                                           : reading.sampleConfidence - 1;
+  }
+#if ROVER_SIMULATION
+  simBenchmarkRadarUpdate(reading, ESP.getCycleCount() - updateStartCycles);
+#endif
+}
+RadarSectorReading radarSectorReading(RadarSector sector, unsigned long nowMs) {
+  // Nearest fresh bin in the sector, timestamped with the sector's newest update. When nothing in the
+  // sector is fresh the newest bin is returned as-is and callers see its age.
+  unsigned long staleMs = (sector == RADAR_SECTOR_FRONT) ? RADAR_FRONT_STALE_MS : RADAR_SIDE_STALE_MS;
+  uint8_t firstBin = 0;
+  uint8_t lastBin = 0;
+  radarSectorBins(sector, firstBin, lastBin);
+  RadarSectorReading result = {-1.0f, 0, 0};
+  const RadarBin *newest = nullptr;
+  const RadarBin *nearestFresh = nullptr;
+  for (uint8_t bin = firstBin; bin <= lastBin; bin++) {
+    const RadarBin &slot = radarBins[bin];
+    if (slot.updatedMs == 0) {
+      continue;
+    }
+    if (newest == nullptr || (long)(slot.updatedMs - newest->updatedMs) > 0) {
+      newest = &slot;
+    }
+    if ((nowMs - slot.updatedMs) <= staleMs && (nearestFresh == nullptr || slot.distanceCm < nearestFresh->distanceCm)) {
+      nearestFresh = &slot;
+    }
+  }
+  if (newest == nullptr) {
+    return result;
   }
-  if (deltaFromFront <= PAN_FRONT_WINDOW_DEG) {
-    radarFrontCm = reading.distanceCm;
-    radarFrontUpdatedMs = reading.capturedMs;
-    radarFrontSampleConfidence = reading.sampleConfidence;
-    return;
+  const RadarBin &chosen = (nearestFresh != nullptr) ? *nearestFresh : *newest;
+  result.distanceCm = chosen.distanceCm;
+  result.confidence = chosen.confidence;
+  result.updatedMs = newest->updatedMs;
+  return result;
+}
+RadarGap findWidestRadarGap(uint8_t minDeg, uint8_t maxDeg, unsigned long nowMs, float clearanceCm) {
+  // One pass over the bins in [minDeg, maxDeg]. A bin is open when it is fresh and at least clearanceCm
+  // away; its weight is its confidence decayed linearly with age, and the best-scoring run wins.
+  RadarGap best = {};
+  RadarGap run = {};
+  uint8_t firstBin = radarBinForAngle(minDeg);
+  uint8_t lastBin = radarBinForAngle(maxDeg);
+  for (uint8_t bin = firstBin; bin <= lastBin + 1; bin++) {
+    bool open = false;
+    float weight = 0.0f;
+    if (bin <= lastBin) {
+      const RadarBin &slot = radarBins[bin];
+      unsigned long ageMs = nowMs - slot.updatedMs;
+      open = slot.updatedMs != 0 && ageMs <= RADAR_SIDE_STALE_MS && slot.distanceCm >= clearanceCm;
+      if (open) {
+        weight = slot.confidence * (1.0f - (float)ageMs / (float)(RADAR_SIDE_STALE_MS + 1));
+        if (!run.found) {
+          run = {};
+          run.found = true;
+          run.startDeg = bin * RADAR_BIN_DEG;
+          run.minClearanceCm = slot.distanceCm;
+        }
+        run.endDeg = bin * RADAR_BIN_DEG + RADAR_BIN_DEG - 1;
+        run.minClearanceCm = fminf(run.minClearanceCm, slot.distanceCm);
+        run.score += weight;
+        continue;
+      }
+    }
+    if (run.found) {
+      run.widthDeg = run.endDeg - run.startDeg + 1;
+      run.centerDeg = run.startDeg + run.widthDeg / 2;
+      if (!best.found || run.score > best.score ||
+          (run.score == best.score && run.minClearanceCm > best.minClearanceCm)) {
+        best = run;
+      }
+      run.found = false;
+    }
   }
-  if (reading.angleDeg > PAN_FORWARD_DEG) {
-    radarLeftCm = reading.distanceCm;
-    radarLeftUpdatedMs = reading.capturedMs;
-    radarLeftSampleConfidence = reading.sampleConfidence;
-  } else if (reading.angleDeg < PAN_FORWARD_DEG) {
-    radarRightCm = reading.distanceCm;
-    radarRightUpdatedMs = reading.capturedMs;
-    radarRightSampleConfidence = reading.sampleConfidence;
+  return best;
+}
+float radarHeadingClearanceCm(uint8_t headingDeg, unsigned long nowMs) {
+  // Clearance a turn towards headingDeg would face: the bin at that angle, -1 when it is not fresh.
+  const RadarBin &slot = radarBins[radarBinForAngle(headingDeg)];
+  if (slot.updatedMs == 0 || (nowMs - slot.updatedMs) > RADAR_SIDE_STALE_MS) {
+    return -1.0f;
   }
+  return slot.distanceCm;
+}
+bool radarSectorHasOpening(RadarSector sector, unsigned long nowMs) {
+  uint8_t firstBin = 0;
+  uint8_t lastBin = 0;
+  radarSectorBins(sector, firstBin, lastBin);
+  RadarGap gap = findWidestRadarGap(firstBin * RADAR_BIN_DEG, lastBin * RADAR_BIN_DEG, nowMs, HAZARD_CLEAR_CM);
+  return gap.found && gap.widthDeg >= RADAR_MIN_GAP_DEG;
 }
 void invalidateSideScan() {
-  radarLeftCm = -1.0f;
-  radarRightCm = -1.0f;
-  radarLeftUpdatedMs = 0;
-  radarRightUpdatedMs = 0;
-  radarLeftSampleConfidence = 0;
-  radarRightSampleConfidence = 0;
+  uint8_t frontFirst = 0;
+  uint8_t frontLast = 0;
+  radarSectorBins(RADAR_SECTOR_FRONT, frontFirst, frontLast);
+  for (uint8_t bin = 0; bin < RADAR_BIN_COUNT; bin++) {
+    if (bin < frontFirst || bin > frontLast) {
+      radarBins[bin] = {-1.0f, 0, 0};
+    }
+  }
+#if ROVER_SIMULATION
+  simBenchmarkRadarInvalidate();
+#endif
 }
 bool ultrasonicSampleGapElapsed(unsigned long nowMs) {
   return lastUltrasonicSampleMs == 0 || (nowMs - lastUltrasonicSampleMs) >= ULTRASONIC_SAMPLE_GAP_MS;
@@ -1963,23 +2544,33 @@ const char *scanBestActionString(const SideScanResult &scan) {
   return "NONE";
 }
 SideScanResult getRadarScanSnapshot() {
-  // Convert the live radar buckets into a decision-friendly left/right comparison.
+  // Convert the polar histogram into a decision-friendly left/right comparison.
+  // When both sides are valid, the side whose turn heading has more clearance wins. The widest open gap
+  // only settles a near tie between two clear headings: a wide gap off the heading does not help a
+  // 90-degree turn, and letting it override a clearer heading chose worse sides in the simulator.
   // If neither side is trustworthy, the scan reports BACKWARD as the conservative escape bias.
   SideScanResult result;
-  unsigned long nowMs = millis();
-  bool leftFresh =
-      radarLeftUpdatedMs != 0 &&
-      (nowMs - radarLeftUpdatedMs) <= RADAR_SIDE_STALE_MS;
-  bool rightFresh =
-      radarRightUpdatedMs != 0 &&
-      (nowMs - radarRightUpdatedMs) <= RADAR_SIDE_STALE_MS;
-  result.leftDistanceCm = leftFresh ? radarLeftCm : -1.0f;
-  result.rightDistanceCm = rightFresh ? radarRightCm : -1.0f;
+  unsigned long nowMs = roverNowMs();
+  RadarSectorReading left = radarSectorReading(RADAR_SECTOR_LEFT, nowMs);
+  RadarSectorReading right = radarSectorReading(RADAR_SECTOR_RIGHT, nowMs);
+  bool leftFresh = left.updatedMs != 0 && (nowMs - left.updatedMs) <= RADAR_SIDE_STALE_MS;
+  bool rightFresh = right.updatedMs != 0 && (nowMs - right.updatedMs) <= RADAR_SIDE_STALE_MS;
+  result.leftDistanceCm = leftFresh ? left.distanceCm : -1.0f;
+  result.rightDistanceCm = rightFresh ? right.distanceCm : -1.0f;
+  result.widestGap = findWidestRadarGap(0, 180, nowMs, HAZARD_CLEAR_CM);
   result.bestAction = ACTION_STOP;
   bool leftValid = (result.leftDistanceCm >= ULTRASONIC_MIN_VALID_CM);
   bool rightValid = (result.rightDistanceCm >= ULTRASONIC_MIN_VALID_CM);
-  if (leftValid && rightValid) {
-    result.bestAction = (result.leftDistanceCm >= result.rightDistanceCm) ? ACTION_LEFT : ACTION_RIGHT;
+  bool gapOnLeft = result.widestGap.found && result.widestGap.startDeg > PAN_FORWARD_DEG + PAN_FRONT_WINDOW_DEG;
+  bool gapOnRight = result.widestGap.found && result.widestGap.endDeg < PAN_FORWARD_DEG - PAN_FRONT_WINDOW_DEG;
+  float leftHeadingCm = radarHeadingClearanceCm(PAN_LEFT_DEG, nowMs);
+  float rightHeadingCm = radarHeadingClearanceCm(PAN_RIGHT_DEG, nowMs);
+  bool headingsTied = leftHeadingCm >= HAZARD_CLEAR_CM && rightHeadingCm >= HAZARD_CLEAR_CM &&
+                      fabsf(leftHeadingCm - rightHeadingCm) < RADAR_GAP_TIE_CM;
+  if (leftValid && rightValid && headingsTied && (gapOnLeft || gapOnRight)) {
+    result.bestAction = gapOnLeft ? ACTION_LEFT : ACTION_RIGHT;
+  } else if (leftValid && rightValid) {
+    result.bestAction = (leftHeadingCm >= rightHeadingCm) ? ACTION_LEFT : ACTION_RIGHT;
   } else if (leftValid) {
     result.bestAction = ACTION_LEFT;
   } else if (rightValid) {
@@ -1987,12 +2578,11 @@ SideScanResult getRadarScanSnapshot() {
   } else {
     result.bestAction = ACTION_BACKWARD;
   }
-  Serial.print("Radar snapshot: left=");
-  Serial.print(result.leftDistanceCm);
-  Serial.print("cm right=");
-  Serial.print(result.rightDistanceCm);
-  Serial.print("cm best=");
-  Serial.println(scanBestActionString(result));
+  ROVER_LOG_INFO(LOG_RADAR_SNAPSHOT, result.leftDistanceCm, result.rightDistanceCm, scanBestActionString(result),
+                 result.widestGap.found ? (int)result.widestGap.centerDeg : -1, result.widestGap.widthDeg);
+#if ROVER_SIMULATION
+  simBenchmarkRadarDecision(result, nowMs);
+#endif
   return result;
 }
 void setMotorAction(Action action) {
@@ -2047,10 +2637,7 @@ void setMotorAction(Action action) {
     resetTtcSequence();
     currentDriveMode = DRIVE_PIVOT_RIGHT;
   }
-  Serial.print("Applying request: ");
-  Serial.print(actionToString(requestedAction));
-  Serial.print(" | drive mode: ");
-  Serial.println(driveModeString(currentDriveMode));
+  ROVER_LOG_INFO(LOG_APPLY_REQUEST, actionToString(requestedAction), driveModeString(currentDriveMode));
   switch (action) {
     case ACTION_FORWARD:
       if (previousAction == ACTION_LEFT || previousAction == ACTION_RIGHT || previousAction == ACTION_BACKWARD) {
@@ -2060,33 +2647,33 @@ void setMotorAction(Action action) {
         Serial.print(boostRight);
         Serial.print(" left=");
         Serial.println(boostLeft);
-        robot.MoveBalanced(Forward, boostRight, boostLeft);
+        roverDriveMotors(Forward, boostRight, boostLeft);
         forwardRestartBoostActive = true;
-        forwardRestartBoostUntilMs = millis() + FORWARD_RESTART_BOOST_MS;
+        forwardRestartBoostUntilMs = roverNowMs() + FORWARD_RESTART_BOOST_MS;
         lastAppliedForwardBaseSpeed = adaptiveForwardBaseSpeed;
       } else {
-        robot.MoveBalanced(Forward, rightSpeed, leftSpeed);
+        roverDriveMotors(Forward, rightSpeed, leftSpeed);
         lastAppliedForwardBaseSpeed = adaptiveForwardBaseSpeed;
       }
       break;
     case ACTION_BACKWARD:
-      robot.MoveBalanced(Backward, rightSpeed, leftSpeed);
+      roverDriveMotors(Backward, rightSpeed, leftSpeed);
       break;
     case ACTION_LEFT:
-      robot.MoveBalanced(Move_Left, rightSpeed, leftSpeed);
+      roverDriveMotors(Move_Left, rightSpeed, leftSpeed);
       break;
     case ACTION_RIGHT:
-      robot.MoveBalanced(Move_Right, rightSpeed, leftSpeed);
+      roverDriveMotors(Move_Right, rightSpeed, leftSpeed);
       break;
     default:
-      robot.Move(Stop, 0);
+      roverStopMotors();
       currentMotorAction = ACTION_STOP;
         currentDriveMode = DRIVE_STOPPED;
       return;
   }
   currentMotorAction = action;
   if (action != ACTION_STOP) {
-    lastValidMotorCommandMs = millis();
+    lastValidMotorCommandMs = roverNowMs();
   }
   lastAction = action;
   recordAction(action);
@@ -2137,7 +2724,7 @@ void updateForwardRestartBoost(unsigned long nowMs) {
     leftSpeed = MIN_DRIVE_LEFT_PWM;
   }
   Serial.println("Forward restart boost complete; applying cruise forward PWM");
-  robot.MoveBalanced(Forward, rightSpeed, leftSpeed);
+  roverDriveMotors(Forward, rightSpeed, leftSpeed);
   forwardRestartBoostActive = false;
   lastAppliedForwardBaseSpeed = adaptiveForwardBaseSpeed;
 }
@@ -2167,7 +2754,7 @@ void applySteeringDrive(int direction, float rightScale, float leftScale) {
       rightSpeed = MIN_STEER_INNER_PWM;
     }
   }
-  robot.MoveBalanced(direction, rightSpeed, leftSpeed);
+  roverDriveMotors(direction, rightSpeed, leftSpeed);
 }
 void setSteeringManeuver(Action action, bool reverseDrive) {
   // Steering maneuvers are short pulses, not open-ended turns.
@@ -2178,14 +2765,10 @@ void setSteeringManeuver(Action action, bool reverseDrive) {
       : (action == ACTION_LEFT ? DRIVE_PIVOT_LEFT : DRIVE_PIVOT_RIGHT);
   resetTtcSequence();
   currentDriveMode = proposedDriveMode;
-  Serial.print("Applying steering request: ");
-  Serial.print(actionToString(requestedAction));
-  Serial.print(" | drive mode: ");
-  Serial.println(driveModeString(currentDriveMode));
+  ROVER_LOG_INFO(LOG_APPLY_STEERING_REQUEST, actionToString(requestedAction), driveModeString(currentDriveMode));
   int driveDirection = reverseDrive ? Backward : Forward;
-  unsigned long nowMs = millis();
+  unsigned long nowMs = roverNowMs();
   NavigationSnapshot snapshot = buildNavigationSnapshot(nowMs);
-  SideScanResult safetyScan = getRadarScanSnapshot();
   bool frontBlocked = snapshot.frontBlocked;
   if (frontBlocked && driveModeHasForwardMotion(proposedDriveMode)) {
     Serial.println("Safety override: rejecting steering mode with forward motion while front blocked");
@@ -2203,28 +2786,28 @@ void setSteeringManeuver(Action action, bool reverseDrive) {
   }
   currentMotorAction = action;
   requestedAction = action;
-  lastValidMotorCommandMs = millis();
+  lastValidMotorCommandMs = roverNowMs();
   lastAction = action;
   recordAction(action);
 }
 void startManeuver(Action maneuverAction, unsigned long durationMs, Action resumeAction) {
   maneuverResumeAction = resumeAction;
-  maneuverUntilMs = millis() + durationMs;
+  maneuverUntilMs = roverNowMs() + durationMs;
   roverState = STATE_MANEUVERING;
   maneuverUsesSteering = false;
   activeManeuverAction = maneuverAction;
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   applyMotorAction(maneuverAction, snapshot);
 }
 void startSteeringManeuver(Action maneuverAction, unsigned long durationMs, Action resumeAction, bool reverseDrive) {
   maneuverResumeAction = resumeAction;
-  maneuverUntilMs = millis() + durationMs;
+  maneuverUntilMs = roverNowMs() + durationMs;
   roverState = STATE_MANEUVERING;
   maneuverUsesSteering = true;
   activeManeuverAction = maneuverAction;
   if (turnPulsesExecuted == 1) {
     turnSequenceStartCm = estimateFrontClearanceCm();
-    turnSequenceStartedMs = millis();
+    turnSequenceStartedMs = roverNowMs();
   }
   turnReverseDrive = reverseDrive;
   setSteeringManeuver(maneuverAction, reverseDrive);
@@ -2232,7 +2815,8 @@ void startSteeringManeuver(Action maneuverAction, unsigned long durationMs, Acti
 void beginDecisionManeuver(Action decision) {
   // Translate a high-level decision into a bounded maneuver sequence.
   // Left/right become pulsed steering turns; backward becomes a timed reverse; forward resumes roaming.
-  NavigationSnapshot snapshot = buildNavigationSnapshot(millis());
+  traceRecord(TRACE_DECISION, (uint8_t)decision, 0, 0, 0.0f);
+  NavigationSnapshot snapshot = buildNavigationSnapshot(roverNowMs());
   switch (decision) {
     case ACTION_LEFT:
       Serial.println("Executing pulsed left steering turn until clearance improves");
@@ -2355,8 +2939,11 @@ void updateManeuverState(unsigned long now) {
     hazardClearArmed = !obstacleNearby;
     return;
   }
-  Serial.println("Maneuver complete, checking distance before resuming forward");
-  DirectionalReading postTurnReading = readDirectionalUltrasonic(panCurrentDeg);
+  DirectionalReading postTurnReading;
+  if (!pollDirectionalUltrasonic(panCurrentDeg, postTurnReading)) {
+    return;
+  }
+  Serial.println("Maneuver complete, checked distance before resuming forward");
   bool immediatePostTurnHazard = applyImmediatePostManeuverHazardCheck(postTurnReading);
   bool validPostTurnReading = postTurnReading.valid;
   maneuverUsesSteering = false;
@@ -2382,19 +2969,14 @@ void updateManeuverState(unsigned long now) {
   setMotorAction(maneuverResumeAction);
   hazardClearArmed = true;
 }
-float readUltrasonicCm() {
-  // Driver wrapper around the sensor library with serial diagnostics for both successful reads and no-echo cases.
-  float distance = sensor.Ranging();
-  unsigned long pulseWidthUs = sensor.LastPulseWidthUs();
+float recordUltrasonicRanging(float distance, unsigned long pulseWidthUs) {
+  // Trace and serial diagnostics for one finished ranging, for both successful reads and no-echo cases.
+  traceRecord(TRACE_RANGING, 0, 0, (int32_t)pulseWidthUs, distance);
   if (distance < 0.0f) {
-    Serial.print("Ultrasonic: no echo | pulseWidthUs=");
-    Serial.println(pulseWidthUs);
+    ROVER_LOG_INFO(LOG_ULTRASONIC_NO_ECHO, pulseWidthUs);
     return -1.0f;
   }
-  Serial.print("Ultrasonic: ");
-  Serial.print(distance);
-  Serial.print(" cm | pulseWidthUs=");
-  Serial.println(pulseWidthUs);
+  ROVER_LOG_INFO(LOG_ULTRASONIC_RANGE, distance, pulseWidthUs);
   return distance;
 }
 bool updateHazardFromDistance(float distanceCm) {
@@ -2469,22 +3051,10 @@ Action queryGeminiForObstacleTurnBlocking(const NavigationSnapshot &snapshot, Ac
                                                    discouragedOscillationAction),
                               snapshot, scan);
   }
-  WiFiClientSecure secureClient;
-  // TODO: prototype-only transport; replace with certificate validation before production use.
-  secureClient.setInsecure();
-  HTTPClient http;
-  // TODO: prototype-only key handling; move the API key out of the query string before production use.
-  String url = String(GEMINI_URL) + "?key=" + String(GEMINI_API_KEY);
-  if (!http.begin(secureClient, url)) {
-    Serial.println("Gemini: HTTP begin failed");
-    return validateSafeAction(chooseLocalFallback(snapshot.frontCm, scan, physicallyBlockedAction,
-                                                   discouragedOscillationAction),
-                              snapshot, scan);
-  }
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(GEMINI_HTTP_TIMEOUT_MS);
-  String recentActions = recentActionsString(6);
-  String recentOutcomes = recentManeuverOutcomesString(4);
+  char recentActions[64];
+  char recentOutcomes[320];
+  formatRecentActions(recentActions, sizeof(recentActions), 6);
+  formatRecentManeuverOutcomes(recentOutcomes, sizeof(recentOutcomes), 4);
   const char *currentTurnDirection = currentTurnDirectionString(previousAction);
   const char *bestFromScan = scanBestActionString(scan);
   const char *hazardClass = hazardClassString(snapshot.frontCm);
@@ -2497,26 +3067,27 @@ Action queryGeminiForObstacleTurnBlocking(const NavigationSnapshot &snapshot, Ac
   const char *discouragedAction = actionToString(discouragedOscillationAction);
   SafeActionSet safeActions = buildSafeActionSet(snapshot, scan);
   Action localRecommendation = chooseBestActionFromSafeSet(safeActions, physicallyBlockedAction, discouragedOscillationAction);
-  String safeActionList = safeActionSetString(safeActions);
+  char safeActionList[32];
+  formatSafeActionSet(safeActions, safeActionList, sizeof(safeActionList));
   const char *localRecommendationText = actionToString(localRecommendation);
-  DynamicJsonDocument requestDoc(4096);
-  char prompt[2400];
+  char *prompt = geminiPromptBuffer;
+  const size_t promptCapacity = sizeof(geminiPromptBuffer);
   size_t promptLen = 0;
   auto appendPrompt = [&](const char *format, ...) {
-    if (promptLen >= sizeof(prompt)) {
+    if (promptLen >= promptCapacity) {
       return;
     }
     va_list args;
     va_start(args, format);
-    int written = vsnprintf(prompt + promptLen, sizeof(prompt) - promptLen, format, args);
+    int written = vsnprintf(prompt + promptLen, promptCapacity - promptLen, format, args);
     va_end(args);
     if (written < 0) {
-      promptLen = sizeof(prompt) - 1;
+      promptLen = promptCapacity - 1;
       prompt[promptLen] = '\0';
       return;
     }
-    if ((size_t)written >= sizeof(prompt) - promptLen) {
-      promptLen = sizeof(prompt) - 1;
+    if ((size_t)written >= promptCapacity - promptLen) {
+      promptLen = promptCapacity - 1;
     } else {
       promptLen += (size_t)written;
     }
@@ -2530,6 +3101,7 @@ Action queryGeminiForObstacleTurnBlocking(const NavigationSnapshot &snapshot, Ac
     return gate.localRecommendation;
   }
 
+  prompt[0] = '\0';
   appendPrompt("You are the navigation controller for a small autonomous robot car.\n");
   appendPrompt("Robot context:\n");
   appendPrompt("- Floor-level robot, common obstacles: walls, boxes, table legs\n");
@@ -2581,202 +3153,1609 @@ Action queryGeminiForObstacleTurnBlocking(const NavigationSnapshot &snapshot, Ac
   appendPrompt("right_valid=%d\n", snapshot.rightValid ? 1 : 0);
   appendPrompt("front_blocked=%d\n", snapshot.frontBlocked ? 1 : 0);
   appendPrompt("no_echo_streak=%u\n", ultrasonicNoEchoStreak);
-  appendPrompt("recent_actions=%s\n", recentActions.c_str());
-  appendPrompt("recent_maneuver_outcomes=%s\n", recentOutcomes.c_str());
+  appendPrompt("recent_actions=%s\n", recentActions);
+  appendPrompt("recent_maneuver_outcomes=%s\n", recentOutcomes);
   appendPrompt("escape_attempt_stage=%s\n", escapeStage);
   appendPrompt("requested_action=%s\n", requestedMotion);
   appendPrompt("current_drive_mode=%s\n", currentDriveModeText);
   appendPrompt("current_turn_direction=%s\n", currentTurnDirection);
   appendPrompt("physically_blocked_action=%s\n", blockedAction);
   appendPrompt("discouraged_oscillation_action=%s\n", discouragedAction);
-  appendPrompt("safe_actions=%s\n", safeActionList.c_str());
+  appendPrompt("safe_actions=%s\n", safeActionList);
   appendPrompt("local_recommendation=%s\n", localRecommendationText);
   appendPrompt("left_scan_cm=%.1f\n", scan.leftDistanceCm);
   appendPrompt("right_scan_cm=%.1f\n", scan.rightDistanceCm);
   appendPrompt("best_scan_action=%s\n", bestFromScan);
-  JsonObject content = requestDoc["contents"].createNestedObject();
-  JsonArray parts = content["parts"].to<JsonArray>();
-  JsonObject part = parts.createNestedObject();
-  part["text"] = prompt;
-  JsonObject generationConfig = requestDoc["generationConfig"].to<JsonObject>();
-  generationConfig["temperature"] = 0.2;
-  generationConfig["maxOutputTokens"] = GEMINI_MAX_OUTPUT_TOKENS;
-  String requestBody;
-  serializeJson(requestDoc, requestBody);
-  int statusCode = http.POST(requestBody);
-  printHeapDiagnostics("after first TLS request");
-  String responseBody = http.getString();
-  http.end();
-  if (statusCode < 200 || statusCode >= 300) {
-    Serial.print("Gemini HTTP error: ");
-    Serial.println(statusCode);
-    return validateSafeAction(chooseLocalFallback(snapshot.frontCm, scan, physicallyBlockedAction,
-                                                   discouragedOscillationAction),
-                              snapshot, scan);
-  }
-  StaticJsonDocument<2048> responseDoc;
-  DeserializationError err = deserializeJson(responseDoc, responseBody);
-  if (err) {
-    Serial.print("Gemini JSON parse error: ");
-    Serial.println(err.c_str());
+  // Pan angles: 0 = right, 90 = ahead, 180 = left.
+  appendPrompt("widest_gap_center_deg=%d\n", scan.widestGap.found ? (int)scan.widestGap.centerDeg : -1);
+  appendPrompt("widest_gap_width_deg=%u\n", (unsigned)scan.widestGap.widthDeg);
+  appendPrompt("widest_gap_clearance_cm=%.1f\n", scan.widestGap.found ? scan.widestGap.minClearanceCm : -1.0f);
+  // Race the prompt across every configured backend; the first answer inside the safe set wins
+  // and the slower requests are cancelled.
+  char modelText[DECISION_BROKER_ANSWER_BYTES];
+  int8_t winner = -1;
+  bool answered = decisionBroker.race(prompt, decisionAnswerIsSafe, &safeActions, DECISION_RACE_TIMEOUT_MS,
+                                      modelText, sizeof(modelText), winner);
+  decisionBroker.printStats(Serial);
+  if (!answered) {
+    Serial.println("Decision race: no backend returned a safe action in time");
     return validateSafeAction(chooseLocalFallback(snapshot.frontCm, scan, physicallyBlockedAction,
                                                    discouragedOscillationAction),
                               snapshot, scan);
   }
-  printHeapDiagnostics("after Gemini response parsing");
-  JsonArray candidates = responseDoc["candidates"].as<JsonArray>();
-  if (candidates.isNull() || candidates.size() == 0) {
-    Serial.println("Gemini response rejected: missing candidates");
-    return localRecommendation;
-  }
-  JsonArray responseParts = candidates[0]["content"]["parts"].as<JsonArray>();
-  if (responseParts.isNull() || responseParts.size() == 0) {
-    Serial.println("Gemini response rejected: missing content parts");
-    return localRecommendation;
-  }
-  const char *modelText = responseParts[0]["text"];
-  if (modelText == nullptr || modelText[0] == '\0') {
-    Serial.println("Gemini response rejected: missing text content");
-    return localRecommendation;
-  }
-  ParsedAction parsedDecision = parseActionFromText(modelText);
-  if (!parsedDecision.valid) {
-    Serial.println("Gemini response rejected: malformed or unrecognized JSON action");
-    return validateSafeAction(localRecommendation, snapshot, scan);
-  }
-  Action decision = parsedDecision.action;
-  if (!actionIsInSafeSet(decision, safeActions)) {
-    Serial.println("Gemini response rejected: action not in safe set");
-    return localRecommendation;
-  }
+  Action decision = parseActionFromText(modelText).action;
   if (decision == physicallyBlockedAction) {
     Serial.println("Gemini proposed retraction; selecting fallback instead");
     return validateSafeAction(localRecommendation, snapshot, scan);
   }
   decision = chooseSmartAction(decision, physicallyBlockedAction, discouragedOscillationAction);
   decision = validateSafeAction(decision, snapshot, scan);
-  Serial.print("Decision source: Gemini | decision=");
+  Serial.print("Decision source: ");
+  Serial.print(decisionBroker.backend(winner).name);
+  Serial.print(" | decision=");
   Serial.println(actionToString(decision));
   return decision;
 }
-void geminiDecisionWorkerTask(void *parameter) {
-  // Background task wrapper so network latency never blocks loop().
-  GeminiDecisionRequestArgs *request = static_cast<GeminiDecisionRequestArgs *>(parameter);
-  Action decision = queryGeminiForObstacleTurnBlocking(request->snapshot, request->previousAction, request->scan,
-                                                       request->templateType);
-  if (geminiDecisionResultQueue != nullptr) {
-    GeminiDecisionResultMessage result;
-    result.generation = request->generation;
-    result.decision = decision;
-    xQueueOverwrite(geminiDecisionResultQueue, &result);
+bool decisionAnswerIsSafe(const char *answer, void *context) {
+  // Race validator: the answer must parse as a JSON action and name one of the safe actions.
+  ParsedAction parsed = parseActionFromText(answer);
+  return parsed.valid && actionIsInSafeSet(parsed.action, *static_cast<const SafeActionSet *>(context));
+}
+bool geminiRaceCall(DecisionBackend &backend, const char *prompt, char *answer, size_t answerSize) {
+  // Gemini backend for the decision race. Streams the request from the prompt buffer and scans the reply
+  // for the model text. A reused socket may have been closed by Gemini while idle; retry once on a fresh
+  // connection. readGeminiByte() gives up as soon as the race is decided elsewhere.
+  geminiRaceBackend = &backend;
+  unsigned long callStartMs = millis();
+  GeminiHeapProbe heapProbe;
+  startGeminiHeapProbe(heapProbe);
+  GeminiTextScanner scanner;
+  int statusCode = -1;
+  for (uint8_t attempt = 0; attempt < 2 && !backend.abortRequested(); attempt++) {
+    bool reusedConnection = false;
+    if (!ensureGeminiConnection(reusedConnection) || backend.abortRequested()) {
+      break;
+    }
+    sampleGeminiHeapProbe(heapProbe);
+    unsigned long requestStartMs = millis();
+    statusCode = sendGeminiRequest(prompt);
+    if (statusCode == 0) {
+      statusCode = readGeminiResponse(scanner, heapProbe);
+    }
+    if (statusCode > 0) {
+      recordGeminiLatency(millis() - requestStartMs, reusedConnection);
+      printGeminiLatencyHistogram();
+      break;
+    }
+    geminiSecureClient.stop();
+    if (!reusedConnection || backend.abortRequested()) {
+      break;
+    }
+    Serial.println("Gemini: pooled connection went stale, reconnecting");
+  }
+  sampleGeminiHeapProbe(heapProbe);
+  printGeminiHeapProbe(heapProbe);
+  if (backend.abortRequested()) {
+    return false;
+  }
+  // A reply that never completed within the read deadline counts against the timeout budget.
+  uint32_t callMs = millis() - callStartMs;
+  bool httpOk = statusCode >= 200 && statusCode < 300;
+  LatencyBreakerOutcome breakerOutcome = LATENCY_BREAKER_OK;
+  if (!httpOk) {
+    breakerOutcome = callMs >= GEMINI_HTTP_TIMEOUT_MS ? LATENCY_BREAKER_TIMEOUT : LATENCY_BREAKER_HTTP_ERROR;
+  }
+  geminiBreaker.record(breakerOutcome, callMs, millis());
+  if (!httpOk) {
+    Serial.print("Gemini HTTP error: ");
+    Serial.println(statusCode);
+    return false;
+  }
+  if (scanner.state != GEMINI_SCAN_DONE || scanner.textLen == 0) {
+    Serial.println("Gemini response rejected: missing text content");
+    return false;
+  }
+  if (scanner.textTruncated) {
+    Serial.println("Gemini response rejected: text content too long");
+    return false;
   }
-  geminiDecisionTaskHandle = nullptr;
-  delete request;
-  vTaskDelete(nullptr);
+  snprintf(answer, answerSize, "%s", scanner.text);
+  return true;
 }
-bool startGeminiDecisionRequest(const NavigationSnapshot &snapshot, Action previousAction, const SideScanResult &scan,
-                                GeminiPromptTemplate templateType) {
-  // Fire exactly one asynchronous Gemini request at a time and remember the local fallback
-  // that should be used if the request later fails or times out.
-  if (geminiDecisionResultQueue == nullptr) {
+bool ollamaRaceTokenCallback(const String &textSoFar, void *context) {
+  // Stop reading once the JSON object has closed or another backend already won.
+  const DecisionBackend *backend = static_cast<const DecisionBackend *>(context);
+  return !backend->abortRequested() && textSoFar.indexOf('}') < 0;
+}
+bool ollamaRaceCall(DecisionBackend &backend, const char *prompt, char *answer, size_t answerSize) {
+  // Ollama backend for the decision race: plain HTTP on the LAN, streamed so the request can be dropped
+  // between tokens when Gemini answers first.
+  JsonDocument requestDoc;
+  requestDoc["model"] = OLLAMA_MODEL;
+  requestDoc["prompt"] = prompt;
+  requestDoc["stream"] = true;
+  requestDoc["format"] = "json";
+  requestDoc["keep_alive"] = "30m";
+  JsonObject options = requestDoc["options"].to<JsonObject>();
+  options["temperature"] = 0.2;
+  options["num_predict"] = GEMINI_MAX_OUTPUT_TOKENS;
+  String requestBody;
+  serializeJson(requestDoc, requestBody);
+  HTTPClient http;
+  if (!http.begin(OLLAMA_URL)) {
     return false;
   }
-  if (geminiDecisionTaskHandle != nullptr) {
+  http.addHeader("Content-Type", "application/json");
+  http.setTimeout(OLLAMA_HTTP_TIMEOUT_MS);
+  http.useHTTP10(true);
+  unsigned long callStartMs = millis();
+  int statusCode = http.POST(requestBody);
+  if (statusCode != HTTP_CODE_OK || backend.abortRequested()) {
+    if (!backend.abortRequested()) {
+      ollamaBreaker.record(statusCode == HTTPC_ERROR_READ_TIMEOUT ? LATENCY_BREAKER_TIMEOUT
+                                                                  : LATENCY_BREAKER_HTTP_ERROR,
+                           millis() - callStartMs, millis());
+      Serial.print("Ollama HTTP error: ");
+      Serial.println(statusCode);
+    }
+    http.end();
     return false;
   }
-  if (geminiDecisionRequestState == GEMINI_REQUEST_PENDING) {
+  OllamaStreamResult streamed;
+  readOllamaStream(http, ollamaRaceTokenCallback, &backend, streamed);
+  http.end();
+  if (backend.abortRequested()) {
     return false;
   }
-  if (geminiDecisionRequestState == GEMINI_REQUEST_TIMED_OUT) {
+  // A stream that produced no text before its read timeout counts as a timeout.
+  ollamaBreaker.record(streamed.text.length() > 0 ? LATENCY_BREAKER_OK : LATENCY_BREAKER_TIMEOUT,
+                       millis() - callStartMs, millis());
+  if (streamed.text.length() == 0) {
     return false;
   }
-  if (WiFi.status() != WL_CONNECTED) {
+  snprintf(answer, answerSize, "%s", streamed.text.c_str());
+  return true;
+}
+bool parseGeminiUrl(const char *url) {
+  // Split GEMINI_URL ("https://host/path") once so requests can be written without building Strings.
+  const char *scheme = "https://";
+  if (strncmp(url, scheme, strlen(scheme)) != 0) {
     return false;
   }
-  GeminiDecisionRequestArgs *request = new GeminiDecisionRequestArgs;
-  if (request == nullptr) {
+  const char *hostStart = url + strlen(scheme);
+  const char *pathStart = strchr(hostStart, '/');
+  size_t hostLen = pathStart != nullptr ? (size_t)(pathStart - hostStart) : strlen(hostStart);
+  if (hostLen == 0 || hostLen >= sizeof(geminiHost)) {
     return false;
   }
-  request->snapshot = snapshot;
-  request->previousAction = previousAction;
-  request->scan = scan;
-  request->templateType = templateType;
-  request->generation = ++geminiRequestGeneration;
-  geminiDecisionFallbackAction = chooseLocalEscapeActionForStage(snapshot, scan, previousAction);
-  geminiDecisionRequestStartedMs = millis();
-  geminiDecisionRequestState = GEMINI_REQUEST_PENDING;
-  GeminiDecisionResultMessage staleResult;
-  while (xQueueReceive(geminiDecisionResultQueue, &staleResult, 0) == pdPASS) {
+  memcpy(geminiHost, hostStart, hostLen);
+  geminiHost[hostLen] = '\0';
+  int written = snprintf(geminiPath, sizeof(geminiPath), "%s", pathStart != nullptr ? pathStart : "/");
+  return written > 0 && (size_t)written < sizeof(geminiPath);
+}
+bool ensureGeminiConnection(bool &reusedConnection) {
+  // Reuse the pooled socket when it is still open and idle; otherwise pay for one TLS handshake.
+  if (geminiSecureClient.connected()) {
+    while (geminiSecureClient.available() > 0) {
+      geminiSecureClient.read();
+    }
+    reusedConnection = true;
+    return true;
   }
-  BaseType_t taskCreated = xTaskCreatePinnedToCore(geminiDecisionWorkerTask, "GeminiDecision", 8192, request, 1,
-                                                   const_cast<TaskHandle_t *>(&geminiDecisionTaskHandle), 1);
-  if (taskCreated != pdPASS) {
-    geminiDecisionRequestState = GEMINI_REQUEST_FAILED;
-    geminiDecisionTaskHandle = nullptr;
-    geminiRequestGeneration = request->generation;
-    delete request;
+  reusedConnection = false;
+  geminiSecureClient.stop();
+  if (!geminiSecureClient.connect(geminiHost, 443)) {
+    Serial.println("Gemini: TLS connect failed");
     return false;
   }
-  printHeapDiagnostics("after Gemini task creation");
   return true;
 }
-bool updateGeminiDecisionRequest(unsigned long nowMs, Action &decisionOut) {
-  // Poll the async request state without blocking.
-  // If the reply is late, the main loop marks the request timed out and stays on local logic.
-  GeminiDecisionResultMessage result;
-  while (geminiDecisionRequestState == GEMINI_REQUEST_PENDING && geminiDecisionResultQueue != nullptr &&
-         xQueueReceive(geminiDecisionResultQueue, &result, 0) == pdPASS) {
-    if (result.generation != geminiRequestGeneration) {
-      continue;
+void geminiWriterFlush(GeminiRequestWriter &writer) {
+  if (writer.client != nullptr && writer.used > 0 && !writer.failed) {
+    if (writer.client->write((const uint8_t *)geminiTxBuffer, writer.used) != writer.used) {
+      writer.failed = true;
     }
-    decisionOut = result.decision;
-    geminiDecisionRequestState = GEMINI_REQUEST_READY;
-    break;
   }
-  if (geminiDecisionRequestState == GEMINI_REQUEST_READY) {
-    geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
-    return true;
+  writer.used = 0;
+}
+void geminiWriterPut(GeminiRequestWriter &writer, char c) {
+  writer.total++;
+  if (writer.client == nullptr) {
+    return;
   }
-  if (geminiDecisionRequestState == GEMINI_REQUEST_TIMED_OUT) {
-    if (geminiDecisionTaskHandle == nullptr) {
-      if (geminiDecisionResultQueue != nullptr) {
-        while (xQueueReceive(geminiDecisionResultQueue, &result, 0) == pdPASS) {
+  if (writer.used == sizeof(geminiTxBuffer)) {
+    geminiWriterFlush(writer);
+  }
+  geminiTxBuffer[writer.used++] = c;
+}
+void geminiWriterPutString(GeminiRequestWriter &writer, const char *text) {
+  while (*text != '\0') {
+    geminiWriterPut(writer, *text++);
+  }
+}
+void geminiWriterPutJsonEscaped(GeminiRequestWriter &writer, const char *text) {
+  // Same escaping serializeJson applies to the prompt text.
+  for (; *text != '\0'; text++) {
+    char c = *text;
+    switch (c) {
+      case '"':
+        geminiWriterPutString(writer, "\\\"");
+        break;
+      case '\\':
+        geminiWriterPutString(writer, "\\\\");
+        break;
+      case '\n':
+        geminiWriterPutString(writer, "\\n");
+        break;
+      case '\r':
+        geminiWriterPutString(writer, "\\r");
+        break;
+      case '\t':
+        geminiWriterPutString(writer, "\\t");
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char escaped[7];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+          geminiWriterPutString(writer, escaped);
+        } else {
+          geminiWriterPut(writer, c);
         }
-      }
-      geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
+        break;
     }
-    return false;
   }
-  if (geminiDecisionRequestState != GEMINI_REQUEST_PENDING) {
-    return false;
+}
+void writeGeminiRequestBody(GeminiRequestWriter &writer, const char *prompt) {
+  // {"contents":[{"parts":[{"text":"..."}]}],"generationConfig":{"temperature":0.2,"maxOutputTokens":N}}
+  char maxTokens[8];
+  snprintf(maxTokens, sizeof(maxTokens), "%u", GEMINI_MAX_OUTPUT_TOKENS);
+  geminiWriterPutString(writer, "{\"contents\":[{\"parts\":[{\"text\":\"");
+  geminiWriterPutJsonEscaped(writer, prompt);
+  geminiWriterPutString(writer, "\"}]}],\"generationConfig\":{\"temperature\":0.2,\"maxOutputTokens\":");
+  geminiWriterPutString(writer, maxTokens);
+  geminiWriterPutString(writer, "}}");
+}
+int sendGeminiRequest(const char *prompt) {
+  // Returns 0 once the whole request is on the socket, -1 if a write failed.
+  GeminiRequestWriter counter = {nullptr, 0, 0, false};
+  writeGeminiRequestBody(counter, prompt);
+  char contentLength[12];
+  snprintf(contentLength, sizeof(contentLength), "%u", (unsigned)counter.total);
+
+  GeminiRequestWriter writer = {&geminiSecureClient, 0, 0, false};
+  geminiWriterPutString(writer, "POST ");
+  geminiWriterPutString(writer, geminiPath);
+  // TODO: prototype-only key handling; move the API key out of the query string before production use.
+  geminiWriterPutString(writer, "?key=");
+  geminiWriterPutString(writer, GEMINI_API_KEY);
+  geminiWriterPutString(writer, " HTTP/1.1\r\nHost: ");
+  geminiWriterPutString(writer, geminiHost);
+  geminiWriterPutString(writer, "\r\nContent-Type: application/json\r\nContent-Length: ");
+  geminiWriterPutString(writer, contentLength);
+  geminiWriterPutString(writer, "\r\nConnection: keep-alive\r\n\r\n");
+  writeGeminiRequestBody(writer, prompt);
+  geminiWriterFlush(writer);
+  return writer.failed ? -1 : 0;
+}
+int readGeminiByte(unsigned long deadlineMs) {
+  // Next byte from the socket, or -1 once the deadline passes, the peer closed with nothing buffered,
+  // or another backend won the decision race.
+  while (geminiSecureClient.available() <= 0) {
+    if (!geminiSecureClient.connected() || (long)(millis() - deadlineMs) >= 0 ||
+        (geminiRaceBackend != nullptr && geminiRaceBackend->abortRequested())) {
+      return -1;
+    }
+    delay(1);
   }
-  if ((nowMs - geminiDecisionRequestStartedMs) >= GEMINI_DECISION_REQUEST_TIMEOUT_MS) {
-    Serial.println("Gemini async timeout: using local decision");
-    decisionOut = geminiDecisionFallbackAction;
-    geminiDecisionRequestState = GEMINI_REQUEST_TIMED_OUT;
-    return false;
+  return geminiSecureClient.read();
+}
+size_t readGeminiLine(char *line, size_t lineSize, unsigned long deadlineMs, bool &ok) {
+  // Reads one CRLF-terminated line; characters past lineSize are dropped.
+  size_t len = 0;
+  ok = false;
+  while (true) {
+    int c = readGeminiByte(deadlineMs);
+    if (c < 0) {
+      line[len] = '\0';
+      return len;
+    }
+    if (c == '\n') {
+      break;
+    }
+    if (c != '\r' && len < lineSize - 1) {
+      line[len++] = (char)c;
+    }
   }
-  return false;
+  line[len] = '\0';
+  ok = true;
+  return len;
 }
+void feedGeminiTextScanner(GeminiTextScanner &scanner, char c) {
+  switch (scanner.state) {
+    case GEMINI_SCAN_OUTSIDE:
+      if (c == '"') {
+        scanner.keyLen = 0;
+        scanner.keyTooLong = false;
+        scanner.state = GEMINI_SCAN_KEY;
+      }
+      break;
+    case GEMINI_SCAN_KEY:
+      if (c == '\\') {
+        scanner.keyTooLong = true;
+        scanner.state = GEMINI_SCAN_KEY_ESCAPE;
+      } else if (c == '"') {
+        scanner.key[scanner.keyLen] = '\0';
+        bool isTextKey = !scanner.keyTooLong && strcmp(scanner.key, "text") == 0;
+        scanner.state = isTextKey ? GEMINI_SCAN_AFTER_KEY : GEMINI_SCAN_OUTSIDE;
+      } else if (scanner.keyLen < sizeof(scanner.key) - 1) {
+        scanner.key[scanner.keyLen++] = c;
+      } else {
+        scanner.keyTooLong = true;
+      }
+      break;
+    case GEMINI_SCAN_KEY_ESCAPE:
+      scanner.state = GEMINI_SCAN_KEY;
+      break;
+    case GEMINI_SCAN_AFTER_KEY:
+      if (c == ':') {
+        scanner.state = GEMINI_SCAN_VALUE_START;
+      } else if (!isspace((unsigned char)c)) {
+        // "text" was a value, not a key; this byte may start the next string.
+        scanner.state = GEMINI_SCAN_OUTSIDE;
+        feedGeminiTextScanner(scanner, c);
+      }
+      break;
+    case GEMINI_SCAN_VALUE_START:
+      if (c == '"') {
+        scanner.state = GEMINI_SCAN_VALUE;
+      } else if (!isspace((unsigned char)c)) {
+        scanner.state = GEMINI_SCAN_OUTSIDE;
+      }
+      break;
+    case GEMINI_SCAN_VALUE:
+      if (scanner.unicodeDigitsToSkip > 0) {
+        scanner.unicodeDigitsToSkip--;
+        break;
+      }
+      if (c == '\\') {
+        scanner.state = GEMINI_SCAN_VALUE_ESCAPE;
+        break;
+      }
+      if (c == '"') {
+        scanner.text[scanner.textLen] = '\0';
+        scanner.state = GEMINI_SCAN_DONE;
+        break;
+      }
+      if (scanner.textLen < sizeof(scanner.text) - 1) {
+        scanner.text[scanner.textLen++] = c;
+      } else {
+        scanner.textTruncated = true;
+      }
+      break;
+    case GEMINI_SCAN_VALUE_ESCAPE: {
+      char decoded = c;
+      if (c == 'n') {
+        decoded = '\n';
+      } else if (c == 't') {
+        decoded = '\t';
+      } else if (c == 'r') {
+        decoded = '\r';
+      } else if (c == 'u') {
+        // Non-ASCII never forms a valid action; keep a placeholder so parsing rejects it.
+        decoded = '?';
+        scanner.unicodeDigitsToSkip = 4;
+      }
+      if (scanner.textLen < sizeof(scanner.text) - 1) {
+        scanner.text[scanner.textLen++] = decoded;
+      } else {
+        scanner.textTruncated = true;
+      }
+      scanner.state = GEMINI_SCAN_VALUE;
+      break;
+    }
+    case GEMINI_SCAN_DONE:
+      break;
+  }
+}
+int readGeminiResponse(GeminiTextScanner &scanner, GeminiHeapProbe &heapProbe) {
+  // Parses the status line and headers, then feeds the body (plain or chunked) through the
+  // text scanner. The body is always read to the end so the connection can be reused.
+  memset(&scanner, 0, sizeof(scanner));
+  unsigned long deadlineMs = millis() + GEMINI_HTTP_TIMEOUT_MS;
+  char line[128];
+  bool ok = false;
+  readGeminiLine(line, sizeof(line), deadlineMs, ok);
+  if (!ok || strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+    return -1;
+  }
+  int statusCode = atoi(line + 9);
+  sampleGeminiHeapProbe(heapProbe);
+
+  long contentLength = -1;
+  bool chunked = false;
+  bool closeAfter = false;
+  while (true) {
+    size_t len = readGeminiLine(line, sizeof(line), deadlineMs, ok);
+    if (!ok) {
+      return -1;
+    }
+    if (len == 0) {
+      break;
+    }
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      contentLength = atol(line + 15);
+    } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line + 18, "chunked") != nullptr) {
+      chunked = true;
+    } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close") != nullptr) {
+      closeAfter = true;
+    }
+  }
+
+  bool complete = false;
+  if (chunked) {
+    while (true) {
+      readGeminiLine(line, sizeof(line), deadlineMs, ok);
+      if (!ok) {
+        break;
+      }
+      long chunkSize = strtol(line, nullptr, 16);
+      if (chunkSize <= 0) {
+        // Last chunk: skip optional trailers up to the blank line.
+        while (readGeminiLine(line, sizeof(line), deadlineMs, ok) > 0 && ok) {
+        }
+        complete = ok;
+        break;
+      }
+      for (; chunkSize > 0; chunkSize--) {
+        int c = readGeminiByte(deadlineMs);
+        if (c < 0) {
+          break;
+        }
+        feedGeminiTextScanner(scanner, (char)c);
+      }
+      if (chunkSize > 0) {
+        break;
+      }
+      readGeminiLine(line, sizeof(line), deadlineMs, ok);  // CRLF after chunk data
+      if (!ok) {
+        break;
+      }
+    }
+  } else if (contentLength >= 0) {
+    for (; contentLength > 0; contentLength--) {
+      int c = readGeminiByte(deadlineMs);
+      if (c < 0) {
+        break;
+      }
+      feedGeminiTextScanner(scanner, (char)c);
+    }
+    complete = (contentLength == 0);
+  } else {
+    // No length given: the body runs until Gemini closes the socket.
+    int c;
+    while ((c = readGeminiByte(deadlineMs)) >= 0) {
+      feedGeminiTextScanner(scanner, (char)c);
+    }
+    closeAfter = true;
+  }
+  if (!complete || closeAfter) {
+    geminiSecureClient.stop();
+  }
+  return statusCode;
+}
+void startGeminiHeapProbe(GeminiHeapProbe &probe) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  probe.freeBefore = info.total_free_bytes;
+  probe.lowestFree = info.total_free_bytes;
+  probe.blocksBefore = info.allocated_blocks;
+  probe.peakBlocks = info.allocated_blocks;
+  probe.blocksAfter = info.allocated_blocks;
+}
+void sampleGeminiHeapProbe(GeminiHeapProbe &probe) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  if (info.total_free_bytes < probe.lowestFree) {
+    probe.lowestFree = info.total_free_bytes;
+  }
+  if (info.allocated_blocks > probe.peakBlocks) {
+    probe.peakBlocks = info.allocated_blocks;
+  }
+  probe.blocksAfter = info.allocated_blocks;
+}
+void printGeminiHeapProbe(const GeminiHeapProbe &probe) {
+  // Sampled at each request stage, so a short-lived allocation between samples can be missed.
+  // On a reused connection every figure should stay near zero; a handshake shows up as mbedTLS buffers.
+  Serial.print("Gemini heap: peak use=");
+  Serial.print((unsigned long)(probe.freeBefore - probe.lowestFree));
+  Serial.print(" bytes | blocks allocated: peak +");
+  Serial.print((long)probe.peakBlocks - (long)probe.blocksBefore);
+  Serial.print(", net ");
+  long netBlocks = (long)probe.blocksAfter - (long)probe.blocksBefore;
+  if (netBlocks >= 0) {
+    Serial.print('+');
+  }
+  Serial.println(netBlocks);
+}
+void recordGeminiLatency(uint32_t latencyMs, bool reusedConnection) {
+  uint8_t bucket = 0;
+  while (bucket < GEMINI_LATENCY_BUCKET_COUNT - 1 && latencyMs >= GEMINI_LATENCY_BUCKET_LIMITS_MS[bucket]) {
+    bucket++;
+  }
+  if (reusedConnection) {
+    geminiLatencyStats.reusedCounts[bucket]++;
+    geminiLatencyStats.reusedTotalMs += latencyMs;
+    geminiLatencyStats.reusedRequests++;
+  } else {
+    geminiLatencyStats.handshakeCounts[bucket]++;
+    geminiLatencyStats.handshakeTotalMs += latencyMs;
+    geminiLatencyStats.handshakeRequests++;
+  }
+  Serial.print("Gemini latency: ");
+  Serial.print(latencyMs);
+  Serial.println(reusedConnection ? " ms (reused connection)" : " ms (new TLS handshake)");
+}
+void printGeminiLatencyHistogram() {
+  // One line per connection type, e.g. "reused n=5 avg=640ms | <250:0 <500:2 <1000:3 ... >=4000:0"
+  for (uint8_t row = 0; row < 2; row++) {
+    bool reused = (row == 0);
+    const uint32_t *counts = reused ? geminiLatencyStats.reusedCounts : geminiLatencyStats.handshakeCounts;
+    uint32_t requests = reused ? geminiLatencyStats.reusedRequests : geminiLatencyStats.handshakeRequests;
+    uint32_t totalMs = reused ? geminiLatencyStats.reusedTotalMs : geminiLatencyStats.handshakeTotalMs;
+    Serial.print(reused ? "Gemini latency histogram: reused    n=" : "Gemini latency histogram: handshake n=");
+    Serial.print(requests);
+    Serial.print(" avg=");
+    Serial.print(requests > 0 ? totalMs / requests : 0);
+    Serial.print("ms |");
+    for (uint8_t bucket = 0; bucket < GEMINI_LATENCY_BUCKET_COUNT; bucket++) {
+      if (bucket < GEMINI_LATENCY_BUCKET_COUNT - 1) {
+        Serial.print(" <");
+        Serial.print(GEMINI_LATENCY_BUCKET_LIMITS_MS[bucket]);
+      } else {
+        Serial.print(" >=");
+        Serial.print(GEMINI_LATENCY_BUCKET_LIMITS_MS[bucket - 1]);
+      }
+      Serial.print(':');
+      Serial.print(counts[bucket]);
+    }
+    Serial.println();
+  }
+}
+void geminiDecisionWorkerTask(void *parameter) {
+  // Long-lived worker so network latency never blocks loop(). It sleeps on the request queue,
+  // runs one decision at a time on the pooled connection, and posts the result back.
+  (void)parameter;
+  GeminiDecisionRequestArgs request;
+  while (true) {
+    if (xQueueReceive(geminiDecisionRequestQueue, &request, portMAX_DELAY) != pdPASS) {
+      continue;
+    }
+    Action decision = queryGeminiForObstacleTurnBlocking(request.snapshot, request.previousAction, request.scan,
+                                                         request.templateType);
+    if (geminiDecisionResultQueue != nullptr) {
+      GeminiDecisionResultMessage result;
+      result.generation = request.generation;
+      result.decision = decision;
+      xQueueOverwrite(geminiDecisionResultQueue, &result);
+    }
+    geminiDecisionWorkerBusy = false;
+  }
+}
+bool startGeminiDecisionWorker() {
+  // Created once from setup(). The TLS client and the prompt and transmit buffers live for
+  // the whole run, so later decisions skip task creation, handshakes, and heap allocations.
+  if (!parseGeminiUrl(GEMINI_URL)) {
+    Serial.println("Gemini: GEMINI_URL must look like https://host/path");
+    return false;
+  }
+  geminiDecisionRequestQueue = xQueueCreate(1, sizeof(GeminiDecisionRequestArgs));
+  if (geminiDecisionRequestQueue == nullptr) {
+    return false;
+  }
+#if ROVER_TRACE_REPLAY
+  // Replay answers requests from the trace in serviceReplayGeminiRequests(); no task or TLS client.
+  return true;
+#endif
+  // TODO: prototype-only transport; replace with certificate validation before production use.
+  geminiSecureClient.setInsecure();
+  // Race backends. Gemini keeps the pooled TLS socket on core 1; Ollama is only raced once configured.
+  geminiBreaker.setLog(&Serial);
+  ollamaBreaker.setLog(&Serial);
+  if (!decisionBroker.addBackend("gemini", geminiRaceCall, GEMINI_WORKER_STACK_BYTES, 1, 1, &geminiBreaker)) {
+    return false;
+  }
+  if (strstr(OLLAMA_URL, "YOUR_OLLAMA_HOST") == nullptr &&
+      !decisionBroker.addBackend("ollama", ollamaRaceCall, OLLAMA_RACE_STACK_BYTES, 0, 1, &ollamaBreaker)) {
+    Serial.println("Ollama: race backend could not be started; racing Gemini alone");
+  }
+  BaseType_t taskCreated = xTaskCreatePinnedToCore(geminiDecisionWorkerTask, "GeminiDecision",
+                                                   GEMINI_WORKER_STACK_BYTES, nullptr, 1,
+                                                   &geminiDecisionTaskHandle, 1);
+  if (taskCreated != pdPASS) {
+    geminiDecisionTaskHandle = nullptr;
+    return false;
+  }
+  return true;
+}
+bool startGeminiDecisionRequest(const NavigationSnapshot &snapshot, Action previousAction, const SideScanResult &scan,
+                                GeminiPromptTemplate templateType) {
+  // Fire exactly one asynchronous Gemini request at a time and remember the local fallback
+  // that should be used if the request later fails or times out.
+  if (geminiDecisionResultQueue == nullptr || geminiDecisionRequestQueue == nullptr) {
+    return false;
+  }
+  if (geminiDecisionRequestState == GEMINI_REQUEST_PENDING) {
+    return false;
+  }
+  if (geminiDecisionRequestState == GEMINI_REQUEST_TIMED_OUT) {
+    return false;
+  }
+  // Worker and Wi-Fi availability depend on the outside world, so the outcome is traced and
+  // replay takes it from the recording instead of re-evaluating it.
+  bool workerAvailable = geminiDecisionTaskHandle != nullptr && !geminiDecisionWorkerBusy &&
+                         WiFi.status() == WL_CONNECTED;
+#if ROVER_TRACE_REPLAY
+  workerAvailable = !geminiDecisionWorkerBusy && replayGeminiRequestAccepted();
+#endif
+  traceRecord(TRACE_GEMINI_REQUEST, workerAvailable ? 1 : 0, 0, 0, 0.0f);
+  if (!workerAvailable) {
+    return false;
+  }
+  GeminiDecisionRequestArgs request;
+  request.snapshot = snapshot;
+  request.previousAction = previousAction;
+  request.scan = scan;
+  request.templateType = templateType;
+  request.generation = ++geminiRequestGeneration;
+  geminiDecisionFallbackAction = chooseLocalEscapeActionForStage(snapshot, scan, previousAction);
+  geminiDecisionRequestStartedMs = roverNowMs();
+  geminiDecisionRequestState = GEMINI_REQUEST_PENDING;
+  GeminiDecisionResultMessage staleResult;
+  while (xQueueReceive(geminiDecisionResultQueue, &staleResult, 0) == pdPASS) {
+  }
+  geminiDecisionWorkerBusy = true;
+  if (xQueueSend(geminiDecisionRequestQueue, &request, 0) != pdPASS) {
+    geminiDecisionWorkerBusy = false;
+    geminiDecisionRequestState = GEMINI_REQUEST_FAILED;
+    return false;
+  }
+  return true;
+}
+bool updateGeminiDecisionRequest(unsigned long nowMs, Action &decisionOut) {
+  // Poll the async request state without blocking.
+  // If the reply is late, the main loop marks the request timed out and stays on local logic.
+  GeminiDecisionResultMessage result;
+  while (geminiDecisionRequestState == GEMINI_REQUEST_PENDING && geminiDecisionResultQueue != nullptr &&
+         xQueueReceive(geminiDecisionResultQueue, &result, 0) == pdPASS) {
+    if (result.generation != geminiRequestGeneration) {
+      continue;
+    }
+    decisionOut = result.decision;
+    geminiDecisionRequestState = GEMINI_REQUEST_READY;
+    traceRecord(TRACE_GEMINI_RESULT, (uint8_t)result.decision, 0, (int32_t)(nowMs - geminiDecisionRequestStartedMs),
+                0.0f);
+    break;
+  }
+  if (geminiDecisionRequestState == GEMINI_REQUEST_READY) {
+    geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
+    return true;
+  }
+  if (geminiDecisionRequestState == GEMINI_REQUEST_TIMED_OUT) {
+    if (!geminiDecisionWorkerBusy) {
+      if (geminiDecisionResultQueue != nullptr) {
+        while (xQueueReceive(geminiDecisionResultQueue, &result, 0) == pdPASS) {
+        }
+      }
+      geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
+    }
+    return false;
+  }
+  if (geminiDecisionRequestState != GEMINI_REQUEST_PENDING) {
+    return false;
+  }
+  if ((nowMs - geminiDecisionRequestStartedMs) >= GEMINI_DECISION_REQUEST_TIMEOUT_MS) {
+    Serial.println("Gemini async timeout: using local decision");
+    decisionOut = geminiDecisionFallbackAction;
+    geminiDecisionRequestState = GEMINI_REQUEST_TIMED_OUT;
+    traceRecord(TRACE_GEMINI_RESULT, TRACE_GEMINI_TIMEOUT, 0, (int32_t)(nowMs - geminiDecisionRequestStartedMs), 0.0f);
+    return false;
+  }
+  return false;
+}
+// Binary trace recorder. traceRecord() is the only part on the control path: one ring slot write
+// and an index bump. Replay builds route the same calls into the comparison in replayCheckOutput().
+bool startTraceRecorder(uint32_t randomSeed) {
+  // Called once from setup(). The previous run's file is kept so a power cycle after a field
+  // incident does not overwrite the trace that explains it.
+  if (!ROVER_TRACE_RECORD || ROVER_TRACE_REPLAY) {
+    return false;
+  }
+  if (!LittleFS.begin(true)) {
+    Serial.println("Trace: LittleFS mount failed, recording disabled");
+    return false;
+  }
+  if (LittleFS.exists(TRACE_FILE_PATH)) {
+    LittleFS.remove(TRACE_PREVIOUS_FILE_PATH);
+    LittleFS.rename(TRACE_FILE_PATH, TRACE_PREVIOUS_FILE_PATH);
+  }
+  traceFile = LittleFS.open(TRACE_FILE_PATH, "w");
+  if (!traceFile) {
+    Serial.println("Trace: cannot create trace file, recording disabled");
+    return false;
+  }
+  // Average, not minimum: the samples carry the counter's typical read cost, not its best case.
+  uint32_t readCyclesTotal = 0;
+  for (uint8_t i = 0; i < 64; i++) {
+    uint32_t first = ESP.getCycleCount();
+    readCyclesTotal += ESP.getCycleCount() - first;
+  }
+  traceStats.cycleReadCycles = readCyclesTotal / 64;
+  TraceFileHeader header = {{'R', 'T', 'R', 'C'}, TRACE_FORMAT_VERSION, (uint16_t)sizeof(TraceRecord), randomSeed, 0};
+  traceFile.write((const uint8_t *)&header, sizeof(header));
+  traceFile.flush();
+  BaseType_t taskCreated = xTaskCreatePinnedToCore(traceFlushTask, "TraceFlush", TRACE_FLUSH_STACK_BYTES, nullptr,
+                                                   tskIDLE_PRIORITY + 1, &traceFlushTaskHandle, 0);
+  if (taskCreated != pdPASS) {
+    traceFlushTaskHandle = nullptr;
+    traceFile.close();
+    Serial.println("Trace: flush task start failed, recording disabled");
+    return false;
+  }
+  traceRecording = true;
+  Serial.print("Trace: recording to ");
+  Serial.println(TRACE_FILE_PATH);
+  return true;
+}
+void traceRecord(TraceRecordType type, uint8_t a, uint16_t b, int32_t c, float value) {
+#if ROVER_TRACE_REPLAY
+  // Ranging and Gemini outcomes are replay inputs; everything else is an output to compare.
+  if (type != TRACE_RANGING && type != TRACE_GEMINI_REQUEST && type != TRACE_GEMINI_RESULT) {
+    TraceRecord produced = {(uint32_t)roverNowMs(), (uint8_t)type, a, b, c, value};
+    replayCheckOutput(produced);
+  }
+#else
+  if (!traceRecording) {
+    return;
+  }
+  bool timed = (traceStats.recorded % TRACE_COST_SAMPLE_INTERVAL) == 0;
+  uint32_t startCycles = timed ? ESP.getCycleCount() : 0;
+  uint16_t head = traceRingHead.load(std::memory_order_relaxed);
+  uint16_t next = (uint16_t)((head + 1) % TRACE_RING_RECORDS);
+  uint16_t tail = traceRingTail.load(std::memory_order_acquire);
+  if (next == tail) {
+    traceStats.dropped++;
+    return;
+  }
+  TraceRecord &record = traceRing[head];
+  record.timeMs = (uint32_t)roverNowMs();
+  record.type = (uint8_t)type;
+  record.a = a;
+  record.b = b;
+  record.c = c;
+  record.value = value;
+  // Release publishes the slot with the index, so the flush task never reads a half-written record.
+  // A plain store on both targets, where the full barrier it replaces was most of the record cost.
+  traceRingHead.store(next, std::memory_order_release);
+  traceStats.recorded++;
+  uint16_t used = (uint16_t)((next + TRACE_RING_RECORDS - tail) % TRACE_RING_RECORDS);
+  if (used > traceStats.ringHighWater) {
+    traceStats.ringHighWater = used;
+  }
+  if (used == TRACE_RING_RECORDS / 2 && traceFlushTaskHandle != nullptr) {
+    xTaskNotifyGive(traceFlushTaskHandle);
+  }
+  if (timed) {
+    uint32_t elapsed = ESP.getCycleCount() - startCycles;
+    traceStats.sampledCycles += elapsed > traceStats.cycleReadCycles ? elapsed - traceStats.cycleReadCycles : 0;
+    traceStats.costSamples++;
+  }
+#endif
+}
+void traceFlushTask(void *parameter) {
+  // Wakes on a timer or when the ring is half full, whichever comes first.
+  (void)parameter;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TRACE_FLUSH_INTERVAL_MS));
+    flushTraceRing();
+  }
+}
+void flushTraceRing() {
+  // Appends everything between tail and head in at most two contiguous writes.
+  uint16_t head = traceRingHead.load(std::memory_order_acquire);
+  uint16_t tail = traceRingTail.load(std::memory_order_relaxed);
+  if (head == tail) {
+    return;
+  }
+  unsigned long startMs = millis();
+  while (tail != head) {
+    uint16_t end = head > tail ? head : TRACE_RING_RECORDS;
+    size_t bytes = (size_t)(end - tail) * sizeof(TraceRecord);
+    if (traceStats.flushedBytes + bytes > TRACE_MAX_FILE_BYTES) {
+      // Keep the file bounded; stop recording and discard what is left in the ring.
+      traceRecording = false;
+      traceRingTail.store(head, std::memory_order_release);
+      Serial.println("Trace: file size limit reached, recording stopped");
+      break;
+    }
+    traceFile.write((const uint8_t *)&traceRing[tail], bytes);
+    traceStats.flushedBytes += bytes;
+    tail = (uint16_t)(end % TRACE_RING_RECORDS);
+    traceRingTail.store(tail, std::memory_order_release);
+  }
+  traceFile.flush();
+  uint32_t elapsedMs = millis() - startMs;
+  traceStats.flushes++;
+  if (elapsedMs > traceStats.flushMaxMs) {
+    traceStats.flushMaxMs = elapsedMs;
+  }
+}
+void printTraceStats() {
+  // Scales the sampled per-record cost up to every record written.
+  float recordCycles = traceStats.costSamples > 0 ? (float)traceStats.sampledCycles * (float)traceStats.recorded /
+                                                        (float)traceStats.costSamples
+                                                  : 0.0f;
+  float overheadPercent = traceStats.loopCycles > 0 ? 100.0f * recordCycles / (float)traceStats.loopCycles : 0.0f;
+  roverReportSerial.printf("Trace | recording=%d recorded=%lu dropped=%lu flushed_bytes=%lu flushes=%lu "
+                           "flush_max_ms=%lu ring_high_water=%u/%u | loop overhead=%.3f%%\n",
+                           traceRecording ? 1 : 0, (unsigned long)traceStats.recorded,
+                           (unsigned long)traceStats.dropped, (unsigned long)traceStats.flushedBytes,
+                           (unsigned long)traceStats.flushes, (unsigned long)traceStats.flushMaxMs,
+                           (unsigned)traceStats.ringHighWater, (unsigned)TRACE_RING_RECORDS, overheadPercent);
+}
+void recordRangingLoopTime(uint32_t elapsedUs) {
+  if (rangingLoopStats.loops == 0 || elapsedUs < rangingLoopStats.loopMinUs) {
+    rangingLoopStats.loopMinUs = elapsedUs;
+  }
+  if (elapsedUs > rangingLoopStats.loopMaxUs) {
+    rangingLoopStats.loopMaxUs = elapsedUs;
+  }
+  rangingLoopStats.loops++;
+  rangingLoopStats.loopTotalUs += elapsedUs;
+  rangingLoopStats.loopSquaredUs += (uint64_t)elapsedUs * elapsedUs;
+}
+void printRangingLoopStats(unsigned long nowMs) {
+  // Jitter is the standard deviation of control pass time; a blocking echo wait shows up here
+  // and in max_us, and the async engine should bring both down without losing samples per second.
+  unsigned long windowMs = nowMs - rangingLoopStats.windowStartMs;
+  float meanUs = rangingLoopStats.loops > 0 ? (float)rangingLoopStats.loopTotalUs / rangingLoopStats.loops : 0.0f;
+  float varianceUs2 = rangingLoopStats.loops > 0
+                          ? (float)rangingLoopStats.loopSquaredUs / rangingLoopStats.loops - meanUs * meanUs
+                          : 0.0f;
+  roverReportSerial.printf("Ranging | mode=%s samples_per_s=%.1f no_echo=%lu | loops=%lu avg_us=%.1f "
+                           "jitter_us=%.1f min_us=%lu max_us=%lu\n",
+                           ULTRASONIC_ASYNC_RANGING ? "interrupt" : "blocking",
+                           windowMs > 0 ? 1000.0f * rangingLoopStats.samples / windowMs : 0.0f,
+                           (unsigned long)rangingLoopStats.noEchoSamples, (unsigned long)rangingLoopStats.loops,
+                           meanUs, sqrtf(fmaxf(varianceUs2, 0.0f)), (unsigned long)rangingLoopStats.loopMinUs,
+                           (unsigned long)rangingLoopStats.loopMaxUs);
+  rangingLoopStats = {};
+  rangingLoopStats.windowStartMs = nowMs;
+}
+void dumpTraceFile(const char *path) {
+  // Hex dump framed by TRACE-BEGIN / TRACE-END lines for trace-decode.py. A dump takes seconds at
+  // 115200 baud, so the rover stops first and recording pauses until the ring has reached flash.
+  emergencyStop("trace dump");
+  bool wasRecording = traceRecording;
+  traceRecording = false;
+  if (traceFlushTaskHandle != nullptr) {
+    xTaskNotifyGive(traceFlushTaskHandle);
+    while (traceRingTail != traceRingHead) {
+      delay(10);
+    }
+  }
+  File dumpFile = LittleFS.open(path, "r");
+  if (!dumpFile) {
+    roverReportSerial.print("Trace: no file at ");
+    roverReportSerial.println(path);
+    traceRecording = wasRecording;
+    return;
+  }
+  roverReportSerial.printf("TRACE-BEGIN %s %lu\n", path, (unsigned long)dumpFile.size());
+  uint8_t line[TRACE_DUMP_LINE_BYTES];
+  size_t count = 0;
+  while ((count = dumpFile.read(line, sizeof(line))) > 0) {
+    for (size_t i = 0; i < count; i++) {
+      roverReportSerial.printf("%02x", line[i]);
+    }
+    roverReportSerial.println();
+  }
+  roverReportSerial.println("TRACE-END");
+  dumpFile.close();
+  traceRecording = wasRecording;
+}
+void pollTraceSerialCommands() {
+  // Single-character Serial commands: S = recorder, ranging, scheduler, log, race, and breaker stats,
+  // T = dump this run, P = dump the previous run.
+  if (Serial.available() <= 0) {
+    return;
+  }
+  char command = (char)Serial.read();
+  if (command == 'S' || command == 's') {
+    printTraceStats();
+    printRangingLoopStats(roverNowMs());
+    controlScheduler.printStats(roverReportSerial);
+    roverReportSerial.printf("Log | written=%lu drained=%lu dropped=%lu\n",
+                             (unsigned long)roverLogStats.written.load(), (unsigned long)roverLogStats.drained.load(),
+                             (unsigned long)roverLogStats.dropped.load());
+    decisionBroker.printStats(roverReportSerial);
+    geminiBreaker.printStats(roverReportSerial);
+    ollamaBreaker.printStats(roverReportSerial);
+  } else if (command == 'T' || command == 't') {
+    dumpTraceFile(TRACE_FILE_PATH);
+  } else if (command == 'P' || command == 'p') {
+    dumpTraceFile(TRACE_PREVIOUS_FILE_PATH);
+  }
+}
+// Hardware abstraction layer. Navigation code reads time, ranges, and drives actuators only
+// through these functions, so the same loop runs on the rover or against the simulator.
+#if !ROVER_VIRTUAL_HARDWARE
+unsigned long roverNowMs() {
+  return millis();
+}
+void roverDelay(unsigned long ms) {
+  delay(ms);
+}
+float roverRangingCm(unsigned long &pulseWidthUs) {
+  float distance = sensor.Ranging();
+  pulseWidthUs = sensor.LastPulseWidthUs();
+  return distance;
+}
+void roverDriveMotors(int direction, int rightPwm, int leftPwm) {
+  robot.MoveBalanced(direction, rightPwm, leftPwm);
+  traceRecord(TRACE_MOTOR, (uint8_t)direction, (uint16_t)rightPwm, leftPwm, 0.0f);
+}
+void roverStopMotors() {
+  robot.Move(Stop, 0);
+  traceRecord(TRACE_MOTOR, TRACE_MOTOR_STOP, 0, 0, 0.0f);
+}
+void roverWritePan(int angleDeg) {
+  ultrasonicPanServo.write(angleDeg);
+}
+#if ULTRASONIC_ASYNC_RANGING
+// Interrupt-driven ranging through ultrasonic_echo.h: roverRangingStart() sends the trigger pulse and
+// returns, and roverRangingPoll() only checks whether the echo-pin interrupt has queued the pulse width.
+UltrasonicEcho ultrasonicEcho;
+bool roverRangingBegin() {
+  return ultrasonicEcho.begin(TRIG_PIN, ECHO_PIN, ULTRASONIC_ECHO_TIMEOUT_US, ULTRASONIC_ECHO_QUEUE_DEPTH);
+}
+void roverRangingStart() {
+  ultrasonicEcho.start();
+}
+bool roverRangingPoll(float &distanceCm, unsigned long &pulseWidthUs) {
+  if (!ultrasonicEcho.ready()) {
+    // No queue (allocation failed at startup): fall back to the blocking library call.
+    distanceCm = roverRangingCm(pulseWidthUs);
+    return true;
+  }
+  return ultrasonicEcho.poll(distanceCm, pulseWidthUs);
+}
+#endif
+#elif ROVER_SIMULATION
+// Simulated world: a closed room with boxes, in cm, origin at the bottom-left corner.
+// Obstacles are axis-aligned rectangles so ray casts and collision checks stay cheap.
+struct SimRect {
+  float minX;
+  float minY;
+  float maxX;
+  float maxY;
+};
+const SimRect SIM_OBSTACLES[] = {
+  {-10.0f, -10.0f, 410.0f, 0.0f},     // south wall
+  {-10.0f, 300.0f, 410.0f, 310.0f},   // north wall
+  {-10.0f, 0.0f, 0.0f, 300.0f},       // west wall
+  {400.0f, 0.0f, 410.0f, 300.0f},     // east wall
+  {120.0f, 90.0f, 160.0f, 130.0f},    // box
+  {250.0f, 180.0f, 290.0f, 260.0f},   // cabinet
+  {300.0f, 40.0f, 304.0f, 44.0f},     // table leg
+  {340.0f, 40.0f, 344.0f, 44.0f},     // table leg
+  {60.0f, 220.0f, 64.0f, 224.0f},     // chair leg
+};
+const uint8_t SIM_OBSTACLE_COUNT = sizeof(SIM_OBSTACLES) / sizeof(SIM_OBSTACLES[0]);
+const float SIM_START_X_CM = 60.0f;
+const float SIM_START_Y_CM = 60.0f;
+const float SIM_START_HEADING_DEG = 30.0f;
+const unsigned long SIM_LOOP_STEP_MS = 2;            // Virtual time charged per loop() pass
+const unsigned long SIM_DURATION_MS = 600000UL;      // Simulated run length (10 min)
+const unsigned long SIM_REPORT_INTERVAL_MS = 30000;  // Simulated time between progress reports
+const unsigned long SIM_RANDOM_SEED = 12345;         // Fixed seed so runs are repeatable
+const float SIM_MAX_WHEEL_SPEED_CMPS = 60.0f;        // Wheel speed at PWM 255
+const int SIM_PWM_DEADBAND = 50;                     // Below this PWM the wheel does not turn
+const float SIM_TRACK_WIDTH_CM = 13.0f;
+const float SIM_ROVER_RADIUS_CM = 10.0f;
+const float SIM_SENSOR_OFFSET_CM = 8.0f;             // Sensor ahead of the rover centre
+const float SIM_SENSOR_MAX_RANGE_CM = 300.0f;
+const float SIM_SENSOR_CONE_HALF_DEG = 7.5f;
+const float SIM_SENSOR_NOISE_CM = 0.6f;
+const uint8_t SIM_SENSOR_DROPOUT_PERCENT = 1;
+const unsigned long SIM_NO_ECHO_TIMEOUT_US = 25000;
+const uint32_t SIM_LATENCY_BUCKET_LIMITS_US[] = {50, 100, 250, 500, 1000, 2500};
+const uint8_t SIM_LATENCY_BUCKET_COUNT = sizeof(SIM_LATENCY_BUCKET_LIMITS_US) / sizeof(SIM_LATENCY_BUCKET_LIMITS_US[0]) + 1;
+
+struct SimState {
+  unsigned long nowMs;
+  float x;
+  float y;
+  float headingRad;
+  float panDeg;
+  float rightWheelCmps;
+  float leftWheelCmps;
+  uint32_t noiseState;
+  bool inContact;
+  uint32_t collisions;
+  float distanceCm;
+  uint32_t loopCount;
+  uint64_t loopTotalUs;
+  uint32_t loopMaxUs;
+  uint32_t loopBuckets[SIM_LATENCY_BUCKET_COUNT];
+  uint32_t rangingCount;
+  unsigned long nextReportMs;
+  unsigned long wallStartMs;
+  bool finished;
+};
+SimState sim;
+// Radar model benchmark: a shadow copy of the previous three-bucket model is fed the same readings,
+// and whenever its left/right choice differs from the histogram's, both are scored against the
+// simulated room's true clearance on that side.
+struct SimRadarBenchmark {
+  float bucketFrontCm;
+  float bucketLeftCm;
+  float bucketRightCm;
+  unsigned long bucketFrontMs;
+  unsigned long bucketLeftMs;
+  unsigned long bucketRightMs;
+  uint32_t updates;
+  uint64_t histogramCycles;
+  uint64_t bucketCycles;
+  uint32_t decisions;
+  uint32_t disagreements;
+  uint32_t histogramBetter;
+  uint32_t bucketBetter;
+};
+SimRadarBenchmark simRadar;
+
+float simWheelSpeed(int pwm) {
+  if (pwm < SIM_PWM_DEADBAND) {
+    return 0.0f;
+  }
+  return (float)clampPwm(pwm) * SIM_MAX_WHEEL_SPEED_CMPS / 255.0f;
+}
+float simNoise() {
+  // xorshift32: independent of random() so sensor noise does not shift navigation tie-breaks.
+  sim.noiseState ^= sim.noiseState << 13;
+  sim.noiseState ^= sim.noiseState >> 17;
+  sim.noiseState ^= sim.noiseState << 5;
+  return ((float)(sim.noiseState % 2001) / 1000.0f) - 1.0f;
+}
+float simRayDistance(float originX, float originY, float angleRad) {
+  // Slab test against every rectangle; returns the nearest hit or a value past max range.
+  float dx = cosf(angleRad);
+  float dy = sinf(angleRad);
+  float nearest = SIM_SENSOR_MAX_RANGE_CM + 1.0f;
+  for (uint8_t i = 0; i < SIM_OBSTACLE_COUNT; i++) {
+    const SimRect &r = SIM_OBSTACLES[i];
+    float tMin = 0.0f;
+    float tMax = nearest;
+    if (fabsf(dx) < 1e-6f) {
+      if (originX < r.minX || originX > r.maxX) {
+        continue;
+      }
+    } else {
+      float t1 = (r.minX - originX) / dx;
+      float t2 = (r.maxX - originX) / dx;
+      tMin = fmaxf(tMin, fminf(t1, t2));
+      tMax = fminf(tMax, fmaxf(t1, t2));
+    }
+    if (fabsf(dy) < 1e-6f) {
+      if (originY < r.minY || originY > r.maxY) {
+        continue;
+      }
+    } else {
+      float t1 = (r.minY - originY) / dy;
+      float t2 = (r.maxY - originY) / dy;
+      tMin = fmaxf(tMin, fminf(t1, t2));
+      tMax = fminf(tMax, fmaxf(t1, t2));
+    }
+    if (tMin <= tMax && tMin < nearest) {
+      nearest = tMin;
+    }
+  }
+  return nearest;
+}
+bool simOverlapsObstacle(float x, float y) {
+  for (uint8_t i = 0; i < SIM_OBSTACLE_COUNT; i++) {
+    const SimRect &r = SIM_OBSTACLES[i];
+    float nearestX = fmaxf(r.minX, fminf(x, r.maxX));
+    float nearestY = fmaxf(r.minY, fminf(y, r.maxY));
+    float ddx = x - nearestX;
+    float ddy = y - nearestY;
+    if (ddx * ddx + ddy * ddy < SIM_ROVER_RADIUS_CM * SIM_ROVER_RADIUS_CM) {
+      return true;
+    }
+  }
+  return false;
+}
+void simInit() {
+  memset(&sim, 0, sizeof(sim));
+  sim.x = SIM_START_X_CM;
+  sim.y = SIM_START_Y_CM;
+  sim.headingRad = SIM_START_HEADING_DEG * DEG_TO_RAD;
+  sim.panDeg = PAN_FORWARD_DEG;
+  sim.noiseState = SIM_RANDOM_SEED;
+  sim.nextReportMs = SIM_REPORT_INTERVAL_MS;
+  sim.wallStartMs = millis();
+  randomSeed(SIM_RANDOM_SEED);
+}
+void simPrintReport(const char *label) {
+  unsigned long wallMs = millis() - sim.wallStartMs;
+  roverReportSerial.printf("SIM %s | sim_ms=%lu wall_ms=%lu speedup=%.0fx | loops=%lu avg_us=%.1f max_us=%lu | "
+                           "ranging=%lu distance_cm=%.0f collisions=%lu | pose=(%.1f,%.1f,%.0fdeg)\n",
+                           label, sim.nowMs, wallMs, wallMs > 0 ? (float)sim.nowMs / (float)wallMs : 0.0f,
+                           (unsigned long)sim.loopCount,
+                           sim.loopCount > 0 ? (float)sim.loopTotalUs / (float)sim.loopCount : 0.0f,
+                           (unsigned long)sim.loopMaxUs, (unsigned long)sim.rangingCount, sim.distanceCm,
+                           (unsigned long)sim.collisions, sim.x, sim.y, sim.headingRad * RAD_TO_DEG);
+  roverReportSerial.printf("SIM radar | updates=%lu histogram_cycles_avg=%.0f bucket_cycles_avg=%.0f | "
+                           "decisions=%lu disagreements=%lu histogram_better=%lu bucket_better=%lu\n",
+                           (unsigned long)simRadar.updates,
+                           simRadar.updates > 0 ? (float)simRadar.histogramCycles / simRadar.updates : 0.0f,
+                           simRadar.updates > 0 ? (float)simRadar.bucketCycles / simRadar.updates : 0.0f,
+                           (unsigned long)simRadar.decisions, (unsigned long)simRadar.disagreements,
+                           (unsigned long)simRadar.histogramBetter, (unsigned long)simRadar.bucketBetter);
+  roverReportSerial.print("SIM loop latency histogram |");
+  for (uint8_t bucket = 0; bucket < SIM_LATENCY_BUCKET_COUNT; bucket++) {
+    if (bucket < SIM_LATENCY_BUCKET_COUNT - 1) {
+      roverReportSerial.printf(" <%luus:%lu", (unsigned long)SIM_LATENCY_BUCKET_LIMITS_US[bucket],
+                               (unsigned long)sim.loopBuckets[bucket]);
+    } else {
+      roverReportSerial.printf(" >=%luus:%lu", (unsigned long)SIM_LATENCY_BUCKET_LIMITS_US[bucket - 1],
+                               (unsigned long)sim.loopBuckets[bucket]);
+    }
+  }
+  roverReportSerial.println();
+}
+void simAdvance(unsigned long stepMs) {
+  // Integrate differential-drive kinematics over the step; a move that would overlap an
+  // obstacle is rejected and counted as one collision per contact episode.
+  float dt = stepMs / 1000.0f;
+  float v = 0.5f * (sim.rightWheelCmps + sim.leftWheelCmps);
+  float omega = (sim.rightWheelCmps - sim.leftWheelCmps) / SIM_TRACK_WIDTH_CM;
+  float nextHeading = sim.headingRad + omega * dt;
+  float nextX = sim.x + v * cosf(nextHeading) * dt;
+  float nextY = sim.y + v * sinf(nextHeading) * dt;
+  if (simOverlapsObstacle(nextX, nextY)) {
+    if (!sim.inContact) {
+      sim.collisions++;
+      roverReportSerial.printf("SIM collision #%lu at sim_ms=%lu pose=(%.1f,%.1f)\n", (unsigned long)sim.collisions,
+                               sim.nowMs, sim.x, sim.y);
+    }
+    sim.inContact = true;
+    sim.headingRad = nextHeading;
+  } else {
+    sim.inContact = false;
+    sim.distanceCm += fabsf(v * dt);
+    sim.x = nextX;
+    sim.y = nextY;
+    sim.headingRad = nextHeading;
+  }
+  sim.nowMs += stepMs;
+  if (sim.nowMs >= sim.nextReportMs && !sim.finished) {
+    sim.nextReportMs += SIM_REPORT_INTERVAL_MS;
+    simPrintReport("progress");
+  }
+}
+void simRecordLoopLatency(unsigned long elapsedUs) {
+  sim.loopCount++;
+  sim.loopTotalUs += elapsedUs;
+  if (elapsedUs > sim.loopMaxUs) {
+    sim.loopMaxUs = elapsedUs;
+  }
+  uint8_t bucket = 0;
+  while (bucket < SIM_LATENCY_BUCKET_COUNT - 1 && elapsedUs >= SIM_LATENCY_BUCKET_LIMITS_US[bucket]) {
+    bucket++;
+  }
+  sim.loopBuckets[bucket]++;
+}
+void simBenchmarkRadarUpdate(const DirectionalReading &reading, uint32_t histogramCycles) {
+  uint32_t bucketStartCycles = ESP.getCycleCount();
+  int deltaFromFront = abs((int)reading.angleDeg - (int)PAN_FORWARD_DEG);
+  if (deltaFromFront <= PAN_FRONT_WINDOW_DEG) {
+    simRadar.bucketFrontCm = reading.distanceCm;
+    simRadar.bucketFrontMs = reading.capturedMs;
+  } else if (reading.angleDeg > PAN_FORWARD_DEG) {
+    simRadar.bucketLeftCm = reading.distanceCm;
+    simRadar.bucketLeftMs = reading.capturedMs;
+  } else {
+    simRadar.bucketRightCm = reading.distanceCm;
+    simRadar.bucketRightMs = reading.capturedMs;
+  }
+  simRadar.bucketCycles += ESP.getCycleCount() - bucketStartCycles;
+  simRadar.histogramCycles += histogramCycles;
+  simRadar.updates++;
+}
+void simBenchmarkRadarInvalidate() {
+  simRadar.bucketLeftMs = 0;
+  simRadar.bucketRightMs = 0;
+}
+float simTrueClearanceCm(Action action) {
+  // Free distance out of the rover's left or right side, or behind it for BACKWARD.
+  float offsetDeg = 0.0f;
+  if (action == ACTION_LEFT) {
+    offsetDeg = 90.0f;
+  } else if (action == ACTION_RIGHT) {
+    offsetDeg = -90.0f;
+  } else if (action == ACTION_BACKWARD) {
+    offsetDeg = 180.0f;
+  }
+  return simRayDistance(sim.x, sim.y, sim.headingRad + offsetDeg * DEG_TO_RAD);
+}
+void simBenchmarkRadarDecision(const SideScanResult &histogramScan, unsigned long nowMs) {
+  bool leftValid = simRadar.bucketLeftMs != 0 && (nowMs - simRadar.bucketLeftMs) <= RADAR_SIDE_STALE_MS &&
+                   simRadar.bucketLeftCm >= ULTRASONIC_MIN_VALID_CM;
+  bool rightValid = simRadar.bucketRightMs != 0 && (nowMs - simRadar.bucketRightMs) <= RADAR_SIDE_STALE_MS &&
+                    simRadar.bucketRightCm >= ULTRASONIC_MIN_VALID_CM;
+  Action bucketAction = ACTION_BACKWARD;
+  if (leftValid && rightValid) {
+    bucketAction = (simRadar.bucketLeftCm >= simRadar.bucketRightCm) ? ACTION_LEFT : ACTION_RIGHT;
+  } else if (leftValid) {
+    bucketAction = ACTION_LEFT;
+  } else if (rightValid) {
+    bucketAction = ACTION_RIGHT;
+  }
+  simRadar.decisions++;
+  if (bucketAction == histogramScan.bestAction) {
+    return;
+  }
+  simRadar.disagreements++;
+  float histogramTrueCm = simTrueClearanceCm(histogramScan.bestAction);
+  float bucketTrueCm = simTrueClearanceCm(bucketAction);
+  if (histogramTrueCm > bucketTrueCm) {
+    simRadar.histogramBetter++;
+  } else if (bucketTrueCm > histogramTrueCm) {
+    simRadar.bucketBetter++;
+  }
+}
+unsigned long roverNowMs() {
+  return sim.nowMs;
+}
+void roverDelay(unsigned long ms) {
+  simAdvance(ms);
+}
+float roverRangingCm(unsigned long &pulseWidthUs) {
+  // Three rays across the sensor cone, nearest wins, plus noise and rare dropouts.
+  // The echo time is charged to the virtual clock like the real blocking pulseIn().
+  sim.rangingCount++;
+  float beamRad = sim.headingRad + (sim.panDeg - PAN_FORWARD_DEG) * DEG_TO_RAD;
+  float originX = sim.x + SIM_SENSOR_OFFSET_CM * cosf(sim.headingRad);
+  float originY = sim.y + SIM_SENSOR_OFFSET_CM * sinf(sim.headingRad);
+  float nearest = SIM_SENSOR_MAX_RANGE_CM + 1.0f;
+  for (int8_t ray = -1; ray <= 1; ray++) {
+    float d = simRayDistance(originX, originY, beamRad + ray * SIM_SENSOR_CONE_HALF_DEG * DEG_TO_RAD);
+    if (d < nearest) {
+      nearest = d;
+    }
+  }
+  bool dropout = (sim.noiseState % 100) < SIM_SENSOR_DROPOUT_PERCENT;
+  float noise = simNoise() * SIM_SENSOR_NOISE_CM;
+  if (nearest > SIM_SENSOR_MAX_RANGE_CM || dropout) {
+    pulseWidthUs = SIM_NO_ECHO_TIMEOUT_US;
+    simAdvance((SIM_NO_ECHO_TIMEOUT_US + 999) / 1000);
+    return -1.0f;
+  }
+  float distance = fmaxf(2.0f, nearest + noise);
+  pulseWidthUs = (unsigned long)(distance * 58.0f);
+  simAdvance((pulseWidthUs + 999) / 1000);
+  return distance;
+}
+void roverDriveMotors(int direction, int rightPwm, int leftPwm) {
+  // Forward/Backward drive both wheels the same way; Move_Left/Move_Right pivot in place.
+  float right = simWheelSpeed(rightPwm);
+  float left = simWheelSpeed(leftPwm);
+  traceRecord(TRACE_MOTOR, (uint8_t)direction, (uint16_t)rightPwm, leftPwm, 0.0f);
+  switch (direction) {
+    case Forward:
+      sim.rightWheelCmps = right;
+      sim.leftWheelCmps = left;
+      break;
+    case Backward:
+      sim.rightWheelCmps = -right;
+      sim.leftWheelCmps = -left;
+      break;
+    case Move_Left:
+      sim.rightWheelCmps = right;
+      sim.leftWheelCmps = -left;
+      break;
+    case Move_Right:
+      sim.rightWheelCmps = -right;
+      sim.leftWheelCmps = left;
+      break;
+    default:
+      sim.rightWheelCmps = 0.0f;
+      sim.leftWheelCmps = 0.0f;
+      break;
+  }
+}
+void roverStopMotors() {
+  sim.rightWheelCmps = 0.0f;
+  sim.leftWheelCmps = 0.0f;
+  traceRecord(TRACE_MOTOR, TRACE_MOTOR_STOP, 0, 0, 0.0f);
+}
+void roverWritePan(int angleDeg) {
+  sim.panDeg = (float)angleDeg;
+}
+#else
+// Trace replay: recorded ranging results and Gemini outcomes drive the unchanged loop on a virtual
+// clock. Each output the loop traces is compared, in order, with the next recording of the same type.
+const unsigned long REPLAY_LOOP_STEP_MS = 2;
+const uint8_t REPLAY_MAX_PRINTED_MISMATCHES = 20;
+const uint8_t REPLAY_STREAM_COUNT = TRACE_GEMINI_RESULT + 1;
+const float REPLAY_DISTANCE_TOLERANCE_CM = 0.01f;
+struct TraceReplayStream {
+  File file;
+  bool exhausted;
+  uint32_t matched;
+  uint32_t mismatched;
+  uint32_t missing;  // Produced by the replay after the recording of that type had run out
+};
+// Any difference from the recording fails the replay; the first one (by time) is reported.
+void replayNoteDivergence(unsigned long atMs);
+struct TraceReplayState {
+  unsigned long nowMs;
+  bool finished;
+  bool diverged;
+  unsigned long firstDivergenceMs;
+  uint32_t printedMismatches;
+  bool geminiPending;
+  bool geminiHasResult;
+  uint32_t geminiGeneration;
+  unsigned long geminiStartedMs;
+  TraceRecord geminiResult;
+};
+TraceReplayStream replayStreams[REPLAY_STREAM_COUNT];
+TraceReplayState replay = {};
+
+const char *traceRecordTypeString(uint8_t type) {
+  switch (type) {
+    case TRACE_RANGING:
+      return "ranging";
+    case TRACE_READING:
+      return "reading";
+    case TRACE_SERVO:
+      return "servo";
+    case TRACE_MOTOR:
+      return "motor";
+    case TRACE_DECISION:
+      return "decision";
+    case TRACE_GEMINI_REQUEST:
+      return "gemini_request";
+    case TRACE_GEMINI_RESULT:
+      return "gemini_result";
+    default:
+      return "unknown";
+  }
+}
+bool replayNextRecord(uint8_t type, TraceRecord &out) {
+  // Each record type has its own file handle, so each stream reads the file front to back once.
+  TraceReplayStream &stream = replayStreams[type];
+  while (!stream.exhausted) {
+    if (stream.file.read((uint8_t *)&out, sizeof(out)) != sizeof(out)) {
+      stream.exhausted = true;
+      break;
+    }
+    if (out.type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+bool replayInit() {
+  memset(&replay, 0, sizeof(replay));
+  if (!LittleFS.begin(false)) {
+    roverReportSerial.println("REPLAY: LittleFS mount failed");
+    return false;
+  }
+  File headerFile = LittleFS.open(TRACE_REPLAY_FILE_PATH, "r");
+  TraceFileHeader header;
+  if (!headerFile || headerFile.read((uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+    roverReportSerial.printf("REPLAY: cannot read %s\n", TRACE_REPLAY_FILE_PATH);
+    return false;
+  }
+  headerFile.close();
+  if (memcmp(header.magic, "RTRC", 4) != 0 || header.version != TRACE_FORMAT_VERSION ||
+      header.recordBytes != sizeof(TraceRecord)) {
+    roverReportSerial.println("REPLAY: trace header does not match this build");
+    return false;
+  }
+  for (uint8_t type = TRACE_RANGING; type < REPLAY_STREAM_COUNT; type++) {
+    replayStreams[type].file = LittleFS.open(TRACE_REPLAY_FILE_PATH, "r");
+    if (!replayStreams[type].file || !replayStreams[type].file.seek(sizeof(TraceFileHeader))) {
+      roverReportSerial.println("REPLAY: cannot open trace stream");
+      return false;
+    }
+  }
+  // Same seed as the recorded run, so random tie-breaks in chooseBestAction() repeat.
+  randomSeed(header.randomSeed);
+  roverReportSerial.printf("REPLAY: %s opened, seed=%lu\n", TRACE_REPLAY_FILE_PATH, (unsigned long)header.randomSeed);
+  return true;
+}
+void replayNoteDivergence(unsigned long atMs) {
+  if (!replay.diverged || (long)(atMs - replay.firstDivergenceMs) < 0) {
+    replay.diverged = true;
+    replay.firstDivergenceMs = atMs;
+  }
+}
+void replayCheckOutput(const TraceRecord &produced) {
+  TraceReplayStream &stream = replayStreams[produced.type];
+  TraceRecord expected;
+  if (!replayNextRecord(produced.type, expected)) {
+    stream.missing++;
+    replayNoteDivergence(produced.timeMs);
+    return;
+  }
+  bool match = produced.a == expected.a;
+  if (produced.type == TRACE_READING) {
+    match = match && produced.b == expected.b && fabsf(produced.value - expected.value) <= REPLAY_DISTANCE_TOLERANCE_CM;
+  } else if (produced.type == TRACE_MOTOR) {
+    match = match && produced.b == expected.b && produced.c == expected.c;
+  }
+  if (match) {
+    stream.matched++;
+    return;
+  }
+  stream.mismatched++;
+  replayNoteDivergence(produced.timeMs);
+  if (replay.printedMismatches < REPLAY_MAX_PRINTED_MISMATCHES) {
+    replay.printedMismatches++;
+    roverReportSerial.printf("REPLAY diff %s | replay t=%lu a=%u b=%u c=%ld v=%.1f | recorded t=%lu a=%u b=%u c=%ld v=%.1f\n",
+                             traceRecordTypeString(produced.type), (unsigned long)produced.timeMs, produced.a,
+                             produced.b, (long)produced.c, produced.value, (unsigned long)expected.timeMs, expected.a,
+                             expected.b, (long)expected.c, expected.value);
+  }
+}
+bool replayGeminiRequestAccepted() {
+  TraceRecord recorded;
+  return replayNextRecord(TRACE_GEMINI_REQUEST, recorded) && recorded.a == 1;
+}
+void serviceReplayGeminiRequests(unsigned long nowMs) {
+  // Stands in for the Gemini worker: takes the request off the queue and posts the recorded reply
+  // once the recorded latency has elapsed. Recorded timeouts never post; they only free the worker.
+  GeminiDecisionRequestArgs request;
+  if (!replay.geminiPending && geminiDecisionRequestQueue != nullptr &&
+      xQueueReceive(geminiDecisionRequestQueue, &request, 0) == pdPASS) {
+    replay.geminiPending = true;
+    replay.geminiGeneration = request.generation;
+    replay.geminiStartedMs = nowMs;
+    replay.geminiHasResult = replayNextRecord(TRACE_GEMINI_RESULT, replay.geminiResult);
+  }
+  if (!replay.geminiPending || !replay.geminiHasResult) {
+    return;
+  }
+  if ((nowMs - replay.geminiStartedMs) < (unsigned long)replay.geminiResult.c) {
+    return;
+  }
+  if (replay.geminiResult.a != TRACE_GEMINI_TIMEOUT) {
+    GeminiDecisionResultMessage result;
+    result.generation = replay.geminiGeneration;
+    result.decision = (Action)replay.geminiResult.a;
+    xQueueOverwrite(geminiDecisionResultQueue, &result);
+  }
+  replay.geminiPending = false;
+  geminiDecisionWorkerBusy = false;
+}
+void printReplayReport(const char *label) {
+  // Recorded outputs the replay never produced count as divergence too, so drain them before the summary.
+  uint32_t unconsumed[TRACE_DECISION + 1] = {};
+  for (uint8_t type = TRACE_READING; type <= TRACE_DECISION; type++) {
+    TraceRecord leftover;
+    while (replayNextRecord(type, leftover)) {
+      if (unconsumed[type]++ == 0) {
+        replayNoteDivergence(leftover.timeMs);
+      }
+    }
+  }
+  roverReportSerial.printf("REPLAY %s | replay_ms=%lu diverged=%d first_divergence_ms=%lu\n", label, replay.nowMs,
+                           replay.diverged ? 1 : 0, replay.diverged ? replay.firstDivergenceMs : 0UL);
+  for (uint8_t type = TRACE_READING; type <= TRACE_DECISION; type++) {
+    const TraceReplayStream &stream = replayStreams[type];
+    roverReportSerial.printf("REPLAY %-8s matched=%lu mismatched=%lu extra_in_replay=%lu missing_from_replay=%lu\n",
+                             traceRecordTypeString(type), (unsigned long)stream.matched,
+                             (unsigned long)stream.mismatched, (unsigned long)stream.missing,
+                             (unsigned long)unconsumed[type]);
+  }
+}
+unsigned long roverNowMs() {
+  return replay.nowMs;
+}
+void roverDelay(unsigned long ms) {
+  replay.nowMs += ms;
+}
+float roverRangingCm(unsigned long &pulseWidthUs) {
+  // The virtual clock never runs behind the recording, which keeps scan timing close to the real run.
+  TraceRecord recorded;
+  if (!replayNextRecord(TRACE_RANGING, recorded)) {
+    replay.finished = true;
+    pulseWidthUs = 0;
+    return -1.0f;
+  }
+  if (recorded.timeMs > replay.nowMs) {
+    replay.nowMs = recorded.timeMs;
+  }
+  pulseWidthUs = (unsigned long)recorded.c;
+  return recorded.value;
+}
+void roverDriveMotors(int direction, int rightPwm, int leftPwm) {
+  traceRecord(TRACE_MOTOR, (uint8_t)direction, (uint16_t)rightPwm, leftPwm, 0.0f);
+}
+void roverStopMotors() {
+  traceRecord(TRACE_MOTOR, TRACE_MOTOR_STOP, 0, 0, 0.0f);
+}
+void roverWritePan(int angleDeg) {
+  (void)angleDeg;
+}
+#endif
+#if ROVER_VIRTUAL_HARDWARE || !ULTRASONIC_ASYNC_RANGING
+// Blocking ranging: the measurement runs inside the poll, so every poll completes.
+bool roverRangingBegin() {
+  return true;
+}
+void roverRangingStart() {
+}
+bool roverRangingPoll(float &distanceCm, unsigned long &pulseWidthUs) {
+  distanceCm = roverRangingCm(pulseWidthUs);
+  return true;
+}
+#endif
 void setup() {
   // One-time initialization sequence:
   // serial logging, Gemini result queue, buzzer, motors, ultrasonic sensor, pan servo,
   // Wi-Fi, and an initial front reading that seeds the first hazard-aware scan cycle.
   Serial.begin(115200);
-  randomSeed((unsigned long)esp_random());
+  if (!roverLogBegin(Serial)) {
+    Serial.println("Log drain task start failed; deferred log lines will not be printed");
+  }
+#if ROVER_SIMULATION
+  simInit();
+  roverReportSerial.println("SIM: navigation loop running against the simulated room");
+  startTraceRecorder(SIM_RANDOM_SEED);
+  controlScheduler.setClock(roverNowUs);
+  registerControlJobs();
+#elif ROVER_TRACE_REPLAY
+  if (!replayInit()) {
+    roverReportSerial.println("REPLAY: no usable trace; nothing to do");
+    replay.finished = true;
+    return;
+  }
+  controlScheduler.setClock(roverNowUs);
+  registerControlJobs();
+#else
+  uint32_t seed = esp_random();
+  randomSeed(seed);
+  startTraceRecorder(seed);
+  registerControlJobs();
+#endif
   printHeapDiagnostics("startup");
   geminiDecisionResultQueue = xQueueCreate(1, sizeof(GeminiDecisionResultMessage));
   if (geminiDecisionResultQueue == nullptr) {
     Serial.println("Gemini result queue alloc failed");
+  } else if (!startGeminiDecisionWorker()) {
+    Serial.println("Gemini worker start failed");
   }
   pinMode(BUZZER_PIN, OUTPUT);
   digitalWrite(BUZZER_PIN, BUZZER_ACTIVE_HIGH ? LOW : HIGH);
+#if !ROVER_VIRTUAL_HARDWARE
   robot.Init();
+#endif
   currentMotorAction = ACTION_FORWARD;
   setMotorAction(ACTION_STOP);
-  delay(STARTUP_MOTOR_STABILIZE_MS);
+  roverDelay(STARTUP_MOTOR_STABILIZE_MS);
   setMotorAction(ACTION_STOP);
+#if ROVER_VIRTUAL_HARDWARE
+  // The simulated or replayed pan servo always responds.
+  panServoReady = true;
+#else
   sensor.Init(TRIG_PIN, ECHO_PIN);
+  if (!roverRangingBegin()) {
+    Serial.println("Ultrasonic echo queue alloc failed; using blocking ranging");
+  }
   ultrasonicPanServo.setPeriodHertz(50);
   int panAttachChannel = ultrasonicPanServo.attach(ULTRASONIC_PAN_PIN, 500, 2400);
   panServoReady = ultrasonicPanServo.attached();
@@ -2793,13 +4772,14 @@ void setup() {
     Serial.print(" attached=");
     Serial.println(panServoReady ? "1" : "0");
   }
+#endif
   if (panServoReady) {
     runPanServoSelfTest();
     setPanAngle(PAN_FORWARD_DEG);
     panSweepEnabled = false;
     ultrasonicScanState = SCAN_IDLE;
-    ultrasonicScanStateMs = millis();
-    lastPanStepMs = millis();
+    ultrasonicScanStateMs = roverNowMs();
+    lastPanStepMs = roverNowMs();
     if (SERVO_SWEEP_DEBUG_ONLY) {
       Serial.println("SERVO SWEEP DEBUG MODE: main rover logic paused");
       Serial.println("Controlled stationary sampling enabled for validation");
@@ -2811,7 +4791,7 @@ void setup() {
     Serial.println("No-servo safe mode: staying stopped");
     panSweepEnabled = false;
     ultrasonicScanState = SCAN_IDLE;
-    ultrasonicScanStateMs = millis();
+    ultrasonicScanStateMs = roverNowMs();
     obstacleNearby = true;
     roverState = STATE_HAZARD;
     startupFrontScanPending = false;
@@ -2822,34 +4802,95 @@ void setup() {
   }
   Serial.println("ESP32 Rover: random roam + Gemini obstacle decisions");
   startBuzzer(150);
+#if !ROVER_VIRTUAL_HARDWARE
   connectWiFi();
+#endif
   DirectionalReading initialReading = readDirectionalUltrasonic(panCurrentDeg);
   lastDistanceCm = initialReading.distanceCm;
   currentFrontDistanceCm = initialReading.distanceCm;
   previousFrontDistanceCm = initialReading.distanceCm;
-  radarFrontCm = initialReading.distanceCm;
-  radarFrontUpdatedMs = initialReading.capturedMs;
-  radarFrontSampleConfidence = initialReading.valid ? 1 : 0;
+  updateRadarHistogram(initialReading);
   obstacleNearby = true;
   roverState = STATE_HAZARD;
   startupFrontScanPending = true;
   ultrasonicScanState = SCAN_MOVE_FRONT;
-  ultrasonicScanStateMs = millis();
+  ultrasonicScanStateMs = roverNowMs();
   lastSensorMs = initialReading.capturedMs;
   lastObstacleDecisionMs = 0;
-  lastValidMotorCommandMs = millis();
-  lastControlHeartbeatMs = millis();
+  lastValidMotorCommandMs = roverNowMs();
+  lastControlHeartbeatMs = roverNowMs();
 }
+#if ROVER_VIRTUAL_HARDWARE
+// Virtual clock for the scheduler; ranging inside a stage moves it, so later jobs in a pass see that time.
+uint64_t roverNowUs() {
+  return (uint64_t)roverNowMs() * 1000ULL;
+}
+#endif
 void loop() {
-  // Main cooperative control loop.
-  // Priority order is deliberate:
-  // 1) watchdog safety
-  // 2) servo/sensor recovery
-  // 3) active maneuver timing
-  // 4) fresh sensor scanning
-  // 5) obstacle decision making
-  // 6) normal forward roaming
-  unsigned long now = millis();
+#if ROVER_SIMULATION
+  // One scheduler pass, then the world moves on by one virtual step.
+  if (sim.finished) {
+    return;
+  }
+  controlScheduler.runDue(roverNowUs());
+  simAdvance(SIM_LOOP_STEP_MS);
+  if (sim.nowMs >= SIM_DURATION_MS) {
+    sim.finished = true;
+    roverStopMotors();
+    simPrintReport("finished");
+    printTraceStats();
+    controlScheduler.printStats(roverReportSerial);
+  }
+#elif ROVER_TRACE_REPLAY
+  // Recorded ranging results pace the run; the loop ends when they are used up.
+  if (replay.finished) {
+    return;
+  }
+  controlScheduler.runDue(roverNowUs());
+  serviceReplayGeminiRequests(replay.nowMs);
+  replay.nowMs += REPLAY_LOOP_STEP_MS;
+  if (replay.finished) {
+    // Mirrors the stop the simulation records when its run ends.
+    roverStopMotors();
+    printReplayReport("finished");
+  }
+#else
+  controlScheduler.runDue(esp_timer_get_time());
+#endif
+}
+// Control pipeline. Each stage is its own scheduler job; a pass starts at the safety stage and moves
+// through sensing, sweep, and decision in that order. A stage that settles the pass (a fault, a
+// maneuver still running, a sweep still sampling) ends it there, refreshing the control heartbeat.
+// A stage whose job is not due yet picks the pass up at its next release, and no new pass starts
+// until the current one has ended.
+// Priority order is deliberate:
+// 1) watchdog safety
+// 2) servo/sensor recovery
+// 3) active maneuver timing
+// 4) fresh sensor scanning
+// 5) obstacle decision making
+// 6) normal forward roaming
+void runControlStage(ControlStage stage, ControlStage (*stageStep)(unsigned long nowMs)) {
+  if (controlPass.next != stage) {
+    return;
+  }
+  unsigned long stageStartUs = micros();
+  uint32_t stageStartCycles = ESP.getCycleCount();
+  ControlStage next = stageStep(controlPass.nowMs);
+  traceStats.loopCycles += ESP.getCycleCount() - stageStartCycles;
+  controlPass.elapsedUs += micros() - stageStartUs;
+  controlPass.next = next;
+  if (next != CONTROL_STAGE_DONE) {
+    return;
+  }
+  refreshControlHeartbeat(controlPass.nowMs);
+#if ROVER_SIMULATION
+  simRecordLoopLatency(controlPass.elapsedUs);
+#elif !ROVER_VIRTUAL_HARDWARE
+  recordRangingLoopTime(controlPass.elapsedUs);
+#endif
+}
+ControlStage controlSafetyStage(unsigned long now) {
   if (currentMotorAction != ACTION_STOP &&
       (now - lastControlHeartbeatMs) > MOTOR_CONTROL_HEARTBEAT_TIMEOUT_MS) {
     emergencyMotorStop();
@@ -2858,8 +4899,7 @@ void loop() {
     emergencyStop("invalid sensor state");
     roverState = STATE_HAZARD;
     obstacleNearby = true;
-    refreshControlHeartbeat(now);
-    return;
+    return CONTROL_STAGE_DONE;
   }
   if (SERVO_SWEEP_DEBUG_ONLY) {
     updatePanSweepDebug(now);
@@ -2873,39 +4913,38 @@ void loop() {
       Serial.print(" angle=");
       Serial.println(panCurrentDeg);
     }
-    refreshControlHeartbeat(now);
-    return;
+    return CONTROL_STAGE_DONE;
   }
-  updateBuzzer(now);
   updateForwardRestartBoost(now);
   if (panSweepRecoveryUntilMs != 0 && (long)(now - panSweepRecoveryUntilMs) >= 0) {
     panSweepRecoveryUntilMs = 0;
     Serial.println("No echo recovery complete: resuming scan");
   } else if (panSweepRecoveryUntilMs != 0) {
-    refreshControlHeartbeat(now);
-    return;
+    return CONTROL_STAGE_DONE;
   }
   updateManeuverState(now);
-  if (handleSensorRetryState(now)) {
-    refreshControlHeartbeat(now);
-    return;
-  }
+  return CONTROL_STAGE_SENSING;
+}
+ControlStage controlSensingStage(unsigned long now) {
+  return handleSensorRetryState(now) ? CONTROL_STAGE_DONE : CONTROL_STAGE_SWEEP;
+}
+ControlStage controlSweepStage(unsigned long now) {
   if (!sensorRetryActive) {
     bool previousObstacle = obstacleNearby;
     if (updateStationaryUltrasonicSampling(now, previousObstacle)) {
-      refreshControlHeartbeat(now);
-      return;
+      return CONTROL_STAGE_DONE;
     }
   }
+  return CONTROL_STAGE_DECISION;
+}
+ControlStage controlDecisionStage(unsigned long now) {
   if (obstacleNearby) {
     if (roverState == STATE_MANEUVERING) {
-      refreshControlHeartbeat(now);
-      return;
+      return CONTROL_STAGE_DONE;
     }
     if (escapeAttemptStage == ESCAPE_ATTEMPT_TRAPPED) {
       signalTrappedState(now);
-      refreshControlHeartbeat(now);
-      return;
+      return CONTROL_STAGE_DONE;
     }
     if (now - lastObstacleDecisionMs >= OBSTACLE_DECISION_COOLDOWN_MS && roverState != STATE_DECIDING) {
       roverState = STATE_DECIDING;
@@ -2919,17 +4958,14 @@ void loop() {
       Action decision = ACTION_STOP;
       if (updateGeminiDecisionRequest(now, decision)) {
         beginDecisionManeuver(decision);
-        lastObstacleDecisionMs = millis();
-        refreshControlHeartbeat(now);
-        return;
+        lastObstacleDecisionMs = roverNowMs();
+        return CONTROL_STAGE_DONE;
       }
       if (geminiDecisionRequestState == GEMINI_REQUEST_TIMED_OUT) {
-        refreshControlHeartbeat(now);
-        return;
+        return CONTROL_STAGE_DONE;
       }
       if (geminiDecisionRequestState == GEMINI_REQUEST_PENDING) {
-        refreshControlHeartbeat(now);
-        return;
+        return CONTROL_STAGE_DONE;
       }
       if (geminiDecisionRequestState == GEMINI_REQUEST_FAILED) {
         geminiDecisionRequestState = GEMINI_REQUEST_IDLE;
@@ -2941,25 +4977,21 @@ void loop() {
           Serial.println(gate.reason);
         }
         beginDecisionManeuver(gate.localRecommendation);
-        lastObstacleDecisionMs = millis();
-        refreshControlHeartbeat(now);
-        return;
+        lastObstacleDecisionMs = roverNowMs();
+        return CONTROL_STAGE_DONE;
       }
       if (startGeminiDecisionRequest(snapshot, lastAction, scan,
                                      geminiPromptTemplateForStage(escapeAttemptStage))) {
-        refreshControlHeartbeat(now);
-        return;
+        return CONTROL_STAGE_DONE;
       }
       decision = gate.localRecommendation;
       beginDecisionManeuver(decision);
-      lastObstacleDecisionMs = millis();
+      lastObstacleDecisionMs = roverNowMs();
     }
-    refreshControlHeartbeat(now);
-    return;
+    return CONTROL_STAGE_DONE;
   }
   if (roverState == STATE_MANEUVERING) {
-    refreshControlHeartbeat(now);
-    return;
+    return CONTROL_STAGE_DONE;
   }
   maybeResetEscapeAttemptStages(now);
   if (!startupFrontScanPending && roverState != STATE_ROAMING) {
@@ -2968,6 +5000,55 @@ void loop() {
   if (!startupFrontScanPending && currentMotorAction == ACTION_STOP) {
     applyMotorAction(ACTION_FORWARD, buildNavigationSnapshot(now));
   }
-  refreshControlHeartbeat(now);
+  return CONTROL_STAGE_DONE;
+}
+void safetyStageJob(unsigned long nowMs) {
+  (void)nowMs;
+  if (controlPass.next != CONTROL_STAGE_DONE) {
+    return;
+  }
+  controlPass = {roverNowMs(), CONTROL_STAGE_SAFETY, 0};
+  runControlStage(CONTROL_STAGE_SAFETY, controlSafetyStage);
+}
+void sensingStageJob(unsigned long nowMs) {
+  (void)nowMs;
+  runControlStage(CONTROL_STAGE_SENSING, controlSensingStage);
+}
+void sweepStageJob(unsigned long nowMs) {
+  (void)nowMs;
+  runControlStage(CONTROL_STAGE_SWEEP, controlSweepStage);
+}
+void decisionStageJob(unsigned long nowMs) {
+  (void)nowMs;
+  runControlStage(CONTROL_STAGE_DECISION, controlDecisionStage);
+}
+void buzzerJob(unsigned long nowMs) {
+  updateBuzzer(nowMs);
+}
+void serialCommandJob(unsigned long nowMs) {
+  (void)nowMs;
+  pollTraceSerialCommands();
+}
+#if !ROVER_VIRTUAL_HARDWARE
+void rangingReportJob(unsigned long nowMs) {
+  printRangingLoopStats(nowMs);
+}
+void schedulerReportJob(unsigned long nowMs) {
+  (void)nowMs;
+  controlScheduler.printStats(roverReportSerial);
+}
+#endif
+// Registration order is run order within a pass.
+void registerControlJobs() {
+  controlScheduler.addJob("safety", CONTROL_JOB_PERIOD_MS, CONTROL_JOB_DEADLINE_MS, safetyStageJob);
+  controlScheduler.addJob("sensing", CONTROL_JOB_PERIOD_MS, CONTROL_JOB_DEADLINE_MS, sensingStageJob);
+  controlScheduler.addJob("sweep", CONTROL_JOB_PERIOD_MS, CONTROL_JOB_DEADLINE_MS, sweepStageJob);
+  controlScheduler.addJob("decision", CONTROL_JOB_PERIOD_MS, CONTROL_JOB_DEADLINE_MS, decisionStageJob);
+  controlScheduler.addJob("buzzer", BUZZER_JOB_PERIOD_MS, BUZZER_JOB_DEADLINE_MS, buzzerJob);
+  controlScheduler.addJob("serial", SERIAL_JOB_PERIOD_MS, SERIAL_JOB_DEADLINE_MS, serialCommandJob);
+#if !ROVER_VIRTUAL_HARDWARE
+  controlScheduler.addJob("ranging", RANGING_REPORT_INTERVAL_MS, REPORT_JOB_DEADLINE_MS, rangingReportJob);
+  controlScheduler.addJob("sched", SCHEDULER_REPORT_INTERVAL_MS, REPORT_JOB_DEADLINE_MS, schedulerReportJob);
+#endif
 }
 
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Expand compact rover_log.h lines captured from a sketch built with ROVER_LOG_COMPACT 1.
+
+The rover prints each deferred log record as "~<ms> <level> <id> <hex args>... [|<text hex>]".
+The format strings are read from the sketch's ROVER_LOG_FORMATS table, so the decoder always
+matches the firmware that produced the capture. Lines that are not log records pass through.
+
+    python log-decode.py capture.log --sketch llm-sweep.ino               # whole capture
+    python log-decode.py capture.log --sketch llm-sweep.ino --level warn  # warnings only
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LEVELS = {0: "DEBUG", 1: "INFO", 2: "WARN"}
+ENTRY = re.compile(r'X\(\s*(\w+)\s*,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)\)')
+LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"')
+CONVERSION = re.compile(r"%([-+ #0-9.]*)[hlz]*([diouxXfegcs%])")
+RECORD = re.compile(r"^~(\d+) (\d+) (\d+)((?: [0-9a-f]+)*)(?: \|([0-9a-f]*))?$")
+
+
+def load_formats(path):
+    """Return the format strings of the sketch's ROVER_LOG_FORMATS(X) table, in id order."""
+    with open(path, encoding="utf-8") as handle:
+        lines = handle.read().splitlines()
+    for index, line in enumerate(lines):
+        if line.startswith("#define ROVER_LOG_FORMATS(X)"):
+            block = line
+            while block.endswith("\\"):
+                index += 1
+                block = block[:-1] + lines[index]
+            break
+    else:
+        sys.exit(f"{path}: no #define ROVER_LOG_FORMATS(X) table found")
+    formats = []
+    for _, literals in ENTRY.findall(block):
+        text = "".join(LITERAL.findall(literals))
+        formats.append(text.encode().decode("unicode_escape"))
+    return formats
+
+
+def expand(fmt, args, text):
+    """Apply one record's raw 32-bit arguments to its printf-style format."""
+    values = iter(args)
+
+    def convert(match):
+        flags, kind = match.groups()
+        if kind == "%":
+            return "%"
+        raw = next(values, 0)
+        if kind in "di":
+            value = raw - (1 << 32) if raw & 0x80000000 else raw
+        elif kind in "feg":
+            value = struct.unpack("<f", struct.pack("<I", raw))[0]
+        elif kind == "s":
+            value = text[raw:].split(b"\0", 1)[0].decode("utf-8", errors="replace")
+        elif kind == "c":
+            value = chr(raw & 0xFF)
+        else:
+            value = raw
+        return ("%" + flags + kind.replace("u", "d")) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_line(line, formats, min_level):
+    """Return the expanded text of one captured line, or None if its level is filtered out."""
+    match = RECORD.match(line)
+    if match is None:
+        return line
+    time_ms, level, format_id, args, text = match.groups()
+    if int(level) < min_level:
+        return None
+    args = [int(value, 16) for value in args.split()]
+    text = bytes.fromhex(text or "")
+    format_id = int(format_id)
+    if format_id >= len(formats):
+        body = f"<unknown format {format_id}> " + " ".join(f"{value:x}" for value in args)
+    else:
+        body = expand(formats[format_id], args, text)
+    return f"{int(time_ms):>9} {LEVELS.get(int(level), level):<5} {body}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="Serial capture containing compact log lines ('-' for stdin)")
+    parser.add_argument("--sketch", required=True, help="sketch whose ROVER_LOG_FORMATS table produced the log")
+    parser.add_argument("--level", choices=["debug", "info", "warn"], default="debug",
+                        help="lowest record level to print (other lines always pass through)")
+    args = parser.parse_args()
+
+    formats = load_formats(args.sketch)
+    min_level = {"debug": 0, "info": 1, "warn": 2}[args.level]
+    handle = sys.stdin if args.log == "-" else open(args.log, encoding="utf-8", errors="replace")
+    with handle:
+        for line in handle:
+            decoded = decode_line(line.rstrip("\r\n"), formats, min_level)
+            if decoded is not None:
+                print(decoded)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,236 @@
+// =================================================
+// maneuver_executor.h
+// Time-sliced maneuver executor: runs a plan's motion segments from loop()
+// while it keeps sampling the forward ultrasonic sensor.
+//
+// Overview:
+//   The sketches used to drive the motors and then delay() for the whole
+//   maneuver, so nothing was measured until the move was over.  Instead, a
+//   plan is queued as up to MaxSegments segments and loop() calls service()
+//   on every pass; each call takes at most one forward reading and returns:
+//
+//       maneuverExecutor.begin(hooks, config);               // setup()
+//       ...
+//       maneuverExecutor.queue({Backward, 180, 380, true, false, MANEUVER_BACKWARD});
+//       maneuverExecutor.queue({Clockwise, 180, 520, false, true, MANEUVER_TURN_RIGHT_90});
+//       maneuverExecutor.start(millis());
+//       ...
+//       void loop() {
+//         if (maneuverExecutor.active() && maneuverExecutor.service(millis())) {
+//           return;  // still maneuvering
+//         }
+//         ...
+//       }
+//
+//   A segment with endWhenClear stops early once confirmSamples readings in a
+//   row show at least clearCm ahead, but never before minRunPercent of its
+//   duration.  Leave it off for a fixed-angle turn: the front reads clear
+//   partway round, and stopping there leaves a partial heading.  A segment with abortOnHazard ends the whole plan (remaining
+//   segments are dropped) once confirmSamples readings show hazardCm or less,
+//   provided an earlier reading in that segment was farther than hazardCm, so
+//   only an obstacle that newly appears aborts.  Other segments (pauses,
+//   rescans) run their full duration without sampling.
+//
+// Statistics: plans, segments, segments shortened by clearance, plans aborted
+// on a hazard, dropped segments, and planned versus actual motion time; the
+// difference is the time saved against fixed-duration moves.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+
+struct ManeuverSegment {
+  int direction;       // vehicle direction code (Move_Left, Backward, Clockwise, ..., Stop)
+  int speed;           // PWM speed 0–255
+  uint16_t durationMs; // Fixed-duration length; the upper bound when sampling
+  bool endWhenClear;   // May end early once the front reads clearCm or more
+  bool abortOnHazard;  // A new front hazard ends the whole plan
+  uint8_t tag;         // Sketch's own maneuver id, handed back to segmentEnded
+};
+
+enum ManeuverEnd : uint8_t {
+  MANEUVER_END_COMPLETED,  // Ran its full duration
+  MANEUVER_END_CLEARED,    // Ended early: clearance reached
+  MANEUVER_END_HAZARD,     // Ended early: new front hazard; the rest of the plan is dropped
+};
+
+struct ManeuverExecutorHooks {
+  void (*drive)(int direction, int speed);
+  void (*stop)();
+  // One forward reading (cm), or a negative value when there is none; a
+  // negative value leaves the confirmation streaks as they are.
+  float (*sampleFrontCm)();
+  // Called after every segment that ran (not for dropped ones); may be nullptr.
+  void (*segmentEnded)(const ManeuverSegment &segment, ManeuverEnd end);
+};
+
+struct ManeuverExecutorConfig {
+  uint16_t sampleIntervalMs;  // Gap between forward readings (lets old echoes die out)
+  float clearCm;              // Front clearance that ends an endWhenClear segment
+  float hazardCm;             // Front distance that aborts an abortOnHazard segment
+  uint8_t confirmSamples;     // Consecutive readings needed for either
+  uint8_t minRunPercent;      // Share of a segment's duration that always runs
+};
+
+struct ManeuverExecutorStats {
+  uint32_t plans;
+  uint32_t segments;
+  uint32_t shortened;  // Segments ended by clearance
+  uint32_t aborted;    // Plans ended by a new hazard
+  uint32_t dropped;    // Segments never started because their plan was aborted
+  uint32_t samples;    // Forward readings taken while maneuvering
+  uint32_t plannedMs;  // Sum of the fixed durations of every queued segment
+  uint32_t actualMs;   // Time the segments actually ran
+};
+
+inline const char *maneuverEndString(ManeuverEnd end) {
+  switch (end) {
+    case MANEUVER_END_CLEARED:
+      return "cleared";
+    case MANEUVER_END_HAZARD:
+      return "hazard";
+    default:
+      return "completed";
+  }
+}
+
+template <uint8_t MaxSegments>
+class ManeuverExecutor {
+ public:
+  void begin(const ManeuverExecutorHooks &hooks, const ManeuverExecutorConfig &config) {
+    hooks_ = hooks;
+    config_ = config;
+  }
+
+  // Appends a segment to the next plan.  Returns false while a plan is
+  // running or when the plan is full.
+  bool queue(const ManeuverSegment &segment) {
+    if (active_ || count_ >= MaxSegments) {
+      return false;
+    }
+    segments_[count_++] = segment;
+    return true;
+  }
+
+  // Starts the queued segments; returns false when nothing was queued.
+  bool start(uint32_t nowMs) {
+    if (active_ || count_ == 0) {
+      return false;
+    }
+    active_ = true;
+    current_ = 0;
+    lastEnd_ = MANEUVER_END_COMPLETED;
+    stats_.plans++;
+    beginSegment(nowMs);
+    return true;
+  }
+
+  bool active() const { return active_; }
+  ManeuverEnd lastEnd() const { return lastEnd_; }
+  const ManeuverExecutorStats &stats() const { return stats_; }
+
+  // Advances the running plan by one slice: ends the segment when its time
+  // is up, otherwise takes at most one forward reading.  Returns true while
+  // the plan is still running.
+  bool service(uint32_t nowMs) {
+    if (!active_) {
+      return false;
+    }
+    const ManeuverSegment &segment = segments_[current_];
+    uint32_t elapsedMs = nowMs - segmentStartMs_;
+    if (elapsedMs >= segment.durationMs) {
+      endSegment(MANEUVER_END_COMPLETED, nowMs);
+      return active_;
+    }
+    if (!segment.endWhenClear && !segment.abortOnHazard) {
+      return true;
+    }
+    if (sampledOnce_ && nowMs - lastSampleMs_ < config_.sampleIntervalMs) {
+      return true;
+    }
+    sampledOnce_ = true;
+    lastSampleMs_ = nowMs;
+    float frontCm = hooks_.sampleFrontCm();
+    stats_.samples++;
+    if (frontCm >= 0.0f) {
+      if (frontCm > config_.hazardCm) {
+        hazardArmed_ = true;
+      }
+      hazardStreak_ = (segment.abortOnHazard && hazardArmed_ && frontCm <= config_.hazardCm) ? hazardStreak_ + 1 : 0;
+      clearStreak_ = (segment.endWhenClear && frontCm >= config_.clearCm) ? clearStreak_ + 1 : 0;
+    }
+    if (hazardStreak_ >= config_.confirmSamples) {
+      endSegment(MANEUVER_END_HAZARD, nowMs);
+    } else if (clearStreak_ >= config_.confirmSamples &&
+               elapsedMs * 100UL >= (uint32_t)segment.durationMs * config_.minRunPercent) {
+      endSegment(MANEUVER_END_CLEARED, nowMs);
+    }
+    return active_;
+  }
+
+  // One line: plans, early ends, and planned versus actual maneuver time.
+  void printStats(Print &out) const {
+    uint32_t savedMs = stats_.plannedMs > stats_.actualMs ? stats_.plannedMs - stats_.actualMs : 0;
+    out.printf("Maneuver | plans=%lu segments=%lu shortened=%lu aborted=%lu dropped=%lu samples=%lu fixedMs=%lu "
+               "ranMs=%lu savedMs=%lu\n",
+               (unsigned long)stats_.plans, (unsigned long)stats_.segments, (unsigned long)stats_.shortened,
+               (unsigned long)stats_.aborted, (unsigned long)stats_.dropped, (unsigned long)stats_.samples,
+               (unsigned long)stats_.plannedMs, (unsigned long)stats_.actualMs, (unsigned long)savedMs);
+  }
+
+ private:
+  void beginSegment(uint32_t nowMs) {
+    const ManeuverSegment &segment = segments_[current_];
+    segmentStartMs_ = nowMs;
+    sampledOnce_ = false;
+    hazardArmed_ = false;
+    hazardStreak_ = 0;
+    clearStreak_ = 0;
+    stats_.segments++;
+    stats_.plannedMs += segment.durationMs;
+    hooks_.drive(segment.direction, segment.speed);
+  }
+
+  void endSegment(ManeuverEnd end, uint32_t nowMs) {
+    hooks_.stop();
+    uint32_t ranMs = nowMs - segmentStartMs_;
+    const ManeuverSegment &segment = segments_[current_];
+    stats_.actualMs += ranMs < segment.durationMs ? ranMs : segment.durationMs;
+    if (end == MANEUVER_END_CLEARED) {
+      stats_.shortened++;
+    }
+    lastEnd_ = end;
+    if (hooks_.segmentEnded != nullptr) {
+      hooks_.segmentEnded(segment, end);
+    }
+    current_++;
+    if (end == MANEUVER_END_HAZARD) {
+      stats_.aborted++;
+      for (; current_ < count_; current_++) {
+        stats_.dropped++;
+        stats_.plannedMs += segments_[current_].durationMs;
+      }
+    }
+    if (current_ < count_) {
+      beginSegment(millis());
+      return;
+    }
+    active_ = false;
+    count_ = 0;
+  }
+
+  ManeuverExecutorHooks hooks_ = {};
+  ManeuverExecutorConfig config_ = {};
+  ManeuverSegment segments_[MaxSegments] = {};
+  uint8_t count_ = 0;
+  uint8_t current_ = 0;
+  bool active_ = false;
+  ManeuverEnd lastEnd_ = MANEUVER_END_COMPLETED;
+  uint32_t segmentStartMs_ = 0;
+  uint32_t lastSampleMs_ = 0;
+  bool sampledOnce_ = false;
+  bool hazardArmed_ = false;
+  uint8_t hazardStreak_ = 0;
+  uint8_t clearStreak_ = 0;
+  ManeuverExecutorStats stats_ = {};
+};
@@ -0,0 +1,105 @@
+// =================================================
+// ollama_stream.h
+// Incremental reader for Ollama's streaming /api/generate replies.
+//
+// Overview:
+//   With "stream": true Ollama answers with NDJSON – one small JSON object
+//   per generated token:
+//       {"model":"...","response":"MO","done":false}
+//       {"model":"...","response":"VE","done":false}
+//       ...
+//       {"model":"...","response":"","done":true,"context":[...],...}
+//   readOllamaStream() parses those objects straight off the socket, appends
+//   each "response" fragment to the accumulated reply text, and hands the
+//   text so far to a caller-supplied callback.  The callback can end the
+//   stream early by returning false – the caller then calls http.end(), which
+//   closes the socket and makes Ollama abandon the rest of the generation.
+//
+// Usage (any sketch that talks to /api/generate, e.g. llm-cellmove.ino,
+// llm-flash.ino, llm-fortune.ino):
+//   1. Set req["stream"] = true in the request body.
+//   2. Call http.useHTTP10(true) before http.POST() so the reply is not sent
+//      with chunked transfer encoding (the reader sees the raw body bytes).
+//   3. After POST returns HTTP_CODE_OK, call readOllamaStream() instead of
+//      http.getString(), then http.end().
+//
+// Only "response" and "done" are kept from each line (ArduinoJson filter),
+// so the large "context" array on the final line never lands in RAM.
+// Per-read timeouts come from http.setTimeout().
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+
+// Outcome of one streamed reply.
+struct OllamaStreamResult {
+  bool completed = false;          // Ollama sent the final "done": true line.
+  bool stoppedEarly = false;       // The callback ended the stream before "done".
+  uint16_t lines = 0;              // NDJSON objects consumed.
+  unsigned long firstTokenMs = 0;  // Time from the call to the first parsed line.
+  unsigned long elapsedMs = 0;     // Time from the call until the reader returned.
+  String text;                     // Concatenated "response" fragments.
+  String error;                    // Parse error text when the stream broke off.
+};
+
+// Called after every parsed line with the reply text so far.
+// Return true to keep reading, false to stop the stream right away.
+typedef bool (*OllamaTokenCallback)(const String &textSoFar, void *context);
+
+// -------------------------------------------------
+// readOllamaStream()
+// Reads NDJSON lines from an HTTPClient whose POST already returned 200.
+//
+// Parameters:
+//   http    – the client the request was sent on (POST done, not yet ended).
+//   onToken – optional callback, see OllamaTokenCallback; nullptr reads to the end.
+//   context – passed through to onToken unchanged.
+//   result  – filled with the accumulated text and timing.
+//
+// Returns true when the reply finished normally or the callback stopped it,
+// false when the connection closed or a line failed to parse first.
+// -------------------------------------------------
+inline bool readOllamaStream(HTTPClient &http, OllamaTokenCallback onToken, void *context,
+                             OllamaStreamResult &result) {
+  result = OllamaStreamResult();
+  unsigned long startMs = millis();
+  WiFiClient *stream = http.getStreamPtr();
+  if (stream == nullptr) {
+    result.error = "no stream";
+    return false;
+  }
+
+  // Keep only the two fields we use from each line.
+  JsonDocument filter;
+  filter["response"] = true;
+  filter["done"] = true;
+
+  while (true) {
+    JsonDocument line;
+    DeserializationError err = deserializeJson(line, *stream, DeserializationOption::Filter(filter));
+    if (err) {
+      // EmptyInput: the server closed the connection between lines.
+      // IncompleteInput: the per-read timeout expired mid-line.
+      result.error = err.c_str();
+      break;
+    }
+    if (result.lines == 0) {
+      result.firstTokenMs = millis() - startMs;
+    }
+    result.lines++;
+    result.text += (const char *)(line["response"] | "");
+    if (line["done"] | false) {
+      result.completed = true;
+      break;
+    }
+    if (onToken != nullptr && !onToken(result.text, context)) {
+      result.stoppedEarly = true;
+      break;
+    }
+  }
+
+  result.elapsedMs = millis() - startMs;
+  return result.completed || result.stoppedEarly;
+}
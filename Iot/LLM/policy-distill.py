@@ -0,0 +1,263 @@
+#!/usr/bin/env python3
+"""Fit a small decision tree to logged Foundry decisions and emit distilled_policy.h.
+
+llm-foundry.ino prints one "Distill sample:" line for every plan Foundry returns, with the
+planner inputs (effective left/front/right distances, front trend, oscillation count, trap
+flag, local candidate) and the model's choice. This tool reads those lines from any number
+of Serial captures (expanded on the rover or by log-decode.py), fits a depth-limited CART
+tree that predicts the model's primary maneuver, and writes it as constexpr data that the
+sketch compiles in. The rover then answers confident situations locally and only asks
+Foundry when the tree's leaf confidence is below the threshold.
+
+    python policy-distill.py run1.log run2.log                 # report only
+    python policy-distill.py run*.log --out distilled_policy.h # report and write the header
+    python policy-distill.py run*.log --max-depth 4 --min-confidence 0.85 --out distilled_policy.h
+
+The report gives agreement with the model on the training samples and under k-fold cross
+validation, plus the share of decisions the tree would answer at the chosen confidence
+(cloud calls avoided) and how often those local answers agree with the model.
+"""
+
+import argparse
+import os
+import random
+import re
+import sys
+from collections import Counter
+
+# Mirrors the sketch's ManeuverType enum.
+MANEUVERS = ["STOP", "STRAFE_LEFT", "STRAFE_RIGHT", "BACKWARD", "TURN_LEFT_90", "TURN_RIGHT_90", "RESCAN"]
+# Feature order of the generated DistilledPolicyFeature enum.
+# SIDE_DIFF_CM (left - right) is derived, since a tree cannot compare two features directly.
+FEATURES = ["LEFT_CM", "FRONT_CM", "RIGHT_CM", "SIDE_DIFF_CM", "FRONT_TREND_CM", "OSCILLATION_COUNT", "REPEATED_TRAP",
+            "LOCAL_PRIMARY"]
+SAMPLE = re.compile(
+    r"Distill sample: left=(-?\d+) front=(-?\d+) right=(-?\d+) trend=(-?[\d.]+) osc=(\d+) trap=(\d) "
+    r"local=(\w+) llm=(\w+) then (\w+) conf=([\d.]+)")
+MAX_NODES = 255  # Node indices are uint8_t in the header
+
+
+def load_samples(paths):
+    """Return (features, primary, secondary) tuples from every Distill sample line."""
+    samples = []
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as handle:
+            for line in handle:
+                match = SAMPLE.search(line)
+                if match is None:
+                    continue
+                left, front, right, trend, osc, trap, local, primary, secondary, _ = match.groups()
+                if local not in MANEUVERS or primary not in MANEUVERS or secondary not in MANEUVERS:
+                    continue
+                features = (float(left), float(front), float(right), float(left) - float(right), float(trend),
+                            float(osc), float(trap), float(MANEUVERS.index(local)))
+                samples.append((features, MANEUVERS.index(primary), MANEUVERS.index(secondary)))
+    return samples
+
+
+def gini(counts, total):
+    return 1.0 - sum((count / total) ** 2 for count in counts.values())
+
+
+def best_split(samples, min_leaf):
+    """Return (feature, threshold) minimizing weighted Gini impurity, or None."""
+    total = len(samples)
+    best = None
+    best_score = gini(Counter(s[1] for s in samples), total)
+    for feature in range(len(FEATURES)):
+        ordered = sorted(samples, key=lambda s: s[0][feature])
+        below = Counter()
+        above = Counter(s[1] for s in ordered)
+        for index in range(1, total):
+            label = ordered[index - 1][1]
+            below[label] += 1
+            above[label] -= 1
+            low, high = ordered[index - 1][0][feature], ordered[index][0][feature]
+            if low == high or index < min_leaf or total - index < min_leaf:
+                continue
+            score = (index * gini(below, index) + (total - index) * gini(+above, total - index)) / total
+            if score < best_score - 1e-9:
+                best_score = score
+                best = (feature, (low + high) / 2.0)
+    return best
+
+
+def make_leaf(samples):
+    primaries = Counter(s[1] for s in samples)
+    primary, agree = primaries.most_common(1)[0]
+    secondary = Counter(s[2] for s in samples if s[1] == primary).most_common(1)[0][0]
+    # Laplace-smoothed agreement, so a leaf backed by one sample is not "certain".
+    confidence = (agree + 1.0) / (len(samples) + 2.0)
+    return {"primary": primary, "secondary": secondary, "confidence": confidence, "samples": len(samples)}
+
+
+def fit(samples, max_depth, min_leaf, depth=0):
+    if depth < max_depth and len(samples) >= 2 * min_leaf and len({s[1] for s in samples}) > 1:
+        split = best_split(samples, min_leaf)
+        if split is not None:
+            feature, threshold = split
+            below = [s for s in samples if s[0][feature] < threshold]
+            above = [s for s in samples if s[0][feature] >= threshold]
+            return {"feature": feature, "threshold": threshold,
+                    "below": fit(below, max_depth, min_leaf, depth + 1),
+                    "above": fit(above, max_depth, min_leaf, depth + 1)}
+    return make_leaf(samples)
+
+
+def predict(node, features):
+    while "feature" in node:
+        node = node["below"] if features[node["feature"]] < node["threshold"] else node["above"]
+    return node
+
+
+def score(tree, samples, min_confidence):
+    """Return (agreement, coverage, agreement among covered) of tree on samples."""
+    agree = covered = covered_agree = 0
+    for features, primary, _ in samples:
+        leaf = predict(tree, features)
+        hit = leaf["primary"] == primary
+        agree += hit
+        if leaf["confidence"] >= min_confidence:
+            covered += 1
+            covered_agree += hit
+    total = max(1, len(samples))
+    return agree / total, covered / total, covered_agree / max(1, covered)
+
+
+def cross_validate(samples, folds, max_depth, min_leaf, min_confidence, seed):
+    shuffled = samples[:]
+    random.Random(seed).shuffle(shuffled)
+    agree = covered = covered_agree = 0
+    for fold in range(folds):
+        test = shuffled[fold::folds]
+        train = [s for index, s in enumerate(shuffled) if index % folds != fold]
+        if not test or not train:
+            continue
+        tree = fit(train, max_depth, min_leaf)
+        a, c, ca = score(tree, test, min_confidence)
+        agree += a * len(test)
+        covered += c * len(test)
+        covered_agree += ca * c * len(test)
+    total = len(samples)
+    return agree / total, covered / total, covered_agree / max(1e-9, covered)
+
+
+def flatten(tree):
+    """Breadth-first node list; children are referenced by index."""
+    nodes = [tree]
+    index = 0
+    while index < len(nodes):
+        node = nodes[index]
+        if "feature" in node:
+            node["below_index"] = len(nodes)
+            nodes.append(node["below"])
+            node["above_index"] = len(nodes)
+            nodes.append(node["above"])
+        index += 1
+    if len(nodes) > MAX_NODES:
+        sys.exit(f"tree has {len(nodes)} nodes; lower --max-depth (limit {MAX_NODES})")
+    return nodes
+
+
+def render_header(tree, samples, sources, min_confidence, report):
+    train_agree, cv_agree, cv_coverage, cv_covered_agree = report
+    lines = [
+        "// =================================================",
+        "// distilled_policy.h",
+        "// Generated by policy-distill.py – do not edit; re-run the tool on new logs.",
+        "//",
+        "// Decision tree fitted to logged Foundry decisions (\"Distill sample:\" lines",
+        "// from llm-foundry.ino).  Internal nodes send a feature below threshold to",
+        "// `below`, otherwise to `atOrAbove`; leaves hold the model's most common",
+        "// plan there and a smoothed agreement used as the local confidence.",
+        "//",
+        f"// Samples: {len(samples)} from {', '.join(os.path.basename(path) for path in sources)}",
+        f"// Agreement with the model: {train_agree:.1%} on training data, {cv_agree:.1%} cross-validated.",
+        f"// At confidence >= {min_confidence:.2f}: {cv_coverage:.1%} of decisions answered locally,",
+        f"// {cv_covered_agree:.1%} of those agree with the model (cross-validated).",
+        "// =================================================",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        "// Inputs, in this order; llm-foundry.ino fills them in buildDistilledPolicyFeatures().",
+        "enum DistilledPolicyFeature : uint8_t {",
+    ]
+    lines += [f"  DISTILLED_FEATURE_{name}," for name in FEATURES]
+    lines += [
+        "  DISTILLED_FEATURE_COUNT,",
+        "};",
+        "",
+        "struct DistilledPolicyNode {",
+        "  int8_t feature;      // DistilledPolicyFeature, or -1 for a leaf",
+        "  float threshold;",
+        "  uint8_t below;",
+        "  uint8_t atOrAbove;",
+        "  uint8_t primary;     // ManeuverType (leaves only)",
+        "  uint8_t secondary;",
+        "  float confidence;",
+        "};",
+        "",
+        "constexpr DistilledPolicyNode DISTILLED_POLICY_NODES[] = {",
+    ]
+    for index, node in enumerate(flatten(tree)):
+        if "feature" in node:
+            lines.append(f"    {{{node['feature']}, {node['threshold']:.2f}f, {node['below_index']}, "
+                         f"{node['above_index']}, 0, 0, 0.0f}},  // {index}: {FEATURES[node['feature']]}")
+        else:
+            lines.append(f"    {{-1, 0.0f, 0, 0, {node['primary']}, {node['secondary']}, {node['confidence']:.3f}f}},"
+                         f"  // {index}: {MANEUVERS[node['primary']]} then {MANEUVERS[node['secondary']]}, "
+                         f"{node['samples']} samples")
+    lines += [
+        "};",
+        f"constexpr uint32_t DISTILLED_POLICY_SAMPLES = {len(samples)};",
+        f"constexpr float DISTILLED_POLICY_MIN_CONFIDENCE = {min_confidence:.2f}f;",
+        "",
+        "// Leaf reached by features (DISTILLED_FEATURE_COUNT values).",
+        "constexpr const DistilledPolicyNode &distilledPolicyLeaf(const float *features, uint8_t index = 0) {",
+        "  return DISTILLED_POLICY_NODES[index].feature < 0",
+        "             ? DISTILLED_POLICY_NODES[index]",
+        "             : distilledPolicyLeaf(features, features[DISTILLED_POLICY_NODES[index].feature] <",
+        "                                                     DISTILLED_POLICY_NODES[index].threshold",
+        "                                                 ? DISTILLED_POLICY_NODES[index].below",
+        "                                                 : DISTILLED_POLICY_NODES[index].atOrAbove);",
+        "}",
+    ]
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("logs", nargs="+", help="Serial captures containing Distill sample lines")
+    parser.add_argument("--out", help="write the generated header here (e.g. distilled_policy.h)")
+    parser.add_argument("--max-depth", type=int, default=5, help="tree depth limit")
+    parser.add_argument("--min-leaf", type=int, default=3, help="fewest samples in a leaf")
+    parser.add_argument("--min-confidence", type=float, default=0.80,
+                        help="leaf confidence at which the rover skips Foundry")
+    parser.add_argument("--folds", type=int, default=5, help="cross-validation folds")
+    parser.add_argument("--seed", type=int, default=1, help="shuffle seed for cross validation")
+    args = parser.parse_args()
+
+    samples = load_samples(args.logs)
+    if len(samples) < 2 * args.min_leaf:
+        sys.exit(f"only {len(samples)} Distill sample lines found; log more Foundry decisions first")
+    tree = fit(samples, args.max_depth, args.min_leaf)
+    train_agree, train_coverage, _ = score(tree, samples, args.min_confidence)
+    cv_agree, cv_coverage, cv_covered_agree = cross_validate(
+        samples, min(args.folds, len(samples)), args.max_depth, args.min_leaf, args.min_confidence, args.seed)
+
+    print(f"samples={len(samples)} classes={dict(Counter(MANEUVERS[s[1]] for s in samples))}")
+    print(f"agreement: training={train_agree:.1%} cross-validated={cv_agree:.1%}")
+    print(f"confidence>={args.min_confidence:.2f}: cloud calls avoided={cv_coverage:.1%} "
+          f"(training {train_coverage:.1%}), agreement on those={cv_covered_agree:.1%}")
+    if args.out:
+        header = render_header(tree, samples, args.logs, args.min_confidence,
+                               (train_agree, cv_agree, cv_coverage, cv_covered_agree))
+        with open(args.out, "w", encoding="utf-8") as handle:
+            handle.write(header)
+        print(f"wrote {args.out} ({len(flatten(tree))} nodes)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
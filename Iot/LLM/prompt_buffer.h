@@ -0,0 +1,167 @@
+// =================================================
+// prompt_buffer.h
+// Fixed-capacity text writer for building LLM request bodies without String.
+//
+// Overview:
+//   The navigation sketches build one large request per decision.  Their
+//   instruction text is a compile-time constant that lives in flash
+//   (PROGMEM is ordinary .rodata on ESP32, read in place); only the sensor
+//   numbers and plan names change between calls.  PromptBuffer writes both
+//   into a buffer the sketch owns (normally a static array), so building a
+//   request costs no heap and the static prefix is byte-identical on every
+//   call – which is what server-side prompt caching keys on.
+//
+//   Text written into the buffer goes into a JSON string as-is, so the
+//   static templates are written pre-escaped (\" for quotes) and dynamic
+//   fields must be numbers or fixed identifiers that need no escaping.
+//
+// PromptHeapProbe reports the heap blocks/bytes held after a build compared
+// with before it (heap_caps_get_info), which should stay at zero.  A net
+// zero can still hide a String that was allocated and freed on every
+// decision, so when the core is built with CONFIG_HEAP_USE_HOOKS the probe
+// also counts each allocation and free the probing task made in between
+// (ESP-IDF's esp_heap_trace_alloc_hook / esp_heap_trace_free_hook).  The
+// stock Arduino core leaves the hooks off; then only the net change is
+// known and `counted` stays false.  One probe counts at a time; a probe
+// started on another task while one is running is not counted.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <atomic>
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && CONFIG_HEAP_USE_HOOKS
+#define PROMPT_HEAP_PROBE_HOOKS 1
+#else
+#define PROMPT_HEAP_PROBE_HOOKS 0
+#endif
+
+class PromptBuffer {
+ public:
+  PromptBuffer(char *storage, size_t capacity) : data_(storage), capacity_(capacity) { clear(); }
+
+  void clear() {
+    length_ = 0;
+    overflow_ = false;
+    data_[0] = '\0';
+  }
+
+  // Append a NUL-terminated string (RAM or flash).
+  void append(const char *text) {
+    size_t textLength = strlen(text);
+    if (length_ + textLength >= capacity_) {
+      textLength = capacity_ - 1 - length_;
+      overflow_ = true;
+    }
+    memcpy(data_ + length_, text, textLength);
+    length_ += textLength;
+    data_[length_] = '\0';
+  }
+
+  // printf-style append; the format string is normally a flash constant.
+  void appendf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(data_ + length_, capacity_ - length_, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= capacity_ - length_) {
+      length_ = capacity_ - 1;
+      overflow_ = true;
+    } else {
+      length_ += written;
+    }
+  }
+
+  // Cut back to an earlier length (e.g. to swap the tail of a retry body).
+  void truncate(size_t length) {
+    if (length < length_) {
+      length_ = length;
+      data_[length_] = '\0';
+    }
+  }
+
+  const char *c_str() const { return data_; }
+  uint8_t *bytes() const { return reinterpret_cast<uint8_t *>(data_); }
+  size_t length() const { return length_; }
+  size_t capacity() const { return capacity_; }
+  bool overflowed() const { return overflow_; }
+
+ private:
+  char *data_;
+  size_t capacity_;
+  size_t length_ = 0;
+  bool overflow_ = false;
+};
+
+// Running totals fed by the heap hooks for the one task being probed.
+struct PromptHeapHookCounters {
+  std::atomic<TaskHandle_t> task{nullptr};  // Task whose allocations are counted (nullptr = none)
+  std::atomic<uint32_t> allocations{0};
+  std::atomic<uint32_t> allocatedBytes{0};
+  std::atomic<uint32_t> frees{0};
+};
+inline PromptHeapHookCounters promptHeapHookCounters;
+
+#if PROMPT_HEAP_PROBE_HOOKS
+// Called by ESP-IDF after every successful allocation and before every free, on the calling task.
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+  (void)ptr;
+  (void)caps;
+  if (promptHeapHookCounters.task.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle()) {
+    promptHeapHookCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+    promptHeapHookCounters.allocatedBytes.fetch_add((uint32_t)size, std::memory_order_relaxed);
+  }
+}
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+  if (ptr != nullptr && promptHeapHookCounters.task.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle()) {
+    promptHeapHookCounters.frees.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+#endif
+
+// Heap blocks and bytes held across a stretch of code, and (with heap hooks)
+// how many allocations it made on the way.
+struct PromptHeapProbe {
+  size_t startBlocks = 0;
+  size_t startFreeBytes = 0;
+  bool counted = false;         // True when the counts below are valid
+  uint32_t allocations = 0;     // Set by measure()
+  uint32_t allocatedBytes = 0;
+  uint32_t frees = 0;
+
+  void start() {
+#if PROMPT_HEAP_PROBE_HOOKS
+    TaskHandle_t none = nullptr;
+    counted = promptHeapHookCounters.task.compare_exchange_strong(none, xTaskGetCurrentTaskHandle());
+    allocations = promptHeapHookCounters.allocations.load();
+    allocatedBytes = promptHeapHookCounters.allocatedBytes.load();
+    frees = promptHeapHookCounters.frees.load();
+#endif
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    startBlocks = info.allocated_blocks;
+    startFreeBytes = info.total_free_bytes;
+  }
+
+  // Positive values mean the measured code left allocations behind.  Also
+  // ends counting, so call it once per start().
+  void measure(int &blocksHeld, int &bytesHeld) {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    blocksHeld = (int)info.allocated_blocks - (int)startBlocks;
+    bytesHeld = (int)startFreeBytes - (int)info.total_free_bytes;
+#if PROMPT_HEAP_PROBE_HOOKS
+    if (counted) {
+      allocations = promptHeapHookCounters.allocations.load() - allocations;
+      allocatedBytes = promptHeapHookCounters.allocatedBytes.load() - allocatedBytes;
+      frees = promptHeapHookCounters.frees.load() - frees;
+      promptHeapHookCounters.task.store(nullptr);
+    }
+#endif
+  }
+};
@@ -0,0 +1,319 @@
+// =================================================
+// rover_log.h
+// Deferred-format logger: hot paths store a format id plus raw arguments in a
+// lock-free ring, and a low-priority task turns them into Serial output.
+//
+// Overview:
+//   A Serial.print chain on a control path costs milliseconds once the UART
+//   FIFO is full, because the call blocks until there is room.  ROVER_LOG_*
+//   calls instead copy the arguments into a fixed-size record (a few hundred
+//   nanoseconds) and return.  If the ring is full the record is dropped and
+//   counted; the caller never waits.  roverLogBegin() starts the drain task.
+//
+// Declaring formats (before including this header):
+//       #define ROVER_LOG_FORMATS(X) X(LOG_RADAR_SNAPSHOT, "Radar: left=%.2fcm best=%s") ...
+//       #include "rover_log.h"
+//       ...
+//       ROVER_LOG_INFO(LOG_RADAR_SNAPSHOT, leftCm, scanBestActionString(result));
+//   One X(id, format) entry per line in practice (see llm-sweep.ino).  Each id
+//   becomes a RoverLogFormatId; the format strings stay in flash.
+//
+// Arguments: up to ROVER_LOG_MAX_ARGS numbers, bools or strings.  Numbers are
+// stored as raw 32-bit values and only formatted when drained.  Strings (%s,
+// including String) are copied into the record's text area, ROVER_LOG_TEXT_BYTES
+// shared by all string arguments, and truncated to fit.
+//
+// Levels: ROVER_LOG_LEVEL (default ROVER_LOG_LEVEL_INFO) is checked at compile
+// time.  Calls below it compile to nothing, and their arguments are never
+// evaluated.
+//
+// Output: with ROVER_LOG_COMPACT 0 the drain task prints the expanded text.
+// With ROVER_LOG_COMPACT 1 it prints one short line per record,
+//       ~<time ms> <level> <format id> <arg hex>... [|<text hex>]
+// and log-decode.py expands those on the host using the sketch's
+// ROVER_LOG_FORMATS table.  Either way, deferred lines can appear after
+// plain Serial.print output written later; the time stamp is the call time.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <type_traits>
+
+#ifndef ROVER_LOG_FORMATS
+#error "Define ROVER_LOG_FORMATS(X) before including rover_log.h"
+#endif
+
+#define ROVER_LOG_LEVEL_DEBUG 0
+#define ROVER_LOG_LEVEL_INFO 1
+#define ROVER_LOG_LEVEL_WARN 2
+#define ROVER_LOG_LEVEL_OFF 3
+#ifndef ROVER_LOG_LEVEL
+#define ROVER_LOG_LEVEL ROVER_LOG_LEVEL_INFO
+#endif
+#ifndef ROVER_LOG_COMPACT
+#define ROVER_LOG_COMPACT 0
+#endif
+#ifndef ROVER_LOG_RING_RECORDS
+#define ROVER_LOG_RING_RECORDS 64  // Power of two; 8 + 4 * ROVER_LOG_MAX_ARGS + ROVER_LOG_TEXT_BYTES bytes each
+#endif
+#ifndef ROVER_LOG_MAX_ARGS
+#define ROVER_LOG_MAX_ARGS 6  // 32-bit argument slots per record
+#endif
+#ifndef ROVER_LOG_TEXT_BYTES
+#define ROVER_LOG_TEXT_BYTES 24  // Shared by all %s arguments of one record; at most 255
+#endif
+
+static const unsigned long ROVER_LOG_DRAIN_INTERVAL_MS = 10;
+static_assert((ROVER_LOG_RING_RECORDS & (ROVER_LOG_RING_RECORDS - 1)) == 0, "ROVER_LOG_RING_RECORDS must be a power of two");
+
+#define ROVER_LOG_FORMAT_ID(name, format) name,
+enum RoverLogFormatId : uint16_t { ROVER_LOG_FORMATS(ROVER_LOG_FORMAT_ID) ROVER_LOG_FORMAT_COUNT };
+#undef ROVER_LOG_FORMAT_ID
+#define ROVER_LOG_FORMAT_TEXT(name, format) format,
+static const char *const ROVER_LOG_FORMAT_TABLE[] PROGMEM = {ROVER_LOG_FORMATS(ROVER_LOG_FORMAT_TEXT)};
+#undef ROVER_LOG_FORMAT_TEXT
+
+struct RoverLogRecord {
+  uint32_t timeMs;
+  uint16_t formatId;
+  uint8_t level;
+  uint8_t argCount;
+  uint32_t args[ROVER_LOG_MAX_ARGS];  // Raw numbers, float bits, or text offsets for %s
+  char text[ROVER_LOG_TEXT_BYTES];    // NUL-separated copies of the string arguments
+};
+
+struct RoverLogStats {
+  std::atomic<uint32_t> written{0};
+  std::atomic<uint32_t> dropped{0};
+  std::atomic<uint32_t> drained{0};
+};
+
+// Bounded multi-producer / single-consumer ring (per-slot sequence numbers), so
+// any task may log; only the drain task reads.  Not for use from an ISR.
+struct RoverLogSlot {
+  std::atomic<uint32_t> sequence;
+  RoverLogRecord record;
+};
+static RoverLogSlot roverLogRing[ROVER_LOG_RING_RECORDS];
+static std::atomic<uint32_t> roverLogEnqueuePos{0};
+static uint32_t roverLogDequeuePos = 0;  // Drain task only
+static RoverLogStats roverLogStats;
+static Print *roverLogOutput = nullptr;
+static TaskHandle_t roverLogTaskHandle = nullptr;
+
+// Argument packing.  Each overload fills one 32-bit slot.
+struct RoverLogPacker {
+  RoverLogRecord &record;
+  uint8_t textUsed = 0;
+
+  void add(float value) { memcpy(&record.args[record.argCount++], &value, sizeof(value)); }
+  void add(double value) { add((float)value); }
+  void add(bool value) { record.args[record.argCount++] = value ? 1 : 0; }
+  void add(const char *value) {
+    record.args[record.argCount++] = textUsed;
+    if (textUsed >= ROVER_LOG_TEXT_BYTES) {
+      return;
+    }
+    // Scan up to the terminator or the room left, whichever comes first.  strnlen(value, room)
+    // would do the same, but GCC then assumes all `room` bytes are readable and warns when a short
+    // literal is passed.
+    size_t room = ROVER_LOG_TEXT_BYTES - textUsed - 1;
+    size_t length = 0;
+    while (value != nullptr && length < room && value[length] != '\0') {
+      length++;
+    }
+    memcpy(record.text + textUsed, value, length);
+    record.text[textUsed + length] = '\0';
+    textUsed += length + 1;
+  }
+  void add(const String &value) { add(value.c_str()); }
+  template <typename T>
+  void add(T value) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "rover_log: unsupported argument type");
+    record.args[record.argCount++] = (uint32_t)value;
+  }
+};
+
+inline void roverLogPack(RoverLogPacker &) {}
+template <typename First, typename... Rest>
+inline void roverLogPack(RoverLogPacker &packer, const First &first, const Rest &...rest) {
+  packer.add(first);
+  roverLogPack(packer, rest...);
+}
+
+template <typename... Args>
+inline void roverLogWrite(uint8_t level, RoverLogFormatId formatId, const Args &...args) {
+  static_assert(sizeof...(Args) <= ROVER_LOG_MAX_ARGS, "rover_log: too many arguments");
+  uint32_t pos = roverLogEnqueuePos.load(std::memory_order_relaxed);
+  RoverLogSlot *slot;
+  for (;;) {
+    slot = &roverLogRing[pos & (ROVER_LOG_RING_RECORDS - 1)];
+    int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (roverLogEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      roverLogStats.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = roverLogEnqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+  RoverLogRecord &record = slot->record;
+  record.timeMs = millis();
+  record.formatId = formatId;
+  record.level = level;
+  record.argCount = 0;
+  record.text[0] = '\0';
+  RoverLogPacker packer{record};
+  roverLogPack(packer, args...);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  roverLogStats.written.fetch_add(1, std::memory_order_relaxed);
+}
+
+#define ROVER_LOG_AT(level, formatId, ...)            \
+  do {                                                \
+    if ((level) >= ROVER_LOG_LEVEL) {                 \
+      roverLogWrite((level), (formatId), ##__VA_ARGS__); \
+    }                                                 \
+  } while (0)
+#define ROVER_LOG_DEBUG(formatId, ...) ROVER_LOG_AT(ROVER_LOG_LEVEL_DEBUG, formatId, ##__VA_ARGS__)
+#define ROVER_LOG_INFO(formatId, ...) ROVER_LOG_AT(ROVER_LOG_LEVEL_INFO, formatId, ##__VA_ARGS__)
+#define ROVER_LOG_WARN(formatId, ...) ROVER_LOG_AT(ROVER_LOG_LEVEL_WARN, formatId, ##__VA_ARGS__)
+
+// Expands one record into out, one printf conversion at a time.  Length
+// modifiers in the format are ignored; the conversion letter picks the type.
+inline void roverLogExpand(Print &out, const RoverLogRecord &record) {
+  const char *format = record.formatId < ROVER_LOG_FORMAT_COUNT ? ROVER_LOG_FORMAT_TABLE[record.formatId] : "?";
+  uint8_t argIndex = 0;
+  char spec[16];
+  char piece[48];
+  while (*format != '\0') {
+    if (*format != '%') {
+      out.write((uint8_t)*format++);
+      continue;
+    }
+    if (format[1] == '%') {
+      out.write('%');
+      format += 2;
+      continue;
+    }
+    // Copy flags, width and precision; drop h/l/z length modifiers.
+    size_t specLength = 0;
+    spec[specLength++] = *format++;
+    while (*format != '\0' && strchr("-+ #0123456789.", *format) != nullptr && specLength < sizeof(spec) - 3) {
+      spec[specLength++] = *format++;
+    }
+    while (*format == 'h' || *format == 'l' || *format == 'z') {
+      format++;
+    }
+    char conversion = *format;
+    if (conversion == '\0') {
+      break;
+    }
+    format++;
+    uint32_t raw = argIndex < record.argCount ? record.args[argIndex] : 0;
+    argIndex++;
+    if (conversion == 'd' || conversion == 'i') {
+      spec[specLength++] = 'l';
+      spec[specLength++] = conversion;
+      spec[specLength] = '\0';
+      snprintf(piece, sizeof(piece), spec, (long)(int32_t)raw);
+    } else if (conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o') {
+      spec[specLength++] = 'l';
+      spec[specLength++] = conversion;
+      spec[specLength] = '\0';
+      snprintf(piece, sizeof(piece), spec, (unsigned long)raw);
+    } else if (conversion == 'f' || conversion == 'e' || conversion == 'g') {
+      float value;
+      memcpy(&value, &raw, sizeof(value));
+      spec[specLength++] = conversion;
+      spec[specLength] = '\0';
+      snprintf(piece, sizeof(piece), spec, (double)value);
+    } else if (conversion == 's') {
+      spec[specLength++] = 's';
+      spec[specLength] = '\0';
+      snprintf(piece, sizeof(piece), spec, raw < ROVER_LOG_TEXT_BYTES ? record.text + raw : "");
+    } else if (conversion == 'c') {
+      spec[specLength++] = 'c';
+      spec[specLength] = '\0';
+      snprintf(piece, sizeof(piece), spec, (int)raw);
+    } else {
+      snprintf(piece, sizeof(piece), "%%%c", conversion);
+    }
+    out.print(piece);
+  }
+  out.println();
+}
+
+// Compact form for log-decode.py: "~time level id arg..." with hex arguments, then the text area.
+inline void roverLogWriteCompact(Print &out, const RoverLogRecord &record) {
+  out.printf("~%lu %u %u", (unsigned long)record.timeMs, (unsigned)record.level, (unsigned)record.formatId);
+  for (uint8_t i = 0; i < record.argCount; i++) {
+    out.printf(" %lx", (unsigned long)record.args[i]);
+  }
+  size_t textLength = ROVER_LOG_TEXT_BYTES;
+  while (textLength > 0 && record.text[textLength - 1] == '\0') {
+    textLength--;
+  }
+  if (textLength > 0) {
+    out.print(" |");
+    for (size_t i = 0; i < textLength; i++) {
+      out.printf("%02x", (uint8_t)record.text[i]);
+    }
+  }
+  out.println();
+}
+
+// Writes every record queued so far.  Called by the drain task, or directly
+// (e.g. before a deliberate halt) when no drain task is running.
+inline void roverLogDrain() {
+  static uint32_t reportedDropped = 0;
+  if (roverLogOutput == nullptr) {
+    return;
+  }
+  for (;;) {
+    RoverLogSlot &slot = roverLogRing[roverLogDequeuePos & (ROVER_LOG_RING_RECORDS - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != roverLogDequeuePos + 1) {
+      break;
+    }
+#if ROVER_LOG_COMPACT
+    roverLogWriteCompact(*roverLogOutput, slot.record);
+#else
+    roverLogExpand(*roverLogOutput, slot.record);
+#endif
+    slot.sequence.store(roverLogDequeuePos + ROVER_LOG_RING_RECORDS, std::memory_order_release);
+    roverLogDequeuePos++;
+    roverLogStats.drained.fetch_add(1, std::memory_order_relaxed);
+  }
+  uint32_t dropped = roverLogStats.dropped.load(std::memory_order_relaxed);
+  if (dropped != reportedDropped) {
+    roverLogOutput->printf("Log | %lu records dropped (ring full)\n", (unsigned long)(dropped - reportedDropped));
+    reportedDropped = dropped;
+  }
+}
+
+inline void roverLogTask(void *) {
+  for (;;) {
+    roverLogDrain();
+    vTaskDelay(pdMS_TO_TICKS(ROVER_LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+// Prepares the ring and starts the drain task writing to out.  Call it in
+// setup() before any ROVER_LOG_* call; records logged earlier are discarded.
+// Returns false if the task could not be created; records are then written
+// only by explicit roverLogDrain() calls.
+inline bool roverLogBegin(Print &out, BaseType_t core = 0, UBaseType_t priority = tskIDLE_PRIORITY + 1) {
+  for (uint32_t i = 0; i < ROVER_LOG_RING_RECORDS; i++) {
+    roverLogRing[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  roverLogEnqueuePos.store(0, std::memory_order_relaxed);
+  roverLogDequeuePos = 0;
+  roverLogOutput = &out;
+  return xTaskCreatePinnedToCore(roverLogTask, "RoverLog", 3072, nullptr, priority, &roverLogTaskHandle, core) == pdPASS;
+}
@@ -0,0 +1,156 @@
+// =================================================
+// rover_runtime.h
+// Two-core task split for the navigation sketches: a fixed-rate safety task
+// and a networking task that exchange state through lock-free mailboxes.
+//
+// Overview:
+//   The sketches used to sense, check hazards, talk TLS and wait on HTTP all
+//   inside loop(), so a slow Foundry or Gemini round-trip also delayed the
+//   next ultrasonic reading and the emergency stop.  This header provides the
+//   pieces to split that work:
+//
+//     SpscMailbox<T>       – latest-value hand-off between exactly one
+//                            producer task and one consumer task.  Neither
+//                            side blocks or takes a lock; the consumer always
+//                            gets the newest complete value (triple buffer).
+//     RoverTaskStats       – per-task run count, worst run time, deadline
+//                            misses and CPU load since the last report.
+//     RoverPeriodicTask    – runs a tick function at a fixed rate on a pinned
+//                            core (xTaskDelayUntil) and records its stats.
+//     RoverStopLatency     – hazard onset → motor stop latency, worst case.
+//
+// Usage (see llm-nav-max.ino):
+//   - Pin the safety task to the loop() core (1) at a priority above loop(),
+//     and let it own the ultrasonic sensor, the pan servo and the motors.
+//   - Run HTTPS requests in a task pinned to core 0, next to the Wi-Fi stack.
+//   - Pass sensor snapshots, motion commands and LLM jobs/results through
+//     SpscMailbox instances, one per direction.
+//
+// Everything here is header-only and allocation-free after start-up.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Latest-value mailbox for one producer task and one consumer task.
+// Three slots rotate between the writer, the reader and the "ready" hand-off,
+// so publish() and take() never wait for each other and never see a torn value.
+template <typename T>
+class SpscMailbox {
+ public:
+  // Producer only: make value the newest one the consumer can take.
+  void publish(const T &value) {
+    slots_[writeIndex_] = value;
+    uint32_t previous = ready_.exchange(writeIndex_ | FRESH_BIT, std::memory_order_acq_rel);
+    writeIndex_ = previous & INDEX_MASK;
+  }
+
+  // Consumer only: copy out the newest value if one was published since the
+  // last take().  Returns false (and leaves out untouched) otherwise.
+  bool take(T &out) {
+    if ((ready_.load(std::memory_order_acquire) & FRESH_BIT) == 0) {
+      return false;
+    }
+    uint32_t previous = ready_.exchange(readIndex_, std::memory_order_acq_rel);
+    readIndex_ = previous & INDEX_MASK;
+    out = slots_[readIndex_];
+    return true;
+  }
+
+ private:
+  static const uint32_t INDEX_MASK = 0x3;
+  static const uint32_t FRESH_BIT = 0x4;
+
+  T slots_[3] = {};
+  std::atomic<uint32_t> ready_{1};
+  uint32_t writeIndex_ = 0;  // Producer side
+  uint32_t readIndex_ = 2;   // Consumer side
+};
+
+// Run-time statistics for one task.  recordRun() is called only by the task
+// itself; the reporting task reads the counters and calls takeLoadPercent().
+class RoverTaskStats {
+ public:
+  void recordRun(uint32_t runUs, bool missedDeadline) {
+    busyUs_.fetch_add(runUs, std::memory_order_relaxed);
+    runs_.fetch_add(1, std::memory_order_relaxed);
+    if (runUs > worstRunUs_.load(std::memory_order_relaxed)) {
+      worstRunUs_.store(runUs, std::memory_order_relaxed);
+    }
+    if (missedDeadline) {
+      deadlineMisses_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Share of wall time the task spent running since the previous call, in percent.
+  float takeLoadPercent(uint64_t nowUs) {
+    uint32_t busyUs = busyUs_.exchange(0, std::memory_order_relaxed);
+    uint64_t elapsedUs = (sampledUs_ == 0) ? 0 : nowUs - sampledUs_;
+    sampledUs_ = nowUs;
+    return elapsedUs == 0 ? 0.0f : (100.0f * (float)busyUs) / (float)elapsedUs;
+  }
+
+  uint32_t runs() const { return runs_.load(std::memory_order_relaxed); }
+  uint32_t worstRunUs() const { return worstRunUs_.load(std::memory_order_relaxed); }
+  uint32_t deadlineMisses() const { return deadlineMisses_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint32_t> busyUs_{0};
+  std::atomic<uint32_t> runs_{0};
+  std::atomic<uint32_t> worstRunUs_{0};
+  std::atomic<uint32_t> deadlineMisses_{0};
+  uint64_t sampledUs_ = 0;  // Reporter side
+};
+
+// A tick function run every periodMs on a pinned core.  A tick that takes
+// longer than the period counts as a deadline miss; the next tick then starts
+// immediately instead of drifting the schedule.
+struct RoverPeriodicTask {
+  const char *name;
+  uint32_t periodMs;
+  void (*tick)();
+  RoverTaskStats stats;
+  TaskHandle_t handle = nullptr;
+};
+
+inline void roverPeriodicTaskMain(void *arg) {
+  RoverPeriodicTask *task = static_cast<RoverPeriodicTask *>(arg);
+  const TickType_t periodTicks = pdMS_TO_TICKS(task->periodMs);
+  const uint32_t periodUs = task->periodMs * 1000UL;
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    int64_t startUs = esp_timer_get_time();
+    task->tick();
+    uint32_t runUs = (uint32_t)(esp_timer_get_time() - startUs);
+    task->stats.recordRun(runUs, runUs > periodUs);
+    xTaskDelayUntil(&lastWake, periodTicks);
+  }
+}
+
+// Returns false if FreeRTOS could not create the task (out of memory).
+inline bool startRoverPeriodicTask(RoverPeriodicTask &task, uint32_t stackBytes, UBaseType_t priority,
+                                   BaseType_t core) {
+  return xTaskCreatePinnedToCore(roverPeriodicTaskMain, task.name, stackBytes, &task, priority, &task.handle,
+                                 core) == pdPASS;
+}
+
+// Time from the first reading that started a hazard to the motor stop it
+// caused.  Written by the safety task only; read by the reporter.
+struct RoverStopLatency {
+  std::atomic<uint32_t> stops{0};
+  std::atomic<uint32_t> lastUs{0};
+  std::atomic<uint32_t> worstUs{0};
+
+  void record(int64_t hazardOnsetUs, int64_t stopUs) {
+    uint32_t latencyUs = (uint32_t)(stopUs - hazardOnsetUs);
+    lastUs.store(latencyUs, std::memory_order_relaxed);
+    if (latencyUs > worstUs.load(std::memory_order_relaxed)) {
+      worstUs.store(latencyUs, std::memory_order_relaxed);
+    }
+    stops.fetch_add(1, std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Decode binary navigation traces recorded by llm-sweep.ino.
+
+Input is either a raw trace file copied off the board or a Serial log captured while
+sending 'T' or 'P' to the rover (the hex dump between TRACE-BEGIN and TRACE-END).
+
+    python trace-decode.py capture.log                 # print every record
+    python trace-decode.py capture.log --type decision # only one record type
+    python trace-decode.py before.log --diff after.log # compare outputs of two runs
+"""
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct("<4sHHII")   # magic, version, record bytes, random seed, reserved
+RECORD = struct.Struct("<IBBHif")   # time ms, type, a, b, c, value
+FORMAT_VERSION = 1
+
+TYPES = {
+    1: "ranging",
+    2: "reading",
+    3: "servo",
+    4: "motor",
+    5: "decision",
+    6: "gemini_request",
+    7: "gemini_result",
+}
+OUTPUT_TYPES = ("reading", "servo", "motor", "decision")
+# Mirrors the sketch's Action enum and the ACEBOTT vehicle direction codes (255 = roverStopMotors()).
+ACTIONS = {0: "STOP", 1: "FORWARD", 2: "BACKWARD", 3: "LEFT", 4: "RIGHT"}
+DIRECTIONS = {163: "Forward", 92: "Backward", 106: "Move_Left", 149: "Move_Right", 0: "Stop", 255: "Stop"}
+
+
+def load_trace(path):
+    """Return the raw trace bytes from a .bin file or from the first hex dump in a log."""
+    with open(path, "rb") as handle:
+        data = handle.read()
+    if data[:4] == b"RTRC":
+        return data
+    hex_lines = []
+    inside = False
+    for line in data.decode("utf-8", errors="replace").splitlines():
+        line = line.strip()
+        if line.startswith("TRACE-BEGIN"):
+            inside = True
+            hex_lines = []
+        elif line.startswith("TRACE-END") and inside:
+            return bytes.fromhex("".join(hex_lines))
+        elif inside and line:
+            hex_lines.append(line)
+    sys.exit(f"{path}: no raw trace or complete TRACE-BEGIN/TRACE-END dump found")
+
+
+def parse_records(data, path):
+    magic, version, record_bytes, seed, _ = HEADER.unpack_from(data, 0)
+    if magic != b"RTRC" or version != FORMAT_VERSION or record_bytes != RECORD.size:
+        sys.exit(f"{path}: unsupported trace header (version {version}, record {record_bytes} bytes)")
+    records = []
+    offset = HEADER.size
+    while offset + RECORD.size <= len(data):
+        time_ms, kind, a, b, c, value = RECORD.unpack_from(data, offset)
+        records.append((time_ms, TYPES.get(kind, f"type{kind}"), a, b, c, value))
+        offset += RECORD.size
+    return seed, records
+
+
+def describe(record):
+    time_ms, kind, a, b, c, value = record
+    if kind == "ranging":
+        detail = "no echo" if value < 0 else f"{value:.1f} cm"
+        return f"{time_ms:>9} ranging   {detail} pulse={c}us"
+    if kind == "reading":
+        return f"{time_ms:>9} reading   angle={a} {value:.1f} cm conf={b & 0xFF} valid={b >> 8}"
+    if kind == "servo":
+        return f"{time_ms:>9} servo     angle={a}"
+    if kind == "motor":
+        return f"{time_ms:>9} motor     {DIRECTIONS.get(a, a)} right={b} left={c}"
+    if kind == "decision":
+        return f"{time_ms:>9} decision  {ACTIONS.get(a, a)}"
+    if kind == "gemini_request":
+        return f"{time_ms:>9} gemini    request {'accepted' if a else 'unavailable'}"
+    if kind == "gemini_result":
+        outcome = "timeout" if a == 255 else ACTIONS.get(a, a)
+        return f"{time_ms:>9} gemini    result {outcome} after {c} ms"
+    return f"{time_ms:>9} {kind} a={a} b={b} c={c} value={value}"
+
+
+def output_key(record):
+    # Timestamps are left out on purpose: runs are compared by the sequence of what the rover did.
+    _, kind, a, b, c, value = record
+    if kind == "reading":
+        return (kind, a, b, round(value, 1))
+    if kind == "motor":
+        return (kind, a, b, c)
+    return (kind, a)
+
+
+def diff(left, right, limit):
+    mismatches = 0
+    for kind in OUTPUT_TYPES:
+        first = [r for r in left if r[1] == kind]
+        second = [r for r in right if r[1] == kind]
+        same = 0
+        for a, b in zip(first, second):
+            if output_key(a) == output_key(b):
+                same += 1
+                continue
+            mismatches += 1
+            if mismatches <= limit:
+                print(f"- {describe(a)}\n+ {describe(b)}")
+        print(f"{kind:<9} matched={same} left_only={max(0, len(first) - len(second))} "
+              f"right_only={max(0, len(second) - len(first))}")
+    return mismatches
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="raw trace file or Serial log containing a TRACE dump")
+    parser.add_argument("--type", choices=sorted(TYPES.values()), help="only print this record type")
+    parser.add_argument("--diff", metavar="OTHER", help="compare reading/servo/motor/decision sequences")
+    parser.add_argument("--limit", type=int, default=20, help="maximum mismatches printed by --diff")
+    args = parser.parse_args()
+
+    seed, records = parse_records(load_trace(args.trace), args.trace)
+    if args.diff:
+        _, other = parse_records(load_trace(args.diff), args.diff)
+        return 1 if diff(records, other, args.limit) else 0
+
+    print(f"# {args.trace}: {len(records)} records, random seed {seed}")
+    for record in records:
+        if args.type is None or record[1] == args.type:
+            print(describe(record))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,159 @@
+// =================================================
+// ultrasonic_echo.h
+// Interrupt-timed HC-SR04 ranging: trigger now, collect the echo on a later
+// loop() pass instead of busy-waiting for it.
+//
+// Overview:
+//   ultrasonic.h's Ranging() spins until the echo ends, up to the full
+//   no-echo timeout, so every reading stalls the loop.  Here start() sends
+//   the 10 us trigger pulse and returns; a CHANGE interrupt on the echo pin
+//   timestamps the rising and falling edges with esp_timer_get_time() and
+//   queues the pulse width; poll() only checks that queue and the no-echo
+//   deadline:
+//
+//       UltrasonicEcho echo;
+//       echo.begin(TRIG_PIN, ECHO_PIN);         // setup(), after sensor.Init()
+//       ...
+//       if (!echo.busy()) {
+//         echo.start();
+//       }
+//       float cm;
+//       unsigned long widthUs;
+//       if (echo.poll(cm, widthUs)) {           // cm < 0: no echo
+//         ...
+//       }
+//
+//   The ISR posts raw widths; the distance conversion happens in poll()
+//   because floats are not allowed in ESP32 ISRs.  begin() returns false when
+//   the queue cannot be allocated, and callers keep the blocking library call.
+// =================================================
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+class UltrasonicEcho {
+ public:
+  // An echo longer than this (about 430 cm) is treated as no echo.
+  static const uint32_t DEFAULT_TIMEOUT_US = 25000;
+
+  bool begin(uint8_t trigPin, uint8_t echoPin, uint32_t timeoutUs = DEFAULT_TIMEOUT_US, uint8_t queueDepth = 4) {
+    queue_ = xQueueCreate(queueDepth, sizeof(uint32_t));
+    if (queue_ == nullptr) {
+      return false;
+    }
+    trigPin_ = trigPin;
+    echoPin_ = echoPin;
+    timeoutUs_ = timeoutUs;
+    pinMode(trigPin_, OUTPUT);
+    digitalWrite(trigPin_, LOW);
+    pinMode(echoPin_, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(echoPin_), onEchoEdge, this, CHANGE);
+    return true;
+  }
+
+  // False when begin() failed or was never called.
+  bool ready() const { return queue_ != nullptr; }
+  // True from start() until poll() has returned the measurement.
+  bool busy() const { return inFlight_; }
+  uint32_t timeoutUs() const { return timeoutUs_; }
+
+  // Sends the trigger pulse; any result still pending from an earlier start() is dropped.
+  void start() {
+    if (queue_ == nullptr) {
+      return;
+    }
+    xQueueReset(queue_);
+    portENTER_CRITICAL(&mux_);
+    phase_ = WAIT_RISE;
+    portEXIT_CRITICAL(&mux_);
+    digitalWrite(trigPin_, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(trigPin_, LOW);
+    triggerUs_ = esp_timer_get_time();
+    inFlight_ = true;
+  }
+
+  // Forgets the measurement in flight, e.g. after the pan servo moved away from its angle.
+  void cancel() {
+    portENTER_CRITICAL(&mux_);
+    phase_ = IDLE;
+    portEXIT_CRITICAL(&mux_);
+    inFlight_ = false;
+  }
+
+  // True once the echo (or the no-echo deadline) is in: distanceCm is then the range, or -1 without
+  // an echo.  False while the measurement is still in flight or none was started.
+  bool poll(float &distanceCm, unsigned long &pulseWidthUs) {
+    if (!inFlight_) {
+      return false;
+    }
+    uint32_t echoWidthUs = 0;
+    if (xQueueReceive(queue_, &echoWidthUs, 0) == pdTRUE) {
+      inFlight_ = false;
+      pulseWidthUs = echoWidthUs;
+      distanceCm = echoWidthUs < timeoutUs_ ? echoWidthUs / 58.0f : -1.0f;
+      return true;
+    }
+    // Nothing in range (the echo line stays high) or a missed edge: stop waiting at the deadline.
+    bool timedOut = false;
+    portENTER_CRITICAL(&mux_);
+    if (esp_timer_get_time() - triggerUs_ >= (int64_t)timeoutUs_) {
+      phase_ = IDLE;
+      timedOut = true;
+    }
+    portEXIT_CRITICAL(&mux_);
+    if (!timedOut) {
+      return false;
+    }
+    inFlight_ = false;
+    pulseWidthUs = timeoutUs_;
+    distanceCm = -1.0f;
+    return true;
+  }
+
+ private:
+  enum Phase : uint8_t {
+    IDLE = 0,
+    WAIT_RISE,
+    WAIT_FALL,
+  };
+
+  static void IRAM_ATTR onEchoEdge(void *arg) {
+    UltrasonicEcho *self = static_cast<UltrasonicEcho *>(arg);
+    int64_t nowUs = esp_timer_get_time();
+    bool echoHigh = gpio_get_level((gpio_num_t)self->echoPin_) != 0;
+    bool echoComplete = false;
+    uint32_t pulseWidthUs = 0;
+    portENTER_CRITICAL_ISR(&self->mux_);
+    if (echoHigh && self->phase_ == WAIT_RISE) {
+      self->echoRiseUs_ = nowUs;
+      self->phase_ = WAIT_FALL;
+    } else if (!echoHigh && self->phase_ == WAIT_FALL) {
+      pulseWidthUs = (uint32_t)(nowUs - self->echoRiseUs_);
+      self->phase_ = IDLE;
+      echoComplete = true;
+    }
+    portEXIT_CRITICAL_ISR(&self->mux_);
+    if (echoComplete) {
+      BaseType_t higherPriorityTaskWoken = pdFALSE;
+      xQueueSendFromISR(self->queue_, &pulseWidthUs, &higherPriorityTaskWoken);
+      if (higherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+      }
+    }
+  }
+
+  QueueHandle_t queue_ = nullptr;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  volatile uint8_t phase_ = IDLE;
+  volatile int64_t echoRiseUs_ = 0;
+  int64_t triggerUs_ = 0;
+  uint32_t timeoutUs_ = DEFAULT_TIMEOUT_US;
+  uint8_t trigPin_ = 0;
+  uint8_t echoPin_ = 0;
+  bool inFlight_ = false;
+};